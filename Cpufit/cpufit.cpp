@@ -2,8 +2,32 @@
 #include "interface.h"
 
 #include <string>
+#include <thread>
+#include <algorithm>
+#include <atomic>
 
-std::string last_error ;
+// the error of the last call of each thread, hence concurrent callers do not
+// overwrite their errors
+thread_local std::string last_error ;
+
+// number of threads used by cpufit, set by cpufit_set_number_of_threads
+std::atomic< int > n_threads( 1 ) ;
+
+// a number of threads of 0 selects one thread per CPU core
+int resolve_number_of_threads(int number_of_threads)
+{
+    if (number_of_threads < 0)
+    {
+        throw std::runtime_error("invalid number of threads");
+    }
+
+    if (number_of_threads == 0)
+    {
+        number_of_threads = int(std::thread::hardware_concurrency());
+    }
+
+    return (std::max)(number_of_threads, 1);
+}
 
 int cpufit
 (
@@ -24,8 +48,51 @@ int cpufit
     float * output_chi_squares,
     int * output_n_iterations
 )
+{
+    return cpufit_with_threads(
+        n_fits,
+        n_points,
+        data,
+        weights,
+        model_id,
+        initial_parameters,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info_size,
+        user_info,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        n_threads.load());
+}
+
+int cpufit_with_threads
+(
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    int number_of_threads
+)
 try
 {
+    int const n_fit_threads = resolve_number_of_threads(number_of_threads);
+
     __int32 n_points_32 = 0;
     if (n_points <= (unsigned int)(std::numeric_limits<__int32>::max()))
     {
@@ -53,7 +120,7 @@ try
         output_chi_squares,
         output_n_iterations);
 
-    fi.fit(model_id);
+    fi.fit(model_id, n_fit_threads);
 
     return STATUS_OK;
 }
@@ -70,6 +137,20 @@ catch (...)
     return STATUS_ERROR;
 }
 
+int cpufit_set_number_of_threads(int number_of_threads)
+try
+{
+    n_threads = resolve_number_of_threads(number_of_threads);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
 char const * cpufit_get_last_error()
 {
     return last_error.c_str();
@@ -47,6 +47,29 @@ int cpufit
     int * output_n_iterations
 ) ;
 
+int cpufit_with_threads
+(
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    int number_of_threads
+) ;
+
+int cpufit_set_number_of_threads(int number_of_threads) ;
+
 char const * cpufit_get_last_error() ;
 
 #ifdef __cplusplus
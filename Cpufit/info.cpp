@@ -8,7 +8,8 @@ Info::Info(void) :
     n_points_(0),
     model_id_(0),
     estimator_id_(0),
-    user_info_size_(0)
+    user_info_size_(0),
+    n_threads_(1)
 {
 }
 
@@ -21,6 +21,7 @@ public:
     int model_id_;
     int estimator_id_;
     std::size_t user_info_size_;
+    int n_threads_;
     
 private:
 };
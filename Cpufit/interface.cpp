@@ -53,7 +53,7 @@ void FitInterface::check_sizes()
     }
 }
 
-void FitInterface::configure_info(Info & info, int const model_id)
+void FitInterface::configure_info(Info & info, int const model_id, int const n_threads)
 {
     info.model_id_ = model_id;
     info.n_fits_ = n_fits_;
@@ -62,6 +62,7 @@ void FitInterface::configure_info(Info & info, int const model_id)
     info.estimator_id_ = estimator_id_;
     info.user_info_size_ = user_info_size_;
     info.n_parameters_ = n_parameters_;
+    info.n_threads_ = n_threads;
 
     info.set_number_of_parameters_to_fit(parameters_to_fit_);
 }
@@ -93,14 +94,14 @@ void FitInterface::set_number_of_parameters(int const model_id)
     }
 }
 
-void FitInterface::fit(int const model_id)
+void FitInterface::fit(int const model_id, int const n_threads)
 {
     set_number_of_parameters(model_id);
 
     check_sizes();
 
     Info info;
-    configure_info(info, model_id);
+    configure_info(info, model_id, n_threads);
 
     LMFit lmfit(
         data_,
@@ -25,12 +25,12 @@ public:
 
     virtual ~FitInterface();
 
-    void fit(int const model_id);
+    void fit(int const model_id, int const n_threads);
 
 private:
     void set_number_of_parameters(int const model_id);
     void check_sizes();
-    void configure_info(Info & info, int const model_id);
+    void configure_info(Info & info, int const model_id, int const n_threads);
 
 public:
 
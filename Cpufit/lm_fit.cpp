@@ -5,6 +5,8 @@
 #include <utility>
 #include <vector>
 #include <numeric>
+#include <exception>
+#include <thread>
 
 LMFit::LMFit(
     float const * const data,
@@ -34,13 +36,18 @@ LMFit::~LMFit()
 {
 }
 
-void LMFit::run(float const tolerance)
+void LMFit::run_fits(float const tolerance, std::atomic<std::size_t> & next_fit_index)
 {
-    for (std::size_t fit_index = 0; fit_index < info_.n_fits_; fit_index++)
+    LMFitWorkspace workspace(info_);
+
+    for (std::size_t fit_index = next_fit_index++;
+        fit_index < info_.n_fits_;
+        fit_index = next_fit_index++)
     {
         LMFitCPP gf_cpp(
             tolerance,
             fit_index,
+            workspace,
             data_ + fit_index*info_.n_points_,
             weights_ ? weights_ + fit_index*info_.n_points_ : 0,
             info_,
@@ -54,4 +61,53 @@ void LMFit::run(float const tolerance)
 
         gf_cpp.run();
     }
-}
\ No newline at end of file
+}
+
+void LMFit::run(float const tolerance)
+{
+    std::size_t const n_threads
+        = std::max(std::min(std::size_t(info_.n_threads_), info_.n_fits_), std::size_t(1));
+
+    // the fits are distributed dynamically to the threads, each of which
+    // reuses one workspace for all its fits
+    std::atomic<std::size_t> next_fit_index(0);
+
+    if (n_threads == 1)
+    {
+        run_fits(tolerance, next_fit_index);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> exceptions(n_threads);
+
+    for (std::size_t i = 0; i < n_threads; i++)
+    {
+        std::exception_ptr & exception = exceptions[i];
+        threads.push_back(std::thread(
+            [this, tolerance, &next_fit_index, &exception]()
+            {
+                try
+                {
+                    run_fits(tolerance, next_fit_index);
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                }
+            }));
+    }
+
+    for (std::size_t i = 0; i < n_threads; i++)
+    {
+        threads[i].join();
+    }
+
+    for (std::size_t i = 0; i < n_threads; i++)
+    {
+        if (exceptions[i])
+        {
+            std::rethrow_exception(exceptions[i]);
+        }
+    }
+}
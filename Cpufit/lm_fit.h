@@ -3,8 +3,34 @@
 
 #include "info.h"
 
+#include <atomic>
+#include <vector>
+
 class LMFitCPP;
 
+/*
+    The buffers used by LMFitCPP. Each thread allocates one workspace and
+    reuses it for all the fits it processes.
+*/
+
+struct LMFitWorkspace
+{
+    explicit LMFitWorkspace(Info const & info);
+
+    std::vector<float> curve_;
+    std::vector<float> derivatives_;
+    std::vector<float> hessian_;
+    std::vector<float> modified_hessian_;
+    std::vector<float> gradient_;
+    std::vector<float> delta_;
+    std::vector<float> prev_parameters_;
+    std::vector<float> point_weights_;
+    std::vector<float> residuals_;
+    std::vector<int> indxc_;
+    std::vector<int> indxr_;
+    std::vector<int> ipiv_;
+};
+
 class LMFit
 {
 public:
@@ -25,6 +51,9 @@ public:
     void run(float const tolerance);
         
 private:
+    void run_fits(float const tolerance, std::atomic<std::size_t> & next_fit_index);
+
+
     float const * const data_;
     float const * const weights_;
     float const * const initial_parameters_;
@@ -45,6 +74,7 @@ public:
     LMFitCPP(
         float const tolerance,
         std::size_t const fit_index,
+        LMFitWorkspace & workspace,
         float const * data,
         float const * weight,
         Info const & info,
@@ -73,18 +103,18 @@ private:
     void calc_values_gauss2delliptic(std::vector<float>& gaussian);
     void calc_derivatives_gauss2delliptic(std::vector<float> & derivatives);
 
-    void calc_values_gauss2drotated(std::vector<float>& gaussian);
-    void calc_derivatives_gauss2drotated(std::vector<float> & derivatives);
-
     void calc_values_gauss1d(std::vector<float>& gaussian);
     void calc_derivatives_gauss1d(std::vector<float> & derivatives);
 
-    void calc_values_cauchy2delliptic(std::vector<float>& cauchy);
-    void calc_derivatives_cauchy2delliptic(std::vector<float> & derivatives);
-
     void calc_values_linear1d(std::vector<float>& line);
     void calc_derivatives_linear1d(std::vector<float> & derivatives);
 
+    template< int N, typename MODEL >
+    void calc_curve_values_dual(
+        MODEL const & model,
+        std::vector<float>& curve,
+        std::vector<float>& derivatives);
+
     void calculate_hessian(std::vector<float> const & derivatives,
         std::vector<float> const & curve);
 
@@ -118,16 +148,21 @@ private:
     float * chi_square_;
     int * n_iterations_;
 
-    std::vector<float> prev_parameters_;
+    std::vector<float> & prev_parameters_;
     Info const & info_;
 
     float lambda_;
-    std::vector<float> curve_;
-    std::vector<float> derivatives_;
-    std::vector<float> hessian_;
-    std::vector<float> modified_hessian_;
-    std::vector<float> gradient_;
-    std::vector<float> delta_;
+    std::vector<float> & curve_;
+    std::vector<float> & derivatives_;
+    std::vector<float> & hessian_;
+    std::vector<float> & modified_hessian_;
+    std::vector<float> & gradient_;
+    std::vector<float> & delta_;
+    std::vector<int> & indxc_;
+    std::vector<int> & indxr_;
+    std::vector<int> & ipiv_;
+    std::vector<float> & point_weights_;
+    std::vector<float> & residuals_;
     float prev_chi_square_;
     float const tolerance_;
 
@@ -1,13 +1,31 @@
 #include "cpufit.h"
 #include "lm_fit.h"
+#include "vector_operations.h"
+#include "Gpufit/model_functions.h"
 
 #include <vector>
 #include <numeric>
 #include <algorithm>
 
+LMFitWorkspace::LMFitWorkspace(Info const & info) :
+    curve_(info.n_points_),
+    derivatives_(info.n_points_*info.n_parameters_),
+    hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
+    modified_hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
+    gradient_(info.n_parameters_to_fit_),
+    delta_(info.n_parameters_to_fit_),
+    prev_parameters_(info.n_parameters_),
+    point_weights_(info.n_points_),
+    residuals_(info.n_points_),
+    indxc_(info.n_parameters_to_fit_),
+    indxr_(info.n_parameters_to_fit_),
+    ipiv_(info.n_parameters_to_fit_)
+{}
+
 LMFitCPP::LMFitCPP(
     float const tolerance,
     std::size_t const fit_index,
+    LMFitWorkspace & workspace,
     float const * data,
     float const * weight,
     Info const & info,
@@ -27,15 +45,20 @@ LMFitCPP::LMFitCPP(
     converged_(false),
     info_(info),
     parameters_to_fit_(parameters_to_fit),
-    curve_(info.n_points_),
-    derivatives_(info.n_points_*info.n_parameters_),
-    hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
-    modified_hessian_(info.n_parameters_to_fit_*info.n_parameters_to_fit_),
-    gradient_(info.n_parameters_to_fit_),
-    delta_(info.n_parameters_to_fit_),
+    curve_(workspace.curve_),
+    derivatives_(workspace.derivatives_),
+    hessian_(workspace.hessian_),
+    modified_hessian_(workspace.modified_hessian_),
+    gradient_(workspace.gradient_),
+    delta_(workspace.delta_),
+    indxc_(workspace.indxc_),
+    indxr_(workspace.indxr_),
+    ipiv_(workspace.ipiv_),
+    point_weights_(workspace.point_weights_),
+    residuals_(workspace.residuals_),
     prev_chi_square_(0),
     lambda_(0.001f),
-    prev_parameters_(info.n_parameters_to_fit_),
+    prev_parameters_(workspace.prev_parameters_),
     user_info_(user_info),
     parameters_(output_parameters),
     state_(output_state),
@@ -98,44 +121,6 @@ void LMFitCPP::calc_derivatives_gauss2delliptic(
         }
 }
 
-void LMFitCPP::calc_derivatives_gauss2drotated(
-    std::vector<float> & derivatives)
-{
-    std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
-
-    float const amplitude = parameters_[0];
-    float const x0 = parameters_[1];
-    float const y0 = parameters_[2];
-    float const sig_x = parameters_[3];
-    float const sig_y = parameters_[4];
-    float const background = parameters_[5];
-    float const rot_sin = sin(parameters_[6]);
-    float const rot_cos = cos(parameters_[6]);
-
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            float const arga = ((x - x0) * rot_cos) - ((y - y0) * rot_sin);
-            float const argb = ((x - x0) * rot_sin) + ((y - y0) * rot_cos);
-            float const ex = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = ex;
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x]
-                = ex * (amplitude * rot_cos * arga / (sig_x*sig_x) + amplitude * rot_sin *argb / (sig_y*sig_y));
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x]
-                = ex * (-amplitude * rot_sin * arga / (sig_x*sig_x) + amplitude * rot_cos *argb / (sig_y*sig_y));
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * arga * arga / (sig_x*sig_x*sig_x);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * argb * argb / (sig_y*sig_y*sig_y);
-            derivatives[5 * info_.n_points_ + y*fit_size_x + x]
-                = 1;
-            derivatives[6 * info_.n_points_ + y*fit_size_x + x]
-                = ex * amplitude * arga * argb * (1.0f / (sig_x*sig_x) - 1.0f / (sig_y*sig_y));
-        }
-}
-
 void LMFitCPP::calc_derivatives_gauss1d(
     std::vector<float> & derivatives)
 {
@@ -151,40 +136,6 @@ void LMFitCPP::calc_derivatives_gauss1d(
     }
 }
 
-void LMFitCPP::calc_derivatives_cauchy2delliptic(
-    std::vector<float> & derivatives)
-{
-    std::size_t const  fit_size_x = std::size_t(std::sqrt(info_.n_points_));
-
-    for (std::size_t y = 0; y < fit_size_x; y++)
-        for (std::size_t x = 0; x < fit_size_x; x++)
-        {
-            float const argx =
-                ((parameters_[1] - x) / parameters_[3])
-                *((parameters_[1] - x) / parameters_[3]) + 1.f;
-            float const argy =
-                ((parameters_[2] - y) / parameters_[4])
-                *((parameters_[2] - y) / parameters_[4]) + 1.f;
-
-            derivatives[0 * info_.n_points_ + y*fit_size_x + x]
-                = 1.f / (argx*argy);
-            derivatives[1 * info_.n_points_ + y*fit_size_x + x] =
-                -2.f * parameters_[0] * (parameters_[1] - x)
-                / (parameters_[3] * parameters_[3] * argx*argx*argy);
-            derivatives[2 * info_.n_points_ + y*fit_size_x + x] =
-                -2.f * parameters_[0] * (parameters_[2] - y)
-                / (parameters_[4] * parameters_[4] * argy*argy*argx);
-            derivatives[3 * info_.n_points_ + y*fit_size_x + x] =
-                2.f * parameters_[0] * (parameters_[1] - x) * (parameters_[1] - x)
-                / (parameters_[3] * parameters_[3] * parameters_[3] * argx*argx*argy);
-            derivatives[4 * info_.n_points_ + y*fit_size_x + x] =
-                2.f * parameters_[0] * (parameters_[2] - y) * (parameters_[2] - y)
-                / (parameters_[4] * parameters_[4] * parameters_[4] * argy*argy*argx);
-            derivatives[5 * info_.n_points_ + y*fit_size_x + x]
-                = 1.f;
-        }
-}
-
 void LMFitCPP::calc_derivatives_linear1d(
     std::vector<float> & derivatives)
 {
@@ -212,27 +163,6 @@ void LMFitCPP::calc_derivatives_linear1d(
     }
 }
 
-void LMFitCPP::calc_values_cauchy2delliptic(std::vector<float>& cauchy)
-{
-    int const size_x = int(std::sqrt(float(info_.n_points_)));
-    int const size_y = size_x;
-
-    for (int iy = 0; iy < size_y; iy++)
-    {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            float const argx =
-                ((parameters_[1] - ix) / parameters_[3])
-                *((parameters_[1] - ix) / parameters_[3]) + 1.f;
-            float const argy =
-                ((parameters_[2] - iy) / parameters_[4])
-                *((parameters_[2] - iy) / parameters_[4]) + 1.f;
-
-            cauchy[iy*size_x + ix] = parameters_[0] / (argx * argy) + parameters_[5];
-        }
-    }
-}
-
 void LMFitCPP::calc_values_gauss2d(std::vector<float>& gaussian)
 {
     int const size_x = int(std::sqrt(float(info_.n_points_)));
@@ -269,37 +199,6 @@ void LMFitCPP::calc_values_gauss2delliptic(std::vector<float>& gaussian)
     }
 }
     
-void LMFitCPP::calc_values_gauss2drotated(std::vector<float>& gaussian)
-{
-    int const size_x = int(std::sqrt(float(info_.n_points_)));
-    int const size_y = size_x;
-
-    float amplitude = parameters_[0];
-    float background = parameters_[5];
-    float x0 = parameters_[1];
-    float y0 = parameters_[2];
-    float sig_x = parameters_[3];
-    float sig_y = parameters_[4];
-    float rot_sin = sin(parameters_[6]);
-    float rot_cos = cos(parameters_[6]);
-
-    for (int iy = 0; iy < size_y; iy++)
-    {
-        for (int ix = 0; ix < size_x; ix++)
-        {
-            int const pixel_index = iy*size_x + ix;
-
-            float arga = ((ix - x0) * rot_cos) - ((iy - y0) * rot_sin);
-            float argb = ((ix - x0) * rot_sin) + ((iy - y0) * rot_cos);
-
-            float ex
-                = exp((-0.5f) * (((arga / sig_x) * (arga / sig_x)) + ((argb / sig_y) * (argb / sig_y))));
-
-            gaussian[pixel_index] = amplitude * ex + background;
-        }
-    }
-}
-
 void LMFitCPP::calc_values_gauss1d(std::vector<float>& gaussian)
 {
     for (std::size_t ix = 0; ix < info_.n_points_; ix++)
@@ -335,6 +234,35 @@ void LMFitCPP::calc_values_linear1d(std::vector<float>& line)
     }
 }
 
+// the values and derivatives of the models shared with Gpufit, calculated by
+// automatic differentiation (see Gpufit/model_functions.h)
+template< int N, typename MODEL >
+void LMFitCPP::calc_curve_values_dual(
+    MODEL const & model,
+    std::vector<float>& curve,
+    std::vector<float>& derivatives)
+{
+    int const size_x = int(std::sqrt(float(info_.n_points_)));
+    int const size_y = size_x;
+
+    for (int iy = 0; iy < size_y; iy++)
+    {
+        for (int ix = 0; ix < size_x; ix++)
+        {
+            int const point_index = iy*size_x + ix;
+
+            calculate_dual< N >(
+                model,
+                parameters_,
+                float(ix),
+                float(iy),
+                &curve[point_index],
+                &derivatives[point_index],
+                int(info_.n_points_));
+        }
+    }
+}
+
 void LMFitCPP::calc_curve_values(std::vector<float>& curve, std::vector<float>& derivatives)
 {           
     if (info_.model_id_ == GAUSS_1D)
@@ -354,13 +282,11 @@ void LMFitCPP::calc_curve_values(std::vector<float>& curve, std::vector<float>&
     }
     else if (info_.model_id_ == GAUSS_2D_ROTATED)
     {
-        calc_values_gauss2drotated(curve);
-        calc_derivatives_gauss2drotated(derivatives);
+        calc_curve_values_dual< 7 >(Gauss2DRotated(), curve, derivatives);
     }
     else if (info_.model_id_ == CAUCHY_2D_ELLIPTIC)
     {
-        calc_values_cauchy2delliptic(curve);
-        calc_derivatives_cauchy2delliptic(derivatives);
+        calc_curve_values_dual< 6 >(Cauchy2DElliptic(), curve, derivatives);
     }
     else if (info_.model_id_ == LINEAR_1D)
     {
@@ -373,6 +299,21 @@ void LMFitCPP::calculate_hessian(
     std::vector<float> const & derivatives,
     std::vector<float> const & curve)
 {
+    // weights of the derivative products of the data points
+    bool const weighted = info_.estimator_id_ == MLE || weight_;
+    if (info_.estimator_id_ == LSE && weight_)
+    {
+        std::copy(weight_, weight_ + info_.n_points_, point_weights_.begin());
+    }
+    else if (info_.estimator_id_ == MLE)
+    {
+        for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
+        {
+            point_weights_[pixel_index]
+                = data_[pixel_index] / (curve[pixel_index] * curve[pixel_index]);
+        }
+    }
+
     for (int jp = 0, jhessian = 0; jp < info_.n_parameters_; jp++)
     {
         if (parameters_to_fit_[jp])
@@ -385,36 +326,13 @@ void LMFitCPP::calculate_hessian(
                         = ihessian * info_.n_parameters_to_fit_ + jhessian;
                     std::size_t const jihessian
                         = jhessian * info_.n_parameters_to_fit_ + ihessian;
-                    std::size_t const derivatives_index_i = ip*info_.n_points_;
-                    std::size_t const derivatives_index_j = jp*info_.n_points_;
-                    
-                    double sum = 0.0;
-                    for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
-                    {
-                        if (info_.estimator_id_ == LSE)
-                        {
-                            if (!weight_)
-                            {
-                                sum
-                                    += derivatives[derivatives_index_i + pixel_index]
-                                    * derivatives[derivatives_index_j + pixel_index];
-                            }
-                            else
-                            {
-                                sum
-                                    += derivatives[derivatives_index_i + pixel_index]
-                                    * derivatives[derivatives_index_j + pixel_index]
-                                    * weight_[pixel_index];
-                            }
-                        }
-                        else if (info_.estimator_id_ == MLE)
-                        {
-                            sum
-                                += data_[pixel_index] / (curve[pixel_index] * curve[pixel_index])
-                                * derivatives[derivatives_index_i + pixel_index]
-                                * derivatives[derivatives_index_j + pixel_index];
-                        }
-                    }
+                    float const * const derivatives_i = derivatives.data() + ip*info_.n_points_;
+                    float const * const derivatives_j = derivatives.data() + jp*info_.n_points_;
+
+                    double const sum = weighted
+                        ? weighted_dot_product(derivatives_i, derivatives_j, point_weights_.data(), info_.n_points_)
+                        : dot_product(derivatives_i, derivatives_j, info_.n_points_);
+
                     hessian_[ijhessian] = float(sum);
                     if (ijhessian != jihessian)
                     {
@@ -434,37 +352,26 @@ void LMFitCPP::calc_gradient(
     std::vector<float> const & derivatives,
     std::vector<float> const & curve)
 {
+    // the factors the derivatives are multiplied with at each data point
+    for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
+    {
+        if (info_.estimator_id_ == LSE)
+        {
+            float const deviant = data_[pixel_index] - curve[pixel_index];
+            residuals_[pixel_index] = weight_ ? deviant * weight_[pixel_index] : deviant;
+        }
+        else if (info_.estimator_id_ == MLE)
+        {
+            residuals_[pixel_index] = -(1 - data_[pixel_index] / curve[pixel_index]);
+        }
+    }
 
     for (int ip = 0, gradient_index = 0; ip < info_.n_parameters_; ip++)
     {
         if (parameters_to_fit_[ip])
         {
-            std::size_t const derivatives_index = ip*info_.n_points_;
-            double sum = 0.0;
-            for (std::size_t pixel_index = 0; pixel_index < info_.n_points_; pixel_index++)
-            {
-                float deviant = data_[pixel_index] - curve[pixel_index];
-
-                if (info_.estimator_id_ == LSE)
-                {
-                    if (!weight_)
-                    {
-                        sum
-                            += deviant * derivatives[derivatives_index + pixel_index];
-                    }
-                    else
-                    {
-                        sum
-                            += deviant * derivatives[derivatives_index + pixel_index] * weight_[pixel_index];
-                    }
-
-                }
-                else if (info_.estimator_id_ == MLE)
-                {
-                    sum
-                        += -derivatives[derivatives_index + pixel_index] * (1 - data_[pixel_index] / curve[pixel_index]);
-                }
-            }
+            float const * const derivatives_i = derivatives.data() + ip*info_.n_points_;
+            double const sum = dot_product(derivatives_i, residuals_.data(), info_.n_points_);
             gradient_[gradient_index] = float(sum);
             gradient_index++;
         }
@@ -543,9 +450,13 @@ void LMFitCPP::gauss_jordan()
     int icol, irow;
     float big, dum, pivinv;
 
-    std::vector<int> indxc(info_.n_parameters_to_fit_, 0);
-    std::vector<int> indxr(info_.n_parameters_to_fit_, 0);
-    std::vector<int> ipiv(info_.n_parameters_to_fit_, 0);
+    std::vector<int> & indxc = indxc_;
+    std::vector<int> & indxr = indxr_;
+    std::vector<int> & ipiv = ipiv_;
+
+    std::fill(indxc.begin(), indxc.end(), 0);
+    std::fill(indxr.begin(), indxr.end(), 0);
+    std::fill(ipiv.begin(), ipiv.end(), 0);
 
     for (int kp = 0; kp < info_.n_parameters_to_fit_; kp++)
     {
@@ -0,0 +1,140 @@
+#define BOOST_TEST_MODULE Cpufit
+
+#include "Cpufit/vector_operations.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef double (*DotProduct)(float const *, float const *, std::size_t);
+typedef double (*WeightedDotProduct)(float const *, float const *, float const *, std::size_t);
+
+struct Implementation
+{
+    char const * name;
+    DotProduct dot_product;
+    WeightedDotProduct weighted_dot_product;
+};
+
+// the summation of the plain C++ implementation
+double reference_dot_product(float const * a, float const * b, std::size_t n)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+double reference_weighted_dot_product(float const * a, float const * b, float const * w, std::size_t n)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i] * w[i];
+    }
+    return sum;
+}
+
+// the run time selected implementation and each implementation supported by
+// the CPU, which is known from the selected one
+std::vector< Implementation > available_implementations()
+{
+    std::string const instruction_set = vector_operations_instruction_set();
+
+    std::vector< Implementation > implementations;
+    implementations.push_back({ "selected", dot_product, weighted_dot_product });
+
+#ifdef CPUFIT_AVX512
+    if (instruction_set == "AVX-512")
+    {
+        implementations.push_back({ "AVX-512", dot_product_avx512, weighted_dot_product_avx512 });
+    }
+#endif
+#ifdef CPUFIT_AVX2
+    // CPUs with AVX-512 support AVX2 as well
+    if (instruction_set == "AVX-512" || instruction_set == "AVX2")
+    {
+        implementations.push_back({ "AVX2", dot_product_avx2, weighted_dot_product_avx2 });
+    }
+#endif
+
+    return implementations;
+}
+
+bool bit_identical(double const a, double const b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+BOOST_AUTO_TEST_CASE( Vector_Operations )
+{
+    /*
+        Calculates dot products of all lengths up to 100, covering the vector
+        loops and the remaining elements of each implementation, with each
+        implementation available on this CPU.
+        - Checks that the selected instruction set has a known name.
+        - Checks that the results are bit-identical to the plain C++
+          summation if all partial sums are exact.
+        - Checks that the results otherwise differ from it by the different
+          order of the double precision summation only.
+    */
+
+    std::string const instruction_set = vector_operations_instruction_set();
+    BOOST_TEST_MESSAGE( "instruction set: " << instruction_set );
+    BOOST_CHECK(
+        instruction_set == "AVX-512" || instruction_set == "AVX2"
+        || instruction_set == "NEON" || instruction_set == "scalar" );
+
+    std::vector< Implementation > const implementations = available_implementations();
+
+    std::mt19937 rng(0);
+    std::size_t const max_n = 100;
+
+    // multiples of 1/8 between -4 and 4, whose products and sums are exact
+    std::uniform_int_distribution< int > exact_distribution(-32, 32);
+    std::vector< float > a_exact(max_n), b_exact(max_n), w_exact(max_n);
+    for (std::size_t i = 0; i < max_n; i++)
+    {
+        a_exact[i] = float(exact_distribution(rng)) / 8.f;
+        b_exact[i] = float(exact_distribution(rng)) / 8.f;
+        w_exact[i] = float(exact_distribution(rng)) / 8.f;
+    }
+
+    std::uniform_real_distribution< float > distribution(-1.f, 1.f);
+    std::vector< float > a(max_n), b(max_n), w(max_n);
+    for (std::size_t i = 0; i < max_n; i++)
+    {
+        a[i] = distribution(rng);
+        b[i] = distribution(rng);
+        w[i] = distribution(rng);
+    }
+
+    for (Implementation const & implementation : implementations)
+    {
+        BOOST_TEST_MESSAGE( "implementation: " << implementation.name );
+
+        for (std::size_t n = 0; n <= max_n; n++)
+        {
+            BOOST_CHECK( bit_identical(
+                implementation.dot_product(a_exact.data(), b_exact.data(), n),
+                reference_dot_product(a_exact.data(), b_exact.data(), n)) );
+            BOOST_CHECK( bit_identical(
+                implementation.weighted_dot_product(a_exact.data(), b_exact.data(), w_exact.data(), n),
+                reference_weighted_dot_product(a_exact.data(), b_exact.data(), w_exact.data(), n)) );
+
+            // the sum of at most 100 products below 1 in magnitude
+            BOOST_CHECK( std::abs(
+                implementation.dot_product(a.data(), b.data(), n)
+                - reference_dot_product(a.data(), b.data(), n)) < 1e-13 );
+            BOOST_CHECK( std::abs(
+                implementation.weighted_dot_product(a.data(), b.data(), w.data(), n)
+                - reference_weighted_dot_product(a.data(), b.data(), w.data(), n)) < 1e-13 );
+        }
+    }
+}
@@ -0,0 +1,196 @@
+#include "vector_operations.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+double dot_product_scalar(float const * a, float const * b, std::size_t n)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+double weighted_dot_product_scalar(float const * a, float const * b, float const * w, std::size_t n)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        sum += a[i] * b[i] * w[i];
+    }
+    return sum;
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+double dot_product_neon(float const * a, float const * b, std::size_t n)
+{
+    float64x2_t sum_low = vdupq_n_f64(0.0);
+    float64x2_t sum_high = vdupq_n_f64(0.0);
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4_t const product = vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i));
+        sum_low = vaddq_f64(sum_low, vcvt_f64_f32(vget_low_f32(product)));
+        sum_high = vaddq_f64(sum_high, vcvt_high_f64_f32(product));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(sum_low, sum_high));
+    return sum + dot_product_scalar(a + i, b + i, n - i);
+}
+
+double weighted_dot_product_neon(float const * a, float const * b, float const * w, std::size_t n)
+{
+    float64x2_t sum_low = vdupq_n_f64(0.0);
+    float64x2_t sum_high = vdupq_n_f64(0.0);
+
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4_t const product
+            = vmulq_f32(vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)), vld1q_f32(w + i));
+        sum_low = vaddq_f64(sum_low, vcvt_f64_f32(vget_low_f32(product)));
+        sum_high = vaddq_f64(sum_high, vcvt_high_f64_f32(product));
+    }
+
+    double sum = vaddvq_f64(vaddq_f64(sum_low, sum_high));
+    return sum + weighted_dot_product_scalar(a + i, b + i, w + i, n - i);
+}
+#endif
+
+enum InstructionSet
+{
+    INSTRUCTION_SET_SCALAR,
+    INSTRUCTION_SET_NEON,
+    INSTRUCTION_SET_AVX2,
+    INSTRUCTION_SET_AVX512
+};
+
+#if defined(CPUFIT_AVX2) || defined(CPUFIT_AVX512)
+bool cpu_supports(InstructionSet const instruction_set)
+{
+#if defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 0);
+    if (registers[0] < 7)
+        return false;
+
+    // the operating system must save the AVX registers
+    __cpuid(registers, 1);
+    bool const osxsave = (registers[2] & (1 << 27)) != 0;
+    if (!osxsave)
+        return false;
+    unsigned long long const xcr0 = _xgetbv(0);
+
+    __cpuidex(registers, 7, 0);
+    bool const avx2 = (registers[1] & (1 << 5)) != 0;
+    bool const avx512f = (registers[1] & (1 << 16)) != 0;
+
+    if (instruction_set == INSTRUCTION_SET_AVX2)
+        return avx2 && (xcr0 & 0x6) == 0x6;
+    if (instruction_set == INSTRUCTION_SET_AVX512)
+        return avx512f && (xcr0 & 0xe6) == 0xe6;
+    return false;
+#else
+    __builtin_cpu_init();
+    if (instruction_set == INSTRUCTION_SET_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (instruction_set == INSTRUCTION_SET_AVX512)
+        return __builtin_cpu_supports("avx512f");
+    return false;
+#endif
+}
+#endif
+
+InstructionSet select_instruction_set()
+{
+#ifdef CPUFIT_AVX512
+    if (cpu_supports(INSTRUCTION_SET_AVX512))
+        return INSTRUCTION_SET_AVX512;
+#endif
+#ifdef CPUFIT_AVX2
+    if (cpu_supports(INSTRUCTION_SET_AVX2))
+        return INSTRUCTION_SET_AVX2;
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    return INSTRUCTION_SET_NEON;
+#else
+    return INSTRUCTION_SET_SCALAR;
+#endif
+}
+
+// the CPU is checked only once
+InstructionSet instruction_set()
+{
+    static InstructionSet const selected = select_instruction_set();
+    return selected;
+}
+
+}
+
+double dot_product(float const * a, float const * b, std::size_t n)
+{
+    switch (instruction_set())
+    {
+#ifdef CPUFIT_AVX512
+    case INSTRUCTION_SET_AVX512:
+        return dot_product_avx512(a, b, n);
+#endif
+#ifdef CPUFIT_AVX2
+    case INSTRUCTION_SET_AVX2:
+        return dot_product_avx2(a, b, n);
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    case INSTRUCTION_SET_NEON:
+        return dot_product_neon(a, b, n);
+#endif
+    default:
+        return dot_product_scalar(a, b, n);
+    }
+}
+
+double weighted_dot_product(float const * a, float const * b, float const * w, std::size_t n)
+{
+    switch (instruction_set())
+    {
+#ifdef CPUFIT_AVX512
+    case INSTRUCTION_SET_AVX512:
+        return weighted_dot_product_avx512(a, b, w, n);
+#endif
+#ifdef CPUFIT_AVX2
+    case INSTRUCTION_SET_AVX2:
+        return weighted_dot_product_avx2(a, b, w, n);
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    case INSTRUCTION_SET_NEON:
+        return weighted_dot_product_neon(a, b, w, n);
+#endif
+    default:
+        return weighted_dot_product_scalar(a, b, w, n);
+    }
+}
+
+char const * vector_operations_instruction_set()
+{
+    switch (instruction_set())
+    {
+    case INSTRUCTION_SET_AVX512:
+        return "AVX-512";
+    case INSTRUCTION_SET_AVX2:
+        return "AVX2";
+    case INSTRUCTION_SET_NEON:
+        return "NEON";
+    default:
+        return "scalar";
+    }
+}
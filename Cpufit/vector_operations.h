@@ -0,0 +1,36 @@
+#ifndef CPUFIT_VECTOR_OPERATIONS_H_INCLUDED
+#define CPUFIT_VECTOR_OPERATIONS_H_INCLUDED
+
+#include <cstddef>
+
+/*
+    Dot products used for the accumulation of the gradient vectors and the
+    hessian matrices. The products are calculated in single precision and
+    summed up in double precision. The implementation is selected at run time
+    depending on the instruction sets supported by the CPU (AVX-512, AVX2,
+    NEON, or plain C++). The implementations differ only by the order of
+    the double precision summation, their results are bit-identical if the
+    partial sums are exact.
+*/
+
+// sum of a[i] * b[i]
+double dot_product(float const * a, float const * b, std::size_t n);
+
+// sum of a[i] * b[i] * w[i]
+double weighted_dot_product(float const * a, float const * b, float const * w, std::size_t n);
+
+// name of the selected implementation
+char const * vector_operations_instruction_set();
+
+// implementations compiled with the corresponding instruction set enabled
+#ifdef CPUFIT_AVX2
+double dot_product_avx2(float const * a, float const * b, std::size_t n);
+double weighted_dot_product_avx2(float const * a, float const * b, float const * w, std::size_t n);
+#endif
+
+#ifdef CPUFIT_AVX512
+double dot_product_avx512(float const * a, float const * b, std::size_t n);
+double weighted_dot_product_avx512(float const * a, float const * b, float const * w, std::size_t n);
+#endif
+
+#endif
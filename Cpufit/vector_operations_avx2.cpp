@@ -0,0 +1,66 @@
+#include "vector_operations.h"
+
+#include <immintrin.h>
+
+// compiled with AVX2 enabled, called only if the CPU supports it
+
+namespace
+{
+
+// adds the eight single precision values to the two double precision sums
+inline void accumulate(__m256 const values, __m256d & sum_low, __m256d & sum_high)
+{
+    sum_low = _mm256_add_pd(sum_low, _mm256_cvtps_pd(_mm256_castps256_ps128(values)));
+    sum_high = _mm256_add_pd(sum_high, _mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)));
+}
+
+inline double horizontal_sum(__m256d const sum_low, __m256d const sum_high)
+{
+    __m256d const sum = _mm256_add_pd(sum_low, sum_high);
+    __m128d const pair = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+}
+
+}
+
+double dot_product_avx2(float const * a, float const * b, std::size_t n)
+{
+    __m256d sum_low = _mm256_setzero_pd();
+    __m256d sum_high = _mm256_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 const product = _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        accumulate(product, sum_low, sum_high);
+    }
+
+    double sum = horizontal_sum(sum_low, sum_high);
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+double weighted_dot_product_avx2(float const * a, float const * b, float const * w, std::size_t n)
+{
+    __m256d sum_low = _mm256_setzero_pd();
+    __m256d sum_high = _mm256_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 const product = _mm256_mul_ps(
+            _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)),
+            _mm256_loadu_ps(w + i));
+        accumulate(product, sum_low, sum_high);
+    }
+
+    double sum = horizontal_sum(sum_low, sum_high);
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i] * w[i];
+    }
+    return sum;
+}
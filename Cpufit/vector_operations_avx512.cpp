@@ -0,0 +1,73 @@
+#include "vector_operations.h"
+
+#include <immintrin.h>
+
+// compiled with AVX-512F enabled, called only if the CPU supports it
+
+namespace
+{
+
+// adds the sixteen single precision values to the two double precision sums,
+// the zero masking forms of the intrinsics avoid the uninitialized pass through
+// values of the unmasked forms in GCC 12
+inline void accumulate(__m512 const values, __m512d & sum_low, __m512d & sum_high)
+{
+    __m256 const low = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0x0F, _mm512_castps_pd(values), 0));
+    __m256 const high = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(0x0F, _mm512_castps_pd(values), 1));
+    sum_low = _mm512_add_pd(sum_low, _mm512_maskz_cvtps_pd(0xFF, low));
+    sum_high = _mm512_add_pd(sum_high, _mm512_maskz_cvtps_pd(0xFF, high));
+}
+
+// the sum of the eight double precision values, see accumulate
+inline double reduce_add(__m512d const values)
+{
+    __m256d const half = _mm256_add_pd(
+        _mm512_maskz_extractf64x4_pd(0x0F, values, 0),
+        _mm512_maskz_extractf64x4_pd(0x0F, values, 1));
+    __m128d const quarter = _mm_add_pd(_mm256_castpd256_pd128(half), _mm256_extractf128_pd(half, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(quarter, _mm_unpackhi_pd(quarter, quarter)));
+}
+
+}
+
+double dot_product_avx512(float const * a, float const * b, std::size_t n)
+{
+    __m512d sum_low = _mm512_setzero_pd();
+    __m512d sum_high = _mm512_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 const product = _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        accumulate(product, sum_low, sum_high);
+    }
+
+    double sum = reduce_add(_mm512_add_pd(sum_low, sum_high));
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+double weighted_dot_product_avx512(float const * a, float const * b, float const * w, std::size_t n)
+{
+    __m512d sum_low = _mm512_setzero_pd();
+    __m512d sum_high = _mm512_setzero_pd();
+
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512 const product = _mm512_mul_ps(
+            _mm512_mul_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)),
+            _mm512_loadu_ps(w + i));
+        accumulate(product, sum_low, sum_high);
+    }
+
+    double sum = reduce_add(_mm512_add_pd(sum_low, sum_high));
+    for (; i < n; i++)
+    {
+        sum += a[i] * b[i] * w[i];
+    }
+    return sum;
+}
@@ -0,0 +1,66 @@
+#include "autotune_cache.h"
+#include <cstdlib>
+#include <fstream>
+
+AutotuneCache & AutotuneCache::instance()
+{
+    static AutotuneCache cache;
+    return cache;
+}
+
+AutotuneCache::AutotuneCache()
+{
+    char const * const file_name = std::getenv("GPUFIT_AUTOTUNE_CACHE");
+
+    if (file_name)
+    {
+        file_name_ = file_name;
+        read_file();
+    }
+}
+
+void AutotuneCache::read_file()
+{
+    std::ifstream file(file_name_);
+    std::string line;
+
+    while (std::getline(file, line))
+    {
+        std::size_t const separator = line.rfind('\t');
+
+        if (separator == std::string::npos)
+            continue;
+
+        int const n_fits_per_block = std::atoi(line.c_str() + separator + 1);
+
+        if (n_fits_per_block > 0)
+            entries_[line.substr(0, separator)] = n_fits_per_block;
+    }
+}
+
+bool AutotuneCache::find(std::string const & key, int & n_fits_per_block)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    std::map< std::string, int >::const_iterator const entry = entries_.find(key);
+
+    if (entry == entries_.end())
+        return false;
+
+    n_fits_per_block = entry->second;
+    return true;
+}
+
+void AutotuneCache::insert(std::string const & key, int const n_fits_per_block)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    entries_[key] = n_fits_per_block;
+
+    // a cache file which cannot be written only disables the persistence
+    if (!file_name_.empty())
+    {
+        std::ofstream file(file_name_, std::ios::app);
+        file << key << '\t' << n_fits_per_block << '\n';
+    }
+}
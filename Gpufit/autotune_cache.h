@@ -0,0 +1,41 @@
+#ifndef GPUFIT_AUTOTUNE_CACHE_H_INCLUDED
+#define GPUFIT_AUTOTUNE_CACHE_H_INCLUDED
+
+#include <map>
+#include <mutex>
+#include <string>
+
+/* Description of the AutotuneCache class
+* =======================================
+*
+* The numbers of fits per thread block found by autotuning (OPTION_AUTOTUNE),
+* for a device and a fit problem described by a key string. The entries are
+* shared by all fit calls of the process. If the environment variable
+* GPUFIT_AUTOTUNE_CACHE names a file, the entries are read from this file when
+* the cache is used first, and new entries are appended to it, which makes
+* them available to later processes.
+*
+* File format: one entry per line, the key and the number of fits per block
+* separated by a tab character.
+*
+*/
+
+class AutotuneCache
+{
+public:
+    static AutotuneCache & instance();
+
+    bool find(std::string const & key, int & n_fits_per_block);
+    void insert(std::string const & key, int const n_fits_per_block);
+
+private:
+    AutotuneCache();
+
+    void read_file();
+
+    std::mutex mutex_;
+    std::map< std::string, int > entries_;
+    std::string file_name_;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef GPUFIT_CONSTRAINTS_CUH_INCLUDED
+#define GPUFIT_CONSTRAINTS_CUH_INCLUDED
+
+#include "gpufit.h"
+#include "constraints.h"
+
+/* Description of the apply_constraints function
+* ==============================================
+*
+* This function projects the value of a model parameter onto the bounds of the
+* parameter, see Constraints.
+*
+* Parameters:
+*
+* constraints: The constraints of the fit context.
+*
+* n_parameters: The number of model parameters.
+*
+* fit_index: The index of the fit within the complete set of fits of a fit call.
+*
+* parameter_index: The index of the model parameter.
+*
+* value: The value of the parameter after the step.
+*
+* Calling the apply_constraints function
+* ======================================
+*
+* This __device__ function can be only called from a __global__ function or an
+* other __device__ function.
+*
+*/
+
+__device__ __forceinline__ float apply_constraints(
+    Constraints const & constraints,
+    int const n_parameters,
+    int const fit_index,
+    int const parameter_index,
+    float const value)
+{
+    if (!constraints.types)
+    {
+        return value;
+    }
+
+    int const type = constraints.types[parameter_index];
+    int const set_index = constraints.n_sets == 1 ? 0 : fit_index;
+    float const * bounds = constraints.bounds + 2 * (std::size_t(set_index) * n_parameters + parameter_index);
+
+    float result = value;
+
+    if (type == CONSTRAINT_LOWER || type == CONSTRAINT_LOWER_UPPER)
+    {
+        result = fmaxf(result, bounds[0]);
+    }
+
+    if (type == CONSTRAINT_UPPER || type == CONSTRAINT_LOWER_UPPER)
+    {
+        result = fminf(result, bounds[1]);
+    }
+
+    return result;
+}
+
+#endif
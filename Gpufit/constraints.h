@@ -0,0 +1,32 @@
+#ifndef GPUFIT_CONSTRAINTS_H_INCLUDED
+#define GPUFIT_CONSTRAINTS_H_INCLUDED
+
+/* Description of the Constraints structure
+* =========================================
+*
+* The box constraints of the model parameters, passed to the kernels which
+* update the parameters. The constraints set by
+* gpufit_context_set_constraints() are kept in GPU memory by the fit context
+* (see ParameterConstraints), either a single set of bounds shared by all
+* fits or one set per fit. After each step, the parameters are projected onto
+* their bounds (see apply_constraints() in constraints.cuh).
+*
+* Without constraints, types is 0 and the parameters are not bounded.
+*
+*/
+
+struct Constraints
+{
+    // lower and upper bound of each parameter of each set, 2 * n_parameters
+    // values per set
+    float const * bounds;
+
+    // the constraint type of each parameter (CONSTRAINT_NONE, ...), or 0
+    int const * types;
+
+    // 1 if all fits share the bounds, otherwise the bounds of a fit are
+    // selected by the fit index
+    int n_sets;
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "gpufit.h"
+#include "context.h"
+
+FitContext::FitContext() :
+    profiler_(),
+    coordinate_grid_(),
+    parameter_constraints_(),
+    warm_start_(),
+    hybrid_scheduler_(),
+    gpu_data_(),
+    options_(),
+    device_contexts_()
+{
+    info_.profiler_ = &profiler_;
+    info_.warm_start_ = &warm_start_;
+}
+
+FitContext::~FitContext()
+{
+    release_gpu_data();
+}
+
+void FitContext::release_gpu_data()
+{
+    // the buffers are released on the device they were allocated on
+    if (!gpu_data_.empty()
+        || coordinate_grid_.is_allocated()
+        || parameter_constraints_.is_allocated()
+        || warm_start_.is_allocated())
+    {
+        cudaSetDevice(info_.device_);
+        gpu_data_.clear();
+        info_.allocated_gpu_memory_ = 0;
+        coordinate_grid_.release();
+        parameter_constraints_.release();
+        warm_start_.release();
+    }
+}
+
+std::vector< GPUData * > FitContext::get_gpu_data()
+{
+    bool sufficient = gpu_data_.size() == std::size_t(info_.n_streams_);
+    for (std::size_t i = 0; i < gpu_data_.size() && sufficient; i++)
+    {
+        sufficient = gpu_data_[i]->is_sufficient();
+    }
+
+    if (!sufficient)
+    {
+        // free the old buffers before allocating the new ones
+        gpu_data_.clear();
+        info_.allocated_gpu_memory_ = 0;
+        for (int i = 0; i < info_.n_streams_; i++)
+        {
+            gpu_data_.push_back(std::unique_ptr< GPUData >(new GPUData(info_)));
+        }
+        info_.allocated_gpu_memory_ = gpu_data_.size() * info_.get_buffer_memory();
+    }
+
+    std::vector< GPUData * > gpu_data;
+    for (std::size_t i = 0; i < gpu_data_.size(); i++)
+    {
+        gpu_data.push_back(gpu_data_[i].get());
+    }
+
+    return gpu_data;
+}
+
+std::vector< FitContext * > FitContext::get_device_contexts()
+{
+    std::size_t const n_devices = std::size_t(getDeviceCount());
+
+    if (device_contexts_.size() != n_devices)
+    {
+        device_contexts_.clear();
+        for (std::size_t i = 0; i < n_devices; i++)
+        {
+            std::unique_ptr< FitContext > device_context(new FitContext());
+            device_context->info_.set_device(int(i));
+            for (std::size_t j = 0; j < options_.size(); j++)
+            {
+                device_context->apply_option(options_[j].first, options_[j].second);
+            }
+            device_contexts_.push_back(std::move(device_context));
+        }
+    }
+
+    std::vector< FitContext * > device_contexts;
+    for (std::size_t i = 0; i < device_contexts_.size(); i++)
+    {
+        device_contexts.push_back(device_contexts_[i].get());
+    }
+
+    return device_contexts;
+}
+
+void FitContext::set_option(int const option_id, double const value)
+{
+    apply_option(option_id, value);
+
+    // the device selection applies to this fit context only
+    if (option_id == OPTION_DEVICE || option_id == OPTION_MULTI_DEVICE)
+    {
+        return;
+    }
+
+    std::size_t i_option = 0;
+    while (i_option < options_.size() && options_[i_option].first != option_id)
+    {
+        i_option++;
+    }
+    if (i_option < options_.size())
+    {
+        options_[i_option].second = value;
+    }
+    else
+    {
+        options_.push_back(std::make_pair(option_id, value));
+    }
+
+    for (std::size_t i = 0; i < device_contexts_.size(); i++)
+    {
+        device_contexts_[i]->apply_option(option_id, value);
+    }
+}
+
+void FitContext::apply_option(int const option_id, double const value)
+{
+    switch (option_id)
+    {
+    case OPTION_N_STREAMS:
+        if (value < 1 || value > 16 || value != int(value))
+        {
+            throw std::runtime_error("invalid number of streams");
+        }
+        info_.n_streams_ = int(value);
+        break;
+    case OPTION_CONVERGENCE_CHECK_INTERVAL:
+        if (value < 1 || value != int(value))
+        {
+            throw std::runtime_error("invalid convergence check interval");
+        }
+        info_.convergence_check_interval_ = int(value);
+        break;
+    case OPTION_FUSED_KERNEL:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid fused kernel option");
+        }
+        info_.fused_kernel_enabled_ = value != 0;
+        break;
+    case OPTION_ON_THE_FLY_HESSIANS:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid on the fly hessians option");
+        }
+        info_.on_the_fly_hessians_enabled_ = value != 0;
+        break;
+    case OPTION_SOLVER:
+        if (value != SOLVER_GAUSS_JORDAN && value != SOLVER_CHOLESKY && value != SOLVER_CUBLAS)
+        {
+            throw std::runtime_error("invalid solver ID");
+        }
+#ifndef USE_CUBLAS
+        if (value == SOLVER_CUBLAS)
+        {
+            throw std::runtime_error("cuBLAS solver not available, build with USE_CUBLAS");
+        }
+#endif
+        info_.solver_id_ = int(value);
+        break;
+    case OPTION_DEVICE:
+        if (value < 0 || value >= getDeviceCount() || value != int(value))
+        {
+            throw std::runtime_error("invalid device ID");
+        }
+        if (int(value) != info_.device_)
+        {
+            release_gpu_data();
+            info_.set_device(int(value));
+        }
+        break;
+    case OPTION_MULTI_DEVICE:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid multi device option");
+        }
+        info_.multi_device_ = value != 0;
+        break;
+    case OPTION_DATA_TYPE:
+        if (value != DATA_TYPE_FLOAT && value != DATA_TYPE_UINT16 && value != DATA_TYPE_HALF && value != DATA_TYPE_UINT8)
+        {
+            throw std::runtime_error("invalid data type ID");
+        }
+        info_.data_type_ = int(value);
+        break;
+    case OPTION_PRECISION:
+        if (value != PRECISION_MIXED && value != PRECISION_FLOAT && value != PRECISION_COMPENSATED && value != PRECISION_DOUBLE)
+        {
+            throw std::runtime_error("invalid precision ID");
+        }
+        info_.precision_id_ = int(value);
+        break;
+    case OPTION_AUTOTUNE:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid autotune option");
+        }
+        info_.autotune_ = value != 0;
+        break;
+    case OPTION_GPU_MEMORY_BUDGET:
+        if (!(value > 0))
+        {
+            throw std::runtime_error("invalid GPU memory budget");
+        }
+        info_.gpu_memory_budget_ = value;
+        break;
+    case OPTION_PROFILING:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid profiling option");
+        }
+        profiler_.enabled_ = value != 0;
+        break;
+    case OPTION_WARM_START:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid warm start option");
+        }
+        warm_start_.enabled_ = value != 0;
+        break;
+    case OPTION_DIRECT_LINEAR_FIT:
+        if (value != 0 && value != 1)
+        {
+            throw std::runtime_error("invalid direct linear fit option");
+        }
+        info_.direct_linear_fit_enabled_ = value != 0;
+        break;
+    case OPTION_CPU_THREADS:
+        if (value < 0 || value > 1024 || value != int(value))
+        {
+            throw std::runtime_error("invalid number of CPU threads");
+        }
+#ifndef USE_CPUFIT
+        if (value > 0)
+        {
+            throw std::runtime_error("Cpufit not available, build with USE_CPUFIT");
+        }
+#endif
+        hybrid_scheduler_.n_cpu_threads_ = int(value);
+        break;
+    default:
+        throw std::runtime_error("invalid option ID");
+    }
+}
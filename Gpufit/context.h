@@ -0,0 +1,59 @@
+#ifndef GPUFIT_CONTEXT_H_INCLUDED
+#define GPUFIT_CONTEXT_H_INCLUDED
+
+#include "info.h"
+#include "gpu_data.cuh"
+#include "profiler.h"
+#include "coordinate_grid.h"
+#include "parameter_constraints.h"
+#include "warm_start.cuh"
+#include "hybrid_scheduler.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+/*
+    A fit context keeps the configuration of the GPU and the GPU memory alive
+    between several consecutive fit calls. The device properties are queried
+    only once and the GPU memory is reallocated only if the memory requirements
+    of a fit call exceed the capacity of the memory allocated so far.
+
+    In multi-device mode the fit context holds one additional fit context for
+    each visible CUDA device, which are configured with the same options.
+    With OPTION_CPU_THREADS the fits are shared with Cpufit, and the measured
+    throughputs are kept by the hybrid scheduler of the fit context.
+*/
+
+class FitContext
+{
+public:
+    FitContext();
+    virtual ~FitContext();
+
+    std::vector< GPUData * > get_gpu_data();
+    std::vector< FitContext * > get_device_contexts();
+    void set_option(int const option_id, double const value);
+
+private:
+    void apply_option(int const option_id, double const value);
+    void release_gpu_data();
+
+public:
+    Info info_;
+    Profiler profiler_;
+    CoordinateGrid coordinate_grid_;
+    ParameterConstraints parameter_constraints_;
+    WarmStart warm_start_;
+    HybridScheduler hybrid_scheduler_;
+
+private:
+    // one set of GPU buffers for each stream
+    std::vector< std::unique_ptr< GPUData > > gpu_data_;
+
+    // options passed on to the fit contexts of the single devices
+    std::vector< std::pair< int, double > > options_;
+    std::vector< std::unique_ptr< FitContext > > device_contexts_;
+};
+
+#endif
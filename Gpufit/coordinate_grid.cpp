@@ -0,0 +1,75 @@
+#include "coordinate_grid.h"
+
+#include <cmath>
+
+CoordinateGrid::CoordinateGrid() :
+    n_points_(0),
+    n_grids_(0),
+    n_offsets_(0)
+{
+}
+
+void CoordinateGrid::set(
+    std::size_t const n_points,
+    std::size_t const n_grids,
+    float const * const x,
+    float const * const y,
+    std::size_t const n_offsets,
+    float const * const offsets)
+{
+    if ((x && (n_points == 0 || n_grids == 0)) || (y && !x) || (offsets && n_offsets == 0))
+    {
+        throw std::runtime_error("invalid coordinate grid");
+    }
+
+    n_points_ = x ? n_points : 0;
+    n_grids_ = x ? n_grids : 0;
+    n_offsets_ = offsets ? n_offsets : 0;
+
+    x_.assign(x, x ? x + n_grids_ * n_points_ : x);
+    y_.assign(y, y ? y + n_grids_ * n_points_ : y);
+    offsets_.assign(offsets, offsets ? offsets + 2 * n_offsets_ : offsets);
+}
+
+// takes over the grid of another fit context
+void CoordinateGrid::configure(CoordinateGrid const & grid)
+{
+    n_points_ = grid.n_points_;
+    n_grids_ = grid.n_grids_;
+    n_offsets_ = grid.n_offsets_;
+    x_.configure(grid.x_);
+    y_.configure(grid.y_);
+    offsets_.configure(grid.offsets_);
+}
+
+void CoordinateGrid::check(std::size_t const n_fits, int const n_points) const
+{
+    bool const grid_valid
+        = x_.empty()
+        || (n_points_ == std::size_t(n_points) && (n_grids_ == 1 || n_grids_ == n_fits));
+    bool const offsets_valid = offsets_.empty() || n_offsets_ == n_fits;
+
+    if (!grid_valid || !offsets_valid)
+    {
+        throw std::runtime_error("coordinate grid does not match the fits");
+    }
+}
+
+void CoordinateGrid::release()
+{
+    x_.release();
+    y_.release();
+    offsets_.release();
+}
+
+Coordinates CoordinateGrid::get_coordinates(int const n_points)
+{
+    Coordinates coordinates;
+    coordinates.x = x_.get_device_data();
+    coordinates.y = y_.get_device_data();
+    coordinates.offsets = offsets_.get_device_data();
+    coordinates.n_grids = int(n_grids_);
+    coordinates.n_points_x = int(std::sqrt(float(n_points)));
+
+    return coordinates;
+}
@@ -0,0 +1,46 @@
+#ifndef GPUFIT_COORDINATE_GRID_H_INCLUDED
+#define GPUFIT_COORDINATE_GRID_H_INCLUDED
+
+#include "coordinates.h"
+#include "device_mirror.h"
+
+/* Description of the CoordinateGrid class
+* ========================================
+*
+* The coordinate grid of a fit context (gpufit_context_set_coordinates()). The
+* coordinates and the offsets are mirrored to the device (see DeviceMirror).
+* In multi-device mode each device context holds a copy of the grid of the fit
+* context.
+*
+*/
+
+class CoordinateGrid
+{
+public:
+    CoordinateGrid();
+
+    void set(
+        std::size_t const n_points,
+        std::size_t const n_grids,
+        float const * x,
+        float const * y,
+        std::size_t const n_offsets,
+        float const * offsets);
+    void configure(CoordinateGrid const & grid);
+    void check(std::size_t const n_fits, int const n_points) const;
+    Coordinates get_coordinates(int const n_points);
+    void release();
+
+    bool is_allocated() const { return x_.is_allocated() || y_.is_allocated() || offsets_.is_allocated(); }
+    bool is_set() const { return !x_.empty() || !offsets_.empty(); }
+
+private:
+    std::size_t n_points_;
+    std::size_t n_grids_;
+    std::size_t n_offsets_;
+    DeviceMirror< float > x_;
+    DeviceMirror< float > y_;
+    DeviceMirror< float > offsets_;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef GPUFIT_COORDINATES_CUH_INCLUDED
+#define GPUFIT_COORDINATES_CUH_INCLUDED
+
+#include "coordinates.h"
+
+/* Description of the get_x_coordinate and get_xy_coordinates functions
+* =====================================================================
+*
+* These functions return the coordinates of a data point of a fit (see
+* Coordinates). The coordinate grid is read through the read-only data cache.
+*
+* Parameters:
+*
+* coordinates: The coordinate grid.
+*
+* n_points: The number of data points per fit.
+*
+* point_index: The data point index.
+*
+* fit_index: The index of the fit within the complete set of fits of a fit call.
+*
+* x, y: The output coordinates.
+*
+* Calling the functions
+* =====================
+*
+* These __device__ functions can be only called from a __global__ function or
+* an other __device__ function, usually by a model function.
+*
+*/
+
+__device__ __forceinline__ std::size_t get_coordinate_index(
+    Coordinates const & coordinates,
+    int const n_points,
+    int const point_index,
+    int const fit_index)
+{
+    return (coordinates.n_grids > 1 ? std::size_t(fit_index) * n_points : 0) + point_index;
+}
+
+__device__ __forceinline__ float get_x_coordinate(
+    Coordinates const & coordinates,
+    int const n_points,
+    int const point_index,
+    int const fit_index)
+{
+    float x = coordinates.x
+        ? __ldg(coordinates.x + get_coordinate_index(coordinates, n_points, point_index, fit_index))
+        : float(point_index);
+
+    if (coordinates.offsets)
+        x += __ldg(coordinates.offsets + 2 * fit_index);
+
+    return x;
+}
+
+__device__ __forceinline__ void get_xy_coordinates(
+    Coordinates const & coordinates,
+    int const n_points,
+    int const point_index,
+    int const fit_index,
+    float & x,
+    float & y)
+{
+    if (coordinates.x)
+    {
+        std::size_t const index = get_coordinate_index(coordinates, n_points, point_index, fit_index);
+        x = __ldg(coordinates.x + index);
+        y = coordinates.y ? __ldg(coordinates.y + index) : 0.f;
+    }
+    else
+    {
+        int const point_index_y = point_index / coordinates.n_points_x;
+        x = float(point_index - point_index_y * coordinates.n_points_x);
+        y = float(point_index_y);
+    }
+
+    if (coordinates.offsets)
+    {
+        x += __ldg(coordinates.offsets + 2 * fit_index);
+        y += __ldg(coordinates.offsets + 2 * fit_index + 1);
+    }
+}
+
+#endif
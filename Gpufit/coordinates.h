@@ -0,0 +1,39 @@
+#ifndef GPUFIT_COORDINATES_H_INCLUDED
+#define GPUFIT_COORDINATES_H_INCLUDED
+
+/* Description of the Coordinates structure
+* =========================================
+*
+* The coordinates of the data points, passed to the model functions. A
+* coordinate grid set by gpufit_context_set_coordinates() is kept in GPU
+* memory by the fit context (see CoordinateGrid), either a single grid shared
+* by all fits or one grid per fit. Optionally, the coordinates of each fit are
+* shifted by an x and a y offset.
+*
+* Without a grid, x is 0 and the coordinates of the data points are their
+* indices, for two-dimensional models on a square grid of n_points_x *
+* n_points_x data points. The model functions read the coordinates by
+* get_x_coordinate() or get_xy_coordinates() (see coordinates.cuh).
+*
+*/
+
+struct Coordinates
+{
+    // x and y coordinates of the n_points data points of each grid, y may be
+    // 0 for one-dimensional models
+    float const * x;
+    float const * y;
+
+    // x and y offset of each fit, or 0
+    float const * offsets;
+
+    // 1 if all fits share the grid, otherwise the grid of a fit is selected by
+    // the fit index
+    int n_grids;
+
+    // the width of the square grid of two-dimensional models without a
+    // coordinate grid
+    int n_points_x;
+};
+
+#endif
@@ -0,0 +1,373 @@
+#include "cuda_cholesky.cuh"
+#include "gpufit.h"
+#include "definitions.h"
+#include <math_constants.h>
+#include <device_launch_parameters.h>
+#include <algorithm>
+
+/* Description of the cuda_cholesky_kernel function
+* =================================================
+*
+* This function solves a set of equations using the Cholesky decomposition
+* alpha = L * L^T, followed by a forward and a backward substitution. It requires
+* symmetric positive definite matrices, which is the case for the damped hessian
+* matrices of the LM algorithm. Each equation system is solved by a single
+* thread. The number of equations is a template parameter, which allows the
+* decomposition to be stored in registers.
+*
+* Parameters:
+*
+* delta: An output vector of concatenated solution vectors.
+*
+* beta: An input vector of concatenated right hand side vectors.
+*
+* alpha: An input vector of concatenated coefficient matrices. Only the lower
+*        triangle of each matrix is used.
+*
+* skip_calculation: An input vector which allows the calculation to be skipped
+*                   for single solutions.
+*
+* singular: An output vector used to report whether a given matrix is not
+*           positive definite. For each solution, 1 indicates that the matrix
+*           is singular and 0 indicates that a solution was found.
+*
+* solution_indices: An input vector of the indices of the equation systems
+*                   which are solved, one for each thread.
+*
+* n_solutions: The number of elements in solution_indices.
+*
+* Calling the cuda_cholesky_kernel function
+* =========================================
+*
+* The kernel is launched by the host function cuda_cholesky, which selects the
+* template instance matching the number of equations.
+*
+*   int const example_value = 64;
+*
+*   threads.x = min(n_solutions, example_value);
+*   blocks.x = int(ceil(float(n_solutions) / float(threads.x)));
+*
+*   cuda_cholesky_kernel< N ><<< blocks, threads >>>(
+*       delta,
+*       beta,
+*       alpha,
+*       skip_calculation,
+*       singular,
+*       solution_indices,
+*       n_solutions);
+*
+*/
+
+// decomposes alpha = L * L^T, returns 1 if alpha is not positive definite
+template< int N >
+__device__ int cholesky_decompose(float (& l)[N][N], float const * alpha)
+{
+#pragma unroll
+    for (int i = 0; i < N; i++)
+    {
+#pragma unroll
+        for (int j = 0; j <= i; j++)
+        {
+            l[i][j] = alpha[i * N + j];
+        }
+    }
+
+    int is_singular = 0;
+
+#pragma unroll
+    for (int j = 0; j < N; j++)
+    {
+        float diagonal = l[j][j];
+#pragma unroll
+        for (int k = 0; k < j; k++)
+        {
+            diagonal -= l[j][k] * l[j][k];
+        }
+
+        if (!(diagonal > 0.f))
+        {
+            is_singular = 1;
+        }
+
+        diagonal = sqrtf(diagonal);
+        l[j][j] = diagonal;
+
+#pragma unroll
+        for (int i = j + 1; i < N; i++)
+        {
+            float sum = l[i][j];
+#pragma unroll
+            for (int k = 0; k < j; k++)
+            {
+                sum -= l[i][k] * l[j][k];
+            }
+            l[i][j] = sum / diagonal;
+        }
+    }
+
+    return is_singular;
+}
+
+// replaces the right hand side x by the solution of L * L^T * x = x, by a
+// forward and a backward substitution
+template< int N >
+__device__ void cholesky_substitute(float const (& l)[N][N], float (& x)[N])
+{
+#pragma unroll
+    for (int i = 0; i < N; i++)
+    {
+        float sum = x[i];
+#pragma unroll
+        for (int k = 0; k < i; k++)
+        {
+            sum -= l[i][k] * x[k];
+        }
+        x[i] = sum / l[i][i];
+    }
+
+#pragma unroll
+    for (int i = N - 1; i >= 0; i--)
+    {
+        float sum = x[i];
+#pragma unroll
+        for (int k = i + 1; k < N; k++)
+        {
+            sum -= l[k][i] * x[k];
+        }
+        x[i] = sum / l[i][i];
+    }
+}
+
+template< int N >
+__global__ void cuda_cholesky_kernel(
+    float * delta,
+    float const * beta,
+    float const * alpha,
+    int const * skip_calculation,
+    int * singular,
+    int const * solution_indices,
+    int const n_solutions)
+{
+    int const thread_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (thread_index >= n_solutions)
+        return;
+
+    int const solution_index = solution_indices[thread_index];
+
+    if (skip_calculation[solution_index])
+        return;
+
+    float const * current_alpha = &alpha[solution_index * N * N];
+    float const * current_beta = &beta[solution_index * N];
+    float * current_delta = &delta[solution_index * N];
+
+    float l[N][N];
+    float x[N];
+
+    int const is_singular = cholesky_decompose< N >(l, current_alpha);
+
+#pragma unroll
+    for (int i = 0; i < N; i++)
+    {
+        x[i] = current_beta[i];
+    }
+
+    cholesky_substitute< N >(l, x);
+
+#pragma unroll
+    for (int i = 0; i < N; i++)
+    {
+        current_delta[i] = x[i];
+    }
+
+    singular[solution_index] = is_singular;
+}
+
+template< int N >
+void launch_cholesky(
+    float * delta,
+    float const * beta,
+    float const * alpha,
+    int const * skip_calculation,
+    int * singular,
+    int const * solution_indices,
+    int const n_solutions,
+    cudaStream_t const stream)
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    threads.x = std::min(n_solutions, 64);
+    blocks.x = int(std::ceil(float(n_solutions) / float(threads.x)));
+
+    cuda_cholesky_kernel< N > <<< blocks, threads, 0, stream >>>(
+        delta,
+        beta,
+        alpha,
+        skip_calculation,
+        singular,
+        solution_indices,
+        n_solutions);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+}
+
+void cuda_cholesky(
+    float * delta,
+    float const * beta,
+    float const * alpha,
+    int const * skip_calculation,
+    int * singular,
+    int const * solution_indices,
+    int const n_equations,
+    int const n_solutions,
+    cudaStream_t const stream)
+{
+    switch (n_equations)
+    {
+    case 1: launch_cholesky< 1 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 2: launch_cholesky< 2 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 3: launch_cholesky< 3 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 4: launch_cholesky< 4 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 5: launch_cholesky< 5 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 6: launch_cholesky< 6 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 7: launch_cholesky< 7 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 8: launch_cholesky< 8 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 9: launch_cholesky< 9 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 10: launch_cholesky< 10 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 11: launch_cholesky< 11 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 12: launch_cholesky< 12 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 13: launch_cholesky< 13 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 14: launch_cholesky< 14 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 15: launch_cholesky< 15 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    case 16: launch_cholesky< 16 >(delta, beta, alpha, skip_calculation, singular, solution_indices, n_solutions, stream); break;
+    default:
+        throw std::runtime_error("too many parameters for the Cholesky solver");
+    }
+}
+
+/* Description of the cuda_cholesky_inverse_kernel function
+* =========================================================
+*
+* This function inverts the hessian of each fit at its final parameters, which
+* is the covariance matrix of the fitted parameters. The hessian is decomposed
+* once, and the columns of the inverse are found by the forward and backward
+* substitution of the unit vectors. The results are stored in the
+* uncertainties of all model parameters, the rows and columns of the parameters
+* which are not fitted are not set. The uncertainties of a fit whose hessian
+* is not positive definite are set to NaN.
+*
+* The kernel is launched by the host function cuda_cholesky_inverse, with one
+* thread for each fit.
+*
+*/
+
+template< int N >
+__global__ void cuda_cholesky_inverse_kernel(
+    float * uncertainties,
+    float const * alpha,
+    int const n_parameters,
+    int const * parameters_to_fit_indices,
+    int const uncertainty_type,
+    int const n_fits)
+{
+    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (fit_index >= n_fits)
+        return;
+
+    float l[N][N];
+    float x[N];
+
+    bool const singular = cholesky_decompose< N >(l, &alpha[fit_index * N * N]) != 0;
+
+#pragma unroll
+    for (int column = 0; column < N; column++)
+    {
+#pragma unroll
+        for (int i = 0; i < N; i++)
+        {
+            x[i] = i == column ? 1.f : 0.f;
+        }
+
+        cholesky_substitute< N >(l, x);
+
+        int const column_index = parameters_to_fit_indices[column];
+
+        if (uncertainty_type == UNCERTAINTY_STANDARD_DEVIATIONS)
+        {
+            // the square root of a negative variance is NaN as well
+            uncertainties[fit_index * n_parameters + column_index]
+                = singular ? CUDART_NAN_F : sqrtf(x[column]);
+            continue;
+        }
+
+        float * current_covariances = &uncertainties[fit_index * n_parameters * n_parameters];
+
+#pragma unroll
+        for (int row = 0; row < N; row++)
+        {
+            current_covariances[parameters_to_fit_indices[row] * n_parameters + column_index]
+                = singular ? CUDART_NAN_F : x[row];
+        }
+    }
+}
+
+template< int N >
+void launch_cholesky_inverse(
+    float * uncertainties,
+    float const * alpha,
+    int const n_parameters,
+    int const * parameters_to_fit_indices,
+    int const uncertainty_type,
+    int const n_fits,
+    cudaStream_t const stream)
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    threads.x = std::min(n_fits, 64);
+    blocks.x = int(std::ceil(float(n_fits) / float(threads.x)));
+
+    cuda_cholesky_inverse_kernel< N > <<< blocks, threads, 0, stream >>>(
+        uncertainties,
+        alpha,
+        n_parameters,
+        parameters_to_fit_indices,
+        uncertainty_type,
+        n_fits);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+}
+
+void cuda_cholesky_inverse(
+    float * uncertainties,
+    float const * alpha,
+    int const n_equations,
+    int const n_parameters,
+    int const * parameters_to_fit_indices,
+    int const uncertainty_type,
+    int const n_fits,
+    cudaStream_t const stream)
+{
+    switch (n_equations)
+    {
+    case 1: launch_cholesky_inverse< 1 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 2: launch_cholesky_inverse< 2 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 3: launch_cholesky_inverse< 3 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 4: launch_cholesky_inverse< 4 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 5: launch_cholesky_inverse< 5 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 6: launch_cholesky_inverse< 6 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 7: launch_cholesky_inverse< 7 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 8: launch_cholesky_inverse< 8 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 9: launch_cholesky_inverse< 9 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 10: launch_cholesky_inverse< 10 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 11: launch_cholesky_inverse< 11 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 12: launch_cholesky_inverse< 12 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 13: launch_cholesky_inverse< 13 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 14: launch_cholesky_inverse< 14 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 15: launch_cholesky_inverse< 15 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    case 16: launch_cholesky_inverse< 16 >(uncertainties, alpha, n_parameters, parameters_to_fit_indices, uncertainty_type, n_fits, stream); break;
+    default:
+        throw std::runtime_error("too many parameters for the Cholesky solver");
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef GPUFIT_CUDA_CHOLESKY_CUH_INCLUDED
+#define GPUFIT_CUDA_CHOLESKY_CUH_INCLUDED
+
+#include <cuda_runtime.h>
+
+// maximum number of equations supported by the Cholesky solver
+#define CHOLESKY_MAX_N_EQUATIONS 16
+
+extern void cuda_cholesky(
+    float * delta,
+    float const * beta,
+    float const * alpha,
+    int const * skip_calculation,
+    int * singular,
+    int const * solution_indices,
+    int const n_equations,
+    int const n_solutions,
+    cudaStream_t const stream);
+
+extern void cuda_cholesky_inverse(
+    float * uncertainties,
+    float const * alpha,
+    int const n_equations,
+    int const n_parameters,
+    int const * parameters_to_fit_indices,
+    int const uncertainty_type,
+    int const n_fits,
+    cudaStream_t const stream);
+
+#endif
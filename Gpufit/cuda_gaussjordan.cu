@@ -64,6 +64,9 @@
 *           a set of M inputs, this vector has size M.  Memory needs to be allocated
 *           by the calling the function.
 *
+* solution_indices: An input vector of the indices of the solutions calculated
+*                   by the thread blocks, one for each block.
+*
 * n_equations: The number of equations and unknowns for a single solution.  This is
 *              equal to the size N.
 *
@@ -95,6 +98,7 @@
 *       beta,
 *       skip_calculation,
 *       singular,
+*       solution_indices,
 *       n_equations,
 *       n_equations_pow2);
 *
@@ -108,6 +112,7 @@ __global__ void cuda_gaussjordan(
     float const * alpha,
     int const * skip_calculation,
     int * singular,
+    int const * solution_indices,
     std::size_t const n_equations,
     std::size_t const n_equations_pow2)
 {
@@ -134,7 +139,7 @@ __global__ void cuda_gaussjordan(
 
     int const col_index = threadIdx.x;                  //column index in the calculation_matrix
     int const row_index = threadIdx.y;                  //row index in the calculation_matrix
-    int const solution_index = blockIdx.x;
+    int const solution_index = solution_indices[blockIdx.x];
 
     int const n_col = blockDim.x;                       //number of columns in calculation matrix (=threads.x)
     int const n_row = blockDim.y;                       //number of rows in calculation matrix (=threads.y)
@@ -9,6 +9,7 @@ extern __global__ void cuda_gaussjordan(
     float const * alpha,
     int const * skip_calculation,
     int * singular,
+    int const * solution_indices,
     std::size_t const n_equations,
     std::size_t const n_equations_pow2);
 
@@ -1,22 +1,130 @@
 #include "gpufit.h"
 #include "cuda_kernels.cuh"
 #include "definitions.h"
-#include "linear_1d.cuh"
-#include "gauss_1d.cuh"
-#include "gauss_2d.cuh"
-#include "gauss_2d_elliptic.cuh"
-#include "gauss_2d_rotated.cuh"
-#include "cauchy_2d_elliptic.cuh"
-#include "lse.cuh"
-#include "mle.cuh"
+#include "models.cuh"
+#include "estimates.cuh"
+#include "estimators.cuh"
+#include "constraints.cuh"
+#include <math_constants.h>
+
+// the index of the fit calculated by a thread or a group of threads, or -1 if
+// there is no active fit left for it, see cuda_compact_active_fits
+__device__ __forceinline__ int get_fit_index(
+    int const * active_fits,
+    int const n_active_fits,
+    int const active_index)
+{
+    return active_index < n_active_fits ? active_fits[active_index] : -1;
+}
+
+/* Description of the cuda_estimate_initial_parameters function
+* ==============================================================
+*
+* This function estimates the initial parameters of each fit from its data
+* values, see estimates.cuh. It is called before the first iteration if no
+* initial parameters were passed to the fit call. Each thread estimates the
+* parameters of one fit.
+*
+* Parameters:
+*
+* parameters: An output vector of concatenated sets of model parameters.
+*
+* data: An input vector of concatenated sets of data points.
+*
+* weights: An input vector of concatenated sets of weights, or NULL.
+*
+* n_fits: The number of fits.
+*
+* n_points: The number of data points per fit.
+*
+* n_parameters: The number of model parameters.
+*
+* model_id: The fitting model ID.
+*
+* first_fit_index: The index of the first fit of the chunk within the complete
+*                  set of fits.
+*
+* coordinates: The coordinate grid of the data points.
+*
+* user_info: An input vector containing user information.
+*
+* user_info_size: The number of elements in user_info.
+*
+* Calling the cuda_estimate_initial_parameters function
+* =====================================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   int const example_value = 256;
+*
+*   threads.x = min(n_fits, example_value);
+*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*
+*   cuda_estimate_initial_parameters<<< blocks, threads >>>(
+*       parameters,
+*       data,
+*       weights,
+*       n_fits,
+*       n_points,
+*       n_parameters,
+*       model_id,
+*       first_fit_index,
+*       coordinates,
+*       user_info,
+*       user_info_size);
+*
+*/
+
+__global__ void cuda_estimate_initial_parameters(
+    float * parameters,
+    InputData const data,
+    float const * weights,
+    int const n_fits,
+    int const n_points,
+    int const n_parameters,
+    int const model_id,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (fit_index >= n_fits)
+        return;
+
+    std::size_t const first_point = std::size_t(fit_index) * n_points;
+
+    estimate_initial_parameters(
+        model_id,
+        parameters + fit_index * n_parameters,
+        data + first_point,
+        weights ? weights + first_point : 0,
+        n_points,
+        first_fit_index + fit_index,
+        user_info,
+        user_info_size,
+        coordinates);
+}
 
 /* Description of the cuda_calc_curve_values function
 * ===================================================
 *
 * This function calls one of the fitting curve functions depending on the input
-* parameter model_id. The fitting curve function calculates the values of
+* parameter model_id, see calculate_model. The fitting curve function calculates the values of
 * the fitting curves and its partial derivatives with respect to the fitting
-* curve parameters. Multiple fits are calculated in parallel.
+* curve parameters. Multiple fits are calculated in parallel. Each fit is
+* calculated by n_threads_per_fit threads, which loop over the data points if
+* the fit has more data points than threads.
+*
+* Template parameters:
+*
+* MODEL_ID: The model ID for which the kernel is specialized, or GENERIC_MODEL
+*           if the model_id parameter is used.
 *
 * Parameters:
 *
@@ -24,17 +132,31 @@
 *
 * n_fits: The number of fits.
 *
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
 * n_points: The number of data points per fit.
 *
 * n_parameters: The number of curve parameters.
 *
+* n_parameters_to_fit: The number of fitted curve parameters.
+*
+* parameters_to_fit_indices: An input vector of indices of fitted curve
+*                            parameters.
+*
 * finished: An input vector which allows the calculation to be skipped for single
 *           fits.
 *
 * values: An output vector of concatenated sets of model function values.
 *
 * derivatives: An output vector of concatenated sets of model function partial
-*              derivatives.
+*              derivatives with respect to the fitted parameters. The
+*              derivatives with respect to the i-th fitted parameter of a fit
+*              are stored in row i of its n_parameters_to_fit rows of n_points
+*              values, the derivatives with respect to fixed parameters are
+*              not stored.
 *
 * n_fits_per_block: The number of fits calculated by each threadblock.
 *
@@ -42,6 +164,13 @@
 *
 * chunk_index: The chunk index.
 *
+* first_fit_index: The index of the first fit of the chunk within the complete
+*                  set of fits. It is added to the fit index passed to the
+*                  model functions.
+*
+* coordinates: The coordinate grid of the data points, passed to the model
+*              functions.
+*
 * user_info: An input vector containing user information.
 *
 * user_info_size: The number of elements in user_info.
@@ -55,59 +184,89 @@
 *   dim3  threads(1, 1, 1);
 *   dim3  blocks(1, 1, 1);
 *
-*   threads.x = n_points * n_fits_per_block;
-*   blocks.x = n_fits / n_fits_per_block;
+*   threads.x = n_threads_per_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
 *
-*   cuda_calc_curve_values<<< blocks, threads >>>(
+*   cuda_calc_curve_values< MODEL_ID ><<< blocks, threads >>>(
 *       parameters,
+*       n_fits,
+*       active_fits,
+*       n_active_fits,
 *       n_points,
 *       n_parameters,
+*       n_parameters_to_fit,
+*       parameters_to_fit_indices,
 *       finished,
 *       values,
 *       derivatives,
 *       n_fits_per_block,
 *       model_id,
 *       chunk_index,
+*       first_fit_index,
+*       coordinates,
 *       user_info,
 *       user_info_size);
 *
 */
 
+template< int MODEL_ID >
 __global__ void cuda_calc_curve_values(
     float const * parameters,
     int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_points,
     int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
     int const * finished,
     float * values,
     float * derivatives,
     int const n_fits_per_block,
     int const model_id,
     int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
     char * user_info,
     std::size_t const user_info_size)
 {
-    int const fit_in_block = threadIdx.x / n_points;
-    int const point_index = threadIdx.x - fit_in_block * n_points;
-    int const fit_index = blockIdx.x * n_fits_per_block + fit_in_block;
+    int const n_threads_per_fit = blockDim.x / n_fits_per_block;
+    int const fit_in_block = threadIdx.x / n_threads_per_fit;
+    int const thread_index = threadIdx.x - fit_in_block * n_threads_per_fit;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+    int const n_model_parameters = select_n_parameters< MODEL_ID >(n_parameters);
 
-    if (finished[fit_index])
-        return;
-    if (point_index >= n_points)
+    if (fit_index < 0 || finished[fit_index])
         return;
 
-    if (model_id == GAUSS_1D)
-        calculate_gauss1d(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
-    else if (model_id == GAUSS_2D)
-        calculate_gauss2d(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
-    else if (model_id == GAUSS_2D_ELLIPTIC)
-        calculate_gauss2delliptic(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
-    else if (model_id == GAUSS_2D_ROTATED)
-        calculate_gauss2drotated(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
-    else if (model_id == CAUCHY_2D_ELLIPTIC)
-        calculate_cauchy2delliptic(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
-    else if (model_id == LINEAR_1D)
-        calculate_linear1d(parameters, n_fits, n_points, n_parameters, values, derivatives, chunk_index, user_info, user_info_size);
+    float * current_derivatives = &derivatives[fit_index * n_points * n_parameters_to_fit];
+
+    for (int point_index = thread_index; point_index < n_points; point_index += n_threads_per_fit)
+    {
+        float point_derivatives[PointDerivatives< MODEL_ID >::size];
+
+        calculate_model(
+            select_model_id< MODEL_ID >(model_id),
+            &parameters[fit_index * n_model_parameters],
+            n_fits,
+            n_points,
+            &values[fit_index * n_points],
+            point_derivatives,
+            point_index,
+            first_fit_index + fit_index,
+            chunk_index,
+            user_info,
+            user_info_size,
+            coordinates);
+
+        store_fitted_derivatives(
+            point_derivatives,
+            n_model_parameters,
+            n_parameters_to_fit,
+            parameters_to_fit_indices,
+            current_derivatives + point_index,
+            n_points);
+    }
 }
 
 /* Description of the sum_up_floats function
@@ -165,7 +324,18 @@ __device__ void sum_up_floats(volatile float* shared_array, int const size)
 * ========================================================
 *
 * This function calculates the chi-square values calling a __device__ function.
-* The calcluation is performed for multiple fits in parallel.
+* The calcluation is performed for multiple fits in parallel. Each fit is
+* calculated by n_threads_per_fit threads, a power of two. Each thread sums up
+* the summands of every n_threads_per_fit-th data point, and the sums of the
+* threads are summed up by sum_up, see precision.cuh.
+*
+* Template parameters:
+*
+* ESTIMATOR_ID: The estimator ID for which the kernel is specialized, or
+*               GENERIC_ESTIMATOR if the estimator_id parameter is used.
+*
+* PRECISION: The precision policy defining the types of the sums, see
+*            precision.cuh.
 *
 * Parameters:
 *
@@ -197,6 +367,11 @@ __device__ void sum_up_floats(volatile float* shared_array, int const size)
 * finished: An input vector which allows the calculation to be skipped for single
 *           fits.
 *
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
 * n_fits_per_block: The number of fits calculated by each thread block.
 *
 * user_info: An input vector containing user information.
@@ -212,10 +387,10 @@ __device__ void sum_up_floats(volatile float* shared_array, int const size)
 *   dim3  threads(1, 1, 1);
 *   dim3  blocks(1, 1, 1);
 *
-*   threads.x = power_of_two_n_points * n_fits_per_block;
-*   blocks.x = n_fits / n_fits_per_block;
+*   threads.x = n_threads_per_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
 *
-*   cuda_calculate_chi_squares<<< blocks, threads >>>(
+*   cuda_calculate_chi_squares< ESTIMATOR_ID, PRECISION ><<< blocks, threads >>>(
 *       chi_squares,
 *       states,
 *       iteration_falied,
@@ -226,82 +401,75 @@ __device__ void sum_up_floats(volatile float* shared_array, int const size)
 *       n_points,
 *       estimator_id,
 *       finished,
+*       active_fits,
+*       n_active_fits,
 *       n_fits_per_block,
 *       user_info,
 *       user_info_size);
 *
 */
 
+template< int ESTIMATOR_ID, typename PRECISION >
 __global__ void cuda_calculate_chi_squares(
     float * chi_squares,
     int * states,
     int * iteration_falied,
     float const * prev_chi_squares,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * weights,
     int const n_points,
     int const estimator_id,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block,
     char * user_info,
     std::size_t const user_info_size)
 {
     int const shared_size = blockDim.x / n_fits_per_block;
     int const fit_in_block = threadIdx.x / shared_size;
-    int const fit_index = blockIdx.x * n_fits_per_block + fit_in_block;
-    int const point_index = threadIdx.x - fit_in_block * shared_size;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+    int const thread_index = threadIdx.x - fit_in_block * shared_size;
     int const first_point = fit_index * n_points;
 
-    if (finished[fit_index])
+    if (fit_index < 0 || finished[fit_index])
     {
         return;
     }
 
-    float const * current_data = &data[first_point];
+    InputData const current_data = data + first_point;
     float const * current_weight = weights ? &weights[first_point] : NULL;
     float const * current_value  = &values[first_point];
     int * current_state = &states[fit_index];
 
-    extern __shared__ float extern_array[];
-    
-    volatile float * shared_chi_square = &extern_array[fit_in_block*shared_size];
-    
-    if (point_index >= n_points)
-    {
-        shared_chi_square[point_index] = 0.f;
-    }
+    typedef typename PRECISION::ChiSquareSum Sum;
 
-    if (point_index < n_points)
+    extern __shared__ double extern_double_array[];
+
+    Sum * shared_chi_square = reinterpret_cast< Sum * >(extern_double_array) + fit_in_block * shared_size;
+
+    int const estimator = select_estimator_id< ESTIMATOR_ID >(estimator_id);
+
+    Sum sum = Sum(0.f);
+
+    for (int point_index = thread_index; point_index < n_points; point_index += shared_size)
     {
-        if (estimator_id == LSE)
-        {
-            calculate_chi_square_lse(
-                shared_chi_square,
-                point_index,
-                current_data,
-                current_value,
-                current_weight,
-                current_state,
-                user_info,
-                user_info_size);
-        }
-        else if (estimator_id == MLE)
-        {
-            calculate_chi_square_mle(
-                shared_chi_square,
-                point_index,
-                current_data,
-                current_value,
-                current_weight,
-                current_state,
-                user_info,
-                user_info_size);
-        }
+        float summand = 0.f;
+
+        calculate_chi_square(
+            estimator,
+            &summand,
+            point_index,
+            current_data,
+            current_value,
+            current_weight,
+            current_state,
+            user_info,
+            user_info_size);
+        sum = sum + Sum(summand);
     }
-    sum_up_floats(shared_chi_square, shared_size);
-    chi_squares[fit_index] = shared_chi_square[0];
-
+    chi_squares[fit_index] = sum_up(sum, shared_chi_square, thread_index, shared_size);
 
     bool const prev_chi_squares_initialized = prev_chi_squares[fit_index] != 0;
     bool const chi_square_increased = (chi_squares[fit_index] >= prev_chi_squares[fit_index]);
@@ -321,6 +489,17 @@ __global__ void cuda_calculate_chi_squares(
 * This function calculates the gradient values of the chi-square function calling
 * a __device__ function. The calcluation is performed for multiple fits in parallel.
 *
+* Template parameters:
+*
+* MODEL_ID: The model ID for which the kernel is specialized, or GENERIC_MODEL
+*           if the model_id parameter is used.
+*
+* ESTIMATOR_ID: The estimator ID for which the kernel is specialized, or
+*               GENERIC_ESTIMATOR if the estimator_id parameter is used.
+*
+* PRECISION: The precision policy defining the types of the sums, see
+*            precision.cuh.
+*
 * Parameters:
 *
 * gradients: An output vector of concatenated sets of gradient vector values.
@@ -330,7 +509,8 @@ __global__ void cuda_calculate_chi_squares(
 * values: An input vector of concatenated sets of model function values.
 *
 * derivatives: An input vector of concatenated sets of model function partial
-*              derivatives.
+*              derivatives with respect to the fitted parameters, see
+*              cuda_calc_curve_values.
 *
 * weight: An input vector of values for weighting chi-square, gradient and hessian,
 *         while using LSE
@@ -352,6 +532,11 @@ __global__ void cuda_calculate_chi_squares(
 *
 * skip: An input vector which allows the calculation to be skipped for single fits.
 *
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
 * n_fits_per_block: The number of fits calculated by each thread block.
 *
 * user_info: An input vector containing user information.
@@ -367,10 +552,10 @@ __global__ void cuda_calculate_chi_squares(
 *   dim3  threads(1, 1, 1);
 *   dim3  blocks(1, 1, 1);
 *
-*   threads.x = power_of_two_n_points * n_fits_per_block;
-*   blocks.x = n_fits / n_fits_per_block;
+*   threads.x = n_threads_per_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
 *
-*   cuda_calculate_gradients<<< blocks, threads >>>(
+*   cuda_calculate_gradients< MODEL_ID, ESTIMATOR_ID, PRECISION ><<< blocks, threads >>>(
 *       gradients,
 *       data,
 *       values,
@@ -383,15 +568,18 @@ __global__ void cuda_calculate_chi_squares(
 *       estimator_id,
 *       finished,
 *       skip,
+*       active_fits,
+*       n_active_fits,
 *       n_fits_per_block,
 *       user_info,
 *       user_info_size);
 *
 */
 
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
 __global__ void cuda_calculate_gradients(
     float * gradients,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * derivatives,
     float const * weights,
@@ -402,70 +590,72 @@ __global__ void cuda_calculate_gradients(
     int const estimator_id,
     int const * finished,
     int const * skip,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block,
     char * user_info,
     std::size_t const user_info_size)
 {
     int const shared_size = blockDim.x / n_fits_per_block;
     int const fit_in_block = threadIdx.x / shared_size;
-    int const fit_index = blockIdx.x * n_fits_per_block + fit_in_block;
-    int const point_index = threadIdx.x - fit_in_block * shared_size;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+    int const thread_index = threadIdx.x - fit_in_block * shared_size;
     int const first_point = fit_index * n_points;
 
-    if (finished[fit_index] || skip[fit_index])
+    if (fit_index < 0 || finished[fit_index] || skip[fit_index])
     {
         return;
     }
 
-    float const * current_data = &data[first_point];
+    int const estimator = select_estimator_id< ESTIMATOR_ID >(estimator_id);
+    int const max_n_parameters_to_fit = select_n_parameters< MODEL_ID >(n_parameters_to_fit);
+
+    InputData const current_data = data + first_point;
     float const * current_weight = weights ? &weights[first_point] : NULL;
-    float const * current_derivative = &derivatives[first_point * n_parameters];
+    float const * current_derivative = &derivatives[first_point * n_parameters_to_fit];
     float const * current_value = &values[first_point];
 
-    extern __shared__ float extern_array[];
+    typedef typename PRECISION::GradientSum Sum;
 
-    volatile float * shared_gradient = &extern_array[fit_in_block * shared_size];
+    extern __shared__ double extern_double_array[];
 
-    if (point_index >= n_points)
-    {
-        shared_gradient[point_index] = 0.f;
-    }
+    Sum * shared_gradient = reinterpret_cast< Sum * >(extern_double_array) + fit_in_block * shared_size;
 
-    for (int parameter_index = 0; parameter_index < n_parameters_to_fit; parameter_index++)
+#pragma unroll
+    for (int parameter_index = 0; parameter_index < max_n_parameters_to_fit; parameter_index++)
     {
-        if (point_index < n_points)
+        if (parameter_index >= n_parameters_to_fit)
         {
-            int const derivative_index  = parameters_to_fit_indices[parameter_index] * n_points + point_index;
+            break;
+        }
 
-            if (estimator_id == LSE)
-            {
-                calculate_gradient_lse(
-                    shared_gradient,
-                    point_index,
-                    derivative_index,
-                    current_data,
-                    current_value,
-                    current_derivative,
-                    current_weight,
-                    user_info,
-                    user_info_size);
-            }
-            else if (estimator_id == MLE)
-            {
-                calculate_gradient_mle(
-                    shared_gradient,
-                    point_index,
-                    derivative_index,
-                    current_data,
-                    current_value,
-                    current_derivative,
-                    current_weight,
-                    user_info,
-                    user_info_size);
-            }
+        int const derivative_index = parameter_index * n_points;
+
+        Sum sum = Sum(0.f);
+
+        for (int point_index = thread_index; point_index < n_points; point_index += shared_size)
+        {
+            float summand = 0.f;
+
+            calculate_gradient(
+                estimator,
+                &summand,
+                point_index,
+                derivative_index + point_index,
+                current_data,
+                current_value,
+                current_derivative,
+                current_weight,
+                user_info,
+                user_info_size);
+            sum = sum + Sum(summand);
+        }
+        float const gradient = sum_up(sum, shared_gradient, thread_index, shared_size);
+
+        if (thread_index == 0)
+        {
+            gradients[fit_index * n_parameters_to_fit + parameter_index] = gradient;
         }
-        sum_up_floats(shared_gradient, shared_size);
-        gradients[fit_index * n_parameters_to_fit + parameter_index] = shared_gradient[0];
     }
 }
 
@@ -474,7 +664,21 @@ __global__ void cuda_calculate_gradients(
 *
 * This function calculates the hessian matrix values of the chi-square function
 * calling a __device__ functions. The calcluation is performed for multiple fits
-* in parallel.
+* in parallel. Each fit is calculated by n_threads_per_fit threads, a power of
+* two, which loop over the data points as in cuda_calculate_chi_squares. Since
+* the hessian matrix is symmetric, only its upper triangle is calculated and
+* mirrored.
+*
+* Template parameters:
+*
+* MODEL_ID: The model ID for which the kernel is specialized, or GENERIC_MODEL
+*           if the model_id parameter is used.
+*
+* ESTIMATOR_ID: The estimator ID for which the kernel is specialized, or
+*               GENERIC_ESTIMATOR if the estimator_id parameter is used.
+*
+* PRECISION: The precision policy defining the types of the sums, see
+*            precision.cuh.
 *
 * Parameters:
 *
@@ -485,7 +689,8 @@ __global__ void cuda_calculate_gradients(
 * values: An input vector of concatenated sets of model function values.
 *
 * derivatives: An input vector of concatenated sets of model function partial
-*              derivatives.
+*              derivatives with respect to the fitted parameters, see
+*              cuda_calc_curve_values.
 *
 * weight: An input vector of values for weighting chi-square, gradient and hessian,
 *         while using LSE
@@ -507,6 +712,13 @@ __global__ void cuda_calculate_gradients(
 * finished: An input vector which allows the calculation to be skipped for single
 *           fits.
 *
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
+* n_fits_per_block: The number of fits calculated by each threadblock.
+*
 * user_info: An input vector containing user information.
 *
 * user_info_size: The number of elements in user_info.
@@ -520,11 +732,15 @@ __global__ void cuda_calculate_gradients(
 *   dim3  threads(1, 1, 1);
 *   dim3  blocks(1, 1, 1);
 *
-*   threads.x = n_parameters_to_fit;
-*   threads.y = n_parameters_to_fit;
-*   blocks.x = n_fits;
+*   int const shared_size
+*       = sizeof(PRECISION::HessianSum)
+*       * n_threads_per_fit
+*       * n_fits_per_block;
 *
-*   cuda_calculate_hessians<<< blocks, threads >>>(
+*   threads.x = n_threads_per_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
+*
+*   cuda_calculate_hessians< MODEL_ID, ESTIMATOR_ID, PRECISION ><<< blocks, threads, shared_size >>>(
 *       hessians,
 *       data,
 *       values,
@@ -537,14 +753,18 @@ __global__ void cuda_calculate_gradients(
 *       estimator_id,
 *       skip,
 *       finished,
+*       active_fits,
+*       n_active_fits,
+*       n_fits_per_block,
 *       user_info,
 *       user_info_size);
 *
 */
 
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
 __global__ void cuda_calculate_hessians(
     float * hessians,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * derivatives,
     float const * weights,
@@ -555,123 +775,505 @@ __global__ void cuda_calculate_hessians(
     int const estimator_id,
     int const * skip,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_fits_per_block,
     char * user_info,
     std::size_t const user_info_size)
 {
-    int const fit_index = blockIdx.x;
+    int const shared_size = blockDim.x / n_fits_per_block;
+    int const fit_in_block = threadIdx.x / shared_size;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+    int const thread_index = threadIdx.x - fit_in_block * shared_size;
     int const first_point = fit_index * n_points;
 
-    int const parameter_index_i = threadIdx.x;
-    int const parameter_index_j = threadIdx.y;
-
-    if (finished[fit_index] || skip[fit_index])
+    if (fit_index < 0 || finished[fit_index] || skip[fit_index])
     {
         return;
     }
 
+    int const estimator = select_estimator_id< ESTIMATOR_ID >(estimator_id);
+    int const max_n_parameters_to_fit = select_n_parameters< MODEL_ID >(n_parameters_to_fit);
+
     float * current_hessian = &hessians[fit_index * n_parameters_to_fit * n_parameters_to_fit];
-    float const * current_data = &data[first_point];
+    InputData const current_data = data + first_point;
     float const * current_weight = weights ? &weights[first_point] : NULL;
-    float const * current_derivative = &derivatives[first_point*n_parameters];
+    float const * current_derivative = &derivatives[first_point * n_parameters_to_fit];
     float const * current_value = &values[first_point];
 
-    int const hessian_index_ij = parameter_index_i * n_parameters_to_fit + parameter_index_j;
-    int const derivative_index_i = parameters_to_fit_indices[parameter_index_i] * n_points;
-    int const derivative_index_j = parameters_to_fit_indices[parameter_index_j] * n_points;
+    typedef typename PRECISION::HessianSum Sum;
+
+    extern __shared__ double extern_double_array[];
+
+    Sum * shared_hessian = reinterpret_cast< Sum * >(extern_double_array) + fit_in_block * shared_size;
 
-    double sum = 0.0;
-    for (int point_index = 0; point_index < n_points; point_index++)
+#pragma unroll
+    for (int parameter_index_i = 0; parameter_index_i < max_n_parameters_to_fit; parameter_index_i++)
     {
-        if (estimator_id == LSE)
+        if (parameter_index_i >= n_parameters_to_fit)
         {
-            calculate_hessian_lse(
-                &sum,
-                point_index,
-                derivative_index_i + point_index,
-                derivative_index_j + point_index,
-                current_data,
-                current_value,
-                current_derivative,
-                current_weight,
-                user_info,
-                user_info_size);
+            break;
         }
-        else if (estimator_id == MLE)
+
+        int const derivative_index_i = parameter_index_i * n_points;
+
+#pragma unroll
+        for (int parameter_index_j = parameter_index_i; parameter_index_j < max_n_parameters_to_fit; parameter_index_j++)
         {
-            calculate_hessian_mle(
-                &sum,
-                point_index,
-                derivative_index_i + point_index,
-                derivative_index_j + point_index,
-                current_data,
-                current_value,
-                current_derivative,
-                current_weight,
-                user_info,
-                user_info_size);
+            if (parameter_index_j >= n_parameters_to_fit)
+            {
+                break;
+            }
+
+            int const derivative_index_j = parameter_index_j * n_points;
+
+            Sum sum = Sum(0.f);
+
+            for (int point_index = thread_index; point_index < n_points; point_index += shared_size)
+            {
+                double summand = 0.0;
+
+                calculate_hessian(
+                    estimator,
+                    &summand,
+                    point_index,
+                    derivative_index_i + point_index,
+                    derivative_index_j + point_index,
+                    current_data,
+                    current_value,
+                    current_derivative,
+                    current_weight,
+                    user_info,
+                    user_info_size);
+                sum = sum + Sum(summand);
+            }
+            float const hessian = sum_up(sum, shared_hessian, thread_index, shared_size);
+
+            if (thread_index == 0)
+            {
+                current_hessian[parameter_index_i * n_parameters_to_fit + parameter_index_j] = hessian;
+                current_hessian[parameter_index_j * n_parameters_to_fit + parameter_index_i] = hessian;
+            }
         }
     }
-    current_hessian[hessian_index_ij] = sum;
 }
 
-/* Description of the cuda_modify_step_widths function
-* ====================================================
+/* Description of the cuda_calc_curve_values_and_hessians function
+* ================================================================
 *
-* This function midifies the diagonal elements of the hessian matrices by multiplying
-* them by the factor (1+ lambda). This operation controls the step widths of the
-* iteration. If the last iteration failed, befor modifying the hessian, the diagonal
-* elements of the hessian are calculated back to represent unmodified values.
+* This function calculates the fitting curve values and derivatives and
+* accumulates the chi-square values, the gradients and the hessian matrices
+* directly from them. It replaces the sequence of cuda_calc_curve_values,
+* cuda_calculate_chi_squares, cuda_calculate_gradients and
+* cuda_calculate_hessians. The values and derivatives of each data point are
+* kept in shared memory and the sums over the data points are calculated by
+* sum_up, hence the values and the derivatives of all fits are never stored in
+* global memory. Since the hessian matrix is symmetric, only its upper triangle
+* is calculated and mirrored. Multiple fits are calculated in parallel. Each
+* data point is calculated by one thread, n_threads_per_fit must not be smaller
+* than n_points.
 *
-* hessians: An input and output vector of hessian matrices, which are modified by
-*           the lambda values.
+* Template parameters:
 *
-* lambdas: An input vector of values for modifying the hessians.
+* MODEL_ID: The model ID for which the kernel is specialized, or GENERIC_MODEL
+*           if the model_id parameter is used.
 *
-* n_parameters: The number of fitting curve parameters.
+* ESTIMATOR_ID: The estimator ID for which the kernel is specialized, or
+*               GENERIC_ESTIMATOR if the estimator_id parameter is used.
 *
-* iteration_falied: An input vector which indicates whether the previous iteration
-*                   failed.
+* PRECISION: The precision policy defining the types of the sums, see
+*            precision.cuh.
 *
-* finished: An input vector which allows the calculation to be skipped for single fits.
+* Parameters:
 *
-* n_fits_per_block: The number of fits calculated by each thread block.
+* chi_squares: An output vector of chi-square values for multiple fits.
 *
-* Calling the cuda_modify_step_widths function
-* ============================================
+* gradients: An output vector of concatenated sets of gradient vector values.
 *
-* When calling the function, the blocks and threads must be set up correctly,
-* as shown in the following example code.
+* hessians: An output vector of concatenated sets of hessian matrix values.
 *
-*   dim3  threads(1, 1, 1);
-*   dim3  blocks(1, 1, 1);
+* states: An output vector of values which indicate whether the fitting process
+*         was carreid out correctly or which problem occurred.
 *
-*   threads.x = n_parameters_to_fit * n_fits_per_block;
-*   blocks.x = n_fits / n_fits_per_block;
+* iteration_failed: An output vector of flags which indicate whether the
+*                   chi-square values increased. In this case the gradients and
+*                   hessians are not updated.
 *
-*   cuda_modify_step_width<<< blocks, threads >>>(
-*       hessians,
-*       lambdas,
-*       n_parameters,
-*       iteration_failed,
-*       finished,
-*       n_fits_per_block);
+* prev_chi_squares: An input vector of chi-square values for multiple fits
+*                   calculated in the previous iteration.
 *
-*/
-        
+* parameters: An input vector of concatenated sets of model parameters.
+*
+* data: An input vector of data for multiple fits
+*
+* weights: An input vector of values for weighting chi-square, gradient and hessian,
+*          while using LSE
+*
+* n_fits: The number of fits.
+*
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
+* n_points: The number of data points per fit.
+*
+* n_parameters: The number of curve parameters.
+*
+* n_parameters_to_fit: The number of curve parameters, that are not held fixed.
+*
+* parameters_to_fit_indices: An input vector of indices of fitted parameters.
+*
+* finished: An input vector which allows the calculation to be skipped for single
+*           fits.
+*
+* n_fits_per_block: The number of fits calculated by each threadblock.
+*
+* model_id: The fitting model ID.
+*
+* estimator_id: The estimator ID.
+*
+* chunk_index: The chunk index.
+*
+* first_fit_index: The index of the first fit of the chunk within the complete
+*                  set of fits. It is added to the fit index passed to the
+*                  model functions.
+*
+* coordinates: The coordinate grid of the data points, passed to the model
+*              functions.
+*
+* user_info: An input vector containing user information.
+*
+* user_info_size: The number of elements in user_info.
+*
+* Calling the cuda_calc_curve_values_and_hessians function
+* ========================================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   threads.x = n_threads_per_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
+*
+*   int const shared_size
+*       = (sizeof(float) * (n_parameters_to_fit + 1) + SumsSize< PRECISION >::maximum)
+*       * n_threads_per_fit
+*       * n_fits_per_block;
+*
+*   cuda_calc_curve_values_and_hessians< MODEL_ID, ESTIMATOR_ID, PRECISION ><<< blocks, threads, shared_size >>>(
+*       chi_squares,
+*       gradients,
+*       hessians,
+*       states,
+*       iteration_failed,
+*       prev_chi_squares,
+*       parameters,
+*       data,
+*       weights,
+*       n_fits,
+*       active_fits,
+*       n_active_fits,
+*       n_points,
+*       n_parameters,
+*       n_parameters_to_fit,
+*       parameters_to_fit_indices,
+*       finished,
+*       n_fits_per_block,
+*       model_id,
+*       estimator_id,
+*       chunk_index,
+*       first_fit_index,
+*       coordinates,
+*       user_info,
+*       user_info_size);
+*
+*/
+
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
+__global__ void cuda_calc_curve_values_and_hessians(
+    float * chi_squares,
+    float * gradients,
+    float * hessians,
+    int * states,
+    int * iteration_failed,
+    float const * prev_chi_squares,
+    float const * parameters,
+    InputData const data,
+    float const * weights,
+    int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const * finished,
+    int const n_fits_per_block,
+    int const model_id,
+    int const estimator_id,
+    int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const shared_size = blockDim.x / n_fits_per_block;
+    int const fit_in_block = threadIdx.x / shared_size;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+    int const point_index = threadIdx.x - fit_in_block * shared_size;
+    int const first_point = fit_index * n_points;
+
+    // the threads of inactive fits stay on the barriers of sum_up and
+    // contribute zero partial sums
+    bool const active_fit = fit_index >= 0 && !finished[fit_index];
+
+    int const estimator = select_estimator_id< ESTIMATOR_ID >(estimator_id);
+    int const max_n_parameters_to_fit = select_n_parameters< MODEL_ID >(n_parameters_to_fit);
+
+    InputData const current_data = data + first_point;
+    float const * current_weight = weights ? &weights[first_point] : NULL;
+    int * current_state = &states[fit_index];
+
+    typedef typename PRECISION::ChiSquareSum ChiSquareSum;
+    typedef typename PRECISION::GradientSum GradientSum;
+    typedef typename PRECISION::HessianSum HessianSum;
+
+    extern __shared__ double extern_double_array[];
+
+    // the sums of all threads of the block, followed by the values and
+    // derivatives of the fits
+    int const sums_offset = fit_in_block * shared_size;
+    ChiSquareSum * shared_chi_square = reinterpret_cast< ChiSquareSum * >(extern_double_array) + sums_offset;
+    GradientSum * shared_gradient = reinterpret_cast< GradientSum * >(extern_double_array) + sums_offset;
+    HessianSum * shared_hessian = reinterpret_cast< HessianSum * >(extern_double_array) + sums_offset;
+
+    float * current_value
+        = reinterpret_cast< float * >(reinterpret_cast< char * >(extern_double_array) + blockDim.x * SumsSize< PRECISION >::maximum)
+        + fit_in_block * shared_size * (n_parameters_to_fit + 1);
+    float * current_derivative = current_value + shared_size;
+
+    bool const valid_point = active_fit && point_index < n_points;
+
+    // values and derivatives, the derivatives with respect to the i-th fitted
+    // parameter are stored in row i of shared_size values
+    if (valid_point)
+    {
+        float point_derivatives[PointDerivatives< MODEL_ID >::size];
+
+        calculate_model(
+            select_model_id< MODEL_ID >(model_id),
+            &parameters[fit_index * n_parameters],
+            n_fits,
+            n_points,
+            current_value,
+            point_derivatives,
+            point_index,
+            first_fit_index + fit_index,
+            chunk_index,
+            user_info,
+            user_info_size,
+            coordinates);
+
+        store_fitted_derivatives(
+            point_derivatives,
+            select_n_parameters< MODEL_ID >(n_parameters),
+            n_parameters_to_fit,
+            parameters_to_fit_indices,
+            current_derivative + point_index,
+            shared_size);
+    }
+
+    // chi-square
+    float chi_square_summand = 0.f;
+
+    if (valid_point)
+    {
+        calculate_chi_square(
+            estimator,
+            &chi_square_summand,
+            point_index,
+            current_data,
+            current_value,
+            current_weight,
+            current_state,
+            user_info,
+            user_info_size);
+    }
+    float const chi_square = sum_up(ChiSquareSum(chi_square_summand), shared_chi_square, point_index, shared_size);
+
+    // the gradient and the hessian of a failed iteration are not needed, its
+    // threads sum up zeros
+    bool failed = false;
+
+    if (active_fit)
+    {
+        chi_squares[fit_index] = chi_square;
+
+        bool const prev_chi_squares_initialized = prev_chi_squares[fit_index] != 0;
+        bool const chi_square_increased = (chi_square >= prev_chi_squares[fit_index]);
+        failed = prev_chi_squares_initialized && chi_square_increased;
+        iteration_failed[fit_index] = failed ? 1 : 0;
+    }
+
+    bool const calculate_derivatives = valid_point && !failed;
+    bool const store_sums = active_fit && !failed && point_index == 0;
+
+    // gradient
+#pragma unroll
+    for (int parameter_index = 0; parameter_index < max_n_parameters_to_fit; parameter_index++)
+    {
+        if (parameter_index >= n_parameters_to_fit)
+        {
+            break;
+        }
+
+        int const derivative_index = parameter_index * shared_size + point_index;
+
+        float summand = 0.f;
+
+        if (calculate_derivatives)
+        {
+            calculate_gradient(
+                estimator,
+                &summand,
+                point_index,
+                derivative_index,
+                current_data,
+                current_value,
+                current_derivative,
+                current_weight,
+                user_info,
+                user_info_size);
+        }
+        float const gradient = sum_up(GradientSum(summand), shared_gradient, point_index, shared_size);
+
+        if (store_sums)
+        {
+            gradients[fit_index * n_parameters_to_fit + parameter_index] = gradient;
+        }
+    }
+
+    // hessian, upper triangle
+    float * current_hessian = &hessians[fit_index * n_parameters_to_fit * n_parameters_to_fit];
+
+#pragma unroll
+    for (int parameter_index_i = 0; parameter_index_i < max_n_parameters_to_fit; parameter_index_i++)
+    {
+        if (parameter_index_i >= n_parameters_to_fit)
+        {
+            break;
+        }
+
+        int const derivative_index_i = parameter_index_i * shared_size + point_index;
+
+#pragma unroll
+        for (int parameter_index_j = parameter_index_i; parameter_index_j < max_n_parameters_to_fit; parameter_index_j++)
+        {
+            if (parameter_index_j >= n_parameters_to_fit)
+            {
+                break;
+            }
+
+            int const derivative_index_j = parameter_index_j * shared_size + point_index;
+
+            double summand = 0.0;
+
+            if (calculate_derivatives)
+            {
+                calculate_hessian(
+                    estimator,
+                    &summand,
+                    point_index,
+                    derivative_index_i,
+                    derivative_index_j,
+                    current_data,
+                    current_value,
+                    current_derivative,
+                    current_weight,
+                    user_info,
+                    user_info_size);
+            }
+            float const hessian = sum_up(HessianSum(summand), shared_hessian, point_index, shared_size);
+
+            if (store_sums)
+            {
+                current_hessian[parameter_index_i * n_parameters_to_fit + parameter_index_j] = hessian;
+                current_hessian[parameter_index_j * n_parameters_to_fit + parameter_index_i] = hessian;
+            }
+        }
+    }
+}
+
+/* Description of the cuda_modify_step_widths function
+* ====================================================
+*
+* This function midifies the diagonal elements of the hessian matrices by multiplying
+* them by the factor (1+ lambda). This operation controls the step widths of the
+* iteration. If the last iteration failed, befor modifying the hessian, the diagonal
+* elements of the hessian are calculated back to represent unmodified values.
+*
+* hessians: An input and output vector of hessian matrices, which are modified by
+*           the lambda values.
+*
+* lambdas: An input vector of values for modifying the hessians.
+*
+* n_parameters: The number of fitting curve parameters.
+*
+* iteration_falied: An input vector which indicates whether the previous iteration
+*                   failed.
+*
+* finished: An input vector which allows the calculation to be skipped for single fits.
+*
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
+* n_fits_per_block: The number of fits calculated by each thread block.
+*
+* Calling the cuda_modify_step_widths function
+* ============================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   threads.x = n_parameters_to_fit * n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
+*
+*   cuda_modify_step_width<<< blocks, threads >>>(
+*       hessians,
+*       lambdas,
+*       n_parameters,
+*       iteration_failed,
+*       finished,
+*       active_fits,
+*       n_active_fits,
+*       n_fits_per_block);
+*
+*/
+        
 __global__ void cuda_modify_step_widths(
     float * hessians,
     float const * lambdas,
     unsigned int const n_parameters,
     int const * iteration_failed,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block)
 {
     int const shared_size = blockDim.x / n_fits_per_block;
     int const fit_in_block = threadIdx.x / shared_size;
     int const parameter_index = threadIdx.x - fit_in_block * shared_size;
-    int const fit_index = blockIdx.x * n_fits_per_block + fit_in_block;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
 
-    if (finished[fit_index])
+    if (fit_index < 0 || finished[fit_index])
     {
         return;
     }
@@ -710,8 +1312,20 @@ __global__ void cuda_modify_step_widths(
 *
 * finished: An input vector which allows the calculation to be skipped for single fits.
 *
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
+*
 * n_fits_per_block: The number of fits calculated by each threadblock.
 *
+* first_fit_index: The index of the first fit of the chunk within the complete
+*                  set of fits, which selects the bounds of per fit
+*                  constraints.
+*
+* constraints: The box constraints of the parameters. The updated parameters
+*              are projected onto their bounds.
+*
 * Calling the cuda_update_parameters function
 * ===========================================
 *
@@ -722,7 +1336,7 @@ __global__ void cuda_modify_step_widths(
 *   dim3  blocks(1, 1, 1);
 *
 *   threads.x = n_parameters * n_fits_per_block;
-*   blocks.x = n_fits / n_fits_per_block;
+*   blocks.x = (n_active_fits + n_fits_per_block - 1) / n_fits_per_block;
 *
 *   cuda_update_parameters<<< blocks, threads >>>(
 *       deltas,
@@ -730,7 +1344,11 @@ __global__ void cuda_modify_step_widths(
 *       n_parameters_to_fit,
 *       parameters_to_fit_indices,
 *       finished,
-*       n_fits_per_block);
+*       active_fits,
+*       n_active_fits,
+*       n_fits_per_block,
+*       first_fit_index,
+*       constraints);
 *
 */
     
@@ -741,12 +1359,21 @@ __global__ void cuda_update_parameters(
     int const n_parameters_to_fit,
     int const * parameters_to_fit_indices,
     int const * finished,
-    int const n_fits_per_block)
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_fits_per_block,
+    int const first_fit_index,
+    Constraints const constraints)
 {
     int const n_parameters = blockDim.x / n_fits_per_block;
     int const fit_in_block = threadIdx.x / n_parameters;
     int const parameter_index = threadIdx.x - fit_in_block * n_parameters;
-    int const fit_index = blockIdx.x * n_fits_per_block + fit_in_block;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * n_fits_per_block + fit_in_block);
+
+    if (fit_index < 0)
+    {
+        return;
+    }
 
     float * current_parameters = &parameters[fit_index * n_parameters];
     float * current_prev_parameters = &prev_parameters[fit_index * n_parameters];
@@ -765,25 +1392,39 @@ __global__ void cuda_update_parameters(
 
     float const * current_deltas = &deltas[fit_index * n_parameters_to_fit];
 
-    current_parameters[parameters_to_fit_indices[parameter_index]] += current_deltas[parameter_index];
+    int const updated_index = parameters_to_fit_indices[parameter_index];
+
+    current_parameters[updated_index] = apply_constraints(
+        constraints,
+        n_parameters,
+        first_fit_index + fit_index,
+        updated_index,
+        current_parameters[updated_index] + current_deltas[parameter_index]);
 }
 
 /* Description of the cuda_update_state_after_gaussjordan function
 * ================================================================
 *
-* This function interprets the singular flag vector of the Gauss Jordan function
+* This function interprets the singular flag vector of the equation solver
 * according to this LM implementation.
 *
 * Parameters:
 *
-* n_fits: The number of fits.
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
 *
-* singular_checks: An input vector used to report whether a fit is singular.  
+* n_active_fits: The number of elements in active_fits.
+*
+* singular_checks: An input vector used to report whether a fit is singular.
+*                  Any value other than 0 indicates a singular hessian matrix.
 *
 * states: An output vector of values which indicate whether the fitting process
 *         was carreid out correctly or which problem occurred. If a hessian
 *         matrix of a fit is singular, it is set to 2.
 *
+* finished: An input vector which allows the update to be skipped for single
+*           fits.
+*
 * Calling the cuda_update_state_after_gaussjordan function
 * ========================================================
 *
@@ -795,66 +1436,241 @@ __global__ void cuda_update_parameters(
 *
 *   int const example_value = 256;
 *
-*   threads.x = min(n_fits, example_value);
-*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*   threads.x = min(n_active_fits, example_value);
+*   blocks.x = int(ceil(float(n_active_fits) / float(threads.x)));
 *
 *   cuda_update_state_after_gaussjordan<<< blocks, threads >>>(
-*       n_fits,
+*       active_fits,
+*       n_active_fits,
 *       singular_checks,
-*       states);
+*       states,
+*       finished);
 *
 */
 
 
 __global__ void cuda_update_state_after_gaussjordan(
-    int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
     int const * singular_checks,
-    int * states)
+    int * states,
+    int const * finished)
 {
-    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * blockDim.x + threadIdx.x);
 
-    if (fit_index >= n_fits)
+    if (fit_index < 0)
+    {
+        return;
+    }
+
+    if (finished[fit_index])
     {
         return;
     }
 
-    if (singular_checks[fit_index] == 1)
+    if (singular_checks[fit_index] != 0)
     {
         states[fit_index] = STATE_SINGULAR_HESSIAN;
     }
 
 }
 
-/* Description of the cuda_check_for_convergence function
-* =======================================================
+/* Description of the cuda_set_unit_vectors function
+* ==================================================
 *
-* This function checks after each iteration whether the fits are converged or not.
-* It also checks whether the set maximum number of iterations is reached.
+* This function sets the right hand sides of the equation systems of all fits
+* to a unit vector. Solving the equation systems of the hessians for the unit
+* vector of each fitted parameter results in the columns of the inverse
+* hessians, see cuda_store_uncertainties.
 *
 * Parameters:
 *
-* finished: An input and output vector which allows the calculation to be skipped
-*           for single fits.
+* gradients: An output vector of concatenated right hand sides, the gradients
+*            of the fits.
 *
-* tolerance: The tolerance value for the convergence set by user.
+* n_parameters_to_fit: The number of fitted curve parameters.
 *
-* states: An output vector of values which indicate whether the fitting process
-*         was carreid out correctly or which problem occurred. If the maximum
-*         number of iterationsis reached without converging, it is set to 1. If
-*         the fit converged it keeps its initial value of 0.
+* column: The index of the element which is set to 1, all other elements are
+*         set to 0.
 *
-* chi_squares: An input vector of chi-square values for multiple fits. Used for the
-*             convergence check.
+* n_fits: The number of fits.
 *
-* prev_chi_squares: An input vector of chi-square values for multiple fits calculated
-*                  in the previous iteration. Used for the convergence check.
+* Calling the cuda_set_unit_vectors function
+* ==========================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   int const example_value = 256;
+*
+*   threads.x = min(n_fits, example_value);
+*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*
+*   cuda_set_unit_vectors<<< blocks, threads >>>(
+*       gradients,
+*       n_parameters_to_fit,
+*       column,
+*       n_fits);
+*
+*/
+
+__global__ void cuda_set_unit_vectors(
+    float * gradients,
+    int const n_parameters_to_fit,
+    int const column,
+    int const n_fits)
+{
+    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (fit_index >= n_fits)
+    {
+        return;
+    }
+
+    float * current_gradient = &gradients[fit_index * n_parameters_to_fit];
+
+    for (int parameter_index = 0; parameter_index < n_parameters_to_fit; parameter_index++)
+    {
+        current_gradient[parameter_index] = parameter_index == column ? 1.f : 0.f;
+    }
+}
+
+/* Description of the cuda_store_uncertainties function
+* =====================================================
+*
+* This function stores a column of the inverse hessian of each fit, which is
+* the solution of the equation system for a unit vector (see
+* cuda_set_unit_vectors), in the uncertainties. The inverse hessian at the
+* final parameters is the covariance matrix of the fitted parameters. The rows
+* and columns of the parameters which are not fitted are not set.
+*
+* Parameters:
+*
+* uncertainties: An output vector of the standard deviations of all model
+*                parameters of each fit, or of the covariance matrices of all
+*                model parameters of each fit.
+*
+* deltas: An input vector of the solutions of the equation systems.
+*
+* singular_checks: An input vector which reports whether the hessian of a fit
+*                  is singular. The uncertainties of a singular fit are set to
+*                  NaN.
+*
+* n_parameters: The number of curve parameters.
+*
+* n_parameters_to_fit: The number of fitted curve parameters.
+*
+* parameters_to_fit_indices: The indices of fitted curve parameters.
+*
+* column: The index of the fitted parameter whose unit vector was solved.
+*
+* uncertainty_type: UNCERTAINTY_STANDARD_DEVIATIONS or
+*                   UNCERTAINTY_COVARIANCES.
+*
+* n_fits: The number of fits.
+*
+* Calling the cuda_store_uncertainties function
+* =============================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   int const example_value = 256;
+*
+*   threads.x = min(n_fits, example_value);
+*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*
+*   cuda_store_uncertainties<<< blocks, threads >>>(
+*       uncertainties,
+*       deltas,
+*       singular_checks,
+*       n_parameters,
+*       n_parameters_to_fit,
+*       parameters_to_fit_indices,
+*       column,
+*       uncertainty_type,
+*       n_fits);
+*
+*/
+
+__global__ void cuda_store_uncertainties(
+    float * uncertainties,
+    float const * deltas,
+    int const * singular_checks,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const column,
+    int const uncertainty_type,
+    int const n_fits)
+{
+    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (fit_index >= n_fits)
+    {
+        return;
+    }
+
+    float const * current_deltas = &deltas[fit_index * n_parameters_to_fit];
+    bool const singular = singular_checks[fit_index] != 0;
+    int const column_index = parameters_to_fit_indices[column];
+
+    if (uncertainty_type == UNCERTAINTY_STANDARD_DEVIATIONS)
+    {
+        // the square root of a negative variance is NaN as well
+        uncertainties[fit_index * n_parameters + column_index]
+            = singular ? CUDART_NAN_F : sqrtf(current_deltas[column]);
+        return;
+    }
+
+    float * current_covariances = &uncertainties[fit_index * n_parameters * n_parameters];
+
+    for (int row = 0; row < n_parameters_to_fit; row++)
+    {
+        current_covariances[parameters_to_fit_indices[row] * n_parameters + column_index]
+            = singular ? CUDART_NAN_F : current_deltas[row];
+    }
+}
+
+/* Description of the cuda_check_for_convergence function
+* =======================================================
+*
+* This function checks after each iteration whether the fits are converged or not.
+* It also checks whether the set maximum number of iterations is reached.
+*
+* Parameters:
+*
+* finished: An input and output vector which allows the calculation to be skipped
+*           for single fits.
+*
+* tolerance: The tolerance value for the convergence set by user.
+*
+* states: An output vector of values which indicate whether the fitting process
+*         was carreid out correctly or which problem occurred. If the maximum
+*         number of iterationsis reached without converging, it is set to 1. If
+*         the fit converged it keeps its initial value of 0.
+*
+* chi_squares: An input vector of chi-square values for multiple fits. Used for the
+*             convergence check.
+*
+* prev_chi_squares: An input vector of chi-square values for multiple fits calculated
+*                  in the previous iteration. Used for the convergence check.
 *
 * iteration: The value of the current iteration. It is compared to the value
 *            of the maximum number of iteration set by user.
 *
 * max_n_iterations: The maximum number of iterations set by user.
 *
-* n_fits: The number of fits.
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
 *
 * Calling the cuda_check_for_convergence function
 * ===============================================
@@ -867,8 +1683,8 @@ __global__ void cuda_update_state_after_gaussjordan(
 *
 *   int const example_value = 256;
 *
-*   threads.x = min(n_fits, example_value);
-*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*   threads.x = min(n_active_fits, example_value);
+*   blocks.x = int(ceil(float(n_active_fits) / float(threads.x)));
 *
 *   cuda_check_for_convergence<<< blocks, threads >>>(
 *       finished,
@@ -878,7 +1694,8 @@ __global__ void cuda_update_state_after_gaussjordan(
 *       prev_chi_squares,
 *       iteration,
 *       max_n_iterations,
-*       n_fits);
+*       active_fits,
+*       n_active_fits);
 *
 */
 
@@ -890,11 +1707,12 @@ __global__ void cuda_check_for_convergence(
     float const * prev_chi_squares,
     int const iteration,
     int const max_n_iterations,
-    int const n_fits)
+    int const * active_fits,
+    int const n_active_fits)
 {
-    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * blockDim.x + threadIdx.x);
 
-    if (fit_index >= n_fits)
+    if (fit_index < 0)
     {
         return;
     }
@@ -924,12 +1742,9 @@ __global__ void cuda_check_for_convergence(
 * This function evaluates the current iteration.
 *   - It marks a fit as finished if a problem occured.
 *   - It saves the needed number of iterations if a fit finished.
-*   - It checks if all fits finished
 *
 * Parameters:
 *
-* all_finished: An output flag, that indicates whether all fits finished.
-*
 * n_iterations: An output vector of needed iterations for each fit.
 *
 * finished: An input and output  vector which allows the evaluation to be skipped
@@ -940,7 +1755,10 @@ __global__ void cuda_check_for_convergence(
 * states: An input vector of values which indicate whether the fitting process
 *         was carreid out correctly or which problem occurred.
 *
-* n_fits: The number of fits.
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
 *
 * Calling the cuda_evaluate_iteration function
 * ============================================
@@ -953,30 +1771,30 @@ __global__ void cuda_check_for_convergence(
 *
 *   int const example_value = 256;
 *
-*   threads.x = min(n_fits, example_value);
-*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*   threads.x = min(n_active_fits, example_value);
+*   blocks.x = int(ceil(float(n_active_fits) / float(threads.x)));
 *
 *   cuda_evaluate_iteration<<< blocks, threads >>>(
-*       all_finished,
 *       n_iterations,
 *       finished,
 *       iteration,
 *       states,
-*       n_fits)
+*       active_fits,
+*       n_active_fits)
 *
 */
 
 __global__ void cuda_evaluate_iteration(
-    int * all_finished,
     int * n_iterations,
     int * finished,
     int const iteration,
     int const * states,
-    int const n_fits)
+    int const * active_fits,
+    int const n_active_fits)
 {
-    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * blockDim.x + threadIdx.x);
 
-    if (fit_index >= n_fits)
+    if (fit_index < 0)
     {
         return;
     }
@@ -990,11 +1808,6 @@ __global__ void cuda_evaluate_iteration(
     {
         n_iterations[fit_index] = iteration + 1;
     }
-
-    if (!finished[fit_index])
-    {
-        * all_finished = 0;
-    }
 }
 
 /* Description of the cuda_prepare_next_iteration function
@@ -1019,7 +1832,17 @@ __global__ void cuda_evaluate_iteration(
 * prev_parameters: An input vector of concatenated sets of model parameters
 *                  calculated in the previous iteration.
 *
-* n_fits: The number of fits.
+* n_iterations: An input vector of the numbers of iterations of the finished
+*               fits, 0 for fits which did not finish. Fits which finished
+*               before the current iteration, but were not yet removed from the
+*               active fits, are skipped, hence their damping factors are kept.
+*
+* iteration: The index of the current iteration.
+*
+* active_fits: An input vector of the indices of the fits which are not finished,
+*              see cuda_compact_active_fits.
+*
+* n_active_fits: The number of elements in active_fits.
 *
 * n_parameters: The number of fitting curve parameters.
 *
@@ -1034,8 +1857,8 @@ __global__ void cuda_evaluate_iteration(
 *
 *   int const example_value = 256;
 *
-*   threads.x = min(n_fits, example_value);
-*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*   threads.x = min(n_active_fits, example_value);
+*   blocks.x = int(ceil(float(n_active_fits) / float(threads.x)));
 *
 *   cuda_prepare_next_iteration<<< blocks, threads >>>(
 *       lambdas,
@@ -1043,7 +1866,10 @@ __global__ void cuda_evaluate_iteration(
 *       prev_chi_squares,
 *       parameters,
 *       prev_parameters,
-*       n_fits,
+*       n_iterations,
+*       iteration,
+*       active_fits,
+*       n_active_fits,
 *       n_parameters);
 *
 */
@@ -1054,12 +1880,22 @@ __global__ void cuda_prepare_next_iteration(
     float * prev_chi_squares,
     float * parameters,
     float const * prev_parameters,
-    int const n_fits,
+    int const * n_iterations,
+    int const iteration,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_parameters)
 {
-    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * blockDim.x + threadIdx.x);
         
-    if (fit_index >= n_fits)
+    if (fit_index < 0)
+    {
+        return;
+    }
+
+    // the fits which finished in the current iteration take their last step
+    bool const finished_before = n_iterations[fit_index] > 0 && n_iterations[fit_index] <= iteration;
+    if (finished_before)
     {
         return;
     }
@@ -1079,3 +1915,824 @@ __global__ void cuda_prepare_next_iteration(
         }
     }
 }
+
+/* Description of the cuda_compact_active_fits function
+* ======================================================
+*
+* This function removes the finished fits from the list of active fits. The
+* kernels of later iterations are launched for the remaining active fits only.
+* The active fits of a warp are stored consecutively at a position reserved by
+* a single atomic operation, hence the order of the active fits is preserved
+* within each warp only.
+*
+* Parameters:
+*
+* compacted_fits: An output vector of the indices of the fits which are not
+*                 finished. It must not overlap active_fits.
+*
+* n_compacted_fits: An output value of the number of elements in
+*                   compacted_fits. It must be set to 0 before calling the
+*                   function.
+*
+* active_fits: An input vector of the indices of the active fits.
+*
+* finished: An input vector of flags which indicate whether a fit finished.
+*
+* n_active_fits: The number of elements in active_fits.
+*
+* Calling the cuda_compact_active_fits function
+* =============================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code. The number of threads per block
+* must be a multiple of the warp size.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   threads.x = 256;
+*   blocks.x = (n_active_fits + threads.x - 1) / threads.x;
+*
+*   cuda_compact_active_fits<<< blocks, threads >>>(
+*       compacted_fits,
+*       n_compacted_fits,
+*       active_fits,
+*       finished,
+*       n_active_fits);
+*
+*/
+
+__global__ void cuda_compact_active_fits(
+    int * compacted_fits,
+    int * n_compacted_fits,
+    int const * active_fits,
+    int const * finished,
+    int const n_active_fits)
+{
+    int const fit_index = get_fit_index(active_fits, n_active_fits, blockIdx.x * blockDim.x + threadIdx.x);
+    bool const active = fit_index >= 0 && !finished[fit_index];
+
+    // all threads of the warp take part in the vote
+    unsigned const active_mask = __ballot_sync(0xffffffffu, active);
+
+    if (active_mask == 0)
+    {
+        return;
+    }
+
+    int const lane = threadIdx.x % warpSize;
+    int const first_lane = __ffs(active_mask) - 1;
+
+    int first_index = 0;
+    if (lane == first_lane)
+    {
+        first_index = atomicAdd(n_compacted_fits, __popc(active_mask));
+    }
+    first_index = __shfl_sync(0xffffffffu, first_index, first_lane);
+
+    if (active)
+    {
+        compacted_fits[first_index + __popc(active_mask & ((1u << lane) - 1u))] = fit_index;
+    }
+}
+
+/* Description of the solve_equation_system_fused function
+* ========================================================
+*
+* This function solves the equation system alpha * delta = beta of a single fit
+* by Gauss-Jordan elimination, using all threads of the calling block. The
+* pivot of each row is its largest absolute value, like in cuda_gaussjordan.
+*
+* Parameters:
+*
+* delta: An output vector of the solution of the equation system.
+*
+* beta: An input vector of the right hand side of the equation system.
+*
+* alpha: An input matrix of the coefficients of the equation system.
+*
+* calculation_matrix: A shared memory area of n_equations * (n_equations + 1)
+*                     floats used for the elimination.
+*
+* pivot_columns: A shared memory area of n_equations integers.
+*
+* singular: A shared output flag, which is set to 1 if the equation system is
+*           singular.
+*
+* n_equations: The number of equations.
+*
+* Calling the solve_equation_system_fused function
+* ================================================
+*
+* This __device__ function can be only called from a __global__ function or an
+* other __device__ function. It must be called by all threads of a block.
+*
+*/
+
+__device__ void solve_equation_system_fused(
+    float * delta,
+    float const * beta,
+    float const * alpha,
+    float * calculation_matrix,
+    int * pivot_columns,
+    int * singular,
+    int const n_equations)
+{
+    int const n_col = n_equations + 1;
+
+    for (int index = threadIdx.x; index < n_equations * n_col; index += blockDim.x)
+    {
+        int const row_index = index / n_col;
+        int const col_index = index - row_index * n_col;
+
+        if (col_index != n_equations)
+            calculation_matrix[index] = alpha[row_index * n_equations + col_index];
+        else
+            calculation_matrix[index] = beta[row_index];
+    }
+
+    if (threadIdx.x == 0)
+    {
+        *singular = 0;
+    }
+
+    __syncthreads();
+
+    for (int current_row = 0; current_row < n_equations; current_row++)
+    {
+        float * pivot_row = &calculation_matrix[current_row * n_col];
+
+        // find the largest absolute value in the current row and divide the row
+        // by this value
+        if (threadIdx.x == 0)
+        {
+            int pivot_column = 0;
+            for (int col_index = 1; col_index < n_equations; col_index++)
+            {
+                if (abs(pivot_row[pivot_column]) < abs(pivot_row[col_index]))
+                {
+                    pivot_column = col_index;
+                }
+            }
+
+            if (pivot_row[pivot_column] == 0.f)
+            {
+                *singular = 1;
+            }
+
+            float const pivot = pivot_row[pivot_column];
+            for (int col_index = 0; col_index < n_col; col_index++)
+            {
+                pivot_row[col_index] = pivot_row[col_index] / pivot;
+            }
+
+            pivot_columns[current_row] = pivot_column;
+        }
+
+        __syncthreads();
+
+        // reduce all other entries in the pivot column to zero, each thread
+        // handles complete rows
+        int const pivot_column = pivot_columns[current_row];
+
+        for (int row_index = threadIdx.x; row_index < n_equations; row_index += blockDim.x)
+        {
+            if (row_index == current_row)
+            {
+                continue;
+            }
+
+            float * row = &calculation_matrix[row_index * n_col];
+            float const factor = row[pivot_column];
+
+            for (int col_index = 0; col_index < n_col; col_index++)
+            {
+                row[col_index] = row[col_index] - pivot_row[col_index] * factor;
+            }
+        }
+
+        __syncthreads();
+    }
+
+    // the rows were not swapped, the pivot columns give the order of the
+    // solution vector
+    for (int row_index = threadIdx.x; row_index < n_equations; row_index += blockDim.x)
+    {
+        delta[pivot_columns[row_index]] = calculation_matrix[row_index * n_col + n_equations];
+    }
+
+    __syncthreads();
+}
+
+/* Description of the calculate_chi_square_fused function
+* =======================================================
+*
+* This function calculates the chi-square value of a single fit using all
+* threads of the calling block and checks whether it increased with respect
+* to the previous iteration.
+*
+* Parameters:
+*
+* chi_square: A shared output value of the chi-square value.
+*
+* iteration_failed: A shared output flag, which is set to 1 if the chi-square
+*                   value did not decrease.
+*
+* state: A shared output value of the fit state.
+*
+* shared_sum: A shared memory area of blockDim.x floats.
+*
+* prev_chi_square: The chi-square value of the previous iteration.
+*
+* The remaining parameters are the same as for cuda_calculate_chi_squares.
+*
+*/
+
+__device__ void calculate_chi_square_fused(
+    float * chi_square,
+    int * iteration_failed,
+    int * state,
+    volatile float * shared_sum,
+    float const prev_chi_square,
+    InputData const data,
+    float const * value,
+    float const * weight,
+    int const n_points,
+    int const estimator_id,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const point_index = threadIdx.x;
+
+    float summand = 0.f;
+
+    if (point_index < n_points)
+    {
+        calculate_chi_square(estimator_id, &summand, point_index, data, value, weight, state, user_info, user_info_size);
+    }
+
+    shared_sum[point_index] = summand;
+    sum_up_floats(shared_sum, blockDim.x);
+
+    if (point_index == 0)
+    {
+        *chi_square = shared_sum[0];
+
+        bool const prev_chi_square_initialized = prev_chi_square != 0;
+        bool const chi_square_increased = *chi_square >= prev_chi_square;
+        *iteration_failed = prev_chi_square_initialized && chi_square_increased;
+    }
+
+    __syncthreads();
+}
+
+/* Description of the calculate_gradient_hessian_fused function
+* =============================================================
+*
+* This function calculates the gradient vector and the hessian matrix of a
+* single fit using all threads of the calling block. Since the hessian matrix
+* is symmetric, only its upper triangle is calculated and mirrored.
+*
+* Parameters:
+*
+* gradient: A shared output vector of the gradient.
+*
+* hessian: A shared output matrix of the hessian.
+*
+* shared_sum: A shared memory area of blockDim.x floats.
+*
+* The remaining parameters are the same as for cuda_calculate_gradients and
+* cuda_calculate_hessians.
+*
+*/
+
+__device__ void calculate_gradient_hessian_fused(
+    float * gradient,
+    float * hessian,
+    volatile float * shared_sum,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    int const n_points,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const estimator_id,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const point_index = threadIdx.x;
+
+    for (int parameter_index = 0; parameter_index < n_parameters_to_fit; parameter_index++)
+    {
+        int const derivative_index = parameter_index * n_points + point_index;
+
+        float summand = 0.f;
+
+        if (point_index < n_points)
+        {
+            calculate_gradient(estimator_id, &summand, point_index, derivative_index, data, value, derivative, weight, user_info, user_info_size);
+        }
+
+        shared_sum[point_index] = summand;
+        sum_up_floats(shared_sum, blockDim.x);
+
+        if (point_index == 0)
+        {
+            gradient[parameter_index] = shared_sum[0];
+        }
+
+        __syncthreads();
+    }
+
+    int const n_elements = n_parameters_to_fit * n_parameters_to_fit;
+
+    for (int element_index = threadIdx.x; element_index < n_elements; element_index += blockDim.x)
+    {
+        int const parameter_index_i = element_index / n_parameters_to_fit;
+        int const parameter_index_j = element_index - parameter_index_i * n_parameters_to_fit;
+
+        if (parameter_index_j < parameter_index_i)
+        {
+            continue;
+        }
+
+        int const derivative_index_i = parameter_index_i * n_points;
+        int const derivative_index_j = parameter_index_j * n_points;
+
+        double sum = 0.0;
+        for (int point_index = 0; point_index < n_points; point_index++)
+        {
+            calculate_hessian(
+                estimator_id,
+                &sum,
+                point_index,
+                derivative_index_i + point_index,
+                derivative_index_j + point_index,
+                data,
+                value,
+                derivative,
+                weight,
+                user_info,
+                user_info_size);
+        }
+        hessian[parameter_index_i * n_parameters_to_fit + parameter_index_j] = float(sum);
+        hessian[parameter_index_j * n_parameters_to_fit + parameter_index_i] = float(sum);
+    }
+
+    __syncthreads();
+}
+
+// the values and the derivatives with respect to the fitted parameters of a
+// data point, stored in rows of n_points values in shared memory
+__device__ void calculate_model_fused(
+    int const model_id,
+    float const * parameters,
+    int const n_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    float * values,
+    float * derivatives,
+    int const point_index,
+    int const fit_index,
+    int const chunk_index,
+    char * user_info,
+    std::size_t const user_info_size,
+    Coordinates const & coordinates)
+{
+    float point_derivatives[PointDerivatives< GENERIC_MODEL >::size];
+
+    calculate_model(model_id, parameters, n_fits, n_points, values, point_derivatives,
+        point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+
+    store_fitted_derivatives(point_derivatives, n_parameters, n_parameters_to_fit, parameters_to_fit_indices,
+        derivatives + point_index, n_points);
+}
+
+/* Description of the cuda_fit_fused function
+* ===========================================
+*
+* This function performs the complete Levenberg-Marquardt fit of small fitting
+* problems in a single kernel. Each fit is calculated by one thread block. The
+* model function values and derivatives, the gradient, the hessian matrix and
+* the equation system are kept in shared memory during all iterations, and only
+* the final results are written to global memory. The calculation steps of each
+* iteration are the same as in the sequence of kernels launched by LMFitCUDA.
+*
+* Parameters:
+*
+* parameters: An input and output vector of concatenated sets of model
+*             parameters. It holds the initial parameters on input and the
+*             fitted parameters on output.
+*
+* states: An output vector of the fit states.
+*
+* chi_squares: An output vector of the final chi-square values.
+*
+* n_iterations: An output vector of the number of iterations of each fit.
+*
+* lambdas: An input and output vector of the damping factors of the fits. It
+*          holds the initial damping factors on input and the final damping
+*          factors on output.
+*
+* data: An input vector of concatenated sets of data points.
+*
+* weights: An input vector of concatenated sets of weights, or NULL.
+*
+* n_fits: The number of fits.
+*
+* n_points: The number of data points per fit.
+*
+* n_parameters: The number of model parameters.
+*
+* n_parameters_to_fit: The number of model parameters that are not held fixed.
+*
+* parameters_to_fit_indices: An input vector of indices of fitted parameters.
+*
+* model_id: The fitting model ID.
+*
+* estimator_id: The estimator ID.
+*
+* tolerance: The tolerance value for the convergence set by user.
+*
+* max_n_iterations: The maximum number of iterations set by user.
+*
+* chunk_index: The chunk index.
+*
+* first_fit_index: The index of the first fit of the chunk within the complete
+*                  set of fits. It is added to the fit index passed to the
+*                  model functions.
+*
+* coordinates: The coordinate grid of the data points, passed to the model
+*              functions.
+*
+* constraints: The box constraints of the parameters, see
+*              cuda_update_parameters.
+*
+* user_info: An input vector containing user information.
+*
+* user_info_size: The number of elements in user_info.
+*
+* Calling the cuda_fit_fused function
+* ===================================
+*
+* When calling the function, the blocks and threads must be set up correctly,
+* as shown in the following example code. The number of threads must be a
+* power of two not smaller than n_points.
+*
+*   dim3  threads(1, 1, 1);
+*   dim3  blocks(1, 1, 1);
+*
+*   threads.x = n_threads_per_fit;
+*   blocks.x = n_fits;
+*
+*   int const shared_size
+*       = sizeof(float)
+*       * (n_points * (n_parameters_to_fit + 1)
+*       + threads.x
+*       + 2 * n_parameters
+*       + n_parameters_to_fit * (2 * n_parameters_to_fit + 3))
+*       + sizeof(int) * n_parameters_to_fit;
+*
+*   cuda_fit_fused<<< blocks, threads, shared_size >>>(
+*       parameters,
+*       states,
+*       chi_squares,
+*       n_iterations,
+*       lambdas,
+*       data,
+*       weights,
+*       n_fits,
+*       n_points,
+*       n_parameters,
+*       n_parameters_to_fit,
+*       parameters_to_fit_indices,
+*       model_id,
+*       estimator_id,
+*       tolerance,
+*       max_n_iterations,
+*       chunk_index,
+*       first_fit_index,
+*       coordinates,
+*       constraints,
+*       user_info,
+*       user_info_size);
+*
+*/
+
+__global__ void cuda_fit_fused(
+    float * parameters,
+    int * states,
+    float * chi_squares,
+    int * n_iterations,
+    float * lambdas,
+    InputData const data,
+    float const * weights,
+    int const n_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const model_id,
+    int const estimator_id,
+    float const tolerance,
+    int const max_n_iterations,
+    int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    Constraints const constraints,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const fit_index = blockIdx.x;
+    int const point_index = threadIdx.x;
+    int const first_point = fit_index * n_points;
+
+    extern __shared__ float extern_array[];
+
+    float * values = extern_array;
+    float * derivatives = values + n_points;
+    volatile float * shared_sum = derivatives + n_points * n_parameters_to_fit;
+    float * current_parameters = extern_array + n_points * (n_parameters_to_fit + 1) + blockDim.x;
+    float * prev_parameters = current_parameters + n_parameters;
+    float * gradient = prev_parameters + n_parameters;
+    float * hessian = gradient + n_parameters_to_fit;
+    float * delta = hessian + n_parameters_to_fit * n_parameters_to_fit;
+    float * calculation_matrix = delta + n_parameters_to_fit;
+    int * pivot_columns = (int *)(calculation_matrix + n_parameters_to_fit * (n_parameters_to_fit + 1));
+
+    __shared__ float chi_square;
+    __shared__ float prev_chi_square;
+    __shared__ float lambda;
+    __shared__ int state;
+    __shared__ int finished;
+    __shared__ int iteration_failed;
+    __shared__ int singular;
+
+    InputData const current_data = data + first_point;
+    float const * current_weight = weights ? &weights[first_point] : NULL;
+
+    for (int parameter_index = threadIdx.x; parameter_index < n_parameters; parameter_index += blockDim.x)
+    {
+        current_parameters[parameter_index] = parameters[fit_index * n_parameters + parameter_index];
+    }
+
+    if (threadIdx.x == 0)
+    {
+        prev_chi_square = 0.f;
+        lambda = lambdas[fit_index];
+        state = STATE_CONVERGED;
+        finished = 0;
+    }
+
+    __syncthreads();
+
+    // initialize the chi-square value, the gradient and the hessian
+    if (point_index < n_points)
+    {
+        calculate_model_fused(model_id, current_parameters, n_fits, n_points, n_parameters, n_parameters_to_fit,
+            parameters_to_fit_indices, values, derivatives, point_index, first_fit_index + fit_index, chunk_index,
+            user_info, user_info_size, coordinates);
+    }
+    __syncthreads();
+
+    calculate_chi_square_fused(&chi_square, &iteration_failed, &state, shared_sum, prev_chi_square,
+        current_data, values, current_weight, n_points, estimator_id, user_info, user_info_size);
+
+    calculate_gradient_hessian_fused(gradient, hessian, shared_sum, current_data, values, derivatives,
+        current_weight, n_points, n_parameters_to_fit, parameters_to_fit_indices, estimator_id,
+        user_info, user_info_size);
+
+    if (threadIdx.x == 0)
+    {
+        prev_chi_square = chi_square;
+    }
+
+    __syncthreads();
+
+    // loop over the fit iterations, all branches depend only on shared values
+    // and are therefore taken by all threads of the block
+    for (int iteration = 0; !finished; iteration++)
+    {
+        // modify step width
+        for (int parameter_index = threadIdx.x; parameter_index < n_parameters_to_fit; parameter_index += blockDim.x)
+        {
+            float * diagonal = &hessian[parameter_index * n_parameters_to_fit + parameter_index];
+
+            if (iteration_failed)
+            {
+                *diagonal = *diagonal / (1.0f + lambda / 10.f);
+            }
+            *diagonal = *diagonal * (1.0f + lambda);
+        }
+        __syncthreads();
+
+        // Gauss Jordan
+        solve_equation_system_fused(delta, gradient, hessian, calculation_matrix, pivot_columns,
+            &singular, n_parameters_to_fit);
+
+        if (threadIdx.x == 0 && singular)
+        {
+            state = STATE_SINGULAR_HESSIAN;
+        }
+
+        // update fitting parameters
+        for (int parameter_index = threadIdx.x; parameter_index < n_parameters; parameter_index += blockDim.x)
+        {
+            prev_parameters[parameter_index] = current_parameters[parameter_index];
+        }
+        __syncthreads();
+
+        for (int parameter_index = threadIdx.x; parameter_index < n_parameters_to_fit; parameter_index += blockDim.x)
+        {
+            int const updated_index = parameters_to_fit_indices[parameter_index];
+
+            current_parameters[updated_index] = apply_constraints(
+                constraints,
+                n_parameters,
+                first_fit_index + fit_index,
+                updated_index,
+                current_parameters[updated_index] + delta[parameter_index]);
+        }
+        __syncthreads();
+
+        // calculate fitting curve values and its derivatives
+        // calculate chi-squares, gradients and hessians
+        if (point_index < n_points)
+        {
+            calculate_model_fused(model_id, current_parameters, n_fits, n_points, n_parameters, n_parameters_to_fit,
+                parameters_to_fit_indices, values, derivatives, point_index, first_fit_index + fit_index, chunk_index,
+                user_info, user_info_size, coordinates);
+        }
+        __syncthreads();
+
+        calculate_chi_square_fused(&chi_square, &iteration_failed, &state, shared_sum, prev_chi_square,
+            current_data, values, current_weight, n_points, estimator_id, user_info, user_info_size);
+
+        if (!iteration_failed)
+        {
+            calculate_gradient_hessian_fused(gradient, hessian, shared_sum, current_data, values, derivatives,
+                current_weight, n_points, n_parameters_to_fit, parameters_to_fit_indices, estimator_id,
+                user_info, user_info_size);
+        }
+
+        // check for convergence
+        // update chi-square, curve parameters and lambda
+        bool const chi_square_decreased = chi_square < prev_chi_square;
+        __syncthreads();
+
+        if (threadIdx.x == 0)
+        {
+            bool const fit_found
+                = abs(chi_square - prev_chi_square) < tolerance * fmaxf(1, chi_square);
+
+            if (fit_found)
+            {
+                finished = 1;
+            }
+            else if (iteration >= max_n_iterations - 1)
+            {
+                state = STATE_MAX_ITERATION;
+            }
+
+            if (state != STATE_CONVERGED)
+            {
+                finished = 1;
+            }
+
+            if (finished)
+            {
+                n_iterations[fit_index] = iteration + 1;
+            }
+
+            if (chi_square_decreased)
+            {
+                lambda *= 0.1f;
+                prev_chi_square = chi_square;
+            }
+            else
+            {
+                lambda *= 10.f;
+                chi_square = prev_chi_square;
+            }
+        }
+
+        if (!chi_square_decreased)
+        {
+            for (int parameter_index = threadIdx.x; parameter_index < n_parameters; parameter_index += blockDim.x)
+            {
+                current_parameters[parameter_index] = prev_parameters[parameter_index];
+            }
+        }
+
+        __syncthreads();
+    }
+
+    // write the results
+    for (int parameter_index = threadIdx.x; parameter_index < n_parameters; parameter_index += blockDim.x)
+    {
+        parameters[fit_index * n_parameters + parameter_index] = current_parameters[parameter_index];
+    }
+
+    if (threadIdx.x == 0)
+    {
+        states[fit_index] = state;
+        chi_squares[fit_index] = chi_square;
+        lambdas[fit_index] = lambda;
+    }
+}
+
+/* Description of the select_kernels function
+* ===========================================
+*
+* This function returns the set of kernels which are specialized for the given
+* model, estimator and precision mode. The number of model parameters, the model
+* ID and the estimator ID are compile time constants in the specialized kernels.
+* For model or estimator IDs without specialization, kernels which read these
+* values at run time are returned (GENERIC_MODEL, GENERIC_ESTIMATOR). The
+* precision mode defines the types of the sums calculated by the kernels, see
+* precision.cuh.
+*
+* Parameters:
+*
+* model_id: The fitting model ID.
+*
+* estimator_id: The estimator ID.
+*
+* precision_id: The precision ID.
+*
+*/
+
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
+KernelSet const & specialized_kernels()
+{
+    typedef SumsSize< PRECISION > Size;
+
+    static KernelSet const kernels =
+    {
+        cuda_calc_curve_values< MODEL_ID >,
+        cuda_calculate_chi_squares< ESTIMATOR_ID, PRECISION >,
+        cuda_calculate_gradients< MODEL_ID, ESTIMATOR_ID, PRECISION >,
+        cuda_calculate_hessians< MODEL_ID, ESTIMATOR_ID, PRECISION >,
+        cuda_calc_curve_values_and_hessians< MODEL_ID, ESTIMATOR_ID, PRECISION >,
+        Size::chi_square,
+        Size::gradient,
+        Size::hessian,
+        Size::maximum
+    };
+
+    return kernels;
+}
+
+template< int ESTIMATOR_ID, typename PRECISION >
+KernelSet const & select_model_kernels(int const model_id)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        return specialized_kernels< GAUSS_1D, ESTIMATOR_ID, PRECISION >();
+    case GAUSS_2D:
+        return specialized_kernels< GAUSS_2D, ESTIMATOR_ID, PRECISION >();
+    case GAUSS_2D_ELLIPTIC:
+        return specialized_kernels< GAUSS_2D_ELLIPTIC, ESTIMATOR_ID, PRECISION >();
+    case GAUSS_2D_ROTATED:
+        return specialized_kernels< GAUSS_2D_ROTATED, ESTIMATOR_ID, PRECISION >();
+    case CAUCHY_2D_ELLIPTIC:
+        return specialized_kernels< CAUCHY_2D_ELLIPTIC, ESTIMATOR_ID, PRECISION >();
+    case LINEAR_1D:
+        return specialized_kernels< LINEAR_1D, ESTIMATOR_ID, PRECISION >();
+    default:
+        return specialized_kernels< GENERIC_MODEL, ESTIMATOR_ID, PRECISION >();
+    }
+}
+
+template< typename PRECISION >
+KernelSet const & select_estimator_kernels(int const model_id, int const estimator_id)
+{
+    switch (estimator_id)
+    {
+    case LSE:
+        return select_model_kernels< LSE, PRECISION >(model_id);
+    case MLE:
+        return select_model_kernels< MLE, PRECISION >(model_id);
+    default:
+        return select_model_kernels< GENERIC_ESTIMATOR, PRECISION >(model_id);
+    }
+}
+
+KernelSet const & select_kernels(int const model_id, int const estimator_id, int const precision_id)
+{
+    switch (precision_id)
+    {
+    case PRECISION_FLOAT:
+        return select_estimator_kernels< PrecisionFloat >(model_id, estimator_id);
+    case PRECISION_COMPENSATED:
+        return select_estimator_kernels< PrecisionCompensated >(model_id, estimator_id);
+    case PRECISION_DOUBLE:
+        return select_estimator_kernels< PrecisionDouble >(model_id, estimator_id);
+    default:
+        return select_estimator_kernels< PrecisionMixed >(model_id, estimator_id);
+    }
+}
@@ -2,24 +2,33 @@
 #define GPUFIT_CUDA_KERNELS_CUH_INCLUDED
 
 #include <device_launch_parameters.h>
+#include "definitions.h"
+#include "coordinates.h"
+#include "constraints.h"
+#include "input_data.cuh"
+#include "precision.cuh"
 
-extern __global__ void cuda_calculate_chi_squares(
+template< int ESTIMATOR_ID, typename PRECISION >
+__global__ void cuda_calculate_chi_squares(
     float * chi_squares,
     int * states,
     int * iteration_falied,
     float const * prev_chi_squares,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * weights,
     int const n_points,
     int const estimator_id,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block,
     char * user_info,
     std::size_t const user_info_size);
-extern __global__ void cuda_calculate_gradients(
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
+__global__ void cuda_calculate_gradients(
     float * gradients,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * derivatives,
     float const * weights,
@@ -30,12 +39,15 @@ extern __global__ void cuda_calculate_gradients(
     int const estimator_id,
     int const * finished,
     int const * skip,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block,
     char * user_info,
     std::size_t const user_info_size);
-extern __global__ void cuda_calculate_hessians(
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
+__global__ void cuda_calculate_hessians(
     float * hessians,
-    float const * data,
+    InputData const data,
     float const * values,
     float const * derivatives,
     float const * weights,
@@ -46,6 +58,48 @@ extern __global__ void cuda_calculate_hessians(
     int const estimator_id,
     int const * skip,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_fits_per_block,
+    char * user_info,
+    std::size_t const user_info_size);
+template< int MODEL_ID, int ESTIMATOR_ID, typename PRECISION >
+__global__ void cuda_calc_curve_values_and_hessians(
+    float * chi_squares,
+    float * gradients,
+    float * hessians,
+    int * states,
+    int * iteration_failed,
+    float const * prev_chi_squares,
+    float const * parameters,
+    InputData const data,
+    float const * weights,
+    int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const * finished,
+    int const n_fits_per_block,
+    int const model_id,
+    int const estimator_id,
+    int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    char * user_info,
+    std::size_t const user_info_size);
+extern __global__ void cuda_estimate_initial_parameters(
+    float * parameters,
+    InputData const data,
+    float const * weights,
+    int const n_fits,
+    int const n_points,
+    int const n_parameters,
+    int const model_id,
+    int const first_fit_index,
+    Coordinates const coordinates,
     char * user_info,
     std::size_t const user_info_size);
 extern __global__ void cuda_modify_step_widths(
@@ -54,18 +108,27 @@ extern __global__ void cuda_modify_step_widths(
     unsigned int const n_parameters,
     int const * iteration_failed,
     int const * finished,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_fits_per_block);
-extern __global__ void cuda_calc_curve_values(
+template< int MODEL_ID >
+__global__ void cuda_calc_curve_values(
     float const * parameters,
     int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_points,
     int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
     int const * finished,
     float * values,
     float * derivatives,
     int const n_fits_per_block,
     int const model_id,
     int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
     char * user_info,
     std::size_t const user_info_size);
 extern __global__ void cuda_update_parameters(
@@ -75,7 +138,26 @@ extern __global__ void cuda_update_parameters(
     int const n_parameters_to_fit,
     int const * parameters_to_fit_indices,
     int const * finished,
-    int const n_fits_per_block);
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_fits_per_block,
+    int const first_fit_index,
+    Constraints const constraints);
+extern __global__ void cuda_set_unit_vectors(
+    float * gradients,
+    int const n_parameters_to_fit,
+    int const column,
+    int const n_fits);
+extern __global__ void cuda_store_uncertainties(
+    float * uncertainties,
+    float const * deltas,
+    int const * singular_checks,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const column,
+    int const uncertainty_type,
+    int const n_fits);
 extern __global__ void cuda_check_for_convergence(
     int * finished,
     float const tolerance,
@@ -84,25 +166,78 @@ extern __global__ void cuda_check_for_convergence(
     float const * prev_chi_squares,
     int const iteration,
     int const max_n_iterations,
-    int const n_fits);
+    int const * active_fits,
+    int const n_active_fits);
 extern __global__ void cuda_evaluate_iteration(
-    int * all_finished,
     int * n_iterations,
     int * finished,
     int const iteration,
     int const * states,
-    int const n_fits);
+    int const * active_fits,
+    int const n_active_fits);
 extern __global__ void cuda_prepare_next_iteration(
     float * lambdas,
     float * chi_squares,
     float * prev_chi_squares,
     float * function_parameters,
     float const * prev_parameters,
-    int const n_fits,
+    int const * n_iterations,
+    int const iteration,
+    int const * active_fits,
+    int const n_active_fits,
     int const n_parameters);
-extern __global__ void cuda_update_state_after_gaussjordan(
+extern __global__ void cuda_fit_fused(
+    float * parameters,
+    int * states,
+    float * chi_squares,
+    int * n_iterations,
+    float * lambdas,
+    InputData const data,
+    float const * weights,
     int const n_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const model_id,
+    int const estimator_id,
+    float const tolerance,
+    int const max_n_iterations,
+    int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    Constraints const constraints,
+    char * user_info,
+    std::size_t const user_info_size);
+extern __global__ void cuda_update_state_after_gaussjordan(
+    int const * active_fits,
+    int const n_active_fits,
     int const * singular_checks,
-    int * states);
+    int * states,
+    int const * finished);
+extern __global__ void cuda_compact_active_fits(
+    int * compacted_fits,
+    int * n_compacted_fits,
+    int const * active_fits,
+    int const * finished,
+    int const n_active_fits);
+
+// kernels specialized for a model, an estimator and a precision mode, see
+// select_kernels
+struct KernelSet
+{
+    decltype(&cuda_calc_curve_values< GENERIC_MODEL >) calc_curve_values;
+    decltype(&cuda_calculate_chi_squares< GENERIC_ESTIMATOR, PrecisionMixed >) calculate_chi_squares;
+    decltype(&cuda_calculate_gradients< GENERIC_MODEL, GENERIC_ESTIMATOR, PrecisionMixed >) calculate_gradients;
+    decltype(&cuda_calculate_hessians< GENERIC_MODEL, GENERIC_ESTIMATOR, PrecisionMixed >) calculate_hessians;
+    decltype(&cuda_calc_curve_values_and_hessians< GENERIC_MODEL, GENERIC_ESTIMATOR, PrecisionMixed >) calc_curve_values_and_hessians;
+
+    // shared memory of the kernels in bytes per thread
+    std::size_t chi_squares_shared_memory;
+    std::size_t gradients_shared_memory;
+    std::size_t hessians_shared_memory;
+    // in addition to the float arrays of cuda_calc_curve_values_and_hessians
+    std::size_t curve_values_and_hessians_shared_memory;
+};
 
 #endif
@@ -9,4 +9,37 @@
         throw std::runtime_error( cudaGetErrorString( status ) ) ; \
     }
 
+#ifdef USE_CUBLAS
+#include <string>
+#define CUBLAS_CHECK_STATUS( cublas_function_call ) \
+    if (cublasStatus_t const status = cublas_function_call) \
+    { \
+        throw std::runtime_error( "cuBLAS error " + std::to_string( int( status ) ) ) ; \
+    }
+#endif
+
+#ifdef USE_NVRTC
+#define CU_CHECK_STATUS( cu_function_call ) \
+    if (CUresult const status = cu_function_call) \
+    { \
+        char const * message = 0 ; \
+        cuGetErrorString( status, &message ) ; \
+        throw std::runtime_error( message ? message : "CUDA driver error" ) ; \
+    }
+
+#define NVRTC_CHECK_STATUS( nvrtc_function_call ) \
+    if (nvrtcResult const status = nvrtc_function_call) \
+    { \
+        throw std::runtime_error( nvrtcGetErrorString( status ) ) ; \
+    }
+#endif
+
+    // Model and estimator IDs of the generic kernels
+#define GENERIC_MODEL -1
+#define GENERIC_ESTIMATOR -1
+
+    // The largest number of model parameters, limited by the Gauss-Jordan
+    // kernel, which uses (n_parameters + 1) * n_parameters threads per fit
+#define MAX_MODEL_PARAMETERS 31
+
 #endif
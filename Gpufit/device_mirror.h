@@ -0,0 +1,93 @@
+#ifndef GPUFIT_DEVICE_MIRROR_H_INCLUDED
+#define GPUFIT_DEVICE_MIRROR_H_INCLUDED
+
+#include "gpu_data.cuh"
+#include "definitions.h"
+
+#include <memory>
+#include <vector>
+
+/* Description of the DeviceMirror class template
+* ===============================================
+*
+* An array set by the caller of a fit context, e.g. a coordinate grid, which
+* is kept in host memory and copied to the current device once after each
+* change, before the next fit call on the device. The device copy is shared by
+* all following fit calls of the fit context. In multi-device mode each device
+* context holds a mirror of the array of the fit context, which takes over the
+* host array by configure() if it changed.
+*
+*/
+
+template< typename Type >
+class DeviceMirror
+{
+public:
+    DeviceMirror() : version_(0), device_version_(0) {}
+
+    void assign(Type const * const begin, Type const * const end)
+    {
+        host_.assign(begin, end);
+        version_++;
+    }
+
+    // takes over the array of the mirror of another fit context
+    void configure(DeviceMirror const & mirror)
+    {
+        if (mirror.version_ == version_)
+            return;
+
+        host_ = mirror.host_;
+        version_ = mirror.version_;
+    }
+
+    // the device copy, or NULL if the array is empty
+    Type const * get_device_data()
+    {
+        if (device_version_ != version_)
+        {
+            upload();
+        }
+
+        return device_ ? static_cast< Type const * >(*device_) : 0;
+    }
+
+    void release()
+    {
+        device_.reset();
+        device_version_ = 0;
+    }
+
+    bool is_allocated() const { return bool(device_); }
+    bool empty() const { return host_.empty(); }
+    std::size_t size() const { return host_.size(); }
+
+private:
+    void upload()
+    {
+        release();
+
+        if (!host_.empty())
+        {
+            device_.reset(new Device_Array< Type >(host_.size()));
+            CUDA_CHECK_STATUS(cudaMemcpy(
+                static_cast< Type * >(*device_),
+                host_.data(),
+                host_.size() * sizeof(Type),
+                cudaMemcpyHostToDevice));
+        }
+
+        device_version_ = version_;
+    }
+
+    std::vector< Type > host_;
+
+    // incremented by each change, the device copy is up to date if its
+    // version is equal
+    unsigned version_;
+    unsigned device_version_;
+
+    std::unique_ptr< Device_Array< Type > > device_;
+};
+
+#endif
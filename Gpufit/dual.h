@@ -0,0 +1,251 @@
+#ifndef GPUFIT_DUAL_H_INCLUDED
+#define GPUFIT_DUAL_H_INCLUDED
+
+#include <cmath>
+
+/* Description of the Dual structure
+* ==================================
+*
+* Forward mode automatic differentiation of the model functions. A Dual< N >
+* holds a value and its partial derivatives with respect to N variables, and
+* the arithmetic operators and math functions below apply the chain rule to
+* both. A model written once as a function template of the parameter type,
+* evaluated with Dual< N > parameters, returns its value and the derivatives
+* with respect to all N parameters in a single pass. N is a compile time
+* constant, hence the loops over the derivatives are unrolled and the
+* derivatives are kept in registers.
+*
+* The functions are __host__ __device__ functions if compiled by nvcc, and
+* plain C++ functions otherwise, which allows Cpufit to share the model
+* functions (see model_functions.h).
+*
+*/
+
+#ifdef __CUDACC__
+#define GPUFIT_HOST_DEVICE __host__ __device__ __forceinline__
+#else
+#define GPUFIT_HOST_DEVICE inline
+#endif
+
+template< int N >
+struct Dual
+{
+    float value;
+    float derivatives[N];
+
+    GPUFIT_HOST_DEVICE Dual() : value(0.f)
+    {
+        for (int i = 0; i < N; i++)
+            derivatives[i] = 0.f;
+    }
+
+    // a constant
+    GPUFIT_HOST_DEVICE Dual(float const constant) : value(constant)
+    {
+        for (int i = 0; i < N; i++)
+            derivatives[i] = 0.f;
+    }
+
+    // the variable with the given index
+    GPUFIT_HOST_DEVICE static Dual variable(float const value, int const index)
+    {
+        Dual result(value);
+        result.derivatives[index] = 1.f;
+        return result;
+    }
+};
+
+// the value of a function f(a) with the derivative df/da
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > chain(Dual< N > const & a, float const value, float const derivative)
+{
+    Dual< N > result(value);
+    for (int i = 0; i < N; i++)
+        result.derivatives[i] = derivative * a.derivatives[i];
+    return result;
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator-(Dual< N > const & a)
+{
+    return chain(a, -a.value, -1.f);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator+(Dual< N > const & a, Dual< N > const & b)
+{
+    Dual< N > result(a.value + b.value);
+    for (int i = 0; i < N; i++)
+        result.derivatives[i] = a.derivatives[i] + b.derivatives[i];
+    return result;
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator-(Dual< N > const & a, Dual< N > const & b)
+{
+    Dual< N > result(a.value - b.value);
+    for (int i = 0; i < N; i++)
+        result.derivatives[i] = a.derivatives[i] - b.derivatives[i];
+    return result;
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator*(Dual< N > const & a, Dual< N > const & b)
+{
+    Dual< N > result(a.value * b.value);
+    for (int i = 0; i < N; i++)
+        result.derivatives[i] = a.derivatives[i] * b.value + a.value * b.derivatives[i];
+    return result;
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator/(Dual< N > const & a, Dual< N > const & b)
+{
+    float const inverse = 1.f / b.value;
+    float const value = a.value * inverse;
+    Dual< N > result(value);
+    for (int i = 0; i < N; i++)
+        result.derivatives[i] = (a.derivatives[i] - value * b.derivatives[i]) * inverse;
+    return result;
+}
+
+// mixed operations with constants, which do not carry derivatives
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator+(Dual< N > const & a, float const b)
+{
+    return chain(a, a.value + b, 1.f);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator+(float const a, Dual< N > const & b)
+{
+    return chain(b, a + b.value, 1.f);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator-(Dual< N > const & a, float const b)
+{
+    return chain(a, a.value - b, 1.f);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator-(float const a, Dual< N > const & b)
+{
+    return chain(b, a - b.value, -1.f);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator*(Dual< N > const & a, float const b)
+{
+    return chain(a, a.value * b, b);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator*(float const a, Dual< N > const & b)
+{
+    return chain(b, a * b.value, a);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator/(Dual< N > const & a, float const b)
+{
+    float const inverse = 1.f / b;
+    return chain(a, a.value * inverse, inverse);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > operator/(float const a, Dual< N > const & b)
+{
+    float const value = a / b.value;
+    return chain(b, value, -value / b.value);
+}
+
+// math functions
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > exp(Dual< N > const & a)
+{
+    float const value = expf(a.value);
+    return chain(a, value, value);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > log(Dual< N > const & a)
+{
+    return chain(a, logf(a.value), 1.f / a.value);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > sqrt(Dual< N > const & a)
+{
+    float const value = sqrtf(a.value);
+    return chain(a, value, 0.5f / value);
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > sin(Dual< N > const & a)
+{
+    return chain(a, sinf(a.value), cosf(a.value));
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > cos(Dual< N > const & a)
+{
+    return chain(a, cosf(a.value), -sinf(a.value));
+}
+
+template< int N >
+GPUFIT_HOST_DEVICE Dual< N > pow(Dual< N > const & a, float const b)
+{
+    float const value = powf(a.value, b);
+    return chain(a, value, b * powf(a.value, b - 1.f));
+}
+
+/* Description of the calculate_dual function
+* ===========================================
+*
+* Evaluates a model function with N parameters for a single data point, and
+* stores its value and its partial derivatives with respect to the parameters.
+*
+* MODEL: A structure with a member function template
+*
+*            template< typename T >
+*            T operator()(T const * p, float const x, float const y) const
+*
+*        the value of the model at the coordinate (x, y), for the parameters
+*        p of type float or Dual< N >.
+*
+* parameters: An input vector of the N model parameters.
+*
+* x, y: The coordinates of the data point.
+*
+* value: The output model function value.
+*
+* derivative: An output vector of the partial derivatives, stored with a
+*             stride of derivative_stride.
+*
+*/
+
+template< int N, typename MODEL >
+GPUFIT_HOST_DEVICE void calculate_dual(
+    MODEL const & model,
+    float const * parameters,
+    float const x,
+    float const y,
+    float * value,
+    float * derivative,
+    int const derivative_stride)
+{
+    Dual< N > p[N];
+    for (int i = 0; i < N; i++)
+        p[i] = Dual< N >::variable(parameters[i], i);
+
+    Dual< N > const result = model(p, x, y);
+
+    *value = result.value;
+    for (int i = 0; i < N; i++)
+        derivative[i * derivative_stride] = result.derivatives[i];
+}
+
+#endif
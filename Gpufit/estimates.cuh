@@ -0,0 +1,348 @@
+#ifndef GPUFIT_ESTIMATES_CUH_INCLUDED
+#define GPUFIT_ESTIMATES_CUH_INCLUDED
+
+#include "gpufit.h"
+#include "input_data.cuh"
+#include "linear_1d.cuh"
+
+/* Description of the initial parameter estimates
+* ===============================================
+*
+* If no initial parameters are passed to a fit call, they are estimated from
+* the data of each fit before the first iteration (see
+* cuda_estimate_initial_parameters in cuda_kernels.cu).
+*
+* Peak models: the offset is the mean value of the border data points, the
+* amplitude is the difference between the maximum value and the offset. The
+* center and the widths are the first and second moments of the data values
+* above the offset, with respect to the coordinates of the data points. The
+* rotation angle of GAUSS_2D_ROTATED is the orientation of the principal axes
+* of the second moments. For CAUCHY_2D_ELLIPTIC the second moments are an
+* upper bound of the widths.
+*
+* LINEAR_1D: the offset and the slope are the (weighted) least squares
+* solution, which is exact up to rounding.
+*
+* Parameters of the estimate functions:
+*
+* parameters: An output vector of the model parameters of a single fit.
+*
+* data: An input vector of the data values of the fit.
+*
+* weights: An input vector of the weights of the fit, or NULL.
+*
+* n_points: The number of data points per fit.
+*
+* fit_index: The index of the fit within the complete set of fits.
+*
+* user_info, user_info_size: The user information, used by LINEAR_1D.
+*
+* coordinates: The coordinate grid of the data points.
+*
+* Calling the estimate functions
+* ==============================
+*
+* These __device__ functions can be only called from a __global__ function or
+* an other __device__ function. Each call estimates the parameters of a single
+* fit.
+*
+*/
+
+// the smallest estimated width, in units of the coordinates
+#define MIN_ESTIMATED_WIDTH 0.5f
+
+struct Moments
+{
+    float amplitude;
+    float offset;
+    float x;
+    float y;
+    float xx;
+    float yy;
+    float xy;
+};
+
+__device__ float estimate_offset_1d(InputData const & data, int const n_points)
+{
+    return 0.5f * (data[0] + data[n_points - 1]);
+}
+
+// the data points are arranged on a grid of n_points_x columns
+__device__ float estimate_offset_2d(InputData const & data, int const n_points, int const n_points_x)
+{
+    int const n_points_y = n_points / n_points_x;
+
+    if (n_points_x < 3 || n_points_y < 3)
+    {
+        float minimum = data[0];
+        for (int point_index = 1; point_index < n_points; point_index++)
+            minimum = fminf(minimum, data[point_index]);
+        return minimum;
+    }
+
+    float sum = 0.f;
+    for (int index_x = 0; index_x < n_points_x; index_x++)
+    {
+        sum += data[index_x] + data[(n_points_y - 1) * n_points_x + index_x];
+    }
+    for (int index_y = 1; index_y < n_points_y - 1; index_y++)
+    {
+        sum += data[index_y * n_points_x] + data[index_y * n_points_x + n_points_x - 1];
+    }
+
+    return sum / float(2 * n_points_x + 2 * (n_points_y - 2));
+}
+
+__device__ float estimate_width(float const variance)
+{
+    return fmaxf(sqrtf(fmaxf(variance, 0.f)), MIN_ESTIMATED_WIDTH);
+}
+
+// the moments of the data values above the offset, with respect to the
+// coordinates of the data points
+__device__ void calculate_moments(
+    Moments & moments,
+    InputData const & data,
+    int const n_points,
+    int const fit_index,
+    bool const two_dimensional,
+    Coordinates const & coordinates)
+{
+    float maximum = data[0];
+    for (int point_index = 1; point_index < n_points; point_index++)
+        maximum = fmaxf(maximum, data[point_index]);
+
+    moments.offset
+        = two_dimensional
+        ? estimate_offset_2d(data, n_points, coordinates.n_points_x)
+        : estimate_offset_1d(data, n_points);
+    moments.amplitude = maximum - moments.offset;
+
+    float sum = 0.f;
+    float sum_x = 0.f;
+    float sum_y = 0.f;
+    float mean_x = 0.f;
+    float mean_y = 0.f;
+
+    for (int point_index = 0; point_index < n_points; point_index++)
+    {
+        float x = 0.f;
+        float y = 0.f;
+        if (two_dimensional)
+            get_xy_coordinates(coordinates, n_points, point_index, fit_index, x, y);
+        else
+            x = get_x_coordinate(coordinates, n_points, point_index, fit_index);
+
+        float const weight = fmaxf(data[point_index] - moments.offset, 0.f);
+        sum += weight;
+        sum_x += weight * x;
+        sum_y += weight * y;
+        mean_x += x;
+        mean_y += y;
+    }
+
+    // flat data, the center of the data points
+    if (!(sum > 0.f))
+    {
+        moments.x = mean_x / float(n_points);
+        moments.y = mean_y / float(n_points);
+        moments.xx = 1.f;
+        moments.yy = 1.f;
+        moments.xy = 0.f;
+        return;
+    }
+
+    moments.x = sum_x / sum;
+    moments.y = sum_y / sum;
+
+    float sum_xx = 0.f;
+    float sum_yy = 0.f;
+    float sum_xy = 0.f;
+
+    for (int point_index = 0; point_index < n_points; point_index++)
+    {
+        float x = 0.f;
+        float y = 0.f;
+        if (two_dimensional)
+            get_xy_coordinates(coordinates, n_points, point_index, fit_index, x, y);
+        else
+            x = get_x_coordinate(coordinates, n_points, point_index, fit_index);
+
+        float const weight = fmaxf(data[point_index] - moments.offset, 0.f);
+        float const dx = x - moments.x;
+        float const dy = y - moments.y;
+        sum_xx += weight * dx * dx;
+        sum_yy += weight * dy * dy;
+        sum_xy += weight * dx * dy;
+    }
+
+    moments.xx = sum_xx / sum;
+    moments.yy = sum_yy / sum;
+    moments.xy = sum_xy / sum;
+}
+
+__device__ void estimate_gauss1d(
+    float * parameters,
+    InputData const & data,
+    int const n_points,
+    int const fit_index,
+    Coordinates const & coordinates)
+{
+    Moments moments;
+    calculate_moments(moments, data, n_points, fit_index, false, coordinates);
+
+    parameters[0] = moments.amplitude;
+    parameters[1] = moments.x;
+    parameters[2] = estimate_width(moments.xx);
+    parameters[3] = moments.offset;
+}
+
+__device__ void estimate_gauss2d(
+    float * parameters,
+    InputData const & data,
+    int const n_points,
+    int const fit_index,
+    Coordinates const & coordinates)
+{
+    Moments moments;
+    calculate_moments(moments, data, n_points, fit_index, true, coordinates);
+
+    parameters[0] = moments.amplitude;
+    parameters[1] = moments.x;
+    parameters[2] = moments.y;
+    parameters[3] = estimate_width(0.5f * (moments.xx + moments.yy));
+    parameters[4] = moments.offset;
+}
+
+// GAUSS_2D_ELLIPTIC and CAUCHY_2D_ELLIPTIC
+__device__ void estimate_2d_elliptic(
+    float * parameters,
+    InputData const & data,
+    int const n_points,
+    int const fit_index,
+    Coordinates const & coordinates)
+{
+    Moments moments;
+    calculate_moments(moments, data, n_points, fit_index, true, coordinates);
+
+    parameters[0] = moments.amplitude;
+    parameters[1] = moments.x;
+    parameters[2] = moments.y;
+    parameters[3] = estimate_width(moments.xx);
+    parameters[4] = estimate_width(moments.yy);
+    parameters[5] = moments.offset;
+}
+
+__device__ void estimate_gauss2drotated(
+    float * parameters,
+    InputData const & data,
+    int const n_points,
+    int const fit_index,
+    Coordinates const & coordinates)
+{
+    Moments moments;
+    calculate_moments(moments, data, n_points, fit_index, true, coordinates);
+
+    // the model measures width x along (cos(p[6]), -sin(p[6]))
+    float const angle = -0.5f * atan2f(2.f * moments.xy, moments.xx - moments.yy);
+    float const cos_angle = cosf(angle);
+    float const sin_angle = sinf(angle);
+
+    float const variance_a
+        = moments.xx * cos_angle * cos_angle
+        - 2.f * moments.xy * cos_angle * sin_angle
+        + moments.yy * sin_angle * sin_angle;
+    float const variance_b
+        = moments.xx * sin_angle * sin_angle
+        + 2.f * moments.xy * cos_angle * sin_angle
+        + moments.yy * cos_angle * cos_angle;
+
+    parameters[0] = moments.amplitude;
+    parameters[1] = moments.x;
+    parameters[2] = moments.y;
+    parameters[3] = estimate_width(variance_a);
+    parameters[4] = estimate_width(variance_b);
+    parameters[5] = moments.offset;
+    parameters[6] = angle;
+}
+
+__device__ void estimate_linear1d(
+    float * parameters,
+    InputData const & data,
+    float const * weights,
+    int const n_points,
+    int const fit_index,
+    char * user_info,
+    std::size_t const user_info_size,
+    Coordinates const & coordinates)
+{
+    float sum = 0.f;
+    float sum_x = 0.f;
+    float sum_y = 0.f;
+    float sum_xx = 0.f;
+    float sum_xy = 0.f;
+
+    for (int point_index = 0; point_index < n_points; point_index++)
+    {
+        float const x = get_linear1d_x(n_points, point_index, fit_index, user_info, user_info_size, coordinates);
+        float const y = data[point_index];
+        float const weight = weights ? weights[point_index] : 1.f;
+
+        sum += weight;
+        sum_x += weight * x;
+        sum_y += weight * y;
+        sum_xx += weight * x * x;
+        sum_xy += weight * x * y;
+    }
+
+    float const determinant = sum * sum_xx - sum_x * sum_x;
+
+    if (determinant != 0.f)
+    {
+        parameters[1] = (sum * sum_xy - sum_x * sum_y) / determinant;
+        parameters[0] = (sum_y - parameters[1] * sum_x) / sum;
+    }
+    else
+    {
+        parameters[1] = 0.f;
+        parameters[0] = sum > 0.f ? sum_y / sum : 0.f;
+    }
+}
+
+__device__ void estimate_initial_parameters(
+    int const model_id,
+    float * parameters,
+    InputData const & data,
+    float const * weights,
+    int const n_points,
+    int const fit_index,
+    char * user_info,
+    std::size_t const user_info_size,
+    Coordinates const & coordinates)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        estimate_gauss1d(parameters, data, n_points, fit_index, coordinates);
+        break;
+    case GAUSS_2D:
+        estimate_gauss2d(parameters, data, n_points, fit_index, coordinates);
+        break;
+    case GAUSS_2D_ELLIPTIC:
+        estimate_2d_elliptic(parameters, data, n_points, fit_index, coordinates);
+        break;
+    case GAUSS_2D_ROTATED:
+        estimate_gauss2drotated(parameters, data, n_points, fit_index, coordinates);
+        break;
+    case CAUCHY_2D_ELLIPTIC:
+        estimate_2d_elliptic(parameters, data, n_points, fit_index, coordinates);
+        break;
+    case LINEAR_1D:
+        estimate_linear1d(parameters, data, weights, n_points, fit_index, user_info, user_info_size, coordinates);
+        break;
+    default:
+        break;
+    }
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef GPUFIT_ESTIMATORS_CUH_INCLUDED
+#define GPUFIT_ESTIMATORS_CUH_INCLUDED
+
+#include "gpufit.h"
+#include "definitions.h"
+#include "input_data.cuh"
+#include "lse.cuh"
+#include "mle.cuh"
+#include "mle_scmos.cuh"
+#include "robust_lse.cuh"
+
+// the estimator ID, which is a compile time constant for specialized kernels
+template< int ESTIMATOR_ID >
+__device__ __forceinline__ int select_estimator_id(int const estimator_id)
+{
+    return ESTIMATOR_ID == GENERIC_ESTIMATOR ? estimator_id : ESTIMATOR_ID;
+}
+
+/* Description of the calculate_chi_square, calculate_gradient and
+* calculate_hessian functions
+* ================================================================
+*
+* These functions call one of the estimator functions depending on the input
+* parameter estimator_id. Each adds the summand of the data point point_index
+* to the value pointed to by its second parameter. The remaining parameters
+* are passed to the estimator functions, see lse.cuh.
+*
+* The kernels calculate all estimators by these functions. In kernels which
+* are specialized for an estimator, the estimator ID is a compile time
+* constant and the switch is resolved by the compiler. Otherwise the estimator
+* ID is the same for all threads and the switch does not diverge.
+*
+* Calling the functions
+* =====================
+*
+* These __device__ functions can be only called from a __global__ function or
+* an other __device__ function.
+*
+*/
+
+__device__ __forceinline__ void calculate_chi_square(
+    int const estimator_id,
+    float * chi_square,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight,
+    int * state,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    switch (estimator_id)
+    {
+    case LSE:
+        calculate_chi_square_lse(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
+        break;
+    case MLE:
+        calculate_chi_square_mle(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
+        break;
+    case MLE_SCMOS:
+        calculate_chi_square_mle_scmos(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
+        break;
+    case LSE_HUBER:
+        calculate_chi_square_lse_huber(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
+        break;
+    case LSE_CAUCHY:
+        calculate_chi_square_lse_cauchy(chi_square, point_index, data, value, weight, state, user_info, user_info_size);
+        break;
+    default:
+        break;
+    }
+}
+
+__device__ __forceinline__ void calculate_gradient(
+    int const estimator_id,
+    float * gradient,
+    int const point_index,
+    int const parameter_index,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    switch (estimator_id)
+    {
+    case LSE:
+        calculate_gradient_lse(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case MLE:
+        calculate_gradient_mle(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case MLE_SCMOS:
+        calculate_gradient_mle_scmos(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case LSE_HUBER:
+        calculate_gradient_lse_huber(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case LSE_CAUCHY:
+        calculate_gradient_lse_cauchy(gradient, point_index, parameter_index, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    default:
+        break;
+    }
+}
+
+__device__ __forceinline__ void calculate_hessian(
+    int const estimator_id,
+    double * hessian,
+    int const point_index,
+    int const parameter_index_i,
+    int const parameter_index_j,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    switch (estimator_id)
+    {
+    case LSE:
+        calculate_hessian_lse(
+            hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case MLE:
+        calculate_hessian_mle(
+            hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case MLE_SCMOS:
+        calculate_hessian_mle_scmos(
+            hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case LSE_HUBER:
+        calculate_hessian_lse_huber(
+            hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    case LSE_CAUCHY:
+        calculate_hessian_lse_cauchy(
+            hessian, point_index, parameter_index_i, parameter_index_j, data, value, derivative, weight, user_info, user_info_size);
+        break;
+    default:
+        break;
+    }
+}
+
+#endif
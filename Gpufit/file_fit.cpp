@@ -0,0 +1,271 @@
+#include "file_fit.h"
+#include "interface.h"
+#include "context.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace
+{
+    // closes the output file if the fit is aborted by an exception
+    struct FileCloser
+    {
+        void operator()(std::FILE * file) const { std::fclose(file); }
+    };
+}
+
+FileFit::FileFit(
+    FitContext & context,
+    std::string const & data_file,
+    std::size_t const data_offset,
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    char const * weights_file,
+    int const model_id,
+    char const * initial_parameters_file,
+    float const tolerance,
+    int const max_n_iterations,
+    int const * parameters_to_fit,
+    int const estimator_id,
+    std::size_t const user_info_size,
+    char * user_info,
+    std::string const & output_file,
+    std::size_t const batch_size)
+    :
+    context_(context),
+    n_points_(int(n_points)),
+    model_id_(model_id),
+    tolerance_(tolerance),
+    max_n_iterations_(max_n_iterations),
+    estimator_id_(estimator_id),
+    n_parameters_(FitInterface::get_number_of_parameters(model_id)),
+    parameters_to_fit_(),
+    user_info_size_(user_info_size),
+    user_info_(user_info),
+    per_fit_user_info_(false),
+    data_type_size_(context.info_.get_data_type_size()),
+    data_offset_(data_offset),
+    n_fits_(n_fits),
+    batch_size_(batch_size),
+    data_file_(data_file),
+    weights_file_(),
+    initial_parameters_file_(),
+    output_file_(output_file)
+{
+    if (n_points == 0 || n_points > std::size_t(std::numeric_limits< int >::max()))
+    {
+        throw std::runtime_error("invalid number of data points per fit");
+    }
+
+    if (n_parameters_ == 0)
+    {
+        throw std::runtime_error("invalid model ID");
+    }
+
+    if (!parameters_to_fit)
+    {
+        throw std::runtime_error("parameters to fit not set");
+    }
+
+    if (batch_size == 0)
+    {
+        throw std::runtime_error("invalid batch size");
+    }
+
+    // the data values of the mapped file are read in place
+    if (data_offset > data_file_.size() || data_offset % data_type_size_ != 0)
+    {
+        throw std::runtime_error("invalid data offset");
+    }
+
+    std::size_t const fit_size = n_points * data_type_size_;
+    std::size_t const n_fits_in_file = (data_file_.size() - data_offset) / fit_size;
+
+    if (n_fits_ == 0)
+    {
+        n_fits_ = n_fits_in_file;
+    }
+    else if (n_fits_ > n_fits_in_file)
+    {
+        throw std::runtime_error("data file too small");
+    }
+
+    per_fit_user_info_ = n_fits_ > 1 && user_info_size_ == n_fits_ * n_points * sizeof(float);
+
+    if (weights_file)
+    {
+        weights_file_.reset(new MappedFile(weights_file));
+        if (weights_file_->size() / (n_points * sizeof(float)) < n_fits_)
+        {
+            throw std::runtime_error("weights file too small");
+        }
+    }
+
+    if (initial_parameters_file)
+    {
+        initial_parameters_file_.reset(new MappedFile(initial_parameters_file));
+        if (initial_parameters_file_->size() / (n_parameters_ * sizeof(float)) < n_fits_)
+        {
+            throw std::runtime_error("initial parameters file too small");
+        }
+    }
+
+    parameters_to_fit_.assign(parameters_to_fit, parameters_to_fit + n_parameters_);
+}
+
+void FileFit::run()
+{
+    std::unique_ptr< std::FILE, FileCloser > output(std::fopen(output_file_.c_str(), "wb"));
+    if (!output)
+    {
+        throw std::runtime_error("cannot open file " + output_file_);
+    }
+
+    // the results of a batch are written while the next batch is fitted
+    Results results[2];
+    std::thread writer;
+    std::exception_ptr write_error;
+
+    try
+    {
+        for (std::size_t first_fit = 0, batch_index = 0; first_fit < n_fits_; first_fit += batch_size_, batch_index++)
+        {
+            std::size_t const n_fits = std::min(batch_size_, n_fits_ - first_fit);
+            Results & batch_results = results[batch_index % 2];
+
+            fit_batch(first_fit, n_fits, batch_results);
+            release_batch(first_fit, n_fits);
+
+            if (writer.joinable())
+                writer.join();
+            if (write_error)
+                std::rethrow_exception(write_error);
+
+            writer = std::thread(
+                [this, &output, &batch_results, &write_error, n_fits]()
+                {
+                    try
+                    {
+                        write_results(output.get(), batch_results, n_fits);
+                    }
+                    catch (...)
+                    {
+                        write_error = std::current_exception();
+                    }
+                });
+        }
+    }
+    catch (...)
+    {
+        if (writer.joinable())
+            writer.join();
+        throw;
+    }
+
+    if (writer.joinable())
+        writer.join();
+    if (write_error)
+        std::rethrow_exception(write_error);
+
+    if (std::fclose(output.release()) != 0)
+    {
+        throw std::runtime_error("cannot write file " + output_file_);
+    }
+}
+
+void FileFit::fit_batch(std::size_t const first_fit, std::size_t const n_fits, Results & results)
+{
+    std::size_t const point_offset = first_fit * n_points_;
+    std::size_t const parameter_offset = first_fit * n_parameters_;
+
+    results.parameters.resize(n_fits * n_parameters_);
+    results.states.resize(n_fits);
+    results.chi_squares.resize(n_fits);
+    results.n_iterations.resize(n_fits);
+
+    // the per fit user info of the fits of this batch
+    char * const user_info
+        = per_fit_user_info_
+        ? user_info_ + point_offset * sizeof(float)
+        : user_info_;
+    std::size_t const user_info_size
+        = per_fit_user_info_
+        ? n_fits * n_points_ * sizeof(float)
+        : user_info_size_;
+
+    FitInterface fi(
+        data_file_.data() + data_offset_ + point_offset * data_type_size_,
+        weights_file_
+            ? reinterpret_cast< float const * >(weights_file_->data()) + point_offset
+            : 0,
+        n_fits,
+        n_points_,
+        tolerance_,
+        max_n_iterations_,
+        estimator_id_,
+        initial_parameters_file_
+            ? reinterpret_cast< float const * >(initial_parameters_file_->data()) + parameter_offset
+            : 0,
+        parameters_to_fit_.data(),
+        user_info,
+        user_info_size,
+        results.parameters.data(),
+        results.states.data(),
+        results.chi_squares.data(),
+        results.n_iterations.data(),
+        false,
+        0);
+
+    fi.fit(model_id_, context_);
+}
+
+// the input data of the fitted batch is not read again
+void FileFit::release_batch(std::size_t const first_fit, std::size_t const n_fits)
+{
+    std::size_t const point_offset = first_fit * n_points_;
+    std::size_t const n_batch_points = n_fits * n_points_;
+
+    data_file_.release(
+        data_offset_ + point_offset * data_type_size_,
+        n_batch_points * data_type_size_);
+
+    if (weights_file_)
+    {
+        weights_file_->release(point_offset * sizeof(float), n_batch_points * sizeof(float));
+    }
+
+    if (initial_parameters_file_)
+    {
+        initial_parameters_file_->release(
+            first_fit * n_parameters_ * sizeof(float),
+            n_fits * n_parameters_ * sizeof(float));
+    }
+}
+
+void FileFit::write_results(std::FILE * output, Results & results, std::size_t const n_fits) const
+{
+    std::size_t const parameters_size = n_parameters_ * sizeof(float);
+    std::size_t const record_size = parameters_size + 3 * 4;
+
+    results.records.resize(n_fits * record_size);
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        char * record = results.records.data() + fit_index * record_size;
+
+        std::memcpy(record, results.parameters.data() + fit_index * n_parameters_, parameters_size);
+        record += parameters_size;
+        std::memcpy(record, &results.states[fit_index], 4);
+        std::memcpy(record + 4, &results.chi_squares[fit_index], 4);
+        std::memcpy(record + 8, &results.n_iterations[fit_index], 4);
+    }
+
+    if (std::fwrite(results.records.data(), 1, results.records.size(), output) != results.records.size())
+    {
+        throw std::runtime_error("cannot write file " + output_file_);
+    }
+}
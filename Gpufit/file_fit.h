@@ -0,0 +1,100 @@
+#ifndef GPUFIT_FILE_FIT_H_INCLUDED
+#define GPUFIT_FILE_FIT_H_INCLUDED
+
+#include "mapped_file.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FitContext;
+
+/* Description of the FileFit class
+* ================================
+*
+* A file fit (gpufit_context_fit_file()) fits the data values stored in a raw
+* file, which may be larger than the host memory, and writes the results to an
+* output file. The input files are mapped into memory (see MappedFile), and
+* the fits are calculated in batches of batch_size fits. Each batch is fitted
+* by one fit call, which runs through the chunk pipeline of the fit context,
+* directly from the mapped input files. The results of a batch are written to
+* the output file by a writer thread while the next batch is fitted, and the
+* pages of the fitted input data are released. Hence the host memory used is
+* bounded by the results of two batches and the input data of the chunks in
+* flight, independent of the size of the files.
+*
+* User info of one float per data point of each fit, e.g. the X values of
+* LINEAR_1D, is split into batches like the data values. Any other user info is
+* shared by all batches.
+*
+* The output file contains a record of n_parameters + 3 values of 4 bytes for
+* each fit: the fitted parameters (float), the state (int), the chi-square
+* value (float) and the number of iterations (int).
+*
+*/
+
+class FileFit
+{
+public:
+    FileFit(
+        FitContext & context,
+        std::string const & data_file,
+        std::size_t const data_offset,
+        std::size_t const n_fits,
+        std::size_t const n_points,
+        char const * weights_file,
+        int const model_id,
+        char const * initial_parameters_file,
+        float const tolerance,
+        int const max_n_iterations,
+        int const * parameters_to_fit,
+        int const estimator_id,
+        std::size_t const user_info_size,
+        char * user_info,
+        std::string const & output_file,
+        std::size_t const batch_size);
+
+    void run();
+
+private:
+    // the results of a batch
+    struct Results
+    {
+        std::vector< float > parameters;
+        std::vector< int > states;
+        std::vector< float > chi_squares;
+        std::vector< int > n_iterations;
+        std::vector< char > records;
+    };
+
+    void fit_batch(std::size_t const first_fit, std::size_t const n_fits, Results & results);
+    void write_results(std::FILE * output, Results & results, std::size_t const n_fits) const;
+    void release_batch(std::size_t const first_fit, std::size_t const n_fits);
+
+    FitContext & context_;
+
+    int const n_points_;
+    int const model_id_;
+    float const tolerance_;
+    int const max_n_iterations_;
+    int const estimator_id_;
+    int n_parameters_;
+    std::vector< int > parameters_to_fit_;
+    std::size_t const user_info_size_;
+    char * const user_info_;
+    bool per_fit_user_info_;
+    std::size_t const data_type_size_;
+
+    std::size_t const data_offset_;
+    std::size_t n_fits_;
+    std::size_t const batch_size_;
+
+    MappedFile data_file_;
+    std::unique_ptr< MappedFile > weights_file_;
+    std::unique_ptr< MappedFile > initial_parameters_file_;
+    std::string const output_file_;
+};
+
+#endif
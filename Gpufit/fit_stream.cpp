@@ -0,0 +1,373 @@
+#include "fit_stream.h"
+#include "interface.h"
+#include "context.h"
+
+#include <algorithm>
+#include <limits>
+
+FitStream::FitStream(
+    FitContext & context,
+    std::size_t const n_points,
+    int const model_id,
+    int const estimator_id,
+    float const tolerance,
+    int const max_n_iterations,
+    int const * parameters_to_fit,
+    std::size_t const user_info_size,
+    char const * user_info,
+    bool const use_weights,
+    std::size_t const batch_size,
+    std::size_t const capacity,
+    double const max_latency)
+    :
+    context_(context),
+    n_points_(int(n_points)),
+    model_id_(model_id),
+    estimator_id_(estimator_id),
+    tolerance_(tolerance),
+    max_n_iterations_(max_n_iterations),
+    n_parameters_(FitInterface::get_number_of_parameters(model_id)),
+    parameters_to_fit_(),
+    user_info_(user_info, user_info ? user_info + user_info_size : user_info),
+    use_weights_(use_weights),
+    data_type_size_(context.info_.get_data_type_size()),
+    batch_size_(batch_size),
+    capacity_(capacity),
+    max_latency_(max_latency),
+    pushed_(0),
+    launched_(0),
+    fitted_(0),
+    consumed_(0),
+    oldest_push_time_(),
+    flushed_(0),
+    callback_(0),
+    user_data_(0),
+    stopped_(false),
+    error_(),
+    mutex_(),
+    worker_condition_(),
+    producer_condition_(),
+    worker_()
+{
+    if (n_points == 0 || n_points > std::size_t(std::numeric_limits< int >::max()))
+    {
+        throw std::runtime_error("invalid number of data points per fit");
+    }
+
+    if (n_parameters_ == 0)
+    {
+        throw std::runtime_error("invalid model ID");
+    }
+
+    if (!parameters_to_fit)
+    {
+        throw std::runtime_error("parameters to fit not set");
+    }
+
+    if (batch_size == 0 || capacity < batch_size)
+    {
+        throw std::runtime_error("invalid fit stream capacity");
+    }
+
+    if (!(max_latency >= 0.))
+    {
+        throw std::runtime_error("invalid maximum latency");
+    }
+
+    parameters_to_fit_.assign(parameters_to_fit, parameters_to_fit + n_parameters_);
+
+    data_.resize(capacity_ * n_points_ * data_type_size_);
+    if (use_weights_)
+        weights_.resize(capacity_ * n_points_);
+    initial_parameters_.resize(capacity_ * n_parameters_);
+    output_parameters_.resize(capacity_ * n_parameters_);
+    output_states_.resize(capacity_);
+    output_chi_squares_.resize(capacity_);
+    output_n_iterations_.resize(capacity_);
+
+    worker_ = std::thread(&FitStream::run, this);
+}
+
+FitStream::~FitStream()
+{
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        stopped_ = true;
+    }
+    worker_condition_.notify_one();
+    worker_.join();
+}
+
+void FitStream::rethrow_error()
+{
+    if (error_)
+    {
+        std::rethrow_exception(error_);
+    }
+}
+
+void FitStream::set_callback(gpufit_stream_callback const callback, void * const user_data)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    // the results of the fits pushed so far are read by poll()
+    if (pushed_ != consumed_)
+    {
+        throw std::runtime_error("fit stream not empty");
+    }
+
+    callback_ = callback;
+    user_data_ = user_data;
+}
+
+void FitStream::push(
+    std::size_t const n_fits,
+    void const * const data,
+    float const * const weights,
+    float const * const initial_parameters)
+{
+    if (n_fits > 0 && (!data || !initial_parameters))
+    {
+        throw std::runtime_error("invalid fit data");
+    }
+
+    if (use_weights_ != (weights != 0))
+    {
+        throw std::runtime_error("weights do not match the fit stream");
+    }
+
+    std::unique_lock< std::mutex > lock(mutex_);
+
+    rethrow_error();
+
+    // without a callback, the slots are freed by poll() only, pushing more
+    // fits than there are free slots would never return
+    if (!callback_ && n_fits > capacity_ - (pushed_ - consumed_))
+    {
+        throw std::runtime_error("fit stream full");
+    }
+
+    std::size_t n_pushed = 0;
+    while (n_pushed < n_fits)
+    {
+        producer_condition_.wait(lock, [this] { return error_ || pushed_ < consumed_ + capacity_; });
+
+        rethrow_error();
+
+        std::size_t const first_slot = pushed_ % capacity_;
+        std::size_t const n_slot_fits = std::min(
+            std::min(n_fits - n_pushed, consumed_ + capacity_ - pushed_),
+            capacity_ - first_slot);
+
+        std::size_t const data_size = n_points_ * data_type_size_;
+        std::copy(
+            static_cast< char const * >(data) + n_pushed * data_size,
+            static_cast< char const * >(data) + (n_pushed + n_slot_fits) * data_size,
+            data_.begin() + first_slot * data_size);
+
+        if (use_weights_)
+        {
+            std::copy(
+                weights + n_pushed * n_points_,
+                weights + (n_pushed + n_slot_fits) * n_points_,
+                weights_.begin() + first_slot * n_points_);
+        }
+
+        std::copy(
+            initial_parameters + n_pushed * n_parameters_,
+            initial_parameters + (n_pushed + n_slot_fits) * n_parameters_,
+            initial_parameters_.begin() + first_slot * n_parameters_);
+
+        if (pushed_ == launched_)
+        {
+            oldest_push_time_ = std::chrono::steady_clock::now();
+        }
+
+        pushed_ += n_slot_fits;
+        n_pushed += n_slot_fits;
+
+        worker_condition_.notify_one();
+    }
+}
+
+std::size_t FitStream::poll(
+    std::size_t const max_n_fits,
+    float * const output_parameters,
+    int * const output_states,
+    float * const output_chi_squares,
+    int * const output_n_iterations)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    rethrow_error();
+
+    if (callback_)
+    {
+        throw std::runtime_error("results passed to the fit stream callback");
+    }
+
+    std::size_t n_polled = 0;
+    while (n_polled < max_n_fits && consumed_ < fitted_)
+    {
+        std::size_t const first_slot = consumed_ % capacity_;
+        std::size_t const n_slot_fits = std::min(
+            std::min(max_n_fits - n_polled, fitted_ - consumed_),
+            capacity_ - first_slot);
+        std::size_t const last_slot = first_slot + n_slot_fits;
+
+        if (output_parameters)
+        {
+            std::copy(
+                output_parameters_.begin() + first_slot * n_parameters_,
+                output_parameters_.begin() + last_slot * n_parameters_,
+                output_parameters + n_polled * n_parameters_);
+        }
+        if (output_states)
+        {
+            std::copy(
+                output_states_.begin() + first_slot,
+                output_states_.begin() + last_slot,
+                output_states + n_polled);
+        }
+        if (output_chi_squares)
+        {
+            std::copy(
+                output_chi_squares_.begin() + first_slot,
+                output_chi_squares_.begin() + last_slot,
+                output_chi_squares + n_polled);
+        }
+        if (output_n_iterations)
+        {
+            std::copy(
+                output_n_iterations_.begin() + first_slot,
+                output_n_iterations_.begin() + last_slot,
+                output_n_iterations + n_polled);
+        }
+
+        consumed_ += n_slot_fits;
+        n_polled += n_slot_fits;
+    }
+
+    producer_condition_.notify_all();
+
+    return n_polled;
+}
+
+// launches all queued fits and waits for their results
+void FitStream::flush()
+{
+    std::unique_lock< std::mutex > lock(mutex_);
+
+    std::size_t const n_flushed = pushed_;
+    flushed_ = n_flushed;
+    worker_condition_.notify_one();
+
+    producer_condition_.wait(lock, [this, n_flushed] { return error_ || fitted_ >= n_flushed; });
+
+    rethrow_error();
+}
+
+void FitStream::run()
+{
+    std::unique_lock< std::mutex > lock(mutex_);
+
+    while (true)
+    {
+        // waits for a full batch, a flush or the deadline of the oldest fit
+        while (!stopped_)
+        {
+            std::size_t const n_queued = pushed_ - launched_;
+
+            if (n_queued >= batch_size_ || (n_queued > 0 && flushed_ > launched_))
+                break;
+
+            if (n_queued == 0)
+            {
+                worker_condition_.wait(lock);
+            }
+            else if (worker_condition_.wait_until(lock, oldest_push_time_ + max_latency_) == std::cv_status::timeout)
+            {
+                break;
+            }
+        }
+
+        if (stopped_)
+            return;
+
+        // the fits up to the end of the ring buffer are fitted by one fit
+        // call, the fits wrapped around keep the push time of the oldest fit
+        // and are launched by the next iteration
+        std::size_t const first_slot = launched_ % capacity_;
+        std::size_t const n_fits = std::min(pushed_ - launched_, capacity_ - first_slot);
+        std::size_t const first_fit_index = launched_;
+        launched_ += n_fits;
+
+        gpufit_stream_callback const callback = callback_;
+        void * const user_data = user_data_;
+
+        lock.unlock();
+
+        try
+        {
+            fit(first_slot, n_fits);
+
+            if (callback)
+            {
+                gpufit_stream_results results;
+                results.first_fit_index = first_fit_index;
+                results.n_fits = n_fits;
+                results.parameters = output_parameters_.data() + first_slot * n_parameters_;
+                results.states = output_states_.data() + first_slot;
+                results.chi_squares = output_chi_squares_.data() + first_slot;
+                results.n_iterations = output_n_iterations_.data() + first_slot;
+
+                callback(&results, user_data);
+            }
+        }
+        catch (...)
+        {
+            lock.lock();
+            error_ = std::current_exception();
+            stopped_ = true;
+            producer_condition_.notify_all();
+            return;
+        }
+
+        lock.lock();
+
+        fitted_ += n_fits;
+        if (callback)
+        {
+            consumed_ += n_fits;
+        }
+
+        producer_condition_.notify_all();
+    }
+}
+
+void FitStream::fit(std::size_t const first_slot, std::size_t const n_fits)
+{
+    std::size_t const point_offset = first_slot * n_points_;
+    std::size_t const parameter_offset = first_slot * n_parameters_;
+
+    FitInterface fi(
+        data_.data() + point_offset * data_type_size_,
+        use_weights_ ? weights_.data() + point_offset : 0,
+        n_fits,
+        n_points_,
+        tolerance_,
+        max_n_iterations_,
+        estimator_id_,
+        initial_parameters_.data() + parameter_offset,
+        parameters_to_fit_.data(),
+        user_info_.empty() ? 0 : user_info_.data(),
+        user_info_.size(),
+        output_parameters_.data() + parameter_offset,
+        output_states_.data() + first_slot,
+        output_chi_squares_.data() + first_slot,
+        output_n_iterations_.data() + first_slot,
+        false,
+        0);
+
+    fi.fit(model_id_, context_);
+}
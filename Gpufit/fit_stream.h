@@ -0,0 +1,129 @@
+#ifndef GPUFIT_FIT_STREAM_H_INCLUDED
+#define GPUFIT_FIT_STREAM_H_INCLUDED
+
+#include "gpufit.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class FitContext;
+
+/* Description of the FitStream class
+* ==================================
+*
+* A fit stream (gpufit_create_stream()) fits a continuous sequence of fits of
+* the same model, estimator and size on a fit context. The fits pushed by the
+* producer are queued in a ring buffer holding the input data and the results
+* of up to capacity fits. A worker thread launches the queued fits as soon as
+* batch_size fits are queued, or the oldest queued fit waited longer than the
+* maximum latency. All queued fits up to the end of the ring buffer are fitted
+* by one fit call, which runs through the chunk pipeline of the fit context.
+*
+* The results are passed to the result callback in the order of the pushed
+* fits, or, without a callback, kept in the ring buffer until they are read by
+* poll(). A slot of the ring buffer is reused only after its results were
+* read, pushing blocks while the ring buffer is full.
+*
+* The positions in the sequence of fits are counted by
+*
+*   consumed_ <= fitted_ <= launched_ <= pushed_ <= consumed_ + capacity_
+*
+* The slots launched_ to pushed_ are written by push() only, the slots fitted_
+* to launched_ are accessed by the worker thread only and the slots consumed_
+* to fitted_ are read by poll() or the result callback only.
+*
+*/
+
+class FitStream
+{
+public:
+    FitStream(
+        FitContext & context,
+        std::size_t const n_points,
+        int const model_id,
+        int const estimator_id,
+        float const tolerance,
+        int const max_n_iterations,
+        int const * parameters_to_fit,
+        std::size_t const user_info_size,
+        char const * user_info,
+        bool const use_weights,
+        std::size_t const batch_size,
+        std::size_t const capacity,
+        double const max_latency);
+    ~FitStream();
+
+    void set_callback(gpufit_stream_callback const callback, void * const user_data);
+    void push(
+        std::size_t const n_fits,
+        void const * data,
+        float const * weights,
+        float const * initial_parameters);
+    std::size_t poll(
+        std::size_t const max_n_fits,
+        float * output_parameters,
+        int * output_states,
+        float * output_chi_squares,
+        int * output_n_iterations);
+    void flush();
+
+private:
+    void run();
+    void fit(std::size_t const first_slot, std::size_t const n_fits);
+    void rethrow_error();
+
+    FitContext & context_;
+
+    // fit configuration, shared by all fits of the stream
+    int const n_points_;
+    int const model_id_;
+    int const estimator_id_;
+    float const tolerance_;
+    int const max_n_iterations_;
+    int n_parameters_;
+    std::vector< int > parameters_to_fit_;
+    std::vector< char > user_info_;
+    bool const use_weights_;
+    std::size_t const data_type_size_;
+
+    std::size_t const batch_size_;
+    std::size_t const capacity_;
+    std::chrono::duration< double, std::milli > const max_latency_;
+
+    // ring buffer, capacity_ slots
+    std::vector< char > data_;
+    std::vector< float > weights_;
+    std::vector< float > initial_parameters_;
+    std::vector< float > output_parameters_;
+    std::vector< int > output_states_;
+    std::vector< float > output_chi_squares_;
+    std::vector< int > output_n_iterations_;
+
+    std::size_t pushed_;
+    std::size_t launched_;
+    std::size_t fitted_;
+    std::size_t consumed_;
+
+    // push time of the fit at position launched_
+    std::chrono::steady_clock::time_point oldest_push_time_;
+
+    // the fits up to this position are launched regardless of the batch size
+    std::size_t flushed_;
+
+    gpufit_stream_callback callback_;
+    void * user_data_;
+
+    bool stopped_;
+    std::exception_ptr error_;
+
+    std::mutex mutex_;
+    std::condition_variable worker_condition_;
+    std::condition_variable producer_condition_;
+    std::thread worker_;
+};
+
+#endif
@@ -1,85 +1,278 @@
+#include "gpufit.h"
 #include "gpu_data.cuh"
 #include <cuda_runtime.h>
 #include <device_launch_parameters.h>
+#include <algorithm>
+
+bool is_page_locked(void const * const pointer)
+{
+    cudaPointerAttributes attributes;
+    if (cudaPointerGetAttributes(&attributes, pointer) != cudaSuccess)
+    {
+        // pageable memory is reported as an error before CUDA 11
+        cudaGetLastError();
+        return false;
+    }
+#if CUDART_VERSION >= 10000
+    return attributes.type == cudaMemoryTypeHost;
+#else
+    return attributes.memoryType == cudaMemoryTypeHost;
+#endif
+}
 
 GPUData::GPUData(Info const & info) :
     chunk_size_(0),
     info_(info),
 
-    data_( info_.max_chunk_size_*info_.n_points_ ),
-    weights_( info_.use_weights_ ? info_.n_points_ * info_.max_chunk_size_ : 0 ),
-    parameters_( info_.max_chunk_size_*info_.n_parameters_ ),
+    allocated_chunk_size_( info.max_chunk_size_ ),
+    allocated_n_points_( info.n_points_ ),
+    allocated_data_type_size_( info.get_data_type_size() ),
+    allocated_n_parameters_( info.n_parameters_ ),
+    allocated_n_parameters_to_fit_( info.n_parameters_to_fit_ ),
+    allocated_user_info_size_( info.user_info_size_ ),
+    allocated_weights_( info.use_weights_ ),
+    allocated_derivatives_( !info.use_on_the_fly_hessians_ ),
+    allocated_cublas_( info.solver_id_ == SOLVER_CUBLAS ),
+    allocated_io_buffers_( !info.data_on_gpu_ ),
+    allocated_n_uncertainties_( info.get_n_uncertainties() ),
+
+    streamed_( info.n_streams_ > 1 ),
+    inputs_staged_( 0 ),
+    results_staged_( 0 ),
+    own_stream_( 0 ),
+    chunk_index_( 0 ),
+    first_fit_index_( 0 ),
+    stream_( 0 ),
+
+    // the input and output arrays of fits with data in GPU memory are not
+    // allocated, they refer to the memory of the caller
+    data_( allocated_io_buffers_ ? info_.max_chunk_size_*info_.n_points_*allocated_data_type_size_ : 0 ),
+    weights_( allocated_io_buffers_ && info_.use_weights_ ? info_.n_points_ * info_.max_chunk_size_ : 0 ),
+    parameters_( allocated_io_buffers_ ? info_.max_chunk_size_*info_.n_parameters_ : 0 ),
     prev_parameters_( info_.max_chunk_size_*info_.n_parameters_ ),
     parameters_to_fit_indices_( info_.n_parameters_to_fit_ ),
-    user_info_( info_.user_info_size_ ),
+    user_info_( allocated_io_buffers_ ? info_.user_info_size_ : 0 ),
 
-    chi_squares_( info_.max_chunk_size_ ),
+    chi_squares_( allocated_io_buffers_ ? info_.max_chunk_size_ : 0 ),
     prev_chi_squares_( info_.max_chunk_size_ ),
     gradients_( info_.max_chunk_size_ * info_.n_parameters_to_fit_ ),
     hessians_( info_.max_chunk_size_ * info_.n_parameters_to_fit_ * info_.n_parameters_to_fit_ ),
     deltas_(info_.max_chunk_size_ * info_.n_parameters_to_fit_),
 
-    values_( info_.max_chunk_size_ * info_.n_points_ ),
-    derivatives_( info_.max_chunk_size_ * info_.n_points_ * info_.n_parameters_ ),
+    values_( info_.use_on_the_fly_hessians_ ? 0 : info_.max_chunk_size_ * info_.n_points_ ),
+    derivatives_( info_.use_on_the_fly_hessians_ ? 0 : info_.max_chunk_size_ * info_.n_points_ * info_.n_parameters_to_fit_ ),
 
     lambdas_( info_.max_chunk_size_ ),
-    states_( info_.max_chunk_size_ ),
+    states_( allocated_io_buffers_ ? info_.max_chunk_size_ : 0 ),
     finished_( info_.max_chunk_size_ ),
     iteration_falied_(info_.max_chunk_size_),
-    all_finished_( 1 ),
-    n_iterations_( info_.max_chunk_size_ )
+    n_iterations_( allocated_io_buffers_ ? info_.max_chunk_size_ : 0 ),
+    singular_tests_( info_.max_chunk_size_ ),
+    active_fits_( info_.max_chunk_size_ ),
+    compacted_fits_( info_.max_chunk_size_ ),
+    n_active_fits_( 1 ),
+    uncertainties_( info_.max_chunk_size_ * allocated_n_uncertainties_ ),
+
+#ifdef USE_CUBLAS
+    cublas_handle_( 0 ),
+    decomposed_hessians_( allocated_cublas_ ? info_.max_chunk_size_ * info_.n_parameters_to_fit_ * info_.n_parameters_to_fit_ : 0 ),
+    pointers_decomposed_hessians_( allocated_cublas_ ? info_.max_chunk_size_ : 0 ),
+    pointers_deltas_( allocated_cublas_ ? info_.max_chunk_size_ : 0 ),
+    pivot_indices_( allocated_cublas_ ? info_.max_chunk_size_ * info_.n_parameters_to_fit_ : 0 ),
+#endif
+
+    host_data_( streamed_ ? info_.max_chunk_size_*info_.n_points_*allocated_data_type_size_ : 0 ),
+    host_weights_( streamed_ && info_.use_weights_ ? info_.max_chunk_size_*info_.n_points_ : 0 ),
+    host_initial_parameters_( streamed_ ? info_.max_chunk_size_*info_.n_parameters_ : 0 ),
+    host_parameters_( streamed_ ? info_.max_chunk_size_*info_.n_parameters_ : 0 ),
+    host_states_( streamed_ ? info_.max_chunk_size_ : 0 ),
+    host_chi_squares_( streamed_ ? info_.max_chunk_size_ : 0 ),
+    host_n_iterations_( streamed_ ? info_.max_chunk_size_ : 0 ),
+    host_uncertainties_( streamed_ ? info_.max_chunk_size_ * allocated_n_uncertainties_ : 0 )
 {
+    if (streamed_)
+    {
+        CUDA_CHECK_STATUS(cudaStreamCreateWithFlags(&own_stream_, cudaStreamNonBlocking));
+        stream_ = own_stream_;
+        CUDA_CHECK_STATUS(cudaEventCreateWithFlags(&inputs_staged_, cudaEventDisableTiming));
+        CUDA_CHECK_STATUS(cudaEventCreateWithFlags(&results_staged_, cudaEventDisableTiming));
+    }
+
+#ifdef USE_CUBLAS
+    if (allocated_cublas_)
+    {
+        CUBLAS_CHECK_STATUS(cublasCreate(&cublas_handle_));
+        CUBLAS_CHECK_STATUS(cublasSetStream(cublas_handle_, stream_));
+    }
+#endif
+}
 
+GPUData::~GPUData()
+{
+#ifdef USE_CUBLAS
+    if (cublas_handle_)
+        cublasDestroy(cublas_handle_);
+#endif
+    if (inputs_staged_)
+        cudaEventDestroy(inputs_staged_);
+    if (results_staged_)
+        cudaEventDestroy(results_staged_);
+    if (own_stream_)
+        cudaStreamDestroy(own_stream_);
+}
+
+bool GPUData::is_sufficient() const
+{
+    return info_.max_chunk_size_ <= allocated_chunk_size_
+        && info_.n_points_ <= allocated_n_points_
+        && info_.get_data_type_size() <= allocated_data_type_size_
+        && info_.n_parameters_ <= allocated_n_parameters_
+        && info_.n_parameters_to_fit_ <= allocated_n_parameters_to_fit_
+        && info_.user_info_size_ <= allocated_user_info_size_
+        && (allocated_weights_ || !info_.use_weights_)
+        && (allocated_derivatives_ || info_.use_on_the_fly_hessians_)
+        && (allocated_cublas_ || info_.solver_id_ != SOLVER_CUBLAS)
+        && (allocated_io_buffers_ || info_.data_on_gpu_)
+        && info_.get_n_uncertainties() <= allocated_n_uncertainties_
+        && streamed_ == (info_.n_streams_ > 1);
 }
 
 void GPUData::reset(int const chunk_size)
 {
     chunk_size_ = chunk_size;
 
-    set(data_, 0.f, chunk_size_ * info_.n_points_);
-    if (info_.use_weights_)
-        set(weights_, 0.f, chunk_size_ * info_.n_points_);
-    set(parameters_, 0.f, chunk_size_ * info_.n_parameters_);
+    // the arrays may still refer to the device memory of the caller of a
+    // previous fit call with data on the GPU, which is not owned anymore
+    data_.detach();
+    weights_.detach();
+    parameters_.detach();
+    states_.detach();
+    chi_squares_.detach();
+    n_iterations_.detach();
+
+    // the input and output arrays in memory of the caller are not cleared
+    if (!info_.data_on_gpu_)
+    {
+        CUDA_CHECK_STATUS(cudaMemsetAsync(
+            data_, 0, chunk_size_ * info_.n_points_ * info_.get_data_type_size(), stream_));
+        if (info_.use_weights_)
+            set(weights_, 0.f, chunk_size_ * info_.n_points_);
+        set(parameters_, 0.f, chunk_size_ * info_.n_parameters_);
+    }
     set(prev_parameters_, 0.f, chunk_size_ * info_.n_parameters_);
     set(parameters_to_fit_indices_, 0, info_.n_parameters_to_fit_);
 
-    set(chi_squares_, 0.f, chunk_size_);
+    if (!info_.data_on_gpu_)
+        set(chi_squares_, 0.f, chunk_size_);
     set(prev_chi_squares_, 0.f, chunk_size_);
     set(gradients_, 0.f, chunk_size_ * info_.n_parameters_to_fit_);
     set(hessians_, 0.f, chunk_size_ * info_.n_parameters_to_fit_ * info_.n_parameters_to_fit_);
     set(deltas_, 0.f, chunk_size_ * info_.n_parameters_to_fit_);
 
-    set(values_, 0.f, chunk_size_*info_.n_points_);
-    set(derivatives_, 0.f, chunk_size_ * info_.n_points_ * info_.n_parameters_);
+    if (!info_.use_on_the_fly_hessians_)
+    {
+        set(values_, 0.f, chunk_size_*info_.n_points_);
+        set(derivatives_, 0.f, chunk_size_ * info_.n_points_ * info_.n_parameters_to_fit_);
+    }
 
     set(lambdas_, 0.f, chunk_size_);
-    set(states_, 0, chunk_size_);
+    if (!info_.data_on_gpu_)
+        set(states_, 0, chunk_size_);
     set(finished_, 0, chunk_size_);
     set(iteration_falied_, 0, chunk_size_);
-    set(all_finished_, 0, 1);
-    set(n_iterations_, 0, chunk_size_);
+    set_indices(active_fits_, chunk_size_);
+    if (!info_.data_on_gpu_)
+        set(n_iterations_, 0, chunk_size_);
+
+#ifdef USE_CUBLAS
+    if (info_.solver_id_ == SOLVER_CUBLAS)
+    {
+        int const n_parameters_to_fit = info_.n_parameters_to_fit_;
+        set_pointers(
+            pointers_decomposed_hessians_,
+            decomposed_hessians_,
+            n_parameters_to_fit * n_parameters_to_fit,
+            chunk_size_);
+        set_pointers(pointers_deltas_, deltas_, n_parameters_to_fit, chunk_size_);
+    }
+#endif
 }
 
 void GPUData::init
 (
     int const chunk_index,
-    float const * const data,
+    void const * const data,
     float const * const weights,
     float const * const initial_parameters,
     std::vector<int> const & parameters_to_fit_indices)
 {
     chunk_index_ = chunk_index;
+    first_fit_index_ = int(info_.fit_offset_ + chunk_index_ * info_.max_chunk_size_);
+
+    // the transfers of the previous chunk of these buffers from the staging
+    // memory may still be queued, e.g. after a fused kernel or a direct linear
+    // fit, which do not synchronize the host with the device
+    if (streamed_)
+    {
+        CUDA_CHECK_STATUS(cudaEventSynchronize(inputs_staged_));
+    }
+
+    std::size_t const data_type_size = info_.get_data_type_size();
     write(
         data_,
-        &data[chunk_index_*info_.max_chunk_size_*info_.n_points_],
-        chunk_size_*info_.n_points_);
+        host_data_,
+        static_cast< char const * >(data) + chunk_index_*info_.max_chunk_size_*info_.n_points_*data_type_size,
+        chunk_size_*info_.n_points_*data_type_size);
     if (info_.use_weights_)
-        write(weights_, &weights[chunk_index_*info_.max_chunk_size_*info_.n_points_],
+        write(weights_, host_weights_, &weights[chunk_index_*info_.max_chunk_size_*info_.n_points_],
                 chunk_size_*info_.n_points_);
-    write(
-        parameters_,
-        &initial_parameters[chunk_index_*info_.max_chunk_size_*info_.n_parameters_],
-        chunk_size_ * info_.n_parameters_);
+    if (initial_parameters)
+        write(
+            parameters_,
+            host_initial_parameters_,
+            &initial_parameters[chunk_index_*info_.max_chunk_size_*info_.n_parameters_],
+            chunk_size_ * info_.n_parameters_);
+    write(parameters_to_fit_indices_, parameters_to_fit_indices);
+
+    if (streamed_)
+    {
+        CUDA_CHECK_STATUS(cudaEventRecord(inputs_staged_, stream_));
+    }
+
+    set(lambdas_, 0.001f, chunk_size_);
+}
+
+void GPUData::assign
+(
+    int const chunk_index,
+    void const * const data,
+    float const * const weights,
+    float * const parameters,
+    int * const states,
+    float * const chi_squares,
+    int * const n_iterations,
+    std::vector<int> const & parameters_to_fit_indices)
+{
+    chunk_index_ = chunk_index;
+    first_fit_index_ = int(info_.fit_offset_ + chunk_index_ * info_.max_chunk_size_);
+
+    // the fits of the current chunk are calculated in place in the device
+    // memory of the caller
+    std::size_t const fit_offset = chunk_index_ * info_.max_chunk_size_;
+
+    data_.assign(const_cast< char * >(
+        static_cast< char const * >(data) + fit_offset * info_.n_points_ * info_.get_data_type_size()));
+    if (info_.use_weights_)
+        weights_.assign(const_cast< float * >(&weights[fit_offset * info_.n_points_]));
+    parameters_.assign(&parameters[fit_offset * info_.n_parameters_]);
+    states_.assign(&states[fit_offset]);
+    chi_squares_.assign(&chi_squares[fit_offset]);
+    n_iterations_.assign(&n_iterations[fit_offset]);
+
+    set(chi_squares_, 0.f, chunk_size_);
+    set(states_, 0, chunk_size_);
+    set(n_iterations_, 0, chunk_size_);
+
     write(parameters_to_fit_indices_, parameters_to_fit_indices);
 
     set(lambdas_, 0.001f, chunk_size_);
@@ -87,36 +280,139 @@ void GPUData::init
 
 void GPUData::init_user_info(char const * const user_info)
 {
-    if (info_.user_info_size_ > 0)
-        write(user_info_, user_info, info_.user_info_size_);
+    if (info_.data_on_gpu_)
+    {
+        user_info_.assign(const_cast< char * >(user_info));
+    }
+    else
+    {
+        user_info_.detach();
+        if (info_.user_info_size_ > 0)
+            write(user_info_, user_info, info_.user_info_size_);
+    }
+}
+
+void GPUData::set_stream(cudaStream_t const stream)
+{
+    stream_ = stream;
+
+#ifdef USE_CUBLAS
+    if (cublas_handle_)
+        CUBLAS_CHECK_STATUS(cublasSetStream(cublas_handle_, stream_));
+#endif
+}
+
+void GPUData::reset_stream()
+{
+    set_stream(own_stream_);
+}
+
+void GPUData::stage_results(
+    float * const parameters,
+    int * const states,
+    float * const chi_squares,
+    int * const n_iterations,
+    float * const uncertainties)
+{
+    // copies the results of the current chunk asynchronously to the staging
+    // memory or to page-locked output arrays, they are available after
+    // wait_for_results() returned
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(
+        parameters, parameters_, chunk_size_ * info_.n_parameters_ * sizeof(float),
+        cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(
+        states, states_, chunk_size_ * sizeof(int),
+        cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(
+        chi_squares, chi_squares_, chunk_size_ * sizeof(float),
+        cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(
+        n_iterations, n_iterations_, chunk_size_ * sizeof(int),
+        cudaMemcpyDeviceToHost, stream_));
+    if (info_.uncertainty_type_ != UNCERTAINTY_NONE)
+        CUDA_CHECK_STATUS(cudaMemcpyAsync(
+            uncertainties, uncertainties_, chunk_size_ * info_.get_n_uncertainties() * sizeof(float),
+            cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaEventRecord(results_staged_, stream_));
+}
+
+void GPUData::wait_for_results()
+{
+    CUDA_CHECK_STATUS(cudaEventSynchronize(results_staged_));
+}
+
+void GPUData::synchronize()
+{
+    CUDA_CHECK_STATUS(cudaStreamSynchronize(stream_));
 }
 
 void GPUData::read(bool * dst, int const * src)
 {
     int int_dst = 0;
-    CUDA_CHECK_STATUS(cudaMemcpy(&int_dst, src, sizeof(int), cudaMemcpyDeviceToHost));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(&int_dst, src, sizeof(int), cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaStreamSynchronize(stream_));
     * dst = (int_dst == 1) ? true : false;
 }
 
+void GPUData::read(int * dst, int const * src)
+{
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src, sizeof(int), cudaMemcpyDeviceToHost, stream_));
+    CUDA_CHECK_STATUS(cudaStreamSynchronize(stream_));
+}
+
 void GPUData::write(float* dst, float const * src, int const count)
 {
-    CUDA_CHECK_STATUS(cudaMemcpy(dst, src, count * sizeof(float), cudaMemcpyHostToDevice));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src, count * sizeof(float), cudaMemcpyHostToDevice, stream_));
+}
+
+void GPUData::write(float* dst, float * staging, float const * src, int const count)
+{
+    // page-locked memory of the caller is transferred asynchronously without
+    // staging
+    if (streamed_ && !is_page_locked(src))
+    {
+        // the previous transfer from the staging memory finished, see init
+        std::copy(src, src + count, staging);
+        write(dst, staging, count);
+    }
+    else
+    {
+        write(dst, src, count);
+    }
 }
 
 void GPUData::write(int* dst, std::vector<int> const & src)
 {
     std::size_t const size = src.size() * sizeof(int);
-    CUDA_CHECK_STATUS(cudaMemcpy(dst, src.data(), size, cudaMemcpyHostToDevice));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src.data(), size, cudaMemcpyHostToDevice, stream_));
 }
 
 void GPUData::write(char* dst, char const * src, std::size_t const count)
 {
-    CUDA_CHECK_STATUS(cudaMemcpy(dst, src, count * sizeof(char), cudaMemcpyHostToDevice));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src, count * sizeof(char), cudaMemcpyHostToDevice, stream_));
+}
+
+void GPUData::write(char* dst, char * staging, char const * src, std::size_t const count)
+{
+    if (streamed_ && !is_page_locked(src))
+    {
+        std::copy(src, src + count, staging);
+        write(dst, staging, count);
+    }
+    else
+    {
+        write(dst, src, count);
+    }
 }
 
 void GPUData::copy(float * dst, float const * src, std::size_t const count)
 {
-    CUDA_CHECK_STATUS(cudaMemcpy(dst, src, count * sizeof(float), cudaMemcpyDeviceToDevice));
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src, count * sizeof(float), cudaMemcpyDeviceToDevice, stream_));
+}
+
+void GPUData::copy(int * dst, int const * src, std::size_t const count)
+{
+    CUDA_CHECK_STATUS(cudaMemcpyAsync(dst, src, count * sizeof(int), cudaMemcpyDeviceToDevice, stream_));
 }
 
 __global__ void set_kernel(int* dst, int const value, int const count)
@@ -137,7 +433,7 @@ void GPUData::set(int* arr, int const value, int const count)
     dim3  threads(tx, 1, 1);
     dim3  blocks(bx, 1, 1);
 
-    set_kernel<<< blocks, threads >>>(arr, value, count);
+    set_kernel<<< blocks, threads, 0, stream_ >>>(arr, value, count);
     CUDA_CHECK_STATUS(cudaGetLastError());
 }
 
@@ -149,7 +445,7 @@ void GPUData::set(int* arr, int const value)
     dim3  threads(tx, 1, 1);
     dim3  blocks(bx, 1, 1);
 
-    set_kernel<<< blocks, threads >>>(arr, value, 1);
+    set_kernel<<< blocks, threads, 0, stream_ >>>(arr, value, 1);
     CUDA_CHECK_STATUS(cudaGetLastError());
 }
 
@@ -170,6 +466,50 @@ void GPUData::set(float* arr, float const value, int const count)
 
     dim3  threads(tx, 1, 1);
     dim3  blocks(bx, 1, 1);
-    set_kernel<<< blocks, threads >>>(arr, value, count);
+    set_kernel<<< blocks, threads, 0, stream_ >>>(arr, value, count);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+}
+
+__global__ void set_pointers_kernel(float ** pointers, float * base, int const stride, int const count)
+{
+    int const index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (index >= count)
+        return;
+
+    pointers[index] = base + index * stride;
+}
+
+void GPUData::set_pointers(float ** pointers, float * base, int const stride, int const count)
+{
+    int const tx = 256;
+    int const bx = (count / tx) + 1;
+
+    dim3  threads(tx, 1, 1);
+    dim3  blocks(bx, 1, 1);
+
+    set_pointers_kernel<<< blocks, threads, 0, stream_ >>>(pointers, base, stride, count);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+}
+
+__global__ void set_indices_kernel(int * indices, int const count)
+{
+    int const index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (index >= count)
+        return;
+
+    indices[index] = index;
+}
+
+void GPUData::set_indices(int * indices, int const count)
+{
+    int const tx = 256;
+    int const bx = (count / tx) + 1;
+
+    dim3  threads(tx, 1, 1);
+    dim3  blocks(bx, 1, 1);
+
+    set_indices_kernel<<< blocks, threads, 0, stream_ >>>(indices, count);
     CUDA_CHECK_STATUS(cudaGetLastError());
 }
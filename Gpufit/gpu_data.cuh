@@ -4,6 +4,9 @@
 #include "info.h"
 
 #include <cuda_runtime.h>
+#ifdef USE_CUBLAS
+#include <cublas_v2.h>
+#endif
 
 #include <stdexcept>
 #include <vector>
@@ -12,15 +15,16 @@
 template< typename Type >
 struct Device_Array
 {
-    explicit Device_Array( std::size_t const size )
+    explicit Device_Array( std::size_t const size ) : data_( 0 ), allocated_data_( 0 )
     {
         std::size_t const maximum_size = std::numeric_limits< std::size_t >::max() ;
         std::size_t const type_size = sizeof( Type ) ;
         if (size <= maximum_size / type_size)
         {
-            cudaError_t const status = cudaMalloc( & data_, size * type_size ) ;
+            cudaError_t const status = cudaMalloc( & allocated_data_, size * type_size ) ;
             if (status == cudaSuccess)
             {
+                data_ = allocated_data_ ;
                 return ;
             }
             else
@@ -34,7 +38,11 @@ struct Device_Array
         }
     }
 
-    ~Device_Array() { cudaFree( data_ ) ; }
+    ~Device_Array() { cudaFree( allocated_data_ ) ; }
+
+    // refers to device memory owned by the caller, until detach() is called
+    void assign( Type * const data ) { data_ = data ; }
+    void detach() { data_ = allocated_data_ ; }
 
     operator Type * () { return static_cast< Type * >( data_ ) ; }
     operator Type const * () const { return static_cast< Type * >( data_ ) ; }
@@ -56,45 +64,151 @@ struct Device_Array
         }
     }
 
+private:
+    void * data_ ;
+    void * allocated_data_ ;
+} ;
+
+template< typename Type >
+struct Host_Array
+{
+    explicit Host_Array( std::size_t const size ) : data_( 0 )
+    {
+        std::size_t const maximum_size = std::numeric_limits< std::size_t >::max() ;
+        std::size_t const type_size = sizeof( Type ) ;
+        if (size == 0)
+        {
+            return ;
+        }
+        if (size <= maximum_size / type_size)
+        {
+            // page-locked host memory, required for asynchronous transfers
+            cudaError_t const status = cudaMallocHost( & data_, size * type_size ) ;
+            if (status == cudaSuccess)
+            {
+                return ;
+            }
+            else
+            {
+                throw std::runtime_error( cudaGetErrorString( status ) ) ;
+            }
+        }
+        else
+        {
+            throw std::runtime_error( "maximum array size exceeded" ) ;
+        }
+    }
+
+    ~Host_Array() { if (data_) cudaFreeHost( data_ ) ; }
+
+    operator Type * () { return static_cast< Type * >( data_ ) ; }
+    operator Type const * () const { return static_cast< Type * >( data_ ) ; }
+
 private:
     void * data_ ;
 } ;
 
+// true if the host memory was allocated by cudaMallocHost or
+// gpufit_alloc_host, or registered by gpufit_register_host_buffer, the DMA
+// engines then transfer it directly without a staging buffer
+bool is_page_locked(void const * pointer);
+
 class GPUData
 {
 public:
     GPUData(Info const & info);
+    ~GPUData();
 
     void reset(int const chunk_size);
     void init
     (
         int const chunk_index,
-        float const * data,
+        void const * data,
         float const * weights,
         float const * initial_parameters,
         std::vector<int> const & parameters_to_fit_indices
     ) ;
+    void assign
+    (
+        int const chunk_index,
+        void const * data,
+        float const * weights,
+        float * parameters,
+        int * states,
+        float * chi_squares,
+        int * n_iterations,
+        std::vector<int> const & parameters_to_fit_indices
+    ) ;
     void init_user_info(char const * user_info);
+    void set_stream(cudaStream_t const stream);
+    void reset_stream();
+
+    void stage_results(
+        float * parameters,
+        int * states,
+        float * chi_squares,
+        int * n_iterations,
+        float * uncertainties);
+    void wait_for_results();
+    void synchronize();
 
     void read(bool * dst, int const * src);
+    void read(int * dst, int const * src);
     void set(int* arr, int const value);
+    void set(int* arr, int const value, int const count);
+    void set(float* arr, float const value, int const count);
+    void set_indices(int * indices, int const count);
     void copy(float * dst, float const * src, std::size_t const count);
+    void copy(int * dst, int const * src, std::size_t const count);
+
+    bool is_sufficient() const;
 
 private:
-	void set(float* arr, float const value, int const count);
-	void set(int* arr, int const value, int const count);
+    void set_pointers(float ** pointers, float * base, int const stride, int const count);
     void write(float* dst, float const * src, int const count);
+    void write(float* dst, float * staging, float const * src, int const count);
     void write(int* dst, std::vector<int> const & src);
     void write(char* dst, char const * src, std::size_t const count);
+    void write(char* dst, char * staging, char const * src, std::size_t const count);
 
 private:
     int chunk_size_;
     Info const & info_;
 
+    // sizes the device memory was allocated for
+    std::size_t const allocated_chunk_size_;
+    int const allocated_n_points_;
+    std::size_t const allocated_data_type_size_;
+    int const allocated_n_parameters_;
+    int const allocated_n_parameters_to_fit_;
+    std::size_t const allocated_user_info_size_;
+    bool const allocated_weights_;
+    bool const allocated_derivatives_;
+    bool const allocated_cublas_;
+    bool const allocated_io_buffers_;
+    std::size_t const allocated_n_uncertainties_;
+
+    // in streamed mode the transfers are asynchronous and use page-locked
+    // staging memory
+    bool const streamed_;
+    cudaEvent_t inputs_staged_;
+    cudaEvent_t results_staged_;
+
+    // the stream created for streamed mode, stream_ may refer to a stream of
+    // the caller instead
+    cudaStream_t own_stream_;
+
 public:
     int chunk_index_;
 
-    Device_Array< float > data_;
+    // index of the first fit of the current chunk within the complete set of
+    // fits, including the offset of the fits distributed to other devices
+    int first_fit_index_;
+
+    cudaStream_t stream_;
+
+    // data values of the type selected by OPTION_DATA_TYPE
+    Device_Array< char > data_;
     Device_Array< float > weights_;
     Device_Array< float > parameters_;
     Device_Array< float > prev_parameters_;
@@ -109,14 +223,43 @@ public:
 
 
     Device_Array< float > values_;
+    // the derivatives with respect to the fitted parameters only
     Device_Array< float > derivatives_;
 
     Device_Array< float > lambdas_;
     Device_Array< int > states_;
     Device_Array< int > finished_;
     Device_Array< int > iteration_falied_;
-    Device_Array< int > all_finished_;
     Device_Array< int > n_iterations_;
+    Device_Array< int > singular_tests_;
+
+    // indices of the fits which are not finished, see
+    // LMFitCUDA::compact_active_fits
+    Device_Array< int > active_fits_;
+    Device_Array< int > compacted_fits_;
+    Device_Array< int > n_active_fits_;
+
+    // standard deviations or covariances of the fitted parameters, see
+    // LMFitCUDA::calc_uncertainties
+    Device_Array< float > uncertainties_;
+
+#ifdef USE_CUBLAS
+    // scratch buffers of the cuBLAS solver
+    cublasHandle_t cublas_handle_;
+    Device_Array< float > decomposed_hessians_;
+    Device_Array< float * > pointers_decomposed_hessians_;
+    Device_Array< float * > pointers_deltas_;
+    Device_Array< int > pivot_indices_;
+#endif
+
+    Host_Array< char > host_data_;
+    Host_Array< float > host_weights_;
+    Host_Array< float > host_initial_parameters_;
+    Host_Array< float > host_parameters_;
+    Host_Array< int > host_states_;
+    Host_Array< float > host_chi_squares_;
+    Host_Array< int > host_n_iterations_;
+    Host_Array< float > host_uncertainties_;
 };
 
 #endif
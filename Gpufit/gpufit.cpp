@@ -1,5 +1,9 @@
 #include "gpufit.h"
 #include "interface.h"
+#include "context.h"
+#include "fit_stream.h"
+#include "file_fit.h"
+#include "jit_models.h"
 
 #include <string>
 
@@ -24,8 +28,101 @@ int gpufit
     float * output_chi_squares,
     int * output_n_iterations
 )
+{
+    FitContext context;
+
+    return gpufit_context_fit(
+        &context,
+        n_fits,
+        n_points,
+        data,
+        weights,
+        model_id,
+        initial_parameters,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info_size,
+        user_info,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations);
+}
+
+int gpufit_context_fit
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations
+)
+{
+    return gpufit_context_fit_uncertainties(
+        context,
+        n_fits,
+        n_points,
+        data,
+        weights,
+        model_id,
+        initial_parameters,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info_size,
+        user_info,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations,
+        UNCERTAINTY_NONE,
+        0);
+}
+
+int gpufit_context_fit_uncertainties
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    int uncertainty_type,
+    float * output_uncertainties
+)
 try
 {
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
     __int32 n_points_32 = 0;
     if (n_points <= (unsigned int)(std::numeric_limits<__int32>::max()))
     {
@@ -51,9 +148,128 @@ try
         output_parameters,
         output_states,
         output_chi_squares,
-        output_n_iterations);
+        output_n_iterations,
+        false,
+        0);
+
+    fi.set_uncertainty_output(uncertainty_type, output_uncertainties);
+    fi.fit(model_id, * static_cast< FitContext * >(context));
+
+    return STATUS_OK ;
+}
+catch( std::exception & exception )
+{
+    last_error = exception.what() ;
+
+    return STATUS_ERROR ;
+}
+catch( ... )
+{
+    last_error = "unknown error" ;
+
+    return STATUS_ERROR;
+}
+
+int gpufit_cuda_interface
+(
+    size_t n_fits,
+    size_t n_points,
+    float * gpu_data,
+    float * gpu_weights,
+    int model_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * gpu_user_info,
+    float * gpu_fit_parameters,
+    int * gpu_output_states,
+    float * gpu_output_chi_squares,
+    int * gpu_output_n_iterations
+)
+{
+    FitContext context;
+
+    return gpufit_context_cuda_interface(
+        &context,
+        n_fits,
+        n_points,
+        gpu_data,
+        gpu_weights,
+        model_id,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info_size,
+        gpu_user_info,
+        gpu_fit_parameters,
+        gpu_output_states,
+        gpu_output_chi_squares,
+        gpu_output_n_iterations,
+        0);
+}
+
+int gpufit_context_cuda_interface
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * gpu_data,
+    float * gpu_weights,
+    int model_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * gpu_user_info,
+    float * gpu_fit_parameters,
+    int * gpu_output_states,
+    float * gpu_output_chi_squares,
+    int * gpu_output_n_iterations,
+    struct CUstream_st * stream
+)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    __int32 n_points_32 = 0;
+    if (n_points <= (unsigned int)(std::numeric_limits<__int32>::max()))
+    {
+        n_points_32 = __int32(n_points);
+    }
+    else
+    {
+        throw std::runtime_error("maximum number of data points per fit exceeded");
+    }
 
-    fi.fit(model_id);
+    // the fit parameters are initialized with the initial parameters and
+    // overwritten by the fit results
+    FitInterface fi(
+        gpu_data,
+        gpu_weights,
+        n_fits,
+        n_points_32,
+        tolerance,
+        max_n_iterations,
+        estimator_id,
+        gpu_fit_parameters,
+        parameters_to_fit,
+        gpu_user_info,
+        user_info_size,
+        gpu_fit_parameters,
+        gpu_output_states,
+        gpu_output_chi_squares,
+        gpu_output_n_iterations,
+        true,
+        stream);
+
+    fi.fit(model_id, * static_cast< FitContext * >(context));
 
     return STATUS_OK ;
 }
@@ -70,6 +286,477 @@ catch( ... )
     return STATUS_ERROR;
 }
 
+int gpufit_create_context(void ** context)
+try
+{
+    * context = new FitContext();
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_destroy_context(void * context)
+try
+{
+    delete static_cast< FitContext * >(context);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_set_option(void * context, int option_id, double value)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    static_cast< FitContext * >(context)->set_option(option_id, value);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_get_profile(void * context, struct gpufit_profile * profile)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    * profile = static_cast< FitContext * >(context)->profiler_.get_profile();
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_set_profile_callback(void * context, gpufit_profile_callback callback, void * user_data)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    static_cast< FitContext * >(context)->profiler_.set_callback(callback, user_data);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_set_coordinates
+(
+    void * context,
+    size_t n_points,
+    size_t n_grids,
+    float const * x_coordinates,
+    float const * y_coordinates,
+    size_t n_offsets,
+    float const * offsets
+)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    static_cast< FitContext * >(context)->coordinate_grid_.set(
+        n_points, n_grids, x_coordinates, y_coordinates, n_offsets, offsets);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_set_warm_start_mask(void * context, size_t n_fits, int const * mask)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    static_cast< FitContext * >(context)->warm_start_.set_mask(n_fits, mask);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_set_constraints
+(
+    void * context,
+    size_t n_sets,
+    size_t n_parameters,
+    float const * constraints,
+    int const * constraint_types
+)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    static_cast< FitContext * >(context)->parameter_constraints_.set(
+        n_sets, n_parameters, constraints, constraint_types);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_context_fit_file
+(
+    void * context,
+    char const * data_file,
+    size_t data_offset,
+    size_t n_fits,
+    size_t n_points,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    char const * output_file,
+    size_t batch_size
+)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    if (!data_file || !output_file)
+    {
+        throw std::runtime_error("file name not set");
+    }
+
+    FileFit file_fit(
+        * static_cast< FitContext * >(context),
+        data_file,
+        data_offset,
+        n_fits,
+        n_points,
+        weights_file,
+        model_id,
+        initial_parameters_file,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        estimator_id,
+        user_info_size,
+        user_info,
+        output_file,
+        batch_size);
+
+    file_fit.run();
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_create_stream
+(
+    void ** stream,
+    void * context,
+    size_t n_points,
+    int model_id,
+    int estimator_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    size_t user_info_size,
+    char * user_info,
+    int use_weights,
+    size_t batch_size,
+    size_t capacity,
+    double max_latency
+)
+try
+{
+    if (!context)
+    {
+        throw std::runtime_error("invalid fit context");
+    }
+
+    * stream = new FitStream(
+        * static_cast< FitContext * >(context),
+        n_points,
+        model_id,
+        estimator_id,
+        tolerance,
+        max_n_iterations,
+        parameters_to_fit,
+        user_info_size,
+        user_info,
+        use_weights != 0,
+        batch_size,
+        capacity,
+        max_latency);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_destroy_stream(void * stream)
+try
+{
+    delete static_cast< FitStream * >(stream);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_stream_set_callback(void * stream, gpufit_stream_callback callback, void * user_data)
+try
+{
+    if (!stream)
+    {
+        throw std::runtime_error("invalid fit stream");
+    }
+
+    static_cast< FitStream * >(stream)->set_callback(callback, user_data);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_stream_push
+(
+    void * stream,
+    size_t n_fits,
+    float * data,
+    float * weights,
+    float * initial_parameters
+)
+try
+{
+    if (!stream)
+    {
+        throw std::runtime_error("invalid fit stream");
+    }
+
+    static_cast< FitStream * >(stream)->push(n_fits, data, weights, initial_parameters);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_stream_poll
+(
+    void * stream,
+    size_t max_n_fits,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    size_t * n_fits
+)
+try
+{
+    if (!stream)
+    {
+        throw std::runtime_error("invalid fit stream");
+    }
+
+    * n_fits = static_cast< FitStream * >(stream)->poll(
+        max_n_fits,
+        output_parameters,
+        output_states,
+        output_chi_squares,
+        output_n_iterations);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_stream_flush(void * stream)
+try
+{
+    if (!stream)
+    {
+        throw std::runtime_error("invalid fit stream");
+    }
+
+    static_cast< FitStream * >(stream)->flush();
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_register_model
+(
+    int * model_id,
+    char const * source,
+    char const * function_name,
+    int n_parameters
+)
+try
+{
+    if (!model_id || !source || !function_name)
+    {
+        throw std::runtime_error("invalid model source");
+    }
+
+    *model_id = JitModels::instance().register_model(source, function_name, n_parameters);
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_alloc_host(void ** pointer, size_t size)
+try
+{
+    if (!pointer)
+    {
+        throw std::runtime_error("invalid pointer");
+    }
+
+    // portable page-locked memory is transferred by DMA to all devices
+    CUDA_CHECK_STATUS(cudaHostAlloc(pointer, size, cudaHostAllocPortable));
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_free_host(void * pointer)
+try
+{
+    CUDA_CHECK_STATUS(cudaFreeHost(pointer));
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_register_host_buffer(void * pointer, size_t size)
+try
+{
+    if (!pointer || size == 0)
+    {
+        throw std::runtime_error("invalid host buffer");
+    }
+
+    CUDA_CHECK_STATUS(cudaHostRegister(pointer, size, cudaHostRegisterPortable));
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
+int gpufit_unregister_host_buffer(void * pointer)
+try
+{
+    CUDA_CHECK_STATUS(cudaHostUnregister(pointer));
+
+    return STATUS_OK;
+}
+catch (std::exception & exception)
+{
+    last_error = exception.what();
+
+    return STATUS_ERROR;
+}
+
 char const * gpufit_get_last_error()
 {
     return last_error.c_str() ;
@@ -127,4 +814,4 @@ int gpufit_portable_interface(int argc, void *argv[])
         (float *) argv[14],
         (int *) argv[15]);
 
-}
\ No newline at end of file
+}
@@ -9,9 +9,15 @@
 #define CAUCHY_2D_ELLIPTIC 4
 #define LINEAR_1D 5
 
+// ID of the first model registered by gpufit_register_model()
+#define FIRST_JIT_MODEL 100
+
 // estimator ID
 #define LSE 0
 #define MLE 1
+#define MLE_SCMOS 2
+#define LSE_HUBER 3
+#define LSE_CAUCHY 4
 
 // fit state
 #define STATE_CONVERGED 0
@@ -20,6 +26,61 @@
 #define STATE_NEG_CURVATURE_MLE 3
 #define STATE_GPU_NOT_READY 4
 
+// fit context option ID
+#define OPTION_N_STREAMS 0
+#define OPTION_CONVERGENCE_CHECK_INTERVAL 1
+#define OPTION_FUSED_KERNEL 2
+#define OPTION_ON_THE_FLY_HESSIANS 3
+#define OPTION_SOLVER 4
+#define OPTION_DEVICE 5
+#define OPTION_MULTI_DEVICE 6
+#define OPTION_DATA_TYPE 7
+#define OPTION_PRECISION 8
+#define OPTION_AUTOTUNE 9
+#define OPTION_GPU_MEMORY_BUDGET 10
+#define OPTION_PROFILING 11
+#define OPTION_WARM_START 12
+#define OPTION_DIRECT_LINEAR_FIT 13
+#define OPTION_CPU_THREADS 14
+
+// solver ID
+#define SOLVER_GAUSS_JORDAN 0
+#define SOLVER_CHOLESKY 1
+#define SOLVER_CUBLAS 2
+
+// constraint type
+#define CONSTRAINT_NONE 0
+#define CONSTRAINT_LOWER 1
+#define CONSTRAINT_UPPER 2
+#define CONSTRAINT_LOWER_UPPER 3
+
+// uncertainty type
+#define UNCERTAINTY_NONE 0
+#define UNCERTAINTY_STANDARD_DEVIATIONS 1
+#define UNCERTAINTY_COVARIANCES 2
+
+// data type ID
+#define DATA_TYPE_FLOAT 0
+#define DATA_TYPE_UINT16 1
+#define DATA_TYPE_HALF 2
+#define DATA_TYPE_UINT8 3
+
+// precision ID
+#define PRECISION_MIXED 0
+#define PRECISION_FLOAT 1
+#define PRECISION_COMPENSATED 2
+#define PRECISION_DOUBLE 3
+
+// profile phase ID
+#define PROFILE_PHASE_TRANSFERS 0
+#define PROFILE_PHASE_MODEL 1
+#define PROFILE_PHASE_CHI_SQUARES 2
+#define PROFILE_PHASE_GRADIENTS 3
+#define PROFILE_PHASE_HESSIANS 4
+#define PROFILE_PHASE_SOLVER 5
+#define PROFILE_PHASE_EVALUATION 6
+#define N_PROFILE_PHASES 7
+
 // gpufit return state
 #define STATUS_OK 0
 #define STATUS_ERROR -1
@@ -28,6 +89,57 @@
 extern "C" {
 #endif
 
+// CUDA stream type, compatible with cudaStream_t
+struct CUstream_st;
+
+// profile of the last fit call of a fit context, see OPTION_PROFILING
+struct gpufit_profile
+{
+    // GPU times of the phases in milliseconds, see PROFILE_PHASE_*
+    double phase_times[N_PROFILE_PHASES];
+
+    // host time of the fit call in milliseconds
+    double total_time;
+
+    size_t bytes_to_gpu;
+    size_t bytes_from_gpu;
+    size_t n_chunks;
+    size_t n_iterations;
+
+    // GPU memory in bytes of the buffers needed by the fit call, summed over
+    // all devices
+    size_t gpu_memory;
+};
+
+// profile of a single iteration, passed to the profile callback
+struct gpufit_iteration_profile
+{
+    int chunk_index;
+    int iteration;
+    int n_active_fits;
+
+    // GPU times in milliseconds of the phases completed since the previous
+    // iteration profile
+    double phase_times[N_PROFILE_PHASES];
+};
+
+typedef void (* gpufit_profile_callback)(struct gpufit_iteration_profile const * profile, void * user_data);
+
+// results of consecutive fits of a fit stream, passed to the stream callback
+struct gpufit_stream_results
+{
+    // position of the first fit in the sequence of fits pushed to the stream
+    size_t first_fit_index;
+    size_t n_fits;
+
+    float const * parameters;
+    int const * states;
+    float const * chi_squares;
+    int const * n_iterations;
+};
+
+typedef void (* gpufit_stream_callback)(struct gpufit_stream_results const * results, void * user_data);
+
 int gpufit
 (
     size_t n_fits,
@@ -56,6 +168,202 @@ int gpufit_get_cuda_version(int * runtime_version, int * driver_version);
 
 int gpufit_portable_interface(int argc, void *argv[]);
 
+int gpufit_create_context(void ** context);
+
+int gpufit_context_fit
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations
+) ;
+
+int gpufit_context_fit_uncertainties
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * data,
+    float * weights,
+    int model_id,
+    float * initial_parameters,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    int uncertainty_type,
+    float * output_uncertainties
+) ;
+
+int gpufit_cuda_interface
+(
+    size_t n_fits,
+    size_t n_points,
+    float * gpu_data,
+    float * gpu_weights,
+    int model_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * gpu_user_info,
+    float * gpu_fit_parameters,
+    int * gpu_output_states,
+    float * gpu_output_chi_squares,
+    int * gpu_output_n_iterations
+) ;
+
+int gpufit_context_cuda_interface
+(
+    void * context,
+    size_t n_fits,
+    size_t n_points,
+    float * gpu_data,
+    float * gpu_weights,
+    int model_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * gpu_user_info,
+    float * gpu_fit_parameters,
+    int * gpu_output_states,
+    float * gpu_output_chi_squares,
+    int * gpu_output_n_iterations,
+    struct CUstream_st * stream
+) ;
+
+int gpufit_destroy_context(void * context);
+
+int gpufit_context_set_option(void * context, int option_id, double value);
+
+int gpufit_context_get_profile(void * context, struct gpufit_profile * profile);
+
+int gpufit_context_set_profile_callback(void * context, gpufit_profile_callback callback, void * user_data);
+
+int gpufit_context_set_coordinates
+(
+    void * context,
+    size_t n_points,
+    size_t n_grids,
+    float const * x_coordinates,
+    float const * y_coordinates,
+    size_t n_offsets,
+    float const * offsets
+) ;
+
+int gpufit_context_set_warm_start_mask(void * context, size_t n_fits, int const * mask);
+
+int gpufit_context_set_constraints
+(
+    void * context,
+    size_t n_sets,
+    size_t n_parameters,
+    float const * constraints,
+    int const * constraint_types
+) ;
+
+int gpufit_context_fit_file
+(
+    void * context,
+    char const * data_file,
+    size_t data_offset,
+    size_t n_fits,
+    size_t n_points,
+    char const * weights_file,
+    int model_id,
+    char const * initial_parameters_file,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    int estimator_id,
+    size_t user_info_size,
+    char * user_info,
+    char const * output_file,
+    size_t batch_size
+) ;
+
+int gpufit_create_stream
+(
+    void ** stream,
+    void * context,
+    size_t n_points,
+    int model_id,
+    int estimator_id,
+    float tolerance,
+    int max_n_iterations,
+    int * parameters_to_fit,
+    size_t user_info_size,
+    char * user_info,
+    int use_weights,
+    size_t batch_size,
+    size_t capacity,
+    double max_latency
+) ;
+
+int gpufit_destroy_stream(void * stream);
+
+int gpufit_stream_set_callback(void * stream, gpufit_stream_callback callback, void * user_data);
+
+int gpufit_stream_push
+(
+    void * stream,
+    size_t n_fits,
+    float * data,
+    float * weights,
+    float * initial_parameters
+) ;
+
+int gpufit_stream_poll
+(
+    void * stream,
+    size_t max_n_fits,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations,
+    size_t * n_fits
+) ;
+
+int gpufit_stream_flush(void * stream);
+
+int gpufit_register_model
+(
+    int * model_id,
+    char const * source,
+    char const * function_name,
+    int n_parameters
+) ;
+
+int gpufit_alloc_host(void ** pointer, size_t size);
+
+int gpufit_free_host(void * pointer);
+
+int gpufit_register_host_buffer(void * pointer, size_t size);
+
+int gpufit_unregister_host_buffer(void * pointer);
+
 #ifdef __cplusplus
 }
 #endif
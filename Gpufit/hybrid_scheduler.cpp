@@ -0,0 +1,103 @@
+#include "hybrid_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+// duration of the blocks of Cpufit, short enough that Cpufit finishes shortly
+// after the GPU if the throughputs change
+static double const cpu_block_duration = 0.02;
+
+// fits per Cpufit thread of the first block, before Cpufit was measured
+static std::size_t const initial_fits_per_cpu_thread = 16;
+
+HybridScheduler::HybridScheduler() :
+    n_cpu_threads_(0),
+    front_(0),
+    back_(0)
+{
+    throughputs_[GPU] = 0.;
+    throughputs_[CPU] = 0.;
+}
+
+void HybridScheduler::begin(std::size_t const n_fits)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    front_ = 0;
+    back_ = n_fits;
+}
+
+std::size_t HybridScheduler::get_block_size(Worker const worker, std::size_t const n_remaining) const
+{
+    double const throughput = throughputs_[worker];
+    double const other_throughput = throughputs_[1 - worker];
+    bool const measured = throughput > 0. && other_throughput > 0.;
+
+    // share of the remaining fits which the worker calculates in the time the
+    // other worker calculates the rest
+    double const expected_n_fits
+        = std::ceil(double(n_remaining) * throughput / (throughput + other_throughput));
+
+    std::size_t n_fits = 0;
+
+    if (worker == GPU)
+    {
+        n_fits = measured ? std::size_t(expected_n_fits) : (n_remaining + 1) / 2;
+    }
+    else
+    {
+        n_fits = throughput > 0.
+            ? std::size_t(throughput * cpu_block_duration)
+            : initial_fits_per_cpu_thread * std::size_t(n_cpu_threads_);
+
+        if (measured)
+        {
+            n_fits = (std::min)(n_fits, std::size_t(expected_n_fits));
+        }
+    }
+
+    return (std::min)((std::max)(n_fits, std::size_t(1)), n_remaining);
+}
+
+bool HybridScheduler::next_block(Worker const worker, std::size_t & fit_offset, std::size_t & n_fits)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    if (front_ == back_)
+    {
+        return false;
+    }
+
+    n_fits = get_block_size(worker, back_ - front_);
+
+    if (worker == GPU)
+    {
+        fit_offset = front_;
+        front_ += n_fits;
+    }
+    else
+    {
+        back_ -= n_fits;
+        fit_offset = back_;
+    }
+
+    return true;
+}
+
+void HybridScheduler::report(Worker const worker, std::size_t const n_fits, double const seconds)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    if (seconds > 0.)
+    {
+        throughputs_[worker] = double(n_fits) / seconds;
+    }
+}
+
+// the remaining fits are not taken by any worker, after a worker failed
+void HybridScheduler::cancel()
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    back_ = front_;
+}
@@ -0,0 +1,58 @@
+#ifndef GPUFIT_HYBRID_SCHEDULER_H_INCLUDED
+#define GPUFIT_HYBRID_SCHEDULER_H_INCLUDED
+
+#include <cstddef>
+#include <mutex>
+
+/* Description of the HybridScheduler class
+* =========================================
+*
+* Shares the fits of a fit call between the GPU and Cpufit (OPTION_CPU_THREADS).
+* Both workers take blocks of consecutive fits from a common pool, the GPU from
+* the front and Cpufit from the back, until the pool is empty. The size of each
+* block follows from the throughputs of the workers measured by their previous
+* blocks, such that both workers are expected to finish at the same time. A
+* worker which finishes early takes a share of the remaining fits, hence the
+* split adapts to throughputs which differ from the measured ones. The
+* throughputs are kept between the fit calls of a fit context.
+*
+* Usage:
+*
+*   scheduler.begin(n_fits);
+*   in the thread of each worker:
+*       while (scheduler.next_block(worker, fit_offset, n_fits))
+*           ... fit the block ...
+*           scheduler.report(worker, n_fits, seconds);
+*
+*/
+
+class HybridScheduler
+{
+public:
+    enum Worker { GPU = 0, CPU = 1 };
+
+    HybridScheduler();
+
+    void begin(std::size_t const n_fits);
+    bool next_block(Worker const worker, std::size_t & fit_offset, std::size_t & n_fits);
+    void report(Worker const worker, std::size_t const n_fits, double const seconds);
+    void cancel();
+
+public:
+    // number of Cpufit threads, the fits are not shared if zero
+    int n_cpu_threads_;
+
+private:
+    std::size_t get_block_size(Worker const worker, std::size_t const n_remaining) const;
+
+    std::mutex mutex_;
+
+    // the fits not yet taken by a worker
+    std::size_t front_;
+    std::size_t back_;
+
+    // measured fits per second of each worker, zero if not yet measured
+    double throughputs_[2];
+};
+
+#endif
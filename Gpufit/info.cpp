@@ -1,4 +1,7 @@
+#include "gpufit.h"
 #include "info.h"
+#include "input_data.cuh"
+#include "jit_models.h"
 #include <algorithm>
 
 Info::Info() :
@@ -7,15 +10,41 @@ Info::Info() :
     max_chunk_size_(0),
     max_n_iterations_(0),
     n_points_(0),
-    power_of_two_n_points_(0),
+    n_threads_per_fit_(0),
     n_fits_(0),
     user_info_size_(0),
-    n_fits_per_block_(0),
     model_id_(0),
     estimator_id_(0),
+    use_weights_(false),
+    n_streams_(1),
+    convergence_check_interval_(1),
+    fused_kernel_enabled_(false),
+    use_fused_kernel_(false),
+    on_the_fly_hessians_enabled_(false),
+    use_on_the_fly_hessians_(false),
+    solver_id_(0),
+    linear_model_(false),
+    direct_linear_fit_enabled_(false),
+    use_direct_linear_fit_(false),
+    device_(0),
+    multi_device_(false),
+    fit_offset_(0),
+    data_on_gpu_(false),
+    estimate_initial_parameters_(false),
+    data_type_(DATA_TYPE_FLOAT),
+    precision_id_(PRECISION_MIXED),
+    autotune_(false),
+    gpu_memory_budget_(0.1),
+    uncertainty_type_(UNCERTAINTY_NONE),
+    allocated_gpu_memory_(0),
+    profiler_(0),
+    coordinates_(),
+    constraints_(),
+    warm_start_(0),
+    gpu_properties_initialized_(false),
     max_threads_(0),
     max_blocks_(0),
-    available_gpu_memory_(0)
+    free_gpu_memory_(0)
 {
 }
 
@@ -36,36 +65,116 @@ void Info::set_number_of_parameters_to_fit(int const * const parameters_to_fit)
     }
 }
 
-void Info::set_fits_per_block(std::size_t const current_chunk_size)
+std::size_t Info::get_available_gpu_memory() const
 {
-    n_fits_per_block_ = 8;
-    bool is_divisible = false;
-    bool enough_threads = false;
-    do 
+    if (gpu_memory_budget_ <= 1.)
+        return std::size_t(double(free_gpu_memory_) * gpu_memory_budget_);
+
+    return (std::min)(std::size_t(gpu_memory_budget_), free_gpu_memory_);
+}
+
+// the device memory of one fit, the sum of the per fit sizes of the buffers
+// of GPUData
+std::size_t Info::get_fit_memory() const
+{
+    std::size_t const n_points = std::size_t(n_points_);
+    std::size_t const n_parameters = std::size_t(n_parameters_);
+    std::size_t const n_parameters_to_fit = std::size_t(n_parameters_to_fit_);
+
+    // prev_parameters, prev_chi_squares, lambdas, gradients, deltas, hessians
+    std::size_t fit_memory
+        = sizeof(float)
+        * (n_parameters
+        + 2
+        + 2 * n_parameters_to_fit
+        + n_parameters_to_fit * n_parameters_to_fit);
+
+    // finished, iteration_failed, singular_tests, active_fits, compacted_fits
+    fit_memory += sizeof(int) * 5;
+
+    // the data, parameters and results in GPU memory of the caller are not
+    // copied
+    if (!data_on_gpu_)
+    {
+        fit_memory
+            += get_data_type_size() * n_points
+            + sizeof(float) * (n_parameters + 1)
+            + sizeof(int) * 2;
+        if (use_weights_)
+            fit_memory += sizeof(float) * n_points;
+    }
+
+    // model values and derivatives
+    if (!use_on_the_fly_hessians_)
+        fit_memory += sizeof(float) * n_points * (n_parameters_to_fit + 1);
+
+    // uncertainties
+    fit_memory += sizeof(float) * get_n_uncertainties();
+
+    // scratch buffers of the cuBLAS solver
+    if (solver_id_ == SOLVER_CUBLAS)
+        fit_memory
+            += sizeof(float) * n_parameters_to_fit * n_parameters_to_fit
+            + sizeof(int) * n_parameters_to_fit
+            + sizeof(float *) * 2;
+
+    return fit_memory;
+}
+
+// the device memory of one set of GPU buffers independent of the chunk size
+std::size_t Info::get_chunk_memory() const
+{
+    // cudaMalloc aligns each of the buffers, at most 30 buffers are allocated
+    std::size_t const allocation_alignment = 256;
+    std::size_t const n_buffers = 30;
+
+    // parameters_to_fit_indices, n_active_fits
+    std::size_t chunk_memory
+        = sizeof(int) * (n_parameters_to_fit_ + 1)
+        + allocation_alignment * n_buffers;
+
+    // the user info of the caller is used in place
+    if (!data_on_gpu_)
+        chunk_memory += user_info_size_;
+
+    return chunk_memory;
+}
+
+// the device memory of one set of GPU buffers of the maximum chunk size
+std::size_t Info::get_buffer_memory() const
+{
+    return get_chunk_memory() + max_chunk_size_ * get_fit_memory();
+}
+
+// the number of uncertainty values of one fit, the standard deviations or the
+// covariance matrix of all model parameters
+std::size_t Info::get_n_uncertainties() const
+{
+    switch (uncertainty_type_)
     {
-        n_fits_per_block_ /= 2;
-        is_divisible = current_chunk_size % n_fits_per_block_ == 0;
-        enough_threads = n_fits_per_block_ * n_points_ < max_threads_ / 4;
-    } while ((!is_divisible || !enough_threads) && n_fits_per_block_ > 1);
+    case UNCERTAINTY_STANDARD_DEVIATIONS:
+        return std::size_t(n_parameters_);
+    case UNCERTAINTY_COVARIANCES:
+        return std::size_t(n_parameters_) * std::size_t(n_parameters_);
+    default:
+        return 0;
+    }
 }
 
 void Info::set_max_chunk_size()
 {
-    int one_fit_memory
-        = sizeof(float)
-        *(2 * n_points_
-        + 2 * n_parameters_
-        + 2 * n_parameters_to_fit_
-        + 1 * n_parameters_to_fit_*n_parameters_to_fit_
-        + 1 * n_points_*n_parameters_
-        + 4)
-        + sizeof(int)
-        * 3;
-
-    if (use_weights_)
-        one_fit_memory += sizeof(float) * n_points_;
-
-    std::size_t tmp_chunk_size = available_gpu_memory_ / one_fit_memory;
+    std::size_t const fit_memory = get_fit_memory();
+    std::size_t const chunk_memory = get_chunk_memory();
+
+    // each stream uses its own set of GPU buffers
+    std::size_t const stream_memory = get_available_gpu_memory() / n_streams_;
+
+    if (stream_memory <= chunk_memory)
+    {
+        throw std::runtime_error("maximum user info size exceeded or GPU memory budget too small");
+    }
+
+    std::size_t tmp_chunk_size = (stream_memory - chunk_memory) / fit_memory;
     
     if (tmp_chunk_size == 0)
     {
@@ -97,28 +206,75 @@ void Info::set_max_chunk_size()
         tmp_chunk_size = highest_size_t_value / highest_factor;
     }
 
-    max_chunk_size_ = tmp_chunk_size;
-
-    int i = 1;
-    int const divisor = 10;
-    while (tmp_chunk_size > divisor)
+    // in streamed mode the fits are distributed to all streams
+    std::size_t n_chunks = (std::max)((n_fits_ + tmp_chunk_size - 1) / tmp_chunk_size, std::size_t(1));
+    if (n_streams_ > 1 && !data_on_gpu_)
     {
-        i *= divisor;
-        tmp_chunk_size /= divisor;
+        n_chunks = (std::max)(n_chunks, std::size_t(n_streams_));
     }
-    max_chunk_size_ = max_chunk_size_ / i * i;
-    max_chunk_size_ = std::min(max_chunk_size_, n_fits_);
+
+    // chunks of equal size instead of a small last chunk
+    max_chunk_size_ = (n_fits_ + n_chunks - 1) / n_chunks;
+    max_chunk_size_ = (std::max)(max_chunk_size_, std::size_t(1));
 }
 
 
+// the size of the data type of the kernels, see InputData
+std::size_t Info::get_data_type_size() const
+{
+    return InputData::get_data_type_size(data_type_);
+}
+
+void Info::set_device(int const device)
+{
+    if (device != device_)
+    {
+        device_ = device;
+        gpu_properties_initialized_ = false;
+    }
+}
+
 void Info::configure()
 {
-    power_of_two_n_points_ = 1;
-    while (power_of_two_n_points_ < n_points_)
+    n_threads_per_fit_ = 1;
+    while (n_threads_per_fit_ < n_points_ && n_threads_per_fit_ < max_threads_per_fit_)
     {
-        power_of_two_n_points_ *= 2;
+        n_threads_per_fit_ *= 2;
     }
 
-    get_gpu_properties();
+    // these kernels call the model functions compiled into the library
+    bool const jit_model = JitModels::is_jit_model(model_id_);
+
+    use_on_the_fly_hessians_
+        = on_the_fly_hessians_enabled_
+        && !jit_model
+        && n_points_ <= n_threads_per_fit_;
+
+    // the fused kernel sums the chi-square values and the gradients in single
+    // precision and the hessians in double precision
+    use_fused_kernel_
+        = fused_kernel_enabled_
+        && !jit_model
+        && (precision_id_ == PRECISION_MIXED || precision_id_ == PRECISION_FLOAT)
+        && n_parameters_ <= 7
+        && n_points_ <= 256;
+
+    use_direct_linear_fit_
+        = direct_linear_fit_enabled_
+        && linear_model_
+        && estimator_id_ == LSE;
+
+    // the current device is a property of the calling host thread
+    set_current_device();
+
+    // the device properties are queried only once for each Info object, which
+    // allows fit contexts to skip them in subsequent fit calls, the free memory
+    // may be taken by other processes or fit contexts in the meantime
+    if (!gpu_properties_initialized_)
+    {
+        get_gpu_properties();
+        gpu_properties_initialized_ = true;
+    }
+    get_free_gpu_memory();
     set_max_chunk_size();
 }
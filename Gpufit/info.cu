@@ -1,26 +1,26 @@
 #include "info.h"
 #include <cuda_runtime.h>
 
+void Info::set_current_device() const
+{
+    CUDA_CHECK_STATUS(cudaSetDevice(device_));
+}
+
 void Info::get_gpu_properties()
 {
     cudaDeviceProp devProp;
-    CUDA_CHECK_STATUS(cudaGetDeviceProperties(&devProp, 0));
+    CUDA_CHECK_STATUS(cudaGetDeviceProperties(&devProp, device_));
     max_threads_ = devProp.maxThreadsPerBlock;
     max_blocks_ = devProp.maxGridSize[0];
+}
 
+// the buffers of the fit context are available to its fits as well
+void Info::get_free_gpu_memory()
+{
     std::size_t free_bytes;
     std::size_t total_bytes;
     CUDA_CHECK_STATUS(cudaMemGetInfo(&free_bytes, &total_bytes));
-    available_gpu_memory_ = std::size_t(double(free_bytes) * 0.1);
-    
-    if (available_gpu_memory_ > user_info_size_)
-    {
-        available_gpu_memory_ -= user_info_size_;
-    }
-    else
-    {
-        throw std::runtime_error("maximum user info size exceeded");
-    }
+    free_gpu_memory_ = free_bytes + allocated_gpu_memory_;
 }
 
 int getDeviceCount()
@@ -28,4 +28,11 @@ int getDeviceCount()
 	int deviceCount;
 	CUDA_CHECK_STATUS(cudaGetDeviceCount(&deviceCount));
 	return deviceCount;
-}
\ No newline at end of file
+}
+
+int getDeviceMultiprocessorCount(int const device)
+{
+    int n_multiprocessors;
+    CUDA_CHECK_STATUS(cudaDeviceGetAttribute(&n_multiprocessors, cudaDevAttrMultiProcessorCount, device));
+    return n_multiprocessors;
+}
@@ -2,8 +2,13 @@
 #define GPUFIT_PARAMETERS_H_INCLUDED
 
 #include "definitions.h"
+#include "coordinates.h"
+#include "constraints.h"
 #include <vector>
 
+class Profiler;
+class WarmStart;
+
 
 class Info
 {
@@ -11,20 +16,31 @@ public:
     Info();
     virtual ~Info();
 
-    void set_fits_per_block(std::size_t const n_fits);
     void set_number_of_parameters_to_fit(int const * parameters_to_fit);
+    void set_device(int const device);
     void configure();
+    std::size_t get_data_type_size() const;
+    std::size_t get_buffer_memory() const;
+    std::size_t get_n_uncertainties() const;
 
 private:
+    void set_current_device() const;
     void get_gpu_properties();
+    void get_free_gpu_memory();
     void set_max_chunk_size();
+    std::size_t get_available_gpu_memory() const;
+    std::size_t get_fit_memory() const;
+    std::size_t get_chunk_memory() const;
 
 public:
     int n_parameters_;
     int n_parameters_to_fit_;
 
 	int n_points_;
-    int power_of_two_n_points_;
+
+    // threads of the kernels calculating a fit, a power of two not larger than
+    // max_threads_per_fit_, which loop over the data points of larger fits
+    int n_threads_per_fit_;
 
     std::size_t n_fits_;
 
@@ -32,17 +48,96 @@ public:
 
     int max_n_iterations_;
 	std::size_t max_chunk_size_;
-    int n_fits_per_block_;
     int model_id_;
     int estimator_id_;
     bool use_weights_;
 
+    int n_streams_;
+    int convergence_check_interval_;
+
+    // the fused kernel is used if it is enabled and the fit is small enough
+    bool fused_kernel_enabled_;
+    bool use_fused_kernel_;
+
+    // the hessians are accumulated while calculating the model values, and
+    // the model values and derivatives are not stored in GPU memory, if it is
+    // enabled and each data point is calculated by its own thread
+    bool on_the_fly_hessians_enabled_;
+    bool use_on_the_fly_hessians_;
+
+    int solver_id_;
+
+    // the model is linear in its parameters, see
+    // FitInterface::is_linear_model, and the least squares fits of such
+    // models are solved by a single undamped step if it is enabled
+    bool linear_model_;
+    bool direct_linear_fit_enabled_;
+    bool use_direct_linear_fit_;
+
+    // the CUDA device used by this Info object and, if multi_device_ is set,
+    // whether the fits are distributed to all visible devices
+    int device_;
+    bool multi_device_;
+
+    // index of the first fit within the complete set of fits of a fit call,
+    // non-zero for the parts of a fit call distributed to several devices
+    std::size_t fit_offset_;
+
+    // the data, weights, user info, parameters and results of the fit call
+    // are in GPU memory (gpufit_cuda_interface)
+    bool data_on_gpu_;
+
+    // no initial parameters were passed, they are estimated from the data
+    // before the first iteration, see estimates.cuh
+    bool estimate_initial_parameters_;
+
+    // type of the data values, converted to float by the kernels
+    int data_type_;
+
+    // types of the sums of chi-squares, gradients and hessians calculated by
+    // the kernels, see precision.cuh
+    int precision_id_;
+
+    // the number of fits per thread block is found by timing the kernels
+    // instead of by their occupancy, see AutotuneCache
+    bool autotune_;
+
+    // GPU memory used by the fits, a fraction of the free memory of the device
+    // if not larger than 1, otherwise a number of bytes
+    double gpu_memory_budget_;
+
+    // the uncertainties of the fitted parameters calculated from the hessian
+    // at the final parameters, see UNCERTAINTY_*
+    int uncertainty_type_;
+
+    // the device memory of the buffers of the fit context, which are reused or
+    // released before new buffers are allocated, see FitContext::get_gpu_data
+    std::size_t allocated_gpu_memory_;
+
+    // the profiler of the fit context, see OPTION_PROFILING
+    Profiler * profiler_;
+
+    // the coordinate grid of the fit context in device memory, see
+    // CoordinateGrid
+    Coordinates coordinates_;
+
+    // the box constraints of the parameters of the fit context in device
+    // memory, see ParameterConstraints
+    Constraints constraints_;
+
+    // the warm start state of the fit context, see OPTION_WARM_START
+    WarmStart * warm_start_;
+
 private:
+    static int const max_threads_per_fit_ = 256;
+
+    bool gpu_properties_initialized_;
     int max_threads_;
     std::size_t max_blocks_;
-    std::size_t available_gpu_memory_;
+    std::size_t free_gpu_memory_;
 };
 
 int getDeviceCount();
+int getDeviceMultiprocessorCount(int const device);
 
 #endif
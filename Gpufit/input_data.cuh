@@ -0,0 +1,78 @@
+#ifndef GPUFIT_INPUT_DATA_CUH_INCLUDED
+#define GPUFIT_INPUT_DATA_CUH_INCLUDED
+
+#include "gpufit.h"
+#include <cuda_runtime.h>
+#include <cuda_fp16.h>
+
+/* Description of the InputData struct
+* ====================================
+*
+* The data values are stored in GPU memory in the data type selected by
+* OPTION_DATA_TYPE, and converted to float when they are read by the kernels.
+* InputData refers to an array of data values of any of the supported types
+* and is passed to the kernels and estimator functions by value.
+*
+* Members:
+*
+* values: The device memory of the data values.
+*
+* data_type: The data type ID of the values, see gpufit.h.
+*
+* Usage:
+*
+*   InputData const current_data = data + first_point;
+*   float const deviation = value[point_index] - current_data[point_index];
+*
+*/
+
+struct InputData
+{
+    __host__ __device__ InputData(void const * const values, int const data_type) :
+        values_(static_cast< char const * >(values)),
+        data_type_(data_type)
+    {
+    }
+
+    // the data type is the same for all threads, the switch does not diverge
+    __device__ __forceinline__ float operator[](int const index) const
+    {
+        switch (data_type_)
+        {
+        case DATA_TYPE_UINT16:
+            return float(reinterpret_cast< unsigned short const * >(values_)[index]);
+        case DATA_TYPE_HALF:
+            return __half2float(reinterpret_cast< __half const * >(values_)[index]);
+        case DATA_TYPE_UINT8:
+            return float(reinterpret_cast< unsigned char const * >(values_)[index]);
+        default:
+            return reinterpret_cast< float const * >(values_)[index];
+        }
+    }
+
+    __host__ __device__ InputData operator+(std::size_t const offset) const
+    {
+        return InputData(values_ + offset * get_data_type_size(data_type_), data_type_);
+    }
+
+    __host__ __device__ static std::size_t get_data_type_size(int const data_type)
+    {
+        switch (data_type)
+        {
+        case DATA_TYPE_UINT16:
+            return sizeof(unsigned short);
+        case DATA_TYPE_HALF:
+            return sizeof(unsigned short);
+        case DATA_TYPE_UINT8:
+            return sizeof(unsigned char);
+        default:
+            return sizeof(float);
+        }
+    }
+
+private:
+    char const * values_;
+    int data_type_;
+};
+
+#endif
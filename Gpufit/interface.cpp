@@ -1,9 +1,19 @@
 #include "gpufit.h"
 #include "interface.h"
+#include "context.h"
+#include "jit_models.h"
+
+#ifdef USE_CPUFIT
+#include "Cpufit/cpufit.h"
+#endif
+
+#include <chrono>
+#include <exception>
+#include <thread>
 
 FitInterface::FitInterface
 (
-    float const * data,
+    void const * data,
     float const * weights,
     std::size_t n_fits,
     int n_points,
@@ -17,7 +27,9 @@ FitInterface::FitInterface
     float * output_parameters,
     int * output_states,
     float * output_chi_squares,
-    int * output_n_iterations
+    int * output_n_iterations,
+    bool data_on_gpu,
+    cudaStream_t stream
 ) :
     data_( data ),
     weights_( weights ),
@@ -34,12 +46,22 @@ FitInterface::FitInterface
     output_states_(output_states),
     output_chi_squares_(output_chi_squares),
     output_n_iterations_(output_n_iterations),
+    uncertainty_type_(UNCERTAINTY_NONE),
+    output_uncertainties_(0),
+    data_on_gpu_(data_on_gpu),
+    stream_(stream),
     n_parameters_(0)
 {}
 
 FitInterface::~FitInterface()
 {}
 
+void FitInterface::set_uncertainty_output(int const uncertainty_type, float * const output_uncertainties)
+{
+    uncertainty_type_ = uncertainty_type;
+    output_uncertainties_ = output_uncertainties;
+}
+
 void FitInterface::check_sizes()
 {
     std::size_t maximum_size = std::numeric_limits< std::size_t >::max();
@@ -55,33 +77,73 @@ void FitInterface::check_sizes()
     }
 }
 
-void FitInterface::set_number_of_parameters(int const model_id)
+int FitInterface::get_number_of_parameters(int const model_id)
 {
     switch (model_id)
     {
     case GAUSS_1D:
-        n_parameters_ = 4;
-        break;
+        return 4;
     case GAUSS_2D:
-        n_parameters_ = 5;
-        break;
+        return 5;
     case GAUSS_2D_ELLIPTIC:
-        n_parameters_ = 6;
-        break;
+        return 6;
     case GAUSS_2D_ROTATED:
-        n_parameters_ = 7;
-        break;
+        return 7;
     case CAUCHY_2D_ELLIPTIC:
-        n_parameters_ = 6;
-        break;
+        return 6;
     case LINEAR_1D:
-        n_parameters_ = 2;
-        break;
+        return 2;
     default:
-        break;
+        return JitModels::instance().get_number_of_parameters(model_id);
     }
 }
 
+// models whose values depend linearly on their parameters, the derivatives
+// do not depend on the parameters
+bool FitInterface::is_linear_model(int const model_id)
+{
+    switch (model_id)
+    {
+    case LINEAR_1D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool FitInterface::is_valid_estimator(int const estimator_id)
+{
+    switch (estimator_id)
+    {
+    case LSE:
+    case MLE:
+    case MLE_SCMOS:
+    case LSE_HUBER:
+    case LSE_CAUCHY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool FitInterface::is_valid_uncertainty_type(int const uncertainty_type)
+{
+    switch (uncertainty_type)
+    {
+    case UNCERTAINTY_NONE:
+    case UNCERTAINTY_STANDARD_DEVIATIONS:
+    case UNCERTAINTY_COVARIANCES:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void FitInterface::set_number_of_parameters(int const model_id)
+{
+    n_parameters_ = get_number_of_parameters(model_id);
+}
+
 void FitInterface::configure_info(Info & info, int const model_id)
 {
     info.model_id_ = model_id;
@@ -92,32 +154,355 @@ void FitInterface::configure_info(Info & info, int const model_id)
     info.user_info_size_ = user_info_size_;
     info.n_parameters_ = n_parameters_;
     info.use_weights_ = weights_ ? true : false;
+    info.data_on_gpu_ = data_on_gpu_;
+    info.estimate_initial_parameters_ = !initial_parameters_;
+    info.linear_model_ = is_linear_model(model_id);
+    info.uncertainty_type_ = uncertainty_type_;
 
     info.set_number_of_parameters_to_fit(parameters_to_fit_);
     info.configure();
 }
 
-void FitInterface::fit(int const model_id)
+void FitInterface::fit(int const model_id, FitContext & context)
 {
     set_number_of_parameters(model_id);
 
+    if (n_parameters_ == 0)
+    {
+        throw std::runtime_error("invalid model ID");
+    }
+
+    if (!is_valid_estimator(estimator_id_))
+    {
+        throw std::runtime_error("invalid estimator ID");
+    }
+
+    if (!is_valid_uncertainty_type(uncertainty_type_))
+    {
+        throw std::runtime_error("invalid uncertainty type");
+    }
+
+    if (uncertainty_type_ != UNCERTAINTY_NONE && !output_uncertainties_)
+    {
+        throw std::runtime_error("uncertainty output not set");
+    }
+
+    // the initial parameters of registered models are not estimated
+    if (!initial_parameters_ && JitModels::is_jit_model(model_id))
+    {
+        throw std::runtime_error("initial parameters not set");
+    }
+
     check_sizes();
 
-    Info info;
+    context.coordinate_grid_.check(n_fits_, n_points_);
+    context.parameter_constraints_.check(n_fits_, n_parameters_);
+    context.warm_start_.check(n_fits_);
+
+    context.profiler_.begin_fit();
+
+    // data in GPU memory is fitted on the device of the fit context
+    if (use_hybrid(model_id, context))
+    {
+        fit_hybrid(model_id, context);
+    }
+    else if (context.info_.multi_device_ && !data_on_gpu_ && n_fits_ > 1 && getDeviceCount() > 1)
+    {
+        fit_multi_device(model_id, context);
+    }
+    else
+    {
+        fit_device(model_id, context, 0);
+    }
+
+    context.profiler_.end_fit();
+}
+
+void FitInterface::fit_device(int const model_id, FitContext & context, std::size_t const fit_offset)
+{
+    Info & info = context.info_;
+    info.fit_offset_ = fit_offset;
     configure_info(info, model_id);
 
+    // the coordinate grid is copied to the device by the first fit call
+    // after it was set
+    info.coordinates_ = context.coordinate_grid_.get_coordinates(n_points_);
+    info.constraints_ = context.parameter_constraints_.get_constraints();
+
+    // the projection of the direct step onto the bounds is not the minimum
+    // of the constrained fit, it is found by the LM iterations
+    info.use_direct_linear_fit_ = info.use_direct_linear_fit_ && !info.constraints_.types;
+
+    context.warm_start_.begin(info);
+
     LMFit lmfit
     (
         data_,
         weights_,
         info,
+        context.get_gpu_data(),
         initial_parameters_,
         parameters_to_fit_,
         user_info_,
         output_parameters_,
         output_states_,
         output_chi_squares_,
-        output_n_iterations_
+        output_n_iterations_,
+        output_uncertainties_,
+        stream_
     ) ;
     lmfit.run(tolerance_);
+
+    context.warm_start_.end();
+}
+
+void FitInterface::fit_multi_device(int const model_id, FitContext & context)
+{
+    std::vector< FitContext * > const device_contexts = context.get_device_contexts();
+    std::size_t const n_devices = device_contexts.size();
+
+    // the fits are distributed in proportion to the number of multiprocessors
+    std::vector< int > n_multiprocessors(n_devices);
+    std::size_t total_n_multiprocessors = 0;
+    for (std::size_t i = 0; i < n_devices; i++)
+    {
+        n_multiprocessors[i] = getDeviceMultiprocessorCount(int(i));
+        total_n_multiprocessors += n_multiprocessors[i];
+    }
+
+    std::vector< std::size_t > n_device_fits(n_devices);
+    std::size_t n_fits_distributed = 0;
+    for (std::size_t i = 0; i < n_devices; i++)
+    {
+        n_device_fits[i] = std::size_t(
+            double(n_fits_) * n_multiprocessors[i] / total_n_multiprocessors);
+        n_fits_distributed += n_device_fits[i];
+    }
+    n_device_fits[0] += n_fits_ - n_fits_distributed;
+
+    // each device is driven by its own host thread, the results are written
+    // directly to the corresponding parts of the output arrays
+    std::vector< std::thread > threads;
+    std::vector< std::exception_ptr > exceptions(n_devices);
+    std::size_t fit_offset = 0;
+
+    for (std::size_t i = 0; i < n_devices; i++)
+    {
+        if (n_device_fits[i] == 0)
+        {
+            continue;
+        }
+
+        std::unique_ptr< FitInterface > device_interface
+            = create_part(fit_offset, n_device_fits[i], context.info_.get_data_type_size());
+
+        FitContext & device_context = *device_contexts[i];
+        std::exception_ptr & exception = exceptions[i];
+
+        // the profile callback is called by the device threads
+        device_context.profiler_.configure(context.profiler_);
+        device_context.coordinate_grid_.configure(context.coordinate_grid_);
+        device_context.parameter_constraints_.configure(context.parameter_constraints_);
+        device_context.warm_start_.configure(context.warm_start_);
+        device_context.profiler_.begin_fit();
+
+        threads.push_back(std::thread(
+            [&device_context, &exception, model_id, fit_offset](std::unique_ptr< FitInterface > fit_interface)
+            {
+                try
+                {
+                    fit_interface->fit_device(model_id, device_context, fit_offset);
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                }
+            },
+            std::move(device_interface)));
+
+        fit_offset += n_device_fits[i];
+    }
+
+    for (std::size_t i = 0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    for (std::size_t i = 0; i < n_devices; i++)
+    {
+        if (n_device_fits[i] > 0 && !exceptions[i])
+        {
+            device_contexts[i]->profiler_.end_fit();
+            context.profiler_.add(device_contexts[i]->profiler_.get_profile());
+        }
+    }
+
+    for (std::size_t i = 0; i < n_devices; i++)
+    {
+        if (exceptions[i])
+        {
+            std::rethrow_exception(exceptions[i]);
+        }
+    }
+}
+
+// the part of the fits of this fit call beginning at fit_offset, its results
+// are written to the corresponding parts of the output arrays
+std::unique_ptr< FitInterface > FitInterface::create_part(
+    std::size_t const fit_offset,
+    std::size_t const n_fits,
+    std::size_t const data_type_size) const
+{
+    std::size_t const point_offset = fit_offset * n_points_;
+    std::size_t const parameter_offset = fit_offset * n_parameters_;
+
+    std::unique_ptr< FitInterface > part(new FitInterface(
+        static_cast< char const * >(data_) + point_offset * data_type_size,
+        weights_ ? weights_ + point_offset : 0,
+        n_fits,
+        n_points_,
+        tolerance_,
+        max_n_iterations_,
+        estimator_id_,
+        initial_parameters_ ? initial_parameters_ + parameter_offset : 0,
+        const_cast< int * >(parameters_to_fit_),
+        user_info_,
+        user_info_size_,
+        output_parameters_ + parameter_offset,
+        output_states_ + fit_offset,
+        output_chi_squares_ + fit_offset,
+        output_n_iterations_ + fit_offset,
+        data_on_gpu_,
+        stream_));
+    part->n_parameters_ = n_parameters_;
+
+    if (uncertainty_type_ != UNCERTAINTY_NONE)
+    {
+        std::size_t const n_uncertainties
+            = uncertainty_type_ == UNCERTAINTY_COVARIANCES ? n_parameters_ * n_parameters_ : n_parameters_;
+
+        part->set_uncertainty_output(uncertainty_type_, output_uncertainties_ + fit_offset * n_uncertainties);
+    }
+
+    return part;
+}
+
+// Cpufit calculates the models and estimators included with both libraries,
+// in float data, from given initial parameters and at the coordinates given by
+// the indices of the data points or by user info shared by all fits, without
+// constraints and without uncertainties
+bool FitInterface::use_hybrid(int const model_id, FitContext const & context) const
+{
+    return context.hybrid_scheduler_.n_cpu_threads_ > 0
+        && !data_on_gpu_
+        && n_fits_ > 1
+        && context.info_.data_type_ == DATA_TYPE_FLOAT
+        && initial_parameters_
+        && (estimator_id_ == LSE || estimator_id_ == MLE)
+        && !JitModels::is_jit_model(model_id)
+        && !context.coordinate_grid_.is_set()
+        && !context.parameter_constraints_.is_set()
+        && uncertainty_type_ == UNCERTAINTY_NONE
+        && !context.warm_start_.enabled_
+        && user_info_size_ <= n_points_ * sizeof(float);
+}
+
+void FitInterface::fit_hybrid(int const model_id, FitContext & context)
+{
+    typedef std::chrono::steady_clock clock;
+
+    HybridScheduler & scheduler = context.hybrid_scheduler_;
+    int const n_cpu_threads = scheduler.n_cpu_threads_;
+    std::size_t const data_type_size = context.info_.get_data_type_size();
+
+    scheduler.begin(n_fits_);
+
+    // the GPU is driven by its own host thread, Cpufit by the calling thread,
+    // both write their results to the corresponding parts of the output arrays
+    std::exception_ptr gpu_exception;
+    std::thread gpu_thread(
+        [this, &context, &scheduler, &gpu_exception, model_id, data_type_size]()
+        {
+            try
+            {
+                std::size_t fit_offset = 0;
+                std::size_t n_fits = 0;
+                while (scheduler.next_block(HybridScheduler::GPU, fit_offset, n_fits))
+                {
+                    clock::time_point const start = clock::now();
+                    create_part(fit_offset, n_fits, data_type_size)->fit_device(model_id, context, fit_offset);
+                    std::chrono::duration< double > const duration = clock::now() - start;
+                    scheduler.report(HybridScheduler::GPU, n_fits, duration.count());
+                }
+            }
+            catch (...)
+            {
+                gpu_exception = std::current_exception();
+                scheduler.cancel();
+            }
+        });
+
+    std::exception_ptr cpu_exception;
+    try
+    {
+        std::size_t fit_offset = 0;
+        std::size_t n_fits = 0;
+        while (scheduler.next_block(HybridScheduler::CPU, fit_offset, n_fits))
+        {
+            clock::time_point const start = clock::now();
+            create_part(fit_offset, n_fits, data_type_size)->fit_cpu(model_id, n_cpu_threads);
+            std::chrono::duration< double > const duration = clock::now() - start;
+            scheduler.report(HybridScheduler::CPU, n_fits, duration.count());
+        }
+    }
+    catch (...)
+    {
+        cpu_exception = std::current_exception();
+        scheduler.cancel();
+    }
+
+    gpu_thread.join();
+
+    if (gpu_exception)
+    {
+        std::rethrow_exception(gpu_exception);
+    }
+
+    if (cpu_exception)
+    {
+        std::rethrow_exception(cpu_exception);
+    }
+}
+
+// Cpufit is called with the number of threads of the fit context, independent
+// of the number of threads set for other callers of Cpufit in the process
+void FitInterface::fit_cpu(int const model_id, int const n_threads)
+{
+#ifdef USE_CPUFIT
+    int const status = cpufit_with_threads(
+        n_fits_,
+        n_points_,
+        static_cast< float * >(const_cast< void * >(data_)),
+        const_cast< float * >(weights_),
+        model_id,
+        const_cast< float * >(initial_parameters_),
+        tolerance_,
+        max_n_iterations_,
+        const_cast< int * >(parameters_to_fit_),
+        estimator_id_,
+        user_info_size_,
+        user_info_,
+        output_parameters_,
+        output_states_,
+        output_chi_squares_,
+        output_n_iterations_,
+        n_threads);
+
+    if (status != STATUS_OK)
+    {
+        throw std::runtime_error(cpufit_get_last_error());
+    }
+#else
+    throw std::runtime_error("Cpufit not available, build with USE_CPUFIT");
+#endif
 }
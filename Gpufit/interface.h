@@ -3,6 +3,10 @@
 
 #include "lm_fit.h"
 
+#include <memory>
+
+class FitContext;
+
 static_assert( sizeof( int ) == 4, "32 bit 'int' type required" ) ;
 
 class FitInterface
@@ -10,7 +14,7 @@ class FitInterface
 public:
     FitInterface
     (
-        float const * data,
+        void const * data,
         float const * weights,
         std::size_t n_fits,
         int n_points,
@@ -24,22 +28,40 @@ public:
         float * output_parameters,
         int * output_states,
         float * output_chi_squares,
-        int * output_n_iterations
+        int * output_n_iterations,
+        bool data_on_gpu,
+        cudaStream_t stream
     ) ;
     
     virtual ~FitInterface();
-    void fit(int const model_id);
+    void set_uncertainty_output(int const uncertainty_type, float * output_uncertainties);
+    void fit(int const model_id, FitContext & context);
+
+    static int get_number_of_parameters(int const model_id);
+    static bool is_linear_model(int const model_id);
+    static bool is_valid_estimator(int const estimator_id);
+    static bool is_valid_uncertainty_type(int const uncertainty_type);
 
 private:
     void set_number_of_parameters(int const model_id);
     void check_sizes();
     void configure_info(Info & info, int const model_id);
+    void fit_device(int const model_id, FitContext & context, std::size_t const fit_offset);
+    void fit_multi_device(int const model_id, FitContext & context);
+    bool use_hybrid(int const model_id, FitContext const & context) const;
+    void fit_hybrid(int const model_id, FitContext & context);
+    void fit_cpu(int const model_id, int const n_threads);
+    std::unique_ptr< FitInterface > create_part(
+        std::size_t const fit_offset,
+        std::size_t const n_fits,
+        std::size_t const data_type_size) const;
 
 public:
 
 private:
     //input
-    float const * const data_ ;
+    // data values of the type selected by OPTION_DATA_TYPE
+    void const * const data_ ;
     float const * const weights_;
     float const * const initial_parameters_;
     int const * const parameters_to_fit_;
@@ -58,6 +80,16 @@ private:
     int * output_states_;
     float * output_chi_squares_;
     int * output_n_iterations_;
+
+    // the standard deviations or covariances of the fitted parameters, see
+    // UNCERTAINTY_*
+    int uncertainty_type_;
+    float * output_uncertainties_;
+
+    // all arrays except parameters_to_fit are in GPU memory, and the fit is
+    // calculated in the given stream
+    bool const data_on_gpu_;
+    cudaStream_t const stream_;
 };
 
 #endif
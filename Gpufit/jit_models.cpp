@@ -0,0 +1,383 @@
+#include "jit_models.h"
+#include "definitions.h"
+
+#ifdef USE_NVRTC
+#include <nvrtc.h>
+#include "jit_headers.h"
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef USE_NVRTC
+// The definitions of the model function interface compiled with each model,
+// from the headers embedded in jit_headers.h. NVRTC does not provide the
+// standard library headers.
+static char const * const jit_prelude = R"(
+namespace std { typedef decltype(sizeof(0)) size_t; }
+
+#include "coordinates.cuh"
+)";
+
+static int const n_jit_headers = 2;
+static char const * const jit_headers[n_jit_headers] = { jit_coordinates_h, jit_coordinates_cuh };
+static char const * const jit_header_names[n_jit_headers] = { "coordinates.h", "coordinates.cuh" };
+
+// the kernel of cuda_calc_curve_values, calling the registered model function
+static char const * const jit_kernel = R"(
+extern "C" __global__ void gpufit_jit_calc_curve_values(
+    float const * parameters,
+    int const n_fits,
+    int const * active_fits,
+    int const n_active_fits,
+    int const n_points,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    int const * finished,
+    float * values,
+    float * derivatives,
+    int const n_fits_per_block,
+    int const chunk_index,
+    int const first_fit_index,
+    Coordinates const coordinates,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    int const n_threads_per_fit = blockDim.x / n_fits_per_block;
+    int const fit_in_block = threadIdx.x / n_threads_per_fit;
+    int const thread_index = threadIdx.x - fit_in_block * n_threads_per_fit;
+    int const active_index = blockIdx.x * n_fits_per_block + fit_in_block;
+
+    if (active_index >= n_active_fits)
+        return;
+
+    int const fit_index = active_fits[active_index];
+
+    if (finished[fit_index])
+        return;
+
+    float * current_derivatives = &derivatives[fit_index * n_points * n_parameters_to_fit];
+
+    for (int point_index = thread_index; point_index < n_points; point_index += n_threads_per_fit)
+    {
+        float point_derivatives[GPUFIT_JIT_N_PARAMETERS];
+
+        GPUFIT_JIT_MODEL_FUNCTION(
+            &parameters[fit_index * n_parameters],
+            n_fits,
+            n_points,
+            &values[fit_index * n_points],
+            point_derivatives,
+            point_index,
+            first_fit_index + fit_index,
+            chunk_index,
+            user_info,
+            user_info_size,
+            coordinates);
+
+        // the derivatives with respect to the fitted parameters, see
+        // store_fitted_derivatives in models.cuh
+        int fitted_index = 0;
+        for (int parameter_index = 0; parameter_index < GPUFIT_JIT_N_PARAMETERS; parameter_index++)
+        {
+            if (fitted_index < n_parameters_to_fit && parameters_to_fit_indices[fitted_index] == parameter_index)
+            {
+                current_derivatives[fitted_index * n_points + point_index] = point_derivatives[parameter_index];
+                fitted_index++;
+            }
+        }
+    }
+}
+)";
+
+bool is_identifier(std::string const & name)
+{
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+        return false;
+
+    for (std::size_t i = 0; i < name.size(); i++)
+    {
+        char const c = name[i];
+        bool const valid
+            = (c >= 'a' && c <= 'z')
+            || (c >= 'A' && c <= 'Z')
+            || (c >= '0' && c <= '9')
+            || c == '_';
+
+        if (!valid)
+            return false;
+    }
+
+    return true;
+}
+
+// FNV-1a, which is stable across processes and platforms
+std::uint64_t hash_string(std::string const & string, std::uint64_t hash)
+{
+    for (std::size_t i = 0; i < string.size(); i++)
+    {
+        hash ^= static_cast< unsigned char >(string[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+#endif
+
+JitModels & JitModels::instance()
+{
+    static JitModels models;
+    return models;
+}
+
+JitModels::JitModels()
+{
+    char const * const directory = std::getenv("GPUFIT_JIT_CACHE");
+
+    if (directory)
+    {
+        directory_ = directory;
+    }
+}
+
+int JitModels::register_model(
+    std::string const & source,
+    std::string const & function_name,
+    int const n_parameters)
+{
+#ifndef USE_NVRTC
+    throw std::runtime_error("JIT models not available, build with USE_NVRTC");
+#else
+    if (!is_identifier(function_name))
+    {
+        throw std::runtime_error("invalid model function name");
+    }
+
+    if (n_parameters < 1 || n_parameters > MAX_MODEL_PARAMETERS)
+    {
+        throw std::runtime_error("invalid number of model parameters");
+    }
+
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    // registering the same model again returns its model ID
+    for (std::size_t i = 0; i < models_.size(); i++)
+    {
+        if (models_[i].source == source
+            && models_[i].function_name == function_name
+            && models_[i].n_parameters == n_parameters)
+        {
+            return FIRST_JIT_MODEL + int(i);
+        }
+    }
+
+    Model model;
+    model.source = source;
+    model.function_name = function_name;
+    model.n_parameters = n_parameters;
+    model.hash = get_hash(model);
+
+    models_.push_back(model);
+    int const model_id = FIRST_JIT_MODEL + int(models_.size() - 1);
+
+    // the model is compiled for the current device, which reports errors in
+    // the model source when it is registered
+    try
+    {
+        int device = 0;
+        CUDA_CHECK_STATUS(cudaGetDevice(&device));
+        get_function(model_id, device);
+    }
+    catch (...)
+    {
+        models_.pop_back();
+        throw;
+    }
+
+    return model_id;
+#endif
+}
+
+int JitModels::get_number_of_parameters(int const model_id)
+{
+    std::lock_guard< std::mutex > lock(mutex_);
+
+    if (!is_jit_model(model_id) || std::size_t(model_id - FIRST_JIT_MODEL) >= models_.size())
+        return 0;
+
+    return models_[model_id - FIRST_JIT_MODEL].n_parameters;
+}
+
+void JitModels::launch_calc_curve_values(
+    int const model_id,
+    int const device,
+    dim3 const blocks,
+    dim3 const threads,
+    cudaStream_t const stream,
+    void ** const arguments)
+{
+#ifndef USE_NVRTC
+    throw std::runtime_error("JIT models not available, build with USE_NVRTC");
+#else
+    CUfunction function = 0;
+    {
+        std::lock_guard< std::mutex > lock(mutex_);
+        function = get_function(model_id, device);
+    }
+
+    CU_CHECK_STATUS(cuLaunchKernel(
+        function,
+        blocks.x, blocks.y, blocks.z,
+        threads.x, threads.y, threads.z,
+        0,
+        stream,
+        arguments,
+        0));
+#endif
+}
+
+#ifdef USE_NVRTC
+std::string JitModels::get_hash(Model const & model) const
+{
+    int major = 0;
+    int minor = 0;
+    NVRTC_CHECK_STATUS(nvrtcVersion(&major, &minor));
+
+    std::ostringstream key;
+    key << model.function_name << '\n'
+        << model.n_parameters << '\n'
+        << "nvrtc " << major << '.' << minor << '\n';
+
+    std::uint64_t hash = 14695981039346656037ull;
+    hash = hash_string(key.str(), hash);
+    hash = hash_string(jit_prelude, hash);
+    for (int i = 0; i < n_jit_headers; i++)
+    {
+        hash = hash_string(jit_headers[i], hash);
+    }
+    hash = hash_string(jit_kernel, hash);
+    hash = hash_string(model.source, hash);
+
+    std::ostringstream hex;
+    hex << std::hex;
+    hex.width(16);
+    hex.fill('0');
+    hex << hash;
+    return hex.str();
+}
+
+std::vector< char > JitModels::compile(Model const & model, std::string const & architecture) const
+{
+    std::string const program_source
+        = std::string(jit_prelude)
+        + model.source
+        + "\n#define GPUFIT_JIT_MODEL_FUNCTION " + model.function_name
+        + "\n#define GPUFIT_JIT_N_PARAMETERS " + std::to_string(model.n_parameters) + "\n"
+        + jit_kernel;
+
+    nvrtcProgram program;
+    NVRTC_CHECK_STATUS(nvrtcCreateProgram(
+        &program, program_source.c_str(), "gpufit_jit_model.cu", n_jit_headers, jit_headers, jit_header_names));
+
+    std::string const architecture_option = "--gpu-architecture=sm_" + architecture;
+    char const * const options[] = { architecture_option.c_str(), "--std=c++11" };
+
+    nvrtcResult const status = nvrtcCompileProgram(program, 2, options);
+
+    if (status != NVRTC_SUCCESS)
+    {
+        std::size_t log_size = 0;
+        nvrtcGetProgramLogSize(program, &log_size);
+        std::string log(log_size, '\0');
+        if (log_size > 0)
+            nvrtcGetProgramLog(program, &log[0]);
+        nvrtcDestroyProgram(&program);
+
+        throw std::runtime_error("model compilation failed: " + log);
+    }
+
+    std::size_t cubin_size = 0;
+    std::vector< char > cubin;
+    nvrtcResult result = nvrtcGetCUBINSize(program, &cubin_size);
+    if (result == NVRTC_SUCCESS)
+    {
+        cubin.resize(cubin_size);
+        result = nvrtcGetCUBIN(program, cubin.data());
+    }
+    nvrtcDestroyProgram(&program);
+
+    NVRTC_CHECK_STATUS(result);
+
+    return cubin;
+}
+
+// compiles or loads the kernel of a model on a device, called with the mutex
+// locked
+CUfunction JitModels::get_function(int const model_id, int const device)
+{
+    std::pair< int, int > const key(model_id, device);
+
+    std::map< std::pair< int, int >, CUfunction >::const_iterator const entry = functions_.find(key);
+    if (entry != functions_.end())
+        return entry->second;
+
+    if (!is_jit_model(model_id) || std::size_t(model_id - FIRST_JIT_MODEL) >= models_.size())
+    {
+        throw std::runtime_error("invalid model ID");
+    }
+
+    Model const & model = models_[model_id - FIRST_JIT_MODEL];
+
+    int major = 0;
+    int minor = 0;
+    CUDA_CHECK_STATUS(cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device));
+    CUDA_CHECK_STATUS(cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device));
+    std::string const architecture = std::to_string(major * 10 + minor);
+
+    std::string const file_name
+        = directory_.empty()
+        ? std::string()
+        : directory_ + "/" + model.hash + ".sm_" + architecture + ".cubin";
+
+    std::vector< char > cubin;
+    if (!file_name.empty())
+    {
+        std::ifstream file(file_name, std::ios::binary);
+        cubin.assign(std::istreambuf_iterator< char >(file), std::istreambuf_iterator< char >());
+    }
+
+    if (cubin.empty())
+    {
+        cubin = compile(model, architecture);
+
+        // a cache directory which cannot be written only disables the
+        // persistence, the file is renamed when complete, hence processes
+        // reading the cache never see a partially written file
+        if (!file_name.empty())
+        {
+            std::string const temporary_name = file_name + "." + std::to_string(device) + ".tmp";
+            {
+                std::ofstream file(temporary_name, std::ios::binary);
+                file.write(cubin.data(), std::streamsize(cubin.size()));
+            }
+            std::rename(temporary_name.c_str(), file_name.c_str());
+        }
+    }
+
+    // the module is loaded into the current context of the calling thread,
+    // the primary context of the device used by the runtime API
+    CUmodule module;
+    CU_CHECK_STATUS(cuModuleLoadData(&module, cubin.data()));
+
+    CUfunction function;
+    CU_CHECK_STATUS(cuModuleGetFunction(&function, module, "gpufit_jit_calc_curve_values"));
+
+    functions_[key] = function;
+
+    return function;
+}
+#endif
@@ -0,0 +1,83 @@
+#ifndef GPUFIT_JIT_MODELS_H_INCLUDED
+#define GPUFIT_JIT_MODELS_H_INCLUDED
+
+#include "gpufit.h"
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/* Description of the JitModels class
+* ===================================
+*
+* The model functions registered at run time by gpufit_register_model(). The
+* source of a model function is compiled by NVRTC together with a kernel which
+* calculates the model values and derivatives of the data points, like
+* cuda_calc_curve_values. The other kernels of these models are the kernels of
+* GENERIC_MODEL, which read the number of parameters at run time. The fused
+* kernel, the on the fly hessians and the estimation of the initial parameters
+* are not available for these models.
+*
+* The registered models are shared by all fit contexts of the process, and are
+* numbered from FIRST_JIT_MODEL in the order of registration. A model is
+* compiled for the compute capability of each device on which it is fitted.
+* If the environment variable GPUFIT_JIT_CACHE names a directory, the compiled
+* binaries are stored there, named by a hash of the model and of the NVRTC
+* version and by the compute capability, and later processes load them instead
+* of compiling the source again.
+*
+* Only available if Gpufit was built with the CMake option USE_NVRTC.
+*
+*/
+
+class JitModels
+{
+public:
+    static JitModels & instance();
+
+    static bool is_jit_model(int const model_id) { return model_id >= FIRST_JIT_MODEL; }
+
+    int register_model(
+        std::string const & source,
+        std::string const & function_name,
+        int const n_parameters);
+    int get_number_of_parameters(int const model_id);
+    void launch_calc_curve_values(
+        int const model_id,
+        int const device,
+        dim3 const blocks,
+        dim3 const threads,
+        cudaStream_t const stream,
+        void ** arguments);
+
+private:
+    struct Model
+    {
+        std::string source;
+        std::string function_name;
+        int n_parameters;
+
+        // hash of the model source, the function name, the number of
+        // parameters and the NVRTC version, in hexadecimal digits
+        std::string hash;
+    };
+
+    JitModels();
+
+    CUfunction get_function(int const model_id, int const device);
+    std::vector< char > compile(Model const & model, std::string const & architecture) const;
+    std::string get_hash(Model const & model) const;
+
+    std::mutex mutex_;
+    std::vector< Model > models_;
+
+    // the loaded kernels by model ID and device
+    std::map< std::pair< int, int >, CUfunction > functions_;
+
+    std::string directory_;
+};
+
+#endif
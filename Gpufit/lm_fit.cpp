@@ -1,18 +1,23 @@
 #include "lm_fit.h"
+#include "profiler.h"
+#include "warm_start.cuh"
 #include <algorithm>
 
 LMFit::LMFit
 (
-    float const * const data,
+    void const * const data,
     float const * const weights,
     Info & info,
+    std::vector< GPUData * > const & gpu_data,
     float const * const initial_parameters,
     int const * const parameters_to_fit,
     char * const user_info,
     float * output_parameters,
     int * output_states,
     float * output_chi_squares,
-    int * output_n_iterations
+    int * output_n_iterations,
+    float * output_uncertainties,
+    cudaStream_t const stream
 ) :
     data_( data ),
     weights_( weights ),
@@ -23,11 +28,15 @@ LMFit::LMFit
     output_states_( output_states ),
     output_chi_squares_( output_chi_squares ),
     output_n_iterations_( output_n_iterations ),
+    output_uncertainties_( output_uncertainties ),
+    outputs_page_locked_( false ),
     info_(info),
+    gpu_data_(gpu_data),
     chunk_size_(0),
     ichunk_(0),
     n_fits_left_(info.n_fits_),
-    parameters_to_fit_indices_(0)
+    parameters_to_fit_indices_(0),
+    stream_(stream)
 {}
 
 LMFit::~LMFit()
@@ -47,46 +56,274 @@ void LMFit::set_parameters_to_fit_indices()
 
 void LMFit::get_results(GPUData const & gpu_data, int const n_fits)
 {
+    info_.profiler_->start(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
+
     output_parameters_
         = gpu_data.parameters_.copy( n_fits*info_.n_parameters_, output_parameters_ ) ;
     output_states_ = gpu_data.states_.copy( n_fits, output_states_ ) ;
     output_chi_squares_ = gpu_data.chi_squares_.copy( n_fits, output_chi_squares_ ) ;
     output_n_iterations_ = gpu_data.n_iterations_.copy( n_fits, output_n_iterations_ ) ;
+    if (info_.uncertainty_type_ != UNCERTAINTY_NONE)
+        output_uncertainties_
+            = gpu_data.uncertainties_.copy( n_fits*info_.get_n_uncertainties(), output_uncertainties_ ) ;
+
+    info_.profiler_->stop(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
+    info_.profiler_->add_transfer(0, get_results_size(n_fits));
 }
 
-void LMFit::run(float const tolerance)
+void LMFit::stage_results(GPUData & gpu_data, int const chunk_index)
 {
-    set_parameters_to_fit_indices();
+    if (outputs_page_locked_)
+    {
+        // the results of the previous chunk may not have been read yet, the
+        // output pointers refer to the first fit not read
+        std::size_t const n_fits_read = info_.n_fits_ - n_fits_left_;
+        std::size_t const fit_offset = chunk_index * info_.max_chunk_size_ - n_fits_read;
 
-    GPUData gpu_data(info_);
-    gpu_data.init_user_info(user_info_);
+        gpu_data.stage_results(
+            output_parameters_ + fit_offset * info_.n_parameters_,
+            output_states_ + fit_offset,
+            output_chi_squares_ + fit_offset,
+            output_n_iterations_ + fit_offset,
+            output_uncertainties_ + fit_offset * info_.get_n_uncertainties());
+    }
+    else
+    {
+        gpu_data.stage_results(
+            gpu_data.host_parameters_,
+            gpu_data.host_states_,
+            gpu_data.host_chi_squares_,
+            gpu_data.host_n_iterations_,
+            gpu_data.host_uncertainties_);
+    }
+}
 
-    // loop over data chunks
-    while (n_fits_left_ > 0)
+void LMFit::get_staged_results(GPUData & gpu_data, int const n_fits)
+{
+    gpu_data.wait_for_results();
+
+    n_fits_left_ -= n_fits;
+
+    if (outputs_page_locked_)
+    {
+        output_parameters_ += n_fits * info_.n_parameters_;
+        output_states_ += n_fits;
+        output_chi_squares_ += n_fits;
+        output_n_iterations_ += n_fits;
+        output_uncertainties_ += n_fits * info_.get_n_uncertainties();
+        return;
+    }
+
+    float const * const parameters = gpu_data.host_parameters_;
+    int const * const states = gpu_data.host_states_;
+    float const * const chi_squares = gpu_data.host_chi_squares_;
+    int const * const n_iterations = gpu_data.host_n_iterations_;
+
+    output_parameters_
+        = std::copy(parameters, parameters + n_fits*info_.n_parameters_, output_parameters_);
+    output_states_ = std::copy(states, states + n_fits, output_states_);
+    output_chi_squares_ = std::copy(chi_squares, chi_squares + n_fits, output_chi_squares_);
+    output_n_iterations_ = std::copy(n_iterations, n_iterations + n_fits, output_n_iterations_);
+
+    if (info_.uncertainty_type_ != UNCERTAINTY_NONE)
     {
-        chunk_size_ = int((std::min)(n_fits_left_, info_.max_chunk_size_));
+        float const * const uncertainties = gpu_data.host_uncertainties_;
+        output_uncertainties_ = std::copy(
+            uncertainties,
+            uncertainties + n_fits * info_.get_n_uncertainties(),
+            output_uncertainties_);
+    }
+}
+
+// the number of bytes of the parameters, states, chi-square values, numbers
+// of iterations and uncertainties of n_fits
+std::size_t LMFit::get_results_size(int const n_fits) const
+{
+    return n_fits
+        * (info_.n_parameters_ * sizeof(float) + sizeof(int) + sizeof(float) + sizeof(int)
+        + info_.get_n_uncertainties() * sizeof(float));
+}
 
-        info_.set_fits_per_block(chunk_size_);
+int LMFit::get_chunk_size(int const chunk_index) const
+{
+    std::size_t const n_fits_before = chunk_index * info_.max_chunk_size_;
+
+    return int((std::min)(info_.n_fits_ - n_fits_before, info_.max_chunk_size_));
+}
+
+void LMFit::init_chunk(GPUData & gpu_data, int const chunk_index)
+{
+    gpu_data.reset(get_chunk_size(chunk_index));
+
+    if (info_.data_on_gpu_)
+    {
+        // the initial parameters are replaced by the fitted parameters
+        gpu_data.assign(
+            chunk_index,
+            data_,
+            weights_,
+            output_parameters_,
+            output_states_,
+            output_chi_squares_,
+            output_n_iterations_,
+            parameters_to_fit_indices_);
+    }
+    else
+    {
+        info_.profiler_->start(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
 
-        gpu_data.reset(chunk_size_);
         gpu_data.init(
-            ichunk_,
+            chunk_index,
             data_,
             weights_,
             initial_parameters_,
             parameters_to_fit_indices_);
 
-        LMFitCUDA lmfit_cuda(
-            tolerance,
-            info_,
-            gpu_data,
-            chunk_size_);
+        info_.profiler_->stop(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
+
+        std::size_t const chunk_size = get_chunk_size(chunk_index);
+        std::size_t const n_data_points = chunk_size * info_.n_points_;
+
+        info_.profiler_->add_transfer(
+            n_data_points * info_.get_data_type_size()
+            + (info_.use_weights_ ? n_data_points * sizeof(float) : 0)
+            + (initial_parameters_ ? chunk_size * info_.n_parameters_ * sizeof(float) : 0)
+            + parameters_to_fit_indices_.size() * sizeof(int),
+            0);
+    }
+}
+
+void LMFit::fit_chunk(GPUData & gpu_data, int const chunk_index, float const tolerance)
+{
+    int const chunk_size = get_chunk_size(chunk_index);
+
+    LMFitCUDA lmfit_cuda(
+        tolerance,
+        info_,
+        gpu_data,
+        chunk_size);
+
+    lmfit_cuda.run();
+
+    // the uncertainty pass reuses the buffers of the iterations, the state of
+    // the iterations is stored before
+    info_.warm_start_->store(gpu_data, chunk_size);
+
+    if (info_.uncertainty_type_ != UNCERTAINTY_NONE)
+    {
+        lmfit_cuda.calc_uncertainties();
+    }
+
+    info_.profiler_->finish_chunk();
+}
 
-        lmfit_cuda.run();
+void LMFit::run_synchronous(float const tolerance)
+{
+    GPUData & gpu_data = *gpu_data_[0];
 
-        get_results(gpu_data, chunk_size_);
+    // loop over data chunks
+    while (n_fits_left_ > 0)
+    {
+        chunk_size_ = get_chunk_size(ichunk_);
+
+        init_chunk(gpu_data, ichunk_);
+        fit_chunk(gpu_data, ichunk_, tolerance);
+
+        // results in GPU memory are already in place
+        if (!info_.data_on_gpu_)
+        {
+            get_results(gpu_data, chunk_size_);
+        }
 
         n_fits_left_ -= chunk_size_;
         ichunk_++;
     }
+
+    if (info_.data_on_gpu_)
+    {
+        gpu_data.synchronize();
+    }
+}
+
+void LMFit::run_streamed(float const tolerance)
+{
+    int const n_sets = int(gpu_data_.size());
+    int const n_chunks = int(
+        (info_.n_fits_ + info_.max_chunk_size_ - 1) / info_.max_chunk_size_);
+
+    outputs_page_locked_
+        = is_page_locked(output_parameters_)
+        && is_page_locked(output_states_)
+        && is_page_locked(output_chi_squares_)
+        && is_page_locked(output_n_iterations_)
+        && (info_.uncertainty_type_ == UNCERTAINTY_NONE || is_page_locked(output_uncertainties_));
+
+    // The transfer of the next chunk to the GPU is queued before the current
+    // chunk is fitted, and the results of the current chunk are transferred
+    // back while the next chunk is fitted. Each chunk uses its own stream.
+    init_chunk(*gpu_data_[0], 0);
+
+    for (ichunk_ = 0; ichunk_ < n_chunks; ichunk_++)
+    {
+        GPUData & gpu_data = *gpu_data_[ichunk_ % n_sets];
+
+        if (ichunk_ + 1 < n_chunks)
+        {
+            init_chunk(*gpu_data_[(ichunk_ + 1) % n_sets], ichunk_ + 1);
+        }
+
+        fit_chunk(gpu_data, ichunk_, tolerance);
+
+        info_.profiler_->start(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
+        stage_results(gpu_data, ichunk_);
+        info_.profiler_->stop(PROFILE_PHASE_TRANSFERS, gpu_data.stream_);
+        info_.profiler_->add_transfer(0, get_results_size(get_chunk_size(ichunk_)));
+
+        if (ichunk_ > 0)
+        {
+            int const previous_chunk = ichunk_ - 1;
+            get_staged_results(
+                *gpu_data_[previous_chunk % n_sets],
+                get_chunk_size(previous_chunk));
+        }
+    }
+
+    int const last_chunk = n_chunks - 1;
+    get_staged_results(*gpu_data_[last_chunk % n_sets], get_chunk_size(last_chunk));
+}
+
+void LMFit::run(float const tolerance)
+{
+    set_parameters_to_fit_indices();
+
+    info_.profiler_->add_gpu_memory(gpu_data_.size() * info_.get_buffer_memory());
+
+    for (std::size_t i = 0; i < gpu_data_.size(); i++)
+    {
+        if (info_.data_on_gpu_)
+        {
+            gpu_data_[i]->set_stream(stream_);
+        }
+        else
+        {
+            gpu_data_[i]->reset_stream();
+        }
+        gpu_data_[i]->init_user_info(user_info_);
+
+        if (!info_.data_on_gpu_)
+        {
+            info_.profiler_->add_transfer(info_.user_info_size_, 0);
+        }
+    }
+
+    // there are no transfers to overlap with the fits if the data is in
+    // GPU memory
+    if (gpu_data_.size() > 1 && !info_.data_on_gpu_)
+    {
+        run_streamed(tolerance);
+    }
+    else
+    {
+        run_synchronous(tolerance);
+    }
 }
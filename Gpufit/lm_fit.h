@@ -4,24 +4,32 @@
 #include "definitions.h"
 #include "info.h"
 #include "gpu_data.cuh"
+#include <string>
+#include <vector>
 
 class LMFitCUDA;
+struct KernelSet;
+
+KernelSet const & select_kernels(int const model_id, int const estimator_id, int const precision_id);
 
 class LMFit
 {
 public:
     LMFit
     (
-        float const * data,
+        void const * data,
         float const * weights,
         Info & info,
+        std::vector< GPUData * > const & gpu_data,
         float const * initial_parameters,
         int const * parameters_to_fit,
         char * user_info,
         float * output_parameters,
         int * output_states,
         float * output_chi_squares,
-        int * output_n_iterations
+        int * output_n_iterations,
+        float * output_uncertainties,
+        cudaStream_t stream
     ) ;
 
     virtual ~LMFit();
@@ -31,8 +39,16 @@ public:
 private:
     void set_parameters_to_fit_indices();
     void get_results(GPUData const & gpu_data, int const n_fits);
-
-    float const * const data_ ;
+    void stage_results(GPUData & gpu_data, int const chunk_index);
+    void get_staged_results(GPUData & gpu_data, int const n_fits);
+    std::size_t get_results_size(int const n_fits) const;
+    int get_chunk_size(int const chunk_index) const;
+    void init_chunk(GPUData & gpu_data, int const chunk_index);
+    void fit_chunk(GPUData & gpu_data, int const chunk_index, float const tolerance);
+    void run_synchronous(float const tolerance);
+    void run_streamed(float const tolerance);
+
+    void const * const data_ ;
     float const * const weights_ ;
     float const * const initial_parameters_ ;
     int const * const parameters_to_fit_;
@@ -42,14 +58,22 @@ private:
     int * output_states_ ;
     float * output_chi_squares_ ;
     int * output_n_iterations_ ;
+    float * output_uncertainties_ ;
+
+    // the staged results are copied directly to page-locked output arrays
+    bool outputs_page_locked_;
 
     int ichunk_;
     int chunk_size_;
     std::size_t n_fits_left_;
 
     Info & info_;
+    std::vector< GPUData * > const gpu_data_;
 
     std::vector<int> parameters_to_fit_indices_;
+
+    // the stream of the caller, used for fits with data in GPU memory
+    cudaStream_t const stream_;
 };
 
 class LMFitCUDA
@@ -64,14 +88,33 @@ public:
     virtual ~LMFitCUDA();
 
     void run();
+    void calc_uncertainties();
 
 private:
+    void estimate_initial_parameters();
 	void calc_curve_values();
+    void calc_curve_values_jit(dim3 const blocks, dim3 const threads);
     void calc_chi_squares();
     void calc_gradients();
     void calc_hessians();
-    void evaluate_iteration(int const iteration);
+    void calc_curve_values_and_hessians();
+    void calc_chi_squares_gradients_hessians();
+    bool evaluate_iteration(int const iteration);
+    void compact_active_fits();
     void solve_equation_system();
+    void solve_linear_systems();
+    void solve_gauss_jordan();
+#ifdef USE_CUBLAS
+    void solve_cublas();
+#endif
+    void run_fused();
+    void run_direct_linear_fit();
+    void finish_direct_linear_fit();
+    std::vector< int > get_fits_per_block_candidates() const;
+    int get_occupancy_fits_per_block(std::vector< int > const & candidates) const;
+    std::string get_autotune_key() const;
+    int autotune_fits_per_block(std::vector< int > const & candidates);
+    void set_fits_per_block();
 
 public:
 
@@ -80,9 +123,25 @@ private:
     GPUData & gpu_data_;
     int const n_fits_;
 
+    // the number of fits which were not finished at the last convergence
+    // check, the kernels are launched for these fits only
+    int n_active_fits_;
+
     bool all_finished_;
 
     float tolerance_;
+
+    // device buffers of weights and user info, or null if not used by the
+    // current fit call
+    float * const weights_;
+    char * const user_info_;
+
+    // kernels specialized for the model and the estimator
+    KernelSet const & kernels_;
+
+    // the number of fits calculated by each thread block, see
+    // set_fits_per_block
+    int n_fits_per_block_;
 };
 
 #endif
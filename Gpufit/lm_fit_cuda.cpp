@@ -1,4 +1,6 @@
 #include "lm_fit.h"
+#include "profiler.h"
+#include "warm_start.cuh"
 
 LMFitCUDA::LMFitCUDA(
     float const tolerance,
@@ -9,8 +11,13 @@ LMFitCUDA::LMFitCUDA(
     info_(info),
     gpu_data_(gpu_data),
     n_fits_(n_fits),
+    n_active_fits_(n_fits),
     all_finished_(false),
-    tolerance_(tolerance)
+    tolerance_(tolerance),
+    weights_(info.use_weights_ ? static_cast< float * >(gpu_data.weights_) : 0),
+    user_info_(info.user_info_size_ > 0 ? static_cast< char * >(gpu_data.user_info_) : 0),
+    kernels_(select_kernels(info.model_id_, info.estimator_id_, info.precision_id_)),
+    n_fits_per_block_(1)
 {
 }
 
@@ -20,11 +27,32 @@ LMFitCUDA::~LMFitCUDA()
 
 void LMFitCUDA::run()
 {
+    if (info_.estimate_initial_parameters_)
+    {
+        estimate_initial_parameters();
+    }
+
+    // fits which converged in the previous fit call start from its results
+    info_.warm_start_->seed(gpu_data_, n_fits_);
+
+    // least squares fits of linear models are solved in a single step
+    if (info_.use_direct_linear_fit_)
+    {
+        run_direct_linear_fit();
+        return;
+    }
+
+    // small fits are calculated completely by a single kernel
+    if (info_.use_fused_kernel_)
+    {
+        run_fused();
+        return;
+    }
+
+    set_fits_per_block();
+
     // initialize the chi-square values
-	calc_curve_values();
-    calc_chi_squares();
-    calc_gradients();
-    calc_hessians();
+    calc_chi_squares_gradients_hessians();
 
     gpu_data_.copy(
         gpu_data_.prev_chi_squares_,
@@ -34,6 +62,8 @@ void LMFitCUDA::run()
     // loop over the fit iterations
     for (int iteration = 0; !all_finished_; iteration++)
     {
+        int const n_active_fits = n_active_fits_;
+
         // modify step width
         // Gauss Jordan
         // update fitting parameters
@@ -41,10 +71,7 @@ void LMFitCUDA::run()
 
         // calculate fitting curve values and its derivatives
         // calculate chi-squares, gradients and hessians
-		calc_curve_values();
-        calc_chi_squares();
-        calc_gradients();
-        calc_hessians();
+        calc_chi_squares_gradients_hessians();
 
         // check which fits have converged
         // flag finished fits
@@ -52,6 +79,65 @@ void LMFitCUDA::run()
         // save the number of needed iterations by each fitting process
         // check whether chi-squares are increasing or decreasing
         // update chi-squares, curve parameters and lambdas
-        evaluate_iteration(iteration);
+        bool const checked = evaluate_iteration(iteration);
+
+        info_.profiler_->finish_iteration(gpu_data_.chunk_index_, iteration, n_active_fits);
+
+        // the times of the iterations since the last check are read while
+        // the host waits for the device anyway
+        if (checked)
+        {
+            info_.profiler_->read_iterations();
+        }
     }
-}
\ No newline at end of file
+}
+
+// The chi-square of a model which is linear in its parameters is a quadratic
+// function of the parameters, and the hessian of the least squares estimator
+// does not depend on them. The undamped step from the initial parameters
+// therefore ends in the minimum, which is found without iterations and
+// without synchronizing the host with the device.
+void LMFitCUDA::run_direct_linear_fit()
+{
+    set_fits_per_block();
+
+    // the chi-square values, gradients and hessians at the initial parameters
+    calc_chi_squares_gradients_hessians();
+
+    gpu_data_.copy(
+        gpu_data_.prev_chi_squares_,
+        gpu_data_.chi_squares_,
+        n_fits_);
+
+    // solves the normal equations and updates the parameters
+    solve_equation_system();
+
+    // the chi-square values of the solutions
+    if (info_.use_on_the_fly_hessians_)
+    {
+        calc_curve_values_and_hessians();
+    }
+    else
+    {
+        calc_curve_values();
+        calc_chi_squares();
+    }
+
+    finish_direct_linear_fit();
+
+    info_.profiler_->finish_iteration(gpu_data_.chunk_index_, 0, n_fits_);
+}
+void LMFitCUDA::calc_chi_squares_gradients_hessians()
+{
+    if (info_.use_on_the_fly_hessians_)
+    {
+        calc_curve_values_and_hessians();
+    }
+    else
+    {
+        calc_curve_values();
+        calc_chi_squares();
+        calc_gradients();
+        calc_hessians();
+    }
+}
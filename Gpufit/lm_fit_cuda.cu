@@ -1,26 +1,20 @@
+#include "gpufit.h"
 #include "lm_fit.h"
 #include <algorithm>
 #include "cuda_kernels.cuh"
 #include "cuda_gaussjordan.cuh"
-
-void LMFitCUDA::solve_equation_system()
+#include "cuda_cholesky.cuh"
+#include "autotune_cache.h"
+#include "jit_models.h"
+#include "profiler.h"
+#include <limits>
+#include <sstream>
+
+void LMFitCUDA::solve_gauss_jordan()
 {
     dim3  threads(1, 1, 1);
     dim3  blocks(1, 1, 1);
 
-    threads.x = info_.n_parameters_to_fit_*info_.n_fits_per_block_;
-    threads.y = 1;
-    blocks.x = n_fits_ / info_.n_fits_per_block_;
-    blocks.y = 1;
-    cuda_modify_step_widths<<< blocks, threads >>>(
-        gpu_data_.hessians_,
-        gpu_data_.lambdas_,
-        info_.n_parameters_to_fit_,
-        gpu_data_.iteration_falied_,
-        gpu_data_.finished_,
-        info_.n_fits_per_block_);
-    CUDA_CHECK_STATUS(cudaGetLastError());
-
     int n_parameters_pow2 = 1;
 
     while (n_parameters_pow2 < info_.n_parameters_to_fit_)
@@ -30,7 +24,7 @@ void LMFitCUDA::solve_equation_system()
 
     //set up to run the Gauss Jordan elimination
     int const n_equations = info_.n_parameters_to_fit_;
-    int const n_solutions = n_fits_;
+    int const n_solutions = n_active_fits_;
 
     threads.x = n_equations + 1;
     threads.y = n_equations;
@@ -42,49 +36,246 @@ void LMFitCUDA::solve_equation_system()
         = sizeof(float) * ((threads.x * threads.y)
         + n_parameters_pow2 + n_parameters_pow2);
 
-    //set up the singular_test vector
-    int * singular_tests;
-    CUDA_CHECK_STATUS(cudaMalloc((void**)&singular_tests, n_fits_ * sizeof(int)));
-
     //run the Gauss Jordan elimination
-    cuda_gaussjordan<<< blocks, threads, shared_size >>>(
+    cuda_gaussjordan<<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
         gpu_data_.deltas_,
         gpu_data_.gradients_,
         gpu_data_.hessians_,
         gpu_data_.finished_,
-        singular_tests,
+        gpu_data_.singular_tests_,
+        gpu_data_.active_fits_,
         info_.n_parameters_to_fit_,
         n_parameters_pow2);
     CUDA_CHECK_STATUS(cudaGetLastError());
+}
 
-    //set up to update the lm_state_gpu_ variable with the Gauss Jordan results
-    threads.x = std::min(n_fits_, 256);
+#ifdef USE_CUBLAS
+void LMFitCUDA::solve_cublas()
+{
+    int const n_equations = info_.n_parameters_to_fit_;
+
+    // the LU decomposition overwrites the matrices and the solution overwrites
+    // the right hand side, hence both are copied to scratch buffers
+    gpu_data_.copy(
+        gpu_data_.decomposed_hessians_,
+        gpu_data_.hessians_,
+        n_fits_ * n_equations * n_equations);
+    gpu_data_.copy(
+        gpu_data_.deltas_,
+        gpu_data_.gradients_,
+        n_fits_ * n_equations);
+
+    CUBLAS_CHECK_STATUS(cublasSgetrfBatched(
+        gpu_data_.cublas_handle_,
+        n_equations,
+        gpu_data_.pointers_decomposed_hessians_,
+        n_equations,
+        gpu_data_.pivot_indices_,
+        gpu_data_.singular_tests_,
+        n_fits_));
+
+    int info = 0;
+    CUBLAS_CHECK_STATUS(cublasSgetrsBatched(
+        gpu_data_.cublas_handle_,
+        CUBLAS_OP_N,
+        n_equations,
+        1,
+        gpu_data_.pointers_decomposed_hessians_,
+        n_equations,
+        gpu_data_.pivot_indices_,
+        gpu_data_.pointers_deltas_,
+        n_equations,
+        &info,
+        n_fits_));
+}
+#endif
+
+// solves the equation systems of the hessians and the gradients of the active
+// fits by the selected solver, the solutions are stored in the deltas
+void LMFitCUDA::solve_linear_systems()
+{
+    int const n_equations = info_.n_parameters_to_fit_;
+
+    if (info_.solver_id_ == SOLVER_CHOLESKY && n_equations <= CHOLESKY_MAX_N_EQUATIONS)
+    {
+        cuda_cholesky(
+            gpu_data_.deltas_,
+            gpu_data_.gradients_,
+            gpu_data_.hessians_,
+            gpu_data_.finished_,
+            gpu_data_.singular_tests_,
+            gpu_data_.active_fits_,
+            n_equations,
+            n_active_fits_,
+            gpu_data_.stream_);
+    }
+#ifdef USE_CUBLAS
+    else if (info_.solver_id_ == SOLVER_CUBLAS)
+    {
+        solve_cublas();
+    }
+#endif
+    else
+    {
+        solve_gauss_jordan();
+    }
+}
+
+void LMFitCUDA::solve_equation_system()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    info_.profiler_->start(PROFILE_PHASE_SOLVER, gpu_data_.stream_);
+
+    // the direct fit of linear models takes the undamped step
+    if (!info_.use_direct_linear_fit_)
+    {
+        threads.x = info_.n_parameters_to_fit_*n_fits_per_block_;
+        threads.y = 1;
+        blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
+        blocks.y = 1;
+        cuda_modify_step_widths<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+            gpu_data_.hessians_,
+            gpu_data_.lambdas_,
+            info_.n_parameters_to_fit_,
+            gpu_data_.iteration_falied_,
+            gpu_data_.finished_,
+            gpu_data_.active_fits_,
+            n_active_fits_,
+            n_fits_per_block_);
+        CUDA_CHECK_STATUS(cudaGetLastError());
+    }
+
+    //solve the equation systems
+    solve_linear_systems();
+
+    //set up to update the lm_state_gpu_ variable with the solver results
+    threads.x = std::min(n_active_fits_, 256);
     threads.y = 1;
-    blocks.x = int(std::ceil(float(n_fits_) / float(threads.x)));
+    blocks.x = int(std::ceil(float(n_active_fits_) / float(threads.x)));
     blocks.y = 1;
 
     //update the lm_state_gpu_ variable
-    cuda_update_state_after_gaussjordan<<< blocks, threads >>>(
-        n_fits_,
-        singular_tests,
-        gpu_data_.states_);
+    cuda_update_state_after_gaussjordan<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        gpu_data_.singular_tests_,
+        gpu_data_.states_,
+        gpu_data_.finished_);
     CUDA_CHECK_STATUS(cudaGetLastError());
 
-    CUDA_CHECK_STATUS(cudaFree(singular_tests));
-
-    threads.x = info_.n_parameters_*info_.n_fits_per_block_;
+    threads.x = info_.n_parameters_*n_fits_per_block_;
     threads.y = 1;
-    blocks.x = n_fits_ / info_.n_fits_per_block_;
+    blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
     blocks.y = 1;
-    cuda_update_parameters<<< blocks, threads >>>(
+    cuda_update_parameters<<< blocks, threads, 0, gpu_data_.stream_ >>>(
         gpu_data_.parameters_,
         gpu_data_.prev_parameters_,
         gpu_data_.deltas_,
         info_.n_parameters_to_fit_,
         gpu_data_.parameters_to_fit_indices_,
         gpu_data_.finished_,
-        info_.n_fits_per_block_);
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        n_fits_per_block_,
+        gpu_data_.first_fit_index_,
+        info_.constraints_);
     CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_SOLVER, gpu_data_.stream_);
+}
+
+// The uncertainties are calculated from the hessians at the final parameters,
+// the hessians of the last iteration were calculated at the parameters before
+// its step and are modified by the damping. The inverse hessian is the
+// covariance matrix of the fitted parameters, for MLE the Cramer-Rao lower
+// bound. Its columns are the solutions of the equation systems for the unit
+// vectors. Systems too large for the Cholesky decomposition are solved for
+// each unit vector by the solver of the iterations.
+void LMFitCUDA::calc_uncertainties()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    // all fits are calculated, including the finished fits
+    n_active_fits_ = n_fits_;
+    gpu_data_.set_indices(gpu_data_.active_fits_, n_fits_);
+    gpu_data_.set(gpu_data_.finished_, 0, n_fits_);
+    gpu_data_.set(gpu_data_.iteration_falied_, 0, n_fits_);
+
+    if (info_.use_on_the_fly_hessians_)
+    {
+        // the kernel calculates the chi-squares and states as well, the
+        // results of the fits are kept in buffers which are not used anymore,
+        // the damping factors were stored for the warm start before
+        gpu_data_.copy(gpu_data_.lambdas_, gpu_data_.chi_squares_, n_fits_);
+        gpu_data_.copy(gpu_data_.compacted_fits_, gpu_data_.states_, n_fits_);
+        gpu_data_.set(gpu_data_.prev_chi_squares_, 0.f, n_fits_);
+
+        calc_curve_values_and_hessians();
+
+        gpu_data_.copy(gpu_data_.chi_squares_, gpu_data_.lambdas_, n_fits_);
+        gpu_data_.copy(gpu_data_.states_, gpu_data_.compacted_fits_, n_fits_);
+    }
+    else
+    {
+        calc_curve_values();
+        calc_hessians();
+    }
+
+    info_.profiler_->start(PROFILE_PHASE_SOLVER, gpu_data_.stream_);
+
+    // the parameters which are not fitted have no uncertainty
+    gpu_data_.set(gpu_data_.uncertainties_, 0.f, int(n_fits_ * info_.get_n_uncertainties()));
+
+    // the hessians are positive semidefinite at the final parameters, each
+    // hessian is decomposed once for all columns of its inverse
+    if (info_.n_parameters_to_fit_ <= CHOLESKY_MAX_N_EQUATIONS)
+    {
+        cuda_cholesky_inverse(
+            gpu_data_.uncertainties_,
+            gpu_data_.hessians_,
+            info_.n_parameters_to_fit_,
+            info_.n_parameters_,
+            gpu_data_.parameters_to_fit_indices_,
+            info_.uncertainty_type_,
+            n_fits_,
+            gpu_data_.stream_);
+    }
+    else
+    {
+        threads.x = std::min(n_fits_, 256);
+        threads.y = 1;
+        blocks.x = int(std::ceil(float(n_fits_) / float(threads.x)));
+        blocks.y = 1;
+
+        for (int column = 0; column < info_.n_parameters_to_fit_; column++)
+        {
+            cuda_set_unit_vectors<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+                gpu_data_.gradients_,
+                info_.n_parameters_to_fit_,
+                column,
+                n_fits_);
+            CUDA_CHECK_STATUS(cudaGetLastError());
+
+            solve_linear_systems();
+
+            cuda_store_uncertainties<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+                gpu_data_.uncertainties_,
+                gpu_data_.deltas_,
+                gpu_data_.singular_tests_,
+                info_.n_parameters_,
+                info_.n_parameters_to_fit_,
+                gpu_data_.parameters_to_fit_indices_,
+                column,
+                info_.uncertainty_type_,
+                n_fits_);
+            CUDA_CHECK_STATUS(cudaGetLastError());
+        }
+    }
+
+    info_.profiler_->stop(PROFILE_PHASE_SOLVER, gpu_data_.stream_);
 }
 
 void LMFitCUDA::calc_curve_values()
@@ -92,25 +283,94 @@ void LMFitCUDA::calc_curve_values()
 	dim3  threads(1, 1, 1);
 	dim3  blocks(1, 1, 1);
 
-	threads.x = info_.n_points_ * info_.n_fits_per_block_;
+	threads.x = info_.n_threads_per_fit_ * n_fits_per_block_;
 	threads.y = 1;
-	blocks.x = n_fits_ / info_.n_fits_per_block_;
+	blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
 	blocks.y = 1;
 
-	cuda_calc_curve_values << < blocks, threads >> >(
+	info_.profiler_->start(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+
+	if (JitModels::is_jit_model(info_.model_id_))
+	{
+		calc_curve_values_jit(blocks, threads);
+		info_.profiler_->stop(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+		return;
+	}
+
+	kernels_.calc_curve_values <<< blocks, threads, 0, gpu_data_.stream_ >>>(
 		gpu_data_.parameters_,
 		n_fits_,
+		gpu_data_.active_fits_,
+		n_active_fits_,
 		info_.n_points_,
 		info_.n_parameters_,
+		info_.n_parameters_to_fit_,
+		gpu_data_.parameters_to_fit_indices_,
 		gpu_data_.finished_,
 		gpu_data_.values_,
 		gpu_data_.derivatives_,
-		info_.n_fits_per_block_,
+		n_fits_per_block_,
 		info_.model_id_,
 		gpu_data_.chunk_index_,
-		gpu_data_.user_info_,
+		gpu_data_.first_fit_index_,
+		info_.coordinates_,
+		user_info_,
 		info_.user_info_size_);
 	CUDA_CHECK_STATUS(cudaGetLastError());
+
+	info_.profiler_->stop(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+}
+
+// launches the kernel compiled with a model registered by
+// gpufit_register_model(), see JitModels
+void LMFitCUDA::calc_curve_values_jit(dim3 const blocks, dim3 const threads)
+{
+    float const * parameters = gpu_data_.parameters_;
+    int n_fits = n_fits_;
+    int const * active_fits = gpu_data_.active_fits_;
+    int n_active_fits = n_active_fits_;
+    int n_points = info_.n_points_;
+    int n_parameters = info_.n_parameters_;
+    int n_parameters_to_fit = info_.n_parameters_to_fit_;
+    int const * parameters_to_fit_indices = gpu_data_.parameters_to_fit_indices_;
+    int const * finished = gpu_data_.finished_;
+    float * values = gpu_data_.values_;
+    float * derivatives = gpu_data_.derivatives_;
+    int n_fits_per_block = n_fits_per_block_;
+    int chunk_index = gpu_data_.chunk_index_;
+    int first_fit_index = gpu_data_.first_fit_index_;
+    Coordinates coordinates = info_.coordinates_;
+    char * user_info = user_info_;
+    std::size_t user_info_size = info_.user_info_size_;
+
+    void * arguments[] =
+    {
+        &parameters,
+        &n_fits,
+        &active_fits,
+        &n_active_fits,
+        &n_points,
+        &n_parameters,
+        &n_parameters_to_fit,
+        &parameters_to_fit_indices,
+        &finished,
+        &values,
+        &derivatives,
+        &n_fits_per_block,
+        &chunk_index,
+        &first_fit_index,
+        &coordinates,
+        &user_info,
+        &user_info_size
+    };
+
+    JitModels::instance().launch_calc_curve_values(
+        info_.model_id_,
+        info_.device_,
+        blocks,
+        threads,
+        gpu_data_.stream_,
+        arguments);
 }
 
 void LMFitCUDA::calc_chi_squares()
@@ -119,30 +379,36 @@ void LMFitCUDA::calc_chi_squares()
     dim3  blocks(1, 1, 1);
 
     int const shared_size
-        = sizeof(float)
-        * info_.power_of_two_n_points_
-        * info_.n_fits_per_block_;
+        = kernels_.chi_squares_shared_memory
+        * info_.n_threads_per_fit_
+        * n_fits_per_block_;
 
-    threads.x = info_.power_of_two_n_points_*info_.n_fits_per_block_;
+    threads.x = info_.n_threads_per_fit_*n_fits_per_block_;
     threads.y = 1;
-    blocks.x = n_fits_ / info_.n_fits_per_block_;
+    blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
     blocks.y = 1;
 
-    cuda_calculate_chi_squares <<< blocks, threads, shared_size >>>(
+    info_.profiler_->start(PROFILE_PHASE_CHI_SQUARES, gpu_data_.stream_);
+
+    kernels_.calculate_chi_squares <<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
         gpu_data_.chi_squares_,
         gpu_data_.states_,
         gpu_data_.iteration_falied_,
         gpu_data_.prev_chi_squares_,
-        gpu_data_.data_,
+        InputData(gpu_data_.data_, info_.data_type_),
         gpu_data_.values_,
-        gpu_data_.weights_,
+        weights_,
         info_.n_points_,
         info_.estimator_id_,
         gpu_data_.finished_,
-        info_.n_fits_per_block_,
-        gpu_data_.user_info_,
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        n_fits_per_block_,
+        user_info_,
         info_.user_info_size_);
     CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_CHI_SQUARES, gpu_data_.stream_);
 }
 
 void LMFitCUDA::calc_gradients()
@@ -151,21 +417,23 @@ void LMFitCUDA::calc_gradients()
     dim3  blocks(1, 1, 1);
 
     int const shared_size
-        = sizeof(float)
-        * info_.power_of_two_n_points_
-        * info_.n_fits_per_block_;
+        = kernels_.gradients_shared_memory
+        * info_.n_threads_per_fit_
+        * n_fits_per_block_;
 
-    threads.x = info_.power_of_two_n_points_*info_.n_fits_per_block_;
+    threads.x = info_.n_threads_per_fit_*n_fits_per_block_;
     threads.y = 1;
-    blocks.x = n_fits_ / info_.n_fits_per_block_;
+    blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
     blocks.y = 1;
 
-    cuda_calculate_gradients <<< blocks, threads, shared_size >>>(
+    info_.profiler_->start(PROFILE_PHASE_GRADIENTS, gpu_data_.stream_);
+
+    kernels_.calculate_gradients <<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
         gpu_data_.gradients_,
-        gpu_data_.data_,
+        InputData(gpu_data_.data_, info_.data_type_),
         gpu_data_.values_,
         gpu_data_.derivatives_,
-        gpu_data_.weights_,
+        weights_,
         info_.n_points_,
         info_.n_parameters_,
         info_.n_parameters_to_fit_,
@@ -173,10 +441,14 @@ void LMFitCUDA::calc_gradients()
         info_.estimator_id_,
         gpu_data_.finished_,
         gpu_data_.iteration_falied_,
-        info_.n_fits_per_block_,
-        gpu_data_.user_info_,
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        n_fits_per_block_,
+        user_info_,
         info_.user_info_size_);
     CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_GRADIENTS, gpu_data_.stream_);
 }
 
 void LMFitCUDA::calc_hessians()
@@ -184,17 +456,24 @@ void LMFitCUDA::calc_hessians()
     dim3  threads(1, 1, 1);
     dim3  blocks(1, 1, 1);
 
-    threads.x = info_.n_parameters_to_fit_;
-    threads.y = info_.n_parameters_to_fit_;
-    blocks.x = n_fits_;
+    int const shared_size
+        = kernels_.hessians_shared_memory
+        * info_.n_threads_per_fit_
+        * n_fits_per_block_;
+
+    threads.x = info_.n_threads_per_fit_*n_fits_per_block_;
+    threads.y = 1;
+    blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
     blocks.y = 1;
 
-    cuda_calculate_hessians <<< blocks, threads >>>(
+    info_.profiler_->start(PROFILE_PHASE_HESSIANS, gpu_data_.stream_);
+
+    kernels_.calculate_hessians <<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
         gpu_data_.hessians_,
-        gpu_data_.data_,
+        InputData(gpu_data_.data_, info_.data_type_),
         gpu_data_.values_,
         gpu_data_.derivatives_,
-        gpu_data_.weights_,
+        weights_,
         info_.n_points_,
         info_.n_parameters_,
         info_.n_parameters_to_fit_,
@@ -202,22 +481,78 @@ void LMFitCUDA::calc_hessians()
         info_.estimator_id_,
         gpu_data_.iteration_falied_,
         gpu_data_.finished_,
-        gpu_data_.user_info_,
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        n_fits_per_block_,
+        user_info_,
         info_.user_info_size_);
     CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_HESSIANS, gpu_data_.stream_);
 }
 
-void LMFitCUDA::evaluate_iteration(int const iteration)
+void LMFitCUDA::calc_curve_values_and_hessians()
 {
     dim3  threads(1, 1, 1);
     dim3  blocks(1, 1, 1);
 
-    threads.x = std::min(n_fits_, 256);
+    int const shared_size
+        = (sizeof(float) * (info_.n_parameters_to_fit_ + 1) + kernels_.curve_values_and_hessians_shared_memory)
+        * info_.n_threads_per_fit_
+        * n_fits_per_block_;
+
+    threads.x = info_.n_threads_per_fit_*n_fits_per_block_;
     threads.y = 1;
-    blocks.x = int(std::ceil(float(n_fits_) / float(threads.x)));
+    blocks.x = (n_active_fits_ + n_fits_per_block_ - 1) / n_fits_per_block_;
+    blocks.y = 1;
+
+    info_.profiler_->start(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+
+    kernels_.calc_curve_values_and_hessians <<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
+        gpu_data_.chi_squares_,
+        gpu_data_.gradients_,
+        gpu_data_.hessians_,
+        gpu_data_.states_,
+        gpu_data_.iteration_falied_,
+        gpu_data_.prev_chi_squares_,
+        gpu_data_.parameters_,
+        InputData(gpu_data_.data_, info_.data_type_),
+        weights_,
+        n_fits_,
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        info_.n_points_,
+        info_.n_parameters_,
+        info_.n_parameters_to_fit_,
+        gpu_data_.parameters_to_fit_indices_,
+        gpu_data_.finished_,
+        n_fits_per_block_,
+        info_.model_id_,
+        info_.estimator_id_,
+        gpu_data_.chunk_index_,
+        gpu_data_.first_fit_index_,
+        info_.coordinates_,
+        user_info_,
+        info_.user_info_size_);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+}
+
+// returns whether the host waited for the device to check the convergence
+bool LMFitCUDA::evaluate_iteration(int const iteration)
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    info_.profiler_->start(PROFILE_PHASE_EVALUATION, gpu_data_.stream_);
+
+    threads.x = std::min(n_active_fits_, 256);
+    threads.y = 1;
+    blocks.x = int(std::ceil(float(n_active_fits_) / float(threads.x)));
     blocks.y = 1;
 
-    cuda_check_for_convergence<<< blocks, threads >>>(
+    cuda_check_for_convergence<<< blocks, threads, 0, gpu_data_.stream_ >>>(
         gpu_data_.finished_,
         tolerance_,
         gpu_data_.states_,
@@ -225,29 +560,344 @@ void LMFitCUDA::evaluate_iteration(int const iteration)
         gpu_data_.prev_chi_squares_,
         iteration,
         info_.max_n_iterations_,
-        n_fits_);
+        gpu_data_.active_fits_,
+        n_active_fits_);
     CUDA_CHECK_STATUS(cudaGetLastError());
 
-    gpu_data_.set(gpu_data_.all_finished_, 1);
-
-    cuda_evaluate_iteration<<< blocks, threads >>>(
-        gpu_data_.all_finished_,
+    cuda_evaluate_iteration<<< blocks, threads, 0, gpu_data_.stream_ >>>(
         gpu_data_.n_iterations_,
         gpu_data_.finished_,
         iteration,
         gpu_data_.states_,
-        n_fits_);
+        gpu_data_.active_fits_,
+        n_active_fits_);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+
+    cuda_prepare_next_iteration<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+        gpu_data_.lambdas_,
+        gpu_data_.chi_squares_,
+        gpu_data_.prev_chi_squares_,
+        gpu_data_.parameters_,
+        gpu_data_.prev_parameters_,
+        gpu_data_.n_iterations_,
+        iteration,
+        gpu_data_.active_fits_,
+        n_active_fits_,
+        info_.n_parameters_);
     CUDA_CHECK_STATUS(cudaGetLastError());
 
-    gpu_data_.read(&all_finished_, gpu_data_.all_finished_);
+    // The host waits for the device only every convergence_check_interval_
+    // iterations. In between, the iterations are queued without
+    // synchronization. Finished fits are skipped by all kernels, so additional
+    // iterations do not change their results.
+    bool const check_all_finished
+        = (iteration + 1) % info_.convergence_check_interval_ == 0
+        || iteration + 1 >= info_.max_n_iterations_;
+
+    if (check_all_finished)
+    {
+        compact_active_fits();
+        all_finished_ = n_active_fits_ == 0;
+    }
+
+    info_.profiler_->stop(PROFILE_PHASE_EVALUATION, gpu_data_.stream_);
+
+    return check_all_finished;
+}
+
+void LMFitCUDA::finish_direct_linear_fit()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    info_.profiler_->start(PROFILE_PHASE_EVALUATION, gpu_data_.stream_);
+
+    threads.x = std::min(n_fits_, 256);
+    threads.y = 1;
+    blocks.x = int(std::ceil(float(n_fits_) / float(threads.x)));
+    blocks.y = 1;
 
-    cuda_prepare_next_iteration<<< blocks, threads >>>(
+    // keeps the initial parameters of fits whose chi-square did not decrease,
+    // e.g. of singular fits or of fits which started at the solution
+    cuda_prepare_next_iteration<<< blocks, threads, 0, gpu_data_.stream_ >>>(
         gpu_data_.lambdas_,
         gpu_data_.chi_squares_,
         gpu_data_.prev_chi_squares_,
         gpu_data_.parameters_,
         gpu_data_.prev_parameters_,
+        gpu_data_.n_iterations_,
+        0,
+        gpu_data_.active_fits_,
         n_fits_,
         info_.n_parameters_);
     CUDA_CHECK_STATUS(cudaGetLastError());
+
+    gpu_data_.set(gpu_data_.n_iterations_, 1, n_fits_);
+
+    info_.profiler_->stop(PROFILE_PHASE_EVALUATION, gpu_data_.stream_);
+}
+
+void LMFitCUDA::compact_active_fits()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    threads.x = 256;
+    threads.y = 1;
+    blocks.x = (n_active_fits_ + threads.x - 1) / threads.x;
+    blocks.y = 1;
+
+    gpu_data_.set(gpu_data_.n_active_fits_, 0);
+
+    cuda_compact_active_fits<<< blocks, threads, 0, gpu_data_.stream_ >>>(
+        gpu_data_.compacted_fits_,
+        gpu_data_.n_active_fits_,
+        gpu_data_.active_fits_,
+        gpu_data_.finished_,
+        n_active_fits_);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+
+    // the finished fits are not calculated by the kernels of later iterations
+    gpu_data_.read(&n_active_fits_, gpu_data_.n_active_fits_);
+    gpu_data_.copy(gpu_data_.active_fits_, gpu_data_.compacted_fits_, n_active_fits_);
+}
+
+void LMFitCUDA::estimate_initial_parameters()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    threads.x = std::min(n_fits_, 256);
+    blocks.x = int(std::ceil(float(n_fits_) / float(threads.x)));
+
+    info_.profiler_->start(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+
+    cuda_estimate_initial_parameters <<< blocks, threads, 0, gpu_data_.stream_ >>>(
+        gpu_data_.parameters_,
+        InputData(gpu_data_.data_, info_.data_type_),
+        weights_,
+        n_fits_,
+        info_.n_points_,
+        info_.n_parameters_,
+        info_.model_id_,
+        gpu_data_.first_fit_index_,
+        info_.coordinates_,
+        user_info_,
+        info_.user_info_size_);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+}
+
+void LMFitCUDA::run_fused()
+{
+    dim3  threads(1, 1, 1);
+    dim3  blocks(1, 1, 1);
+
+    threads.x = std::max(info_.n_threads_per_fit_, 32);
+    threads.y = 1;
+    blocks.x = n_fits_;
+    blocks.y = 1;
+
+    int const n_parameters = info_.n_parameters_;
+    int const n_parameters_to_fit = info_.n_parameters_to_fit_;
+
+    int const shared_size
+        = sizeof(float)
+        * (info_.n_points_ * (n_parameters_to_fit + 1)
+        + threads.x
+        + 2 * n_parameters
+        + n_parameters_to_fit * (2 * n_parameters_to_fit + 3))
+        + sizeof(int) * n_parameters_to_fit;
+
+    info_.profiler_->start(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+
+    cuda_fit_fused <<< blocks, threads, shared_size, gpu_data_.stream_ >>>(
+        gpu_data_.parameters_,
+        gpu_data_.states_,
+        gpu_data_.chi_squares_,
+        gpu_data_.n_iterations_,
+        gpu_data_.lambdas_,
+        InputData(gpu_data_.data_, info_.data_type_),
+        weights_,
+        n_fits_,
+        info_.n_points_,
+        n_parameters,
+        n_parameters_to_fit,
+        gpu_data_.parameters_to_fit_indices_,
+        info_.model_id_,
+        info_.estimator_id_,
+        tolerance_,
+        info_.max_n_iterations_,
+        gpu_data_.chunk_index_,
+        gpu_data_.first_fit_index_,
+        info_.coordinates_,
+        info_.constraints_,
+        user_info_,
+        info_.user_info_size_);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+
+    info_.profiler_->stop(PROFILE_PHASE_MODEL, gpu_data_.stream_);
+}
+
+// the number of thread blocks of a kernel resident on one multiprocessor
+template< typename Kernel >
+int get_resident_blocks(Kernel const kernel, int const n_threads, std::size_t const shared_size)
+{
+    int n_blocks = 0;
+    CUDA_CHECK_STATUS(cudaOccupancyMaxActiveBlocksPerMultiprocessor(
+        &n_blocks, kernel, n_threads, shared_size));
+    return n_blocks;
+}
+
+std::vector< int > LMFitCUDA::get_fits_per_block_candidates() const
+{
+    int max_threads = 0;
+    CUDA_CHECK_STATUS(cudaDeviceGetAttribute(&max_threads, cudaDevAttrMaxThreadsPerBlock, info_.device_));
+
+    // the kernels of the model parameters use one thread per parameter
+    int const n_threads_per_fit = std::max(info_.n_threads_per_fit_, info_.n_parameters_);
+
+    std::vector< int > candidates;
+    for (int n_fits_per_block = 1;
+        n_fits_per_block * n_threads_per_fit <= max_threads
+        && (n_fits_per_block == 1 || std::size_t(n_fits_per_block) <= n_fits_);
+        n_fits_per_block *= 2)
+    {
+        candidates.push_back(n_fits_per_block);
+    }
+
+    return candidates;
+}
+
+int LMFitCUDA::get_occupancy_fits_per_block(std::vector< int > const & candidates) const
+{
+    int const n_multiprocessors = getDeviceMultiprocessorCount(info_.device_);
+    int const n_threads_per_fit = info_.n_threads_per_fit_;
+
+    int best_n_fits_per_block = 1;
+    std::size_t max_concurrent_fits = 0;
+
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        int const n_fits_per_block = candidates[i];
+        int const n_threads = n_threads_per_fit * n_fits_per_block;
+        int const n_blocks = (n_fits_ + n_fits_per_block - 1) / n_fits_per_block;
+
+        // the kernel with the lowest occupancy limits the number of fits
+        // calculated at the same time
+        int resident_blocks = 0;
+        if (info_.use_on_the_fly_hessians_)
+        {
+            resident_blocks = get_resident_blocks(
+                kernels_.calc_curve_values_and_hessians,
+                n_threads,
+                (sizeof(float) * (info_.n_parameters_to_fit_ + 1) + kernels_.curve_values_and_hessians_shared_memory) * n_threads);
+        }
+        else
+        {
+            resident_blocks = std::min(
+                std::min(
+                    get_resident_blocks(kernels_.calc_curve_values, n_threads, 0),
+                    get_resident_blocks(kernels_.calculate_chi_squares, n_threads, kernels_.chi_squares_shared_memory * n_threads)),
+                std::min(
+                    get_resident_blocks(kernels_.calculate_gradients, n_threads, kernels_.gradients_shared_memory * n_threads),
+                    get_resident_blocks(kernels_.calculate_hessians, n_threads, kernels_.hessians_shared_memory * n_threads)));
+        }
+
+        std::size_t const concurrent_fits
+            = std::size_t(std::min(resident_blocks * n_multiprocessors, n_blocks))
+            * n_fits_per_block;
+
+        // the smallest number of fits per block is kept among equal candidates,
+        // which leaves the most thread blocks to the scheduler
+        if (concurrent_fits > max_concurrent_fits)
+        {
+            max_concurrent_fits = concurrent_fits;
+            best_n_fits_per_block = n_fits_per_block;
+        }
+    }
+
+    return best_n_fits_per_block;
+}
+
+std::string LMFitCUDA::get_autotune_key() const
+{
+    cudaDeviceProp properties;
+    CUDA_CHECK_STATUS(cudaGetDeviceProperties(&properties, info_.device_));
+
+    std::ostringstream key;
+    key << properties.name
+        << " model " << info_.model_id_
+        << " estimator " << info_.estimator_id_
+        << " points " << info_.n_points_
+        << " parameters " << info_.n_parameters_to_fit_ << '/' << info_.n_parameters_
+        << " precision " << info_.precision_id_
+        << " data type " << info_.data_type_
+        << " on the fly " << info_.use_on_the_fly_hessians_;
+    return key.str();
+}
+
+int LMFitCUDA::autotune_fits_per_block(std::vector< int > const & candidates)
+{
+    // the launches of all candidates are queued, the host waits for the
+    // device only once
+    std::vector< CudaEvent > starts(candidates.size());
+    std::vector< CudaEvent > stops(candidates.size());
+
+    // the kernels only depend on the parameters, which are not changed before
+    // the first iteration
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        n_fits_per_block_ = candidates[i];
+
+        // the first launch is not timed
+        calc_chi_squares_gradients_hessians();
+
+        CUDA_CHECK_STATUS(cudaEventRecord(starts[i], gpu_data_.stream_));
+        calc_chi_squares_gradients_hessians();
+        CUDA_CHECK_STATUS(cudaEventRecord(stops[i], gpu_data_.stream_));
+    }
+
+    int best_n_fits_per_block = 1;
+    float best_time = std::numeric_limits< float >::max();
+
+    if (!candidates.empty())
+    {
+        CUDA_CHECK_STATUS(cudaEventSynchronize(stops.back()));
+    }
+
+    for (std::size_t i = 0; i < candidates.size(); i++)
+    {
+        float time = 0.f;
+        CUDA_CHECK_STATUS(cudaEventElapsedTime(&time, starts[i], stops[i]));
+
+        if (time < best_time)
+        {
+            best_time = time;
+            best_n_fits_per_block = candidates[i];
+        }
+    }
+
+    return best_n_fits_per_block;
+}
+
+void LMFitCUDA::set_fits_per_block()
+{
+    std::vector< int > const candidates = get_fits_per_block_candidates();
+
+    if (!info_.autotune_)
+    {
+        n_fits_per_block_ = get_occupancy_fits_per_block(candidates);
+        return;
+    }
+
+    std::string const key = get_autotune_key();
+    AutotuneCache & cache = AutotuneCache::instance();
+
+    if (!cache.find(key, n_fits_per_block_))
+    {
+        n_fits_per_block_ = autotune_fits_per_block(candidates);
+        cache.insert(key, n_fits_per_block_);
+    }
 }
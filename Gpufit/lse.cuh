@@ -1,18 +1,22 @@
 #ifndef GPUFIT_LSE_CUH_INCLUDED
 #define GPUFIT_LSE_CUH_INCLUDED
 
+#include "input_data.cuh"
+
 /* Description of the calculate_chi_square_lse function
 * =====================================================
 *
-* This function calculates the chi-square values for the weighted LSE estimator.
+* This function calculates the chi-square summand of a data point for the
+* weighted LSE estimator and adds it to chi_square.
 *
 * Parameters:
 *
-* chi_square: An output vector of chi-square values for each data point.
+* chi_square: An input and output value, to which the chi-square summand of the
+*             data point is added.
 *
 * point_index: The data point index.
 *
-* data: An input vector of data values.
+* data: An input vector of data values, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -37,9 +41,9 @@
 */
 
 __device__ void calculate_chi_square_lse(
-    volatile float * chi_square,
+    float * chi_square,
     int const point_index,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * weight,
     int * state,
@@ -50,11 +54,11 @@ __device__ void calculate_chi_square_lse(
 
     if (weight)
     {
-        chi_square[point_index] = deviation * deviation * weight[point_index];
+        *chi_square += deviation * deviation * weight[point_index];
     }
     else
     {
-        chi_square[point_index] = deviation * deviation;
+        *chi_square += deviation * deviation;
     }
 }
 
@@ -75,7 +79,7 @@ __device__ void calculate_chi_square_lse(
 *
 * parameter_index_j: Index of the hessian row.
 *
-* data: An input vector of data values.
+* data: An input vector of data values, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -101,7 +105,7 @@ __device__ void calculate_hessian_lse(
     int const point_index,
     int const parameter_index_i,
     int const parameter_index_j,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * derivative,
     float const * weight,
@@ -129,7 +133,8 @@ __device__ void calculate_hessian_lse(
 *
 * Parameters:
 *
-* gradient: An output vector of values of the gradient vector for each data point.
+* gradient: An input and output value, to which the gradient summand of the data
+*           point is added.
 *
 * point_index: The data point index.
 *
@@ -137,7 +142,7 @@ __device__ void calculate_hessian_lse(
 *
 * n_parameters: The number of fitting curve parameters.
 *
-* data: An input vector of data values.
+* data: An input vector of data values, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -159,10 +164,10 @@ __device__ void calculate_hessian_lse(
 */
 
 __device__ void calculate_gradient_lse(
-    volatile float * gradient,
+    float * gradient,
     int const point_index,
     int const parameter_index,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * derivative,
     float const * weight,
@@ -173,13 +178,11 @@ __device__ void calculate_gradient_lse(
 
     if (weight)
     {
-        gradient[point_index]
-            = derivative[parameter_index] * deviation * weight[point_index];
+        *gradient += derivative[parameter_index] * deviation * weight[point_index];
     }
     else
     {
-        gradient[point_index]
-            = derivative[parameter_index] * deviation;
+        *gradient += derivative[parameter_index] * deviation;
     }
 }
 
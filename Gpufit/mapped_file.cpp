@@ -0,0 +1,132 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const & path) :
+    data_(0),
+    size_(0),
+    file_(INVALID_HANDLE_VALUE),
+    mapping_(0)
+{
+    file_ = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error("cannot open file " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+    {
+        CloseHandle(file_);
+        throw std::runtime_error("cannot read the size of file " + path);
+    }
+    size_ = std::size_t(size.QuadPart);
+
+    // empty files cannot be mapped
+    if (size_ == 0)
+        return;
+
+    mapping_ = CreateFileMappingA(file_, 0, PAGE_READONLY, 0, 0, 0);
+    if (mapping_)
+    {
+        data_ = static_cast< char const * >(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+    if (!data_)
+    {
+        if (mapping_)
+            CloseHandle(mapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("cannot map file " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+    if (mapping_)
+        CloseHandle(mapping_);
+    CloseHandle(file_);
+}
+
+// the unmodified pages of a read-only view are removed from the working set
+void MappedFile::release(std::size_t const offset, std::size_t const size)
+{
+    if (data_ && size > 0)
+        VirtualUnlock(const_cast< char * >(data_ + offset), size);
+}
+
+#else
+
+MappedFile::MappedFile(std::string const & path) :
+    data_(0),
+    size_(0),
+    file_(-1)
+{
+    file_ = open(path.c_str(), O_RDONLY);
+    if (file_ < 0)
+    {
+        throw std::runtime_error("cannot open file " + path);
+    }
+
+    struct stat status;
+    if (fstat(file_, &status) != 0)
+    {
+        close(file_);
+        throw std::runtime_error("cannot read the size of file " + path);
+    }
+    size_ = std::size_t(status.st_size);
+
+    // empty files cannot be mapped
+    if (size_ == 0)
+        return;
+
+    void * const data = mmap(0, size_, PROT_READ, MAP_SHARED, file_, 0);
+    if (data == MAP_FAILED)
+    {
+        close(file_);
+        throw std::runtime_error("cannot map file " + path);
+    }
+    data_ = static_cast< char const * >(data);
+
+    // the file is read once from the beginning to the end
+    madvise(data, size_, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+        munmap(const_cast< char * >(data_), size_);
+    close(file_);
+}
+
+// the pages of the range are dropped from the address space, they are read
+// again from the page cache or the file if they are accessed later
+void MappedFile::release(std::size_t const offset, std::size_t const size)
+{
+    if (!data_ || size == 0)
+        return;
+
+    // madvise works on whole pages, the pages partially outside the range are
+    // kept
+    std::size_t const page_size = std::size_t(sysconf(_SC_PAGESIZE));
+    std::size_t const begin = (offset + page_size - 1) / page_size * page_size;
+    std::size_t const end = (offset + size) / page_size * page_size;
+
+    if (begin < end)
+        madvise(const_cast< char * >(data_) + begin, end - begin, MADV_DONTNEED);
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef GPUFIT_MAPPED_FILE_H_INCLUDED
+#define GPUFIT_MAPPED_FILE_H_INCLUDED
+
+#include <cstddef>
+#include <string>
+
+/* Description of the MappedFile class
+* ===================================
+*
+* Maps a file read-only into the address space of the process. The pages of
+* the file are read on first access and belong to the page cache of the
+* operating system, hence files larger than the host memory can be mapped.
+* The pages of a range which is not read again are released by release(),
+* which keeps the resident memory bounded when the file is read sequentially.
+*
+*/
+
+class MappedFile
+{
+public:
+    explicit MappedFile(std::string const & path);
+    ~MappedFile();
+
+    char const * data() const { return data_; }
+    std::size_t size() const { return size_; }
+
+    void release(std::size_t const offset, std::size_t const size);
+
+private:
+    MappedFile(MappedFile const &);
+    MappedFile & operator=(MappedFile const &);
+
+    char const * data_;
+    std::size_t size_;
+
+#ifdef _WIN32
+    void * file_;
+    void * mapping_;
+#else
+    int file_;
+#endif
+};
+
+#endif
@@ -2,5 +2,8 @@ classdef EstimatorID
     properties (Constant = true)
         LSE = 0
         MLE = 1
+        MLE_SCMOS = 2
+        LSE_HUBER = 3
+        LSE_CAUCHY = 4
     end
 end
\ No newline at end of file
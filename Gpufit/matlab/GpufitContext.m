@@ -0,0 +1,40 @@
+classdef GpufitContext < handle
+% Fit context which keeps its GPU memory between repeated fits, e.g. of the
+% frames of an image stack in a loop. The context is released when the
+% object is deleted.
+%
+%   context = GpufitContext();
+%   context.set_option(0, 2); % OPTION_N_STREAMS, see gpufit.h
+%   for i = 1:n_frames
+%       [parameters, states, chi_squares, n_iterations, time] = context.fit(data{i}, [], model_id, initial_parameters{i});
+%   end
+%
+% The arguments of fit are the arguments of gpufit.
+
+    properties (SetAccess = private)
+        handle
+    end
+
+    methods
+        function obj = GpufitContext()
+            obj.handle = GpufitMex('create');
+        end
+
+        function delete(obj)
+            if ~isempty(obj.handle)
+                GpufitMex('destroy', obj.handle);
+            end
+        end
+
+        function set_option(obj, option_id, value)
+            GpufitMex('set_option', obj.handle, option_id, value);
+        end
+
+        function [parameters, states, chi_squares, n_iterations, time] = fit(obj, varargin)
+            assert(numel(varargin) >= 4 && numel(varargin) <= 9, 'Wrong number of parameters');
+            fit_arguments = cell(1, 9);
+            fit_arguments(1:numel(varargin)) = varargin;
+            [parameters, states, chi_squares, n_iterations, time] = gpufit(fit_arguments{:}, obj);
+        end
+    end
+end
@@ -1,25 +1,35 @@
 function [parameters, states, chi_squares, n_iterations, time]...
-    = gpufit(data, weights, model_id, initial_parameters, tolerance, max_n_iterations, parameters_to_fit, estimator_id, user_info)
+    = gpufit(data, weights, model_id, initial_parameters, tolerance, max_n_iterations, parameters_to_fit, estimator_id, user_info, context)
 % Wrapper around the Gpufit mex file.
 %
 % Optional arguments can be given as empty matrix [].
 %
 % Default values as specified
+%
+% If data is a gpuArray, the data stays in GPU memory, weights,
+% initial_parameters and user_info must be gpuArrays as well and all outputs
+% are gpuArrays.
+%
+% context is a GpufitContext, which keeps its GPU memory between repeated
+% calls, or empty for a temporary fit context.
 
 %% size checks
 
 % number of input parameter (variable)
-if nargin < 9
-    user_info = [];
-    if nargin < 8
-        estimator_id = [];
-        if nargin < 7
-            parameters_to_fit = [];
-            if nargin < 6
-                max_n_iterations = [];
-                if nargin < 5
-                    tolerance = [];
-					assert(nargin == 4, 'Not enough parameters');
+if nargin < 10
+    context = [];
+    if nargin < 9
+        user_info = [];
+        if nargin < 8
+            estimator_id = [];
+            if nargin < 7
+                parameters_to_fit = [];
+                if nargin < 6
+                    max_n_iterations = [];
+                    if nargin < 5
+                        tolerance = [];
+                        assert(nargin == 4, 'Not enough parameters');
+                    end
                 end
             end
         end
@@ -75,11 +85,16 @@ end
 %% type checks
 
 % data, weights (if given), initial_parameters are all single
-assert(isa(data, 'single'), 'Type of data is not single');
+assert(strcmp(underlying_class(data), 'single'), 'Type of data is not single');
 if ~isempty(weights)
-    assert(isa(weights, 'single'), 'Type of weights is not single');
+    assert(strcmp(underlying_class(weights), 'single'), 'Type of weights is not single');
+end
+assert(strcmp(underlying_class(initial_parameters), 'single'), 'Type of initial_parameters is not single');
+
+% parameters_to_fit is read on the host
+if isa(parameters_to_fit, 'gpuArray')
+    parameters_to_fit = gather(parameters_to_fit);
 end
-assert(isa(initial_parameters, 'single'), 'Type of initial_parameters is not single');
 
 % parameters_to_fit is int32 (cast to int32 if incorrect type)
 if ~isa(parameters_to_fit, 'int32')
@@ -97,7 +112,11 @@ if ~isa(tolerance, 'single')
 end
 
 % we don't check type of user_info, but we extract the size in bytes of it
-if ~isempty(user_info)
+if isa(user_info, 'gpuArray')
+    element = zeros(1, 1, classUnderlying(user_info));
+    element_info = whos('element');
+    user_info_size = numel(user_info) * element_info.bytes;
+elseif ~isempty(user_info)
     user_info_info = whos('user_info');
     user_info_size = user_info_info.bytes;
 else
@@ -107,8 +126,13 @@ end
 
 %% run Gpufit taking the time
 tic;
-[parameters, states, chi_squares, n_iterations] ...
-    = GpufitMex(data, weights, n_fits, n_points, tolerance, max_n_iterations, estimator_id, initial_parameters, parameters_to_fit, model_id, n_parameters, user_info, user_info_size);
+if isempty(context)
+    [parameters, states, chi_squares, n_iterations] ...
+        = GpufitMex(data, weights, n_fits, n_points, tolerance, max_n_iterations, estimator_id, initial_parameters, parameters_to_fit, model_id, n_parameters, user_info, user_info_size);
+else
+    [parameters, states, chi_squares, n_iterations] ...
+        = GpufitMex('fit', context.handle, data, weights, n_fits, n_points, tolerance, max_n_iterations, estimator_id, initial_parameters, parameters_to_fit, model_id, n_parameters, user_info, user_info_size);
+end
 
 time = toc;
 
@@ -117,3 +141,14 @@ time = toc;
 parameters = reshape(parameters,n_parameters,n_fits);
 
 end
+
+function name = underlying_class(array)
+% class of the elements of an array, also of a gpuArray
+
+if isa(array, 'gpuArray')
+    name = classUnderlying(array);
+else
+    name = class(array);
+end
+
+end
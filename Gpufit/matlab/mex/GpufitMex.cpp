@@ -1,8 +1,13 @@
 #include "Gpufit/gpufit.h"
 
 #include <mex.h>
+#ifdef GPUFIT_MEX_GPU_ARRAY
+#include <gpu/mxGPUArray.h>
+#endif
 
+#include <cstdint>
 #include <cstring>
+#include <set>
 #include <string>
 
 /*
@@ -21,54 +26,151 @@ template<class T> inline bool get_scalar(const mxArray *p, T &v, const mxClassID
 	}
 }
 
-void mexFunction(
-    int          nlhs,
-    mxArray      *plhs[],
-    int          nrhs,
-    mxArray const *prhs[])
+/*
+	Fit contexts created by GpufitMex('create'). The handles passed back to
+	Matlab are checked against this set, and the contexts which were not
+	destroyed are released when the mex file is cleared.
+*/
+std::set< void * > contexts;
+
+void destroy_contexts()
 {
-    int expected_nrhs = 0;
-    int expected_nlhs = 0;
-    bool wrong_nrhs = false;
-    bool wrong_nlhs = false;
+    for (std::set< void * >::iterator it = contexts.begin(); it != contexts.end(); ++it)
+    {
+        gpufit_destroy_context(*it);
+    }
+    contexts.clear();
+}
 
+void check_arguments(int const nlhs, int const expected_nlhs, int const nrhs, int const expected_nrhs)
+{
     // expects a certain number of input (nrhs) and output (nlhs) arguments
-    expected_nrhs = 13;
-    expected_nlhs = 4;
     if (nrhs != expected_nrhs)
     {
-        wrong_nrhs = true;
+        std::string const error = std::to_string(expected_nrhs) + " input arguments required.";
+        mexErrMsgIdAndTxt("Gpufit:Mex", error.c_str());
     }
     else if (nlhs != expected_nlhs)
     {
-        wrong_nlhs = true;
+        std::string const error = std::to_string(expected_nlhs) + " output arguments required.";
+        mexErrMsgIdAndTxt("Gpufit:Mex", error.c_str());
     }
+}
 
-    if (wrong_nrhs || wrong_nlhs)
+void * get_context(mxArray const * handle)
+{
+    std::uint64_t value = 0;
+    if (!get_scalar(handle, value, mxUINT64_CLASS))
     {
-        if (nrhs != expected_nrhs)
-        {
-            char s1[50];
-            _itoa_s(expected_nrhs, s1, 10);
-            char const s2[] = " input arguments required.";
-            size_t const string_length = strlen(s1) + 1 + strlen(s2);
-            strcat_s(s1, string_length, s2);
-            mexErrMsgIdAndTxt("Gpufit:Mex", s1);
-        }
-        else if (nlhs != expected_nlhs)
-        {
-            char s1[50];
-            _itoa_s(expected_nlhs, s1, 10);
-            char const s2[] = " output arguments required.";
-            size_t const string_length = strlen(s1) + 1 + strlen(s2);
-            strcat_s(s1, string_length, s2);
-            mexErrMsgIdAndTxt("Gpufit:Mex", s1);
-        }
+        mexErrMsgIdAndTxt("Gpufit:Mex", "handle is not uint64");
+    }
+
+    void * const context = reinterpret_cast< void * >(value);
+    if (contexts.find(context) == contexts.end())
+    {
+        mexErrMsgIdAndTxt("Gpufit:Mex", "invalid fit context handle");
+    }
+
+    return context;
+}
+
+void check_status(int const status)
+{
+    if (status != STATUS_OK)
+    {
+        std::string const error = gpufit_get_last_error() ;
+        mexErrMsgIdAndTxt( "Gpufit:Mex", error.c_str() ) ;
     }
+}
+
+#ifdef GPUFIT_MEX_GPU_ARRAY
+
+/*
+	Fits data in GPU memory (gpuArray) by the CUDA interface, without
+	transfers between host and GPU. The fitted parameters are calculated in a
+	copy of the initial parameters, all outputs are gpuArrays.
+*/
+int fit_gpu_arrays(
+    void * const context,
+    mxArray * plhs[],
+    mxArray const * prhs[],
+    std::size_t const n_fits,
+    std::size_t const n_points,
+    float const tolerance,
+    int const max_n_iterations,
+    int const estimator_id,
+    int * const parameters_to_fit,
+    int const model_id,
+    std::size_t const user_info_size)
+{
+    mxInitGPU();
+
+    mxGPUArray const * const gpu_data = mxGPUCreateFromMxArray(prhs[0]);
+    mxGPUArray const * const gpu_weights = mxIsEmpty(prhs[1]) ? 0 : mxGPUCreateFromMxArray(prhs[1]);
+    mxGPUArray const * const gpu_user_info = mxIsEmpty(prhs[11]) ? 0 : mxGPUCreateFromMxArray(prhs[11]);
+
+    // the initial parameters are replaced by the fitted parameters
+    mxGPUArray * const gpu_parameters = mxGPUCopyFromMxArray(prhs[7]);
+
+    mwSize const dimensions[2] = { 1, n_fits };
+    mxGPUArray * const gpu_states
+        = mxGPUCreateGPUArray(2, dimensions, mxINT32_CLASS, mxREAL, MX_GPU_DO_NOT_INITIALIZE);
+    mxGPUArray * const gpu_chi_squares
+        = mxGPUCreateGPUArray(2, dimensions, mxSINGLE_CLASS, mxREAL, MX_GPU_DO_NOT_INITIALIZE);
+    mxGPUArray * const gpu_n_iterations
+        = mxGPUCreateGPUArray(2, dimensions, mxINT32_CLASS, mxREAL, MX_GPU_DO_NOT_INITIALIZE);
+
+    int const status
+            = gpufit_context_cuda_interface
+            (
+                context,
+                n_fits,
+                n_points,
+                static_cast< float * >(const_cast< void * >(mxGPUGetDataReadOnly(gpu_data))),
+                gpu_weights ? static_cast< float * >(const_cast< void * >(mxGPUGetDataReadOnly(gpu_weights))) : 0,
+                model_id,
+                tolerance,
+                max_n_iterations,
+                parameters_to_fit,
+                estimator_id,
+                user_info_size,
+                gpu_user_info ? static_cast< char * >(const_cast< void * >(mxGPUGetDataReadOnly(gpu_user_info))) : 0,
+                static_cast< float * >(mxGPUGetData(gpu_parameters)),
+                static_cast< int * >(mxGPUGetData(gpu_states)),
+                static_cast< float * >(mxGPUGetData(gpu_chi_squares)),
+                static_cast< int * >(mxGPUGetData(gpu_n_iterations)),
+                0
+            ) ;
+
+    plhs[0] = mxGPUCreateMxArrayOnGPU(gpu_parameters);
+    plhs[1] = mxGPUCreateMxArrayOnGPU(gpu_states);
+    plhs[2] = mxGPUCreateMxArrayOnGPU(gpu_chi_squares);
+    plhs[3] = mxGPUCreateMxArrayOnGPU(gpu_n_iterations);
+
+    mxGPUDestroyGPUArray(gpu_data);
+    if (gpu_weights)
+        mxGPUDestroyGPUArray(gpu_weights);
+    if (gpu_user_info)
+        mxGPUDestroyGPUArray(gpu_user_info);
+    mxGPUDestroyGPUArray(gpu_parameters);
+    mxGPUDestroyGPUArray(gpu_states);
+    mxGPUDestroyGPUArray(gpu_chi_squares);
+    mxGPUDestroyGPUArray(gpu_n_iterations);
+
+    return status;
+}
+
+#endif
+
+/*
+	Fits on a fit context, the 13 input arguments of the fit are passed by
+	gpufit.m. A temporary context is created if context is 0.
+*/
+void fit(void * context, int nlhs, mxArray * plhs[], int nrhs, mxArray const * prhs[])
+{
+    check_arguments(nlhs, 4, nrhs, 13);
 
 	// input parameters
-	float * data = (float*)mxGetPr(prhs[0]);
-	float * weights = (float*)mxGetPr(prhs[1]);
     std::size_t n_fits = (std::size_t)*mxGetPr(prhs[2]);
     std::size_t n_points = (std::size_t)*mxGetPr(prhs[3]);
 
@@ -87,42 +189,82 @@ void mexFunction(
 	}
 
     int estimator_id = (int)*mxGetPr(prhs[6]);
-	float * initial_parameters = (float*)mxGetPr(prhs[7]);
 	int * parameters_to_fit = (int*)mxGetPr(prhs[8]);
     int model_id = (int)*mxGetPr(prhs[9]);
     int n_parameters = (int)*mxGetPr(prhs[10]);
-	int * user_info = (int*)mxGetPr(prhs[11]);
     std::size_t user_info_size = (std::size_t)*mxGetPr(prhs[12]);
 
-	// output parameters
-    float * output_parameters;
-	mxArray * mx_parameters;
-	mx_parameters = mxCreateNumericMatrix(1, n_fits*n_parameters, mxSINGLE_CLASS, mxREAL);
-	output_parameters = (float*)mxGetData(mx_parameters);
-	plhs[0] = mx_parameters;
-
-    int * output_states;
-	mxArray * mx_states;
-	mx_states = mxCreateNumericMatrix(1, n_fits, mxINT32_CLASS, mxREAL);
-	output_states = (int*)mxGetData(mx_states);
-	plhs[1] = mx_states;
-
-    float * output_chi_squares;
-	mxArray * mx_chi_squares;
-	mx_chi_squares = mxCreateNumericMatrix(1, n_fits, mxSINGLE_CLASS, mxREAL);
-	output_chi_squares = (float*)mxGetData(mx_chi_squares);
-	plhs[2] = mx_chi_squares;
-
-    int * output_n_iterations;
-    mxArray * mx_n_iterations;
-    mx_n_iterations = mxCreateNumericMatrix(1, n_fits, mxINT32_CLASS, mxREAL);
-    output_n_iterations = (int*)mxGetData(mx_n_iterations);
-    plhs[3] = mx_n_iterations;
-
-	// call to gpufit
-    int const status
-            = gpufit
+    // data in GPU memory requires all arrays but parameters_to_fit in GPU
+    // memory
+    bool const gpu_arrays = mxIsClass(prhs[0], "gpuArray");
+    if (gpu_arrays)
+    {
+#ifdef GPUFIT_MEX_GPU_ARRAY
+        if (!mxIsClass(prhs[7], "gpuArray")
+            || (!mxIsEmpty(prhs[1]) && !mxIsClass(prhs[1], "gpuArray"))
+            || (!mxIsEmpty(prhs[11]) && !mxIsClass(prhs[11], "gpuArray")))
+        {
+            mexErrMsgIdAndTxt("Gpufit:Mex", "data, weights, initial_parameters and user_info must all be gpuArrays");
+        }
+#else
+        mexErrMsgIdAndTxt("Gpufit:Mex", "gpuArray not available, build GpufitMex with the Matlab GPU library");
+#endif
+    }
+
+    // a temporary context for calls without a handle
+    bool const temporary_context = !context;
+    if (temporary_context)
+    {
+        check_status(gpufit_create_context(&context));
+    }
+
+    int status = STATUS_OK;
+
+    if (gpu_arrays)
+    {
+#ifdef GPUFIT_MEX_GPU_ARRAY
+        status = fit_gpu_arrays(
+            context, plhs, prhs, n_fits, n_points, tolerance, max_n_iterations, estimator_id, parameters_to_fit,
+            model_id, user_info_size);
+#endif
+    }
+    else
+    {
+        float * data = (float*)mxGetPr(prhs[0]);
+        float * weights = (float*)mxGetPr(prhs[1]);
+        float * initial_parameters = (float*)mxGetPr(prhs[7]);
+        int * user_info = (int*)mxGetPr(prhs[11]);
+
+        // output parameters
+        float * output_parameters;
+        mxArray * mx_parameters;
+        mx_parameters = mxCreateNumericMatrix(1, n_fits*n_parameters, mxSINGLE_CLASS, mxREAL);
+        output_parameters = (float*)mxGetData(mx_parameters);
+        plhs[0] = mx_parameters;
+
+        int * output_states;
+        mxArray * mx_states;
+        mx_states = mxCreateNumericMatrix(1, n_fits, mxINT32_CLASS, mxREAL);
+        output_states = (int*)mxGetData(mx_states);
+        plhs[1] = mx_states;
+
+        float * output_chi_squares;
+        mxArray * mx_chi_squares;
+        mx_chi_squares = mxCreateNumericMatrix(1, n_fits, mxSINGLE_CLASS, mxREAL);
+        output_chi_squares = (float*)mxGetData(mx_chi_squares);
+        plhs[2] = mx_chi_squares;
+
+        int * output_n_iterations;
+        mxArray * mx_n_iterations;
+        mx_n_iterations = mxCreateNumericMatrix(1, n_fits, mxINT32_CLASS, mxREAL);
+        output_n_iterations = (int*)mxGetData(mx_n_iterations);
+        plhs[3] = mx_n_iterations;
+
+        // call to gpufit
+        status
+            = gpufit_context_fit
             (
+                context,
                 n_fits,
                 n_points,
                 data,
@@ -140,11 +282,83 @@ void mexFunction(
                 output_chi_squares,
                 output_n_iterations
             ) ;
+    }
+
+    if (temporary_context)
+    {
+        gpufit_destroy_context(context);
+    }
 
 	// check status
-    if (status != STATUS_OK)
+    check_status(status);
+}
+
+/*
+	GpufitMex(13 fit arguments) fits on a temporary fit context.
+
+	A fit context which keeps its GPU memory between the calls, see
+	GpufitContext.m, is used by the commands
+	    handle = GpufitMex('create')
+	    GpufitMex('set_option', handle, option_id, value)
+	    [parameters, states, chi_squares, n_iterations] = GpufitMex('fit', handle, 13 fit arguments)
+	    GpufitMex('destroy', handle)
+*/
+void mexFunction(
+    int          nlhs,
+    mxArray      *plhs[],
+    int          nrhs,
+    mxArray const *prhs[])
+{
+    mexAtExit(destroy_contexts);
+
+    if (nrhs == 0 || !mxIsChar(prhs[0]))
     {
-        std::string const error = gpufit_get_last_error() ;
-        mexErrMsgIdAndTxt( "Gpufit:Mex", error.c_str() ) ;
+        fit(0, nlhs, plhs, nrhs, prhs);
+        return;
+    }
+
+    char * const command_string = mxArrayToString(prhs[0]);
+    std::string const command = command_string;
+    mxFree(command_string);
+
+    if (command == "create")
+    {
+        check_arguments(nlhs, 1, nrhs, 1);
+
+        void * context = 0;
+        check_status(gpufit_create_context(&context));
+        contexts.insert(context);
+
+        plhs[0] = mxCreateNumericMatrix(1, 1, mxUINT64_CLASS, mxREAL);
+        *static_cast< std::uint64_t * >(mxGetData(plhs[0])) = reinterpret_cast< std::uint64_t >(context);
+    }
+    else if (command == "destroy")
+    {
+        check_arguments(nlhs, 0, nrhs, 2);
+
+        void * const context = get_context(prhs[1]);
+        contexts.erase(context);
+        check_status(gpufit_destroy_context(context));
+    }
+    else if (command == "set_option")
+    {
+        check_arguments(nlhs, 0, nrhs, 4);
+
+        void * const context = get_context(prhs[1]);
+        int const option_id = (int)mxGetScalar(prhs[2]);
+        double const value = mxGetScalar(prhs[3]);
+        check_status(gpufit_context_set_option(context, option_id, value));
+    }
+    else if (command == "fit")
+    {
+        if (nrhs < 2)
+        {
+            mexErrMsgIdAndTxt("Gpufit:Mex", "handle required.");
+        }
+        fit(get_context(prhs[1]), nlhs, plhs, nrhs - 2, prhs + 2);
+    }
+    else
+    {
+        mexErrMsgIdAndTxt("Gpufit:Mex", "unknown command");
     }
 }
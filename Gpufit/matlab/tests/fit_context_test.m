@@ -0,0 +1,47 @@
+% Equivalent/similar to tests/Fit_Context.cpp
+
+% constants
+n_fits = 10;
+n_points = 5;
+n_parameters = 4;
+true_parameters = single([4; 2; 0.5; 1]);
+
+% data
+x = single((1:n_points)' - 1);
+y = gaussian_1d(true_parameters, x);
+data = repmat(y, 1, n_fits);
+
+% model
+model_id = ModelID.GAUSS_1D;
+
+% initial_parameters
+initial_parameters = repmat(single([2; 1.5; 0.3; 0]), 1, n_fits);
+
+% repeated calls on the same fit context
+context = GpufitContext();
+for i = 1:3
+    [parameters, states, chi_squares, n_iterations] = context.fit(data, [], model_id, initial_parameters);
+
+    %% Test results
+    assert(all(states == 0));
+    assert(all(chi_squares < 1e-6));
+    assert(all(all(abs(parameters - true_parameters) < 1e-6)));
+end
+
+% data in GPU memory
+if gpuDeviceCount > 0
+    [parameters, states, chi_squares] = context.fit(gpuArray(data), [], model_id, gpuArray(initial_parameters));
+
+    assert(isa(parameters, 'gpuArray'));
+    assert(all(gather(states) == 0));
+    assert(all(gather(chi_squares) < 1e-6));
+    assert(all(all(abs(gather(parameters) - true_parameters) < 1e-6)));
+end
+
+delete(context);
+
+function y = gaussian_1d(p, x)
+
+y = p(1) * exp(-(x - p(2)).^2 ./ (2 * p(3).^2)) + p(4);
+
+end
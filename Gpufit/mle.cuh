@@ -1,20 +1,23 @@
 #ifndef GPUFIT_MLE_CUH_INCLUDED
 #define GPUFIT_MLE_CUH_INCLUDED
 
+#include "input_data.cuh"
 #include <math.h>
 
 /* Description of the calculate_chi_square_mle function
 * =====================================================
 *
-* This function calculates the chi-square values for the MLE estimator.
+* This function calculates the chi-square summand of a data point for the MLE
+* estimator and adds it to chi_square.
 *
 * Parameters:
 *
-* chi_square: An output vector of chi-square values for each data point.
+* chi_square: An input and output value, to which the chi-square summand of the
+*             data point is added.
 *
 * point_index: The data point index.
 *
-* data: An input vector of data.
+* data: An input vector of data, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -39,9 +42,9 @@
 */
 
 __device__ void calculate_chi_square_mle(
-    volatile float * chi_square,
+    float * chi_square,
     int const point_index,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * weight,
     int * state,
@@ -57,12 +60,11 @@ __device__ void calculate_chi_square_mle(
 
     if (data[point_index] != 0)
     {
-        chi_square[point_index]
-            = 2 * (deviation - data[point_index] * logf(value[point_index] / data[point_index]));
+        *chi_square += 2 * (deviation - data[point_index] * logf(value[point_index] / data[point_index]));
     }
     else
     {
-        chi_square[point_index] = 2 * deviation;
+        *chi_square += 2 * deviation;
     }
 }
 
@@ -82,7 +84,7 @@ __device__ void calculate_chi_square_mle(
 *
 * parameter_index_j: Index of the hessian row.
 *
-* data: An input vector of data values.
+* data: An input vector of data values, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -110,7 +112,7 @@ __device__ void calculate_hessian_mle(
     int const point_index,
     int const parameter_index_i,
     int const parameter_index_j,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * derivatives,
     float const * weight,
@@ -131,13 +133,14 @@ __device__ void calculate_hessian_mle(
 *
 * Parameters:
 *
-* gradient: An output vector of values of the gradient vector for each data point.
+* gradient: An input and output value, to which the gradient summand of the data
+*           point is added.
 *
 * point_index: The data point index.
 *
 * parameter_index: The parameter index.
 *
-* data: An input vector of data values.
+* data: An input vector of data values, see InputData.
 *
 * value: An input vector of fitting curve values.
 *
@@ -161,18 +164,18 @@ __device__ void calculate_hessian_mle(
 */
 
 __device__ void calculate_gradient_mle(
-    volatile float * gradient,
+    float * gradient,
     int const point_index,
     int const parameter_index,
-    float const * data,
+    InputData const data,
     float const * value,
     float const * derivative,
     float const * weight,
     char * user_info,
     std::size_t const user_info_size)
 {
-    gradient[point_index]
-        = -derivative[parameter_index]
+    *gradient
+        += -derivative[parameter_index]
         * (1 - data[point_index] / value[point_index]);
 }
 
@@ -0,0 +1,140 @@
+#ifndef GPUFIT_MLE_SCMOS_CUH_INCLUDED
+#define GPUFIT_MLE_SCMOS_CUH_INCLUDED
+
+#include "input_data.cuh"
+#include <math.h>
+
+/* Description of the MLE_SCMOS estimator
+* =======================================
+*
+* The maximum likelihood estimator for data of sCMOS cameras, whose pixels add
+* Gaussian readout noise of a pixel dependent variance to the Poisson
+* distributed photon counts. The sum of both is approximated by a Poisson
+* distribution of the data value plus the variance, with the expected value
+* of the model value plus the variance. The readout noise variances of the
+* data points, in units of squared photons, are passed in the weights array.
+* Without weights the estimator equals MLE.
+*
+* The shifted data values are clamped at 0. The state is set to 3, if the
+* model value plus the variance is negative.
+*
+*/
+
+// the data value and the model value of a data point shifted by its readout
+// noise variance
+__device__ __forceinline__ void get_scmos_values(
+    float & shifted_data,
+    float & shifted_value,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight)
+{
+    float const variance = weight ? weight[point_index] : 0.f;
+
+    shifted_data = fmaxf(data[point_index] + variance, 0.f);
+    shifted_value = value[point_index] + variance;
+}
+
+/* Description of the calculate_chi_square_mle_scmos function
+* ===========================================================
+*
+* This function calculates the chi-square summand of a data point for the
+* MLE_SCMOS estimator and adds it to chi_square. The parameters are the same
+* as for calculate_chi_square_mle, the weights hold the readout noise
+* variances of the data points.
+*
+*/
+
+__device__ void calculate_chi_square_mle_scmos(
+    float * chi_square,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight,
+    int * state,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float shifted_data = 0.f;
+    float shifted_value = 0.f;
+    get_scmos_values(shifted_data, shifted_value, point_index, data, value, weight);
+
+    if (shifted_value < 0)
+    {
+        *state = 3;
+    }
+
+    float const deviation = shifted_value - shifted_data;
+
+    if (shifted_data != 0)
+    {
+        *chi_square += 2 * (deviation - shifted_data * logf(shifted_value / shifted_data));
+    }
+    else
+    {
+        *chi_square += 2 * deviation;
+    }
+}
+
+/* Description of the calculate_hessian_mle_scmos function
+* ========================================================
+*
+* This function calculates the hessian summand of a data point for the
+* MLE_SCMOS estimator and adds it to hessian. The parameters are the same as
+* for calculate_hessian_mle.
+*
+*/
+
+__device__ void calculate_hessian_mle_scmos(
+    double * hessian,
+    int const point_index,
+    int const parameter_index_i,
+    int const parameter_index_j,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float shifted_data = 0.f;
+    float shifted_value = 0.f;
+    get_scmos_values(shifted_data, shifted_value, point_index, data, value, weight);
+
+    *hessian
+        += shifted_data
+        / (shifted_value * shifted_value)
+        * derivative[parameter_index_i] * derivative[parameter_index_j];
+}
+
+/* Description of the calculate_gradient_mle_scmos function
+* =========================================================
+*
+* This function calculates the gradient summand of a data point for the
+* MLE_SCMOS estimator and adds it to gradient. The parameters are the same as
+* for calculate_gradient_mle.
+*
+*/
+
+__device__ void calculate_gradient_mle_scmos(
+    float * gradient,
+    int const point_index,
+    int const parameter_index,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float shifted_data = 0.f;
+    float shifted_value = 0.f;
+    get_scmos_values(shifted_data, shifted_value, point_index, data, value, weight);
+
+    *gradient
+        += -derivative[parameter_index]
+        * (1 - shifted_data / shifted_value);
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef GPUFIT_MODEL_FUNCTIONS_H_INCLUDED
+#define GPUFIT_MODEL_FUNCTIONS_H_INCLUDED
+
+#include "dual.h"
+
+/* Description of the model functions
+* ===================================
+*
+* The values of the models whose derivatives are calculated by automatic
+* differentiation (see dual.h), written once as function templates of the
+* parameter type. Gpufit evaluates them in the model functions of its kernels
+* (see gauss_2d_rotated.cuh and cauchy_2d_elliptic.cuh), and Cpufit in
+* LMFitCPP::calc_curve_values, with Dual< N > parameters.
+*
+* Parameters:
+*
+* p: An input vector of model parameters, see the description of the model.
+*
+* x, y: The coordinates of the data point.
+*
+* Adding a model
+* ==============
+*
+* A new model defines a structure like these, and calls calculate_dual() with
+* the number of model parameters from its model function, instead of
+* calculating its derivatives analytically.
+*
+*/
+
+// GAUSS_2D_ROTATED
+struct Gauss2DRotated
+{
+    template< typename T >
+    GPUFIT_HOST_DEVICE T operator()(T const * p, float const x, float const y) const
+    {
+        T const cos_angle = cos(p[6]);
+        T const sin_angle = sin(p[6]);
+
+        T const arga = (x - p[1]) * cos_angle - (y - p[2]) * sin_angle;
+        T const argb = (x - p[1]) * sin_angle + (y - p[2]) * cos_angle;
+
+        T const ratio_a = arga / p[3];
+        T const ratio_b = argb / p[4];
+
+        return p[0] * exp(-0.5f * (ratio_a * ratio_a + ratio_b * ratio_b)) + p[5];
+    }
+};
+
+// CAUCHY_2D_ELLIPTIC
+struct Cauchy2DElliptic
+{
+    template< typename T >
+    GPUFIT_HOST_DEVICE T operator()(T const * p, float const x, float const y) const
+    {
+        T const ratio_x = (p[1] - x) / p[3];
+        T const ratio_y = (p[2] - y) / p[4];
+
+        T const argx = ratio_x * ratio_x + 1.f;
+        T const argy = ratio_y * ratio_y + 1.f;
+
+        return p[0] / (argx * argy) + p[5];
+    }
+};
+
+#endif
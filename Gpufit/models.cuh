@@ -0,0 +1,175 @@
+#ifndef GPUFIT_MODELS_CUH_INCLUDED
+#define GPUFIT_MODELS_CUH_INCLUDED
+
+#include "gpufit.h"
+#include "definitions.h"
+#include "linear_1d.cuh"
+#include "gauss_1d.cuh"
+#include "gauss_2d.cuh"
+#include "gauss_2d_elliptic.cuh"
+#include "gauss_2d_rotated.cuh"
+#include "cauchy_2d_elliptic.cuh"
+
+/* Compile time properties of the models
+* =======================================
+*
+* The kernels are specialized for each model and estimator (see
+* select_kernels in cuda_kernels.cu). The number of model parameters is known at
+* compile time for the specialized kernels, which allows the loops over the
+* parameters to be unrolled. The kernels instantiated for GENERIC_MODEL use the
+* model ID and the number of parameters passed at run time, hence models
+* without specialization are supported as well.
+*
+*/
+
+template< int MODEL_ID > struct ModelProperties { static int const n_parameters = 0; };
+template<> struct ModelProperties< GAUSS_1D > { static int const n_parameters = 4; };
+template<> struct ModelProperties< GAUSS_2D > { static int const n_parameters = 5; };
+template<> struct ModelProperties< GAUSS_2D_ELLIPTIC > { static int const n_parameters = 6; };
+template<> struct ModelProperties< GAUSS_2D_ROTATED > { static int const n_parameters = 7; };
+template<> struct ModelProperties< CAUCHY_2D_ELLIPTIC > { static int const n_parameters = 6; };
+template<> struct ModelProperties< LINEAR_1D > { static int const n_parameters = 2; };
+
+// the size of an array holding the derivatives of a data point
+template< int MODEL_ID > struct PointDerivatives
+{
+    static int const size
+        = ModelProperties< MODEL_ID >::n_parameters > 0
+        ? ModelProperties< MODEL_ID >::n_parameters
+        : MAX_MODEL_PARAMETERS;
+};
+
+// the model ID, which is a compile time constant for specialized kernels
+template< int MODEL_ID >
+__device__ __forceinline__ int select_model_id(int const model_id)
+{
+    return MODEL_ID == GENERIC_MODEL ? model_id : MODEL_ID;
+}
+
+// the number of model parameters, or an upper bound of the number of fitted
+// parameters, which are compile time constants for specialized kernels
+template< int MODEL_ID >
+__device__ __forceinline__ int select_n_parameters(int const n_parameters)
+{
+    return ModelProperties< MODEL_ID >::n_parameters > 0 ? ModelProperties< MODEL_ID >::n_parameters : n_parameters;
+}
+
+/* Description of the calculate_model function
+* ============================================
+*
+* This function calls one of the fitting curve functions depending on the input
+* parameter model_id. It calculates the value and the partial derivatives of
+* the fitting curve for a single data point of a single fit.
+*
+* Parameters:
+*
+* model_id: The fitting model ID.
+*
+* parameters: An input vector of model parameters of the current fit.
+*
+* n_fits: The number of fits.
+*
+* n_points: The number of data points per fit.
+*
+* value: An output vector of model function values of the current fit.
+*
+* derivative: An output vector of the model function partial derivatives of
+*             the data point, derivative[k] holds the derivative with respect
+*             to parameter k.
+*
+* point_index: The data point index.
+*
+* fit_index: The index of the fit within the complete set of fits of a fit call.
+*
+* chunk_index: The chunk index.
+*
+* user_info: An input vector containing user information.
+*
+* user_info_size: The number of elements in user_info.
+*
+* coordinates: The coordinate grid of the data points, see coordinates.h.
+*
+* Calling the calculate_model function
+* ====================================
+*
+* This __device__ function can be only called from a __global__ function or an
+* other __device__ function. The derivatives of the data point are kept in an
+* array of PointDerivatives< MODEL_ID >::size elements, and the rows of the
+* fitted parameters are stored by store_fitted_derivatives.
+*
+*/
+
+__device__ void calculate_model(
+    int const model_id,
+    float const * parameters,
+    int const n_fits,
+    int const n_points,
+    float * value,
+    float * derivative,
+    int const point_index,
+    int const fit_index,
+    int const chunk_index,
+    char * user_info,
+    std::size_t const user_info_size,
+    Coordinates const & coordinates)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        calculate_gauss1d(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    case GAUSS_2D:
+        calculate_gauss2d(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    case GAUSS_2D_ELLIPTIC:
+        calculate_gauss2delliptic(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    case GAUSS_2D_ROTATED:
+        calculate_gauss2drotated(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    case CAUCHY_2D_ELLIPTIC:
+        calculate_cauchy2delliptic(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    case LINEAR_1D:
+        calculate_linear1d(parameters, n_fits, n_points, value, derivative, point_index, fit_index, chunk_index, user_info, user_info_size, coordinates);
+        break;
+    default:
+        break;
+    }
+}
+
+/* Description of the store_fitted_derivatives function
+* =====================================================
+*
+* This function stores the derivatives of a data point with respect to the
+* fitted parameters, the derivatives of fixed parameters are discarded. The
+* derivative with respect to the i-th fitted parameter is stored in
+* derivatives[i * stride].
+*
+* The loop over the model parameters is unrolled for specialized kernels, in
+* which n_parameters is a compile time constant, hence point_derivatives is
+* kept in registers. parameters_to_fit_indices is sorted in ascending order.
+*
+*/
+
+__device__ __forceinline__ void store_fitted_derivatives(
+    float const * point_derivatives,
+    int const n_parameters,
+    int const n_parameters_to_fit,
+    int const * parameters_to_fit_indices,
+    float * derivatives,
+    int const stride)
+{
+    int fitted_index = 0;
+
+    for (int parameter_index = 0; parameter_index < n_parameters; parameter_index++)
+    {
+        if (fitted_index < n_parameters_to_fit && parameters_to_fit_indices[fitted_index] == parameter_index)
+        {
+            derivatives[fitted_index * stride] = point_derivatives[parameter_index];
+            fitted_index++;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,86 @@
+#include "gpufit.h"
+#include "parameter_constraints.h"
+
+ParameterConstraints::ParameterConstraints() :
+    n_sets_(0),
+    n_parameters_(0)
+{
+}
+
+void ParameterConstraints::set(
+    std::size_t const n_sets,
+    std::size_t const n_parameters,
+    float const * const constraints,
+    int const * const types)
+{
+    if (types && (n_sets == 0 || n_parameters == 0 || !constraints))
+    {
+        throw std::runtime_error("invalid constraints");
+    }
+
+    std::size_t const n_constrained_sets = types ? n_sets : 0;
+    std::size_t const n_constrained_parameters = types ? n_parameters : 0;
+
+    for (std::size_t i = 0; i < n_constrained_parameters; i++)
+    {
+        if (types[i] != CONSTRAINT_NONE
+            && types[i] != CONSTRAINT_LOWER
+            && types[i] != CONSTRAINT_UPPER
+            && types[i] != CONSTRAINT_LOWER_UPPER)
+        {
+            throw std::runtime_error("invalid constraint type");
+        }
+
+        for (std::size_t set_index = 0; set_index < n_constrained_sets; set_index++)
+        {
+            float const * const bounds = constraints + 2 * (set_index * n_constrained_parameters + i);
+
+            if (types[i] == CONSTRAINT_LOWER_UPPER && !(bounds[0] <= bounds[1]))
+            {
+                throw std::runtime_error("lower bound larger than upper bound");
+            }
+        }
+    }
+
+    n_sets_ = n_constrained_sets;
+    n_parameters_ = n_constrained_parameters;
+    bounds_.assign(constraints, types ? constraints + 2 * n_sets_ * n_parameters_ : constraints);
+    types_.assign(types, types ? types + n_parameters_ : types);
+}
+
+// takes over the constraints of another fit context
+void ParameterConstraints::configure(ParameterConstraints const & constraints)
+{
+    n_sets_ = constraints.n_sets_;
+    n_parameters_ = constraints.n_parameters_;
+    bounds_.configure(constraints.bounds_);
+    types_.configure(constraints.types_);
+}
+
+void ParameterConstraints::check(std::size_t const n_fits, int const n_parameters) const
+{
+    bool const valid
+        = types_.empty()
+        || (n_parameters_ == std::size_t(n_parameters) && (n_sets_ == 1 || n_sets_ == n_fits));
+
+    if (!valid)
+    {
+        throw std::runtime_error("constraints do not match the fits");
+    }
+}
+
+void ParameterConstraints::release()
+{
+    bounds_.release();
+    types_.release();
+}
+
+Constraints ParameterConstraints::get_constraints()
+{
+    Constraints constraints;
+    constraints.bounds = bounds_.get_device_data();
+    constraints.types = types_.get_device_data();
+    constraints.n_sets = int(n_sets_);
+
+    return constraints;
+}
@@ -0,0 +1,42 @@
+#ifndef GPUFIT_PARAMETER_CONSTRAINTS_H_INCLUDED
+#define GPUFIT_PARAMETER_CONSTRAINTS_H_INCLUDED
+
+#include "constraints.h"
+#include "device_mirror.h"
+
+/* Description of the ParameterConstraints class
+* ==============================================
+*
+* The box constraints of the model parameters of a fit context
+* (gpufit_context_set_constraints()). The bounds and the constraint types are
+* mirrored to the device (see DeviceMirror). In multi-device mode each device
+* context holds a copy of the constraints of the fit context.
+*
+*/
+
+class ParameterConstraints
+{
+public:
+    ParameterConstraints();
+
+    void set(
+        std::size_t const n_sets,
+        std::size_t const n_parameters,
+        float const * constraints,
+        int const * types);
+    void configure(ParameterConstraints const & constraints);
+    void check(std::size_t const n_fits, int const n_parameters) const;
+    Constraints get_constraints();
+    void release();
+
+    bool is_allocated() const { return bounds_.is_allocated() || types_.is_allocated(); }
+    bool is_set() const { return !types_.empty(); }
+
+private:
+    std::size_t n_sets_;
+    std::size_t n_parameters_;
+    DeviceMirror< float > bounds_;
+    DeviceMirror< int > types_;
+};
+
+#endif
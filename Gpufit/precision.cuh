@@ -0,0 +1,198 @@
+#ifndef GPUFIT_PRECISION_CUH_INCLUDED
+#define GPUFIT_PRECISION_CUH_INCLUDED
+
+#include "gpufit.h"
+#include <cuda_runtime.h>
+#include <cstddef>
+
+/* Description of the precision policies
+* ======================================
+*
+* The chi-square values, gradients and hessian matrices are sums over the data
+* points of a fit. The summands are calculated in float. Each thread sums up the
+* summands of its data points, and the partial sums of the threads are summed
+* up by sum_up. A precision policy defines the types in which the sums are
+* calculated, selected by OPTION_PRECISION:
+*
+* PrecisionFloat: All sums in float, the fastest mode.
+*
+* PrecisionMixed: Chi-squares and gradients in float, hessians in double. This
+*                 is the default mode.
+*
+* PrecisionCompensated: All sums in float, the rounding errors of the additions
+*                       are accumulated separately (CompensatedSum).
+*
+* PrecisionDouble: All sums in double, the most accurate mode, but slow on
+*                  GPUs with a low double precision throughput.
+*
+* The results are stored in float, independent of the precision policy.
+*
+*/
+
+/* Description of the CompensatedSum struct
+* =========================================
+*
+* A float sum with a separate float value of the accumulated rounding errors
+* of the additions. The rounding error of each addition is calculated exactly
+* by the TwoSum algorithm, which gives almost the accuracy of a double sum
+* using float arithmetic only.
+*
+*/
+
+struct CompensatedSum
+{
+    __device__ CompensatedSum() : sum(0.f), error(0.f) {}
+    __device__ CompensatedSum(float const value) : sum(value), error(0.f) {}
+    __device__ CompensatedSum(double const value) :
+        sum(float(value)),
+        error(float(value - double(float(value))))
+    {}
+
+    __device__ operator float() const { return sum + error; }
+
+    float sum;
+    float error;
+};
+
+__device__ __forceinline__ CompensatedSum operator+(CompensatedSum const & a, CompensatedSum const & b)
+{
+    // TwoSum, the rounding error of sum is exactly error
+    float const sum = __fadd_rn(a.sum, b.sum);
+    float const b_virtual = __fsub_rn(sum, a.sum);
+    float const a_virtual = __fsub_rn(sum, b_virtual);
+    float const error = __fadd_rn(__fsub_rn(a.sum, a_virtual), __fsub_rn(b.sum, b_virtual));
+
+    // the errors of both operands and of the addition are carried along
+    CompensatedSum result;
+    result.sum = sum;
+    result.error = a.error + b.error + error;
+    return result;
+}
+
+struct PrecisionFloat
+{
+    typedef float ChiSquareSum;
+    typedef float GradientSum;
+    typedef float HessianSum;
+};
+
+struct PrecisionMixed
+{
+    typedef float ChiSquareSum;
+    typedef float GradientSum;
+    typedef double HessianSum;
+};
+
+struct PrecisionCompensated
+{
+    typedef CompensatedSum ChiSquareSum;
+    typedef CompensatedSum GradientSum;
+    typedef CompensatedSum HessianSum;
+};
+
+struct PrecisionDouble
+{
+    typedef double ChiSquareSum;
+    typedef double GradientSum;
+    typedef double HessianSum;
+};
+
+// the largest size of the sums of a precision policy
+template< typename PRECISION >
+struct SumsSize
+{
+    static std::size_t const chi_square = sizeof(typename PRECISION::ChiSquareSum);
+    static std::size_t const gradient = sizeof(typename PRECISION::GradientSum);
+    static std::size_t const hessian = sizeof(typename PRECISION::HessianSum);
+    static std::size_t const chi_square_gradient = chi_square > gradient ? chi_square : gradient;
+    static std::size_t const maximum = chi_square_gradient > hessian ? chi_square_gradient : hessian;
+};
+
+// warp shuffles of the sums, see sum_up
+__device__ __forceinline__ float shuffle_down(unsigned const mask, float const value, int const delta, int const width)
+{
+    return __shfl_down_sync(mask, value, delta, width);
+}
+
+__device__ __forceinline__ double shuffle_down(unsigned const mask, double const value, int const delta, int const width)
+{
+    return __shfl_down_sync(mask, value, delta, width);
+}
+
+__device__ __forceinline__ CompensatedSum shuffle_down(
+    unsigned const mask, CompensatedSum const & value, int const delta, int const width)
+{
+    CompensatedSum result;
+    result.sum = __shfl_down_sync(mask, value.sum, delta, width);
+    result.error = __shfl_down_sync(mask, value.error, delta, width);
+    return result;
+}
+
+/* Description of the sum_up function
+* ===================================
+*
+* This function sums up the partial sums of the threads of a fit and returns the
+* sum to all threads of the fit. The threads of a fit are consecutive, and their
+* number is a power of two. Fits of up to warpSize threads lie within a single
+* warp and are summed up by warp shuffles in registers. Larger fits are summed
+* up by a tree reduction in shared memory.
+*
+* Parameters:
+*
+* value: The partial sum of the calling thread.
+*
+* shared_sums: A vector in shared memory with one element for each thread of the
+*              fit. It is not used by fits of up to warpSize threads, and may be
+*              reused after the function returned.
+*
+* thread_index: The index of the calling thread within the threads of the fit.
+*
+* size: The number of threads of the fit.
+*
+* Calling the sum_up function
+* ===========================
+*
+* All threads of a thread block must call the function. Threads of the fit
+* without data points contribute a zero partial sum.
+*
+*/
+
+template< typename Sum >
+__device__ float sum_up(Sum value, Sum * shared_sums, int const thread_index, int const size)
+{
+    if (size <= warpSize)
+    {
+        // the lanes of the fit within its warp
+        int const first_lane = (threadIdx.x % warpSize) & ~(size - 1);
+        unsigned const mask
+            = size == warpSize
+            ? 0xffffffffu
+            : ((1u << size) - 1u) << first_lane;
+
+        for (int delta = size >> 1; delta > 0; delta >>= 1)
+        {
+            value = value + shuffle_down(mask, value, delta, size);
+        }
+        return __shfl_sync(mask, float(value), 0, size);
+    }
+
+    shared_sums[thread_index] = value;
+
+    int current_size = size >> 1;
+    __syncthreads();
+    while (current_size)
+    {
+        if (thread_index < current_size)
+        {
+            shared_sums[thread_index] = shared_sums[thread_index] + shared_sums[thread_index + current_size];
+        }
+        current_size >>= 1;
+        __syncthreads();
+    }
+
+    float const sum = float(shared_sums[0]);
+    __syncthreads();
+    return sum;
+}
+
+#endif
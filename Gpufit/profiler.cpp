@@ -0,0 +1,238 @@
+#include "profiler.h"
+
+#ifdef USE_NVTX
+#include <nvToolsExt.h>
+
+static char const * const phase_names[N_PROFILE_PHASES] =
+{
+    "transfers",
+    "model",
+    "chi-squares",
+    "gradients",
+    "hessians",
+    "solver",
+    "evaluation"
+};
+#endif
+
+Profiler::Profiler() :
+    enabled_(false),
+    profile_(),
+    callback_(0),
+    user_data_(0),
+    begin_time_(),
+    started_(N_PROFILE_PHASES),
+    stopped_(),
+    queued_(),
+    events_()
+{
+}
+
+Profiler::~Profiler()
+{
+    release_events();
+}
+
+// the events are created on the current device, which may change before the
+// next fit call
+void Profiler::release_events()
+{
+    for (std::size_t i = 0; i < started_.size(); i++)
+    {
+        started_[i].start.reset();
+    }
+    stopped_.clear();
+    queued_.clear();
+    events_.clear();
+}
+
+void Profiler::set_callback(gpufit_profile_callback const callback, void * const user_data)
+{
+    callback_ = callback;
+    user_data_ = user_data;
+}
+
+// takes over the settings of the profiler of another fit context
+void Profiler::configure(Profiler const & profiler)
+{
+    enabled_ = profiler.enabled_;
+    callback_ = profiler.callback_;
+    user_data_ = profiler.user_data_;
+}
+
+void Profiler::begin_fit()
+{
+    // the phases of a failed fit call are discarded
+    release_events();
+
+    profile_ = gpufit_profile();
+    begin_time_ = std::chrono::steady_clock::now();
+}
+
+void Profiler::end_fit()
+{
+    read_iterations();
+    read_intervals(0, stopped_.size(), profile_.phase_times);
+    release_events();
+
+    std::chrono::duration< double, std::milli > const total_time
+        = std::chrono::steady_clock::now() - begin_time_;
+    profile_.total_time = total_time.count();
+}
+
+std::unique_ptr< CudaEvent > Profiler::get_event()
+{
+    if (events_.empty())
+    {
+        return std::unique_ptr< CudaEvent >(new CudaEvent());
+    }
+
+    std::unique_ptr< CudaEvent > event = std::move(events_.back());
+    events_.pop_back();
+    return event;
+}
+
+void Profiler::start(int const phase_id, cudaStream_t const stream)
+{
+#ifdef USE_NVTX
+    nvtxRangePushA(phase_names[phase_id]);
+#endif
+
+    if (!enabled_)
+        return;
+
+    Interval & interval = started_[phase_id];
+    interval.phase_id = phase_id;
+    interval.start = get_event();
+    CUDA_CHECK_STATUS(cudaEventRecord(*interval.start, stream));
+}
+
+void Profiler::stop(int const phase_id, cudaStream_t const stream)
+{
+#ifdef USE_NVTX
+    nvtxRangePop();
+#endif
+
+    if (!enabled_)
+        return;
+
+    Interval & started = started_[phase_id];
+    std::unique_ptr< CudaEvent > stop = get_event();
+    CUDA_CHECK_STATUS(cudaEventRecord(*stop, stream));
+
+    Interval interval;
+    interval.phase_id = phase_id;
+    interval.start = std::move(started.start);
+    interval.stop = std::move(stop);
+    stopped_.push_back(std::move(interval));
+}
+
+void Profiler::add_transfer(std::size_t const bytes_to_gpu, std::size_t const bytes_from_gpu)
+{
+    if (!enabled_)
+        return;
+
+    profile_.bytes_to_gpu += bytes_to_gpu;
+    profile_.bytes_from_gpu += bytes_from_gpu;
+}
+
+void Profiler::add_gpu_memory(std::size_t const gpu_memory)
+{
+    if (!enabled_)
+        return;
+
+    profile_.gpu_memory += gpu_memory;
+}
+
+// waits for the stopped phases from begin to end and adds their times to
+// phase_times and to the profile of the fit call
+void Profiler::read_intervals(std::size_t const begin, std::size_t const end, double * const phase_times)
+{
+    for (std::size_t i = begin; i < end; i++)
+    {
+        Interval const & interval = stopped_[i];
+
+        float time = 0.f;
+        CUDA_CHECK_STATUS(cudaEventSynchronize(*interval.stop));
+        CUDA_CHECK_STATUS(cudaEventElapsedTime(&time, *interval.start, *interval.stop));
+
+        phase_times[interval.phase_id] += time;
+        if (phase_times != profile_.phase_times)
+            profile_.phase_times[interval.phase_id] += time;
+    }
+}
+
+// the events of the first n_intervals stopped phases are reused
+void Profiler::recycle_intervals(std::size_t const n_intervals)
+{
+    for (std::size_t i = 0; i < n_intervals; i++)
+    {
+        events_.push_back(std::move(stopped_[i].start));
+        events_.push_back(std::move(stopped_[i].stop));
+    }
+    stopped_.erase(stopped_.begin(), stopped_.begin() + n_intervals);
+}
+
+// the iteration is read later by read_iterations, the host does not wait for
+// the device
+void Profiler::finish_iteration(int const chunk_index, int const iteration, int const n_active_fits)
+{
+    if (!enabled_)
+        return;
+
+    QueuedIteration queued;
+    queued.profile = gpufit_iteration_profile();
+    queued.profile.chunk_index = chunk_index;
+    queued.profile.iteration = iteration;
+    queued.profile.n_active_fits = n_active_fits;
+    queued.n_stopped = stopped_.size();
+    queued_.push_back(queued);
+
+    profile_.n_iterations++;
+}
+
+// reads the times of the queued iterations, each includes the phases stopped
+// after the end of the previous one, and passes them to the callback in order
+void Profiler::read_iterations()
+{
+    if (queued_.empty())
+        return;
+
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < queued_.size(); i++)
+    {
+        gpufit_iteration_profile & iteration_profile = queued_[i].profile;
+
+        read_intervals(begin, queued_[i].n_stopped, iteration_profile.phase_times);
+        begin = queued_[i].n_stopped;
+
+        if (callback_)
+            callback_(&iteration_profile, user_data_);
+    }
+
+    recycle_intervals(begin);
+    queued_.clear();
+}
+
+void Profiler::finish_chunk()
+{
+    if (!enabled_)
+        return;
+
+    profile_.n_chunks++;
+}
+
+// adds the profile of a fit call on another device, except for its total
+// time, the fit calls on all devices run concurrently
+void Profiler::add(gpufit_profile const & profile)
+{
+    for (int i = 0; i < N_PROFILE_PHASES; i++)
+    {
+        profile_.phase_times[i] += profile.phase_times[i];
+    }
+    profile_.bytes_to_gpu += profile.bytes_to_gpu;
+    profile_.bytes_from_gpu += profile.bytes_from_gpu;
+    profile_.n_chunks += profile.n_chunks;
+    profile_.n_iterations += profile.n_iterations;
+    profile_.gpu_memory += profile.gpu_memory;
+}
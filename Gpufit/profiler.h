@@ -0,0 +1,116 @@
+#ifndef GPUFIT_PROFILER_H_INCLUDED
+#define GPUFIT_PROFILER_H_INCLUDED
+
+#include "gpufit.h"
+#include "definitions.h"
+
+#include <cuda_runtime.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// a CUDA event, which is destroyed with the object, also if an exception is
+// thrown between the recording and the reading of the event
+class CudaEvent
+{
+public:
+    CudaEvent() : event_(0) { CUDA_CHECK_STATUS(cudaEventCreate(&event_)); }
+    ~CudaEvent() { cudaEventDestroy(event_); }
+
+    operator cudaEvent_t() const { return event_; }
+
+private:
+    CudaEvent(CudaEvent const &);
+    CudaEvent & operator=(CudaEvent const &);
+
+    cudaEvent_t event_;
+};
+
+/* Description of the Profiler class
+* ==================================
+*
+* The profile of the fit calls of a fit context (OPTION_PROFILING). The GPU
+* time of each phase of a fit is measured by a pair of CUDA events recorded in
+* the stream of the phase. The iterations are queued by finish_iteration()
+* without synchronization. Their elapsed times are read by read_iterations()
+* when the host waits for the device anyway, i.e. at the convergence checks
+* and at the end of the fit call, and summed up per iteration and per fit
+* call. Each iteration profile is then passed to the profile callback.
+*
+* If Gpufit is built with the CMake option USE_NVTX, each phase is also marked
+* by an NVTX range, independent of OPTION_PROFILING.
+*
+* Usage:
+*
+*   profiler.start(PROFILE_PHASE_SOLVER, stream);
+*   ...
+*   profiler.stop(PROFILE_PHASE_SOLVER, stream);
+*
+*/
+
+class Profiler
+{
+public:
+    Profiler();
+    ~Profiler();
+
+    void set_callback(gpufit_profile_callback const callback, void * const user_data);
+    void configure(Profiler const & profiler);
+
+    void begin_fit();
+    void end_fit();
+    void start(int const phase_id, cudaStream_t const stream);
+    void stop(int const phase_id, cudaStream_t const stream);
+    void add_transfer(std::size_t const bytes_to_gpu, std::size_t const bytes_from_gpu);
+    void add_gpu_memory(std::size_t const gpu_memory);
+    void finish_iteration(int const chunk_index, int const iteration, int const n_active_fits);
+    void read_iterations();
+    void finish_chunk();
+    void add(gpufit_profile const & profile);
+
+    gpufit_profile const & get_profile() const { return profile_; }
+
+public:
+    bool enabled_;
+
+private:
+    struct Interval
+    {
+        int phase_id;
+        std::unique_ptr< CudaEvent > start;
+        std::unique_ptr< CudaEvent > stop;
+    };
+
+    // an iteration whose times are not read yet, with the number of stopped
+    // phases up to its end
+    struct QueuedIteration
+    {
+        gpufit_iteration_profile profile;
+        std::size_t n_stopped;
+    };
+
+    std::unique_ptr< CudaEvent > get_event();
+    void release_events();
+    void read_intervals(std::size_t const begin, std::size_t const end, double * phase_times);
+    void recycle_intervals(std::size_t const n_intervals);
+
+    gpufit_profile profile_;
+    gpufit_profile_callback callback_;
+    void * user_data_;
+
+    std::chrono::steady_clock::time_point begin_time_;
+
+    // started phases, one for each phase ID
+    std::vector< Interval > started_;
+
+    // stopped phases, which are read by read_intervals
+    std::vector< Interval > stopped_;
+
+    // finished iterations, which are read by read_iterations
+    std::vector< QueuedIteration > queued_;
+
+    // events which are not recorded, for reuse
+    std::vector< std::unique_ptr< CudaEvent > > events_;
+};
+
+#endif
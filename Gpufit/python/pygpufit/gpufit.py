@@ -6,9 +6,11 @@
     See https://docs.python.org/3.5/library/ctypes.html, http://www.scipy-lectures.org/advanced/interfacing_with_c/interfacing_with_c.html
 """
 
+import atexit
 import os
+import threading
 import time
-from ctypes import cdll, POINTER, c_int, c_float, c_char, c_char_p, c_size_t
+from ctypes import cdll, POINTER, byref, cast, c_int, c_float, c_double, c_char, c_char_p, c_size_t, c_void_p
 import numpy as np
 
 # define library loader (actual loading is lazy)
@@ -31,6 +33,41 @@ cuda_available_func = lib.gpufit_cuda_available
 cuda_available_func.restype = c_int
 cuda_available_func.argtypes = None
 
+# gpufit_create_context function in the dll
+create_context_func = lib.gpufit_create_context
+create_context_func.restype = c_int
+create_context_func.argtypes = [POINTER(c_void_p)]
+
+# gpufit_destroy_context function in the dll
+destroy_context_func = lib.gpufit_destroy_context
+destroy_context_func.restype = c_int
+destroy_context_func.argtypes = [c_void_p]
+
+# gpufit_context_set_option function in the dll
+set_option_func = lib.gpufit_context_set_option
+set_option_func.restype = c_int
+set_option_func.argtypes = [c_void_p, c_int, c_double]
+
+# gpufit_context_fit function in the dll
+context_fit_func = lib.gpufit_context_fit
+context_fit_func.restype = c_int
+context_fit_func.argtypes = [c_void_p, c_size_t, c_size_t, POINTER(c_float), POINTER(c_float), c_int, POINTER(c_float), c_float, c_int, POINTER(c_int), c_int, c_size_t, POINTER(c_char), POINTER(c_float), POINTER(c_int), POINTER(c_float), POINTER(c_int)]
+
+# gpufit_context_cuda_interface function in the dll
+context_cuda_interface_func = lib.gpufit_context_cuda_interface
+context_cuda_interface_func.restype = c_int
+context_cuda_interface_func.argtypes = [c_void_p, c_size_t, c_size_t, POINTER(c_float), POINTER(c_float), c_int, c_float, c_int, POINTER(c_int), c_int, c_size_t, POINTER(c_char), POINTER(c_float), POINTER(c_int), POINTER(c_float), POINTER(c_int), c_void_p]
+
+# gpufit_register_host_buffer function in the dll
+register_host_buffer_func = lib.gpufit_register_host_buffer
+register_host_buffer_func.restype = c_int
+register_host_buffer_func.argtypes = [c_void_p, c_size_t]
+
+# gpufit_unregister_host_buffer function in the dll
+unregister_host_buffer_func = lib.gpufit_unregister_host_buffer
+unregister_host_buffer_func.restype = c_int
+unregister_host_buffer_func.argtypes = [c_void_p]
+
 
 class ModelID():
 
@@ -46,10 +83,31 @@ class EstimatorID():
 
     LSE = 0
     MLE = 1
+    MLE_SCMOS = 2
+    LSE_HUBER = 3
+    LSE_CAUCHY = 4
+
+
+class DataType():
+
+    FLOAT = 0
+    UINT16 = 1
+    HALF = 2
+    UINT8 = 3
+
+    # NumPy data types of the data array
+    types = ((np.float32, FLOAT), (np.uint16, UINT16), (np.float16, HALF), (np.uint8, UINT8))
+
+
+# fit context option ID of the data type, see gpufit.h
+OPTION_DATA_TYPE = 7
+
+# time.clock was removed in Python 3.8
+timer = getattr(time, 'perf_counter', None) or time.clock
 
 
 def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_iterations=None, \
-           parameters_to_fit=None, estimator_id=None, user_info=None):
+           parameters_to_fit=None, estimator_id=None, user_info=None, out=None):
     """
     Calls the C interface fit function in the library.
     (see also http://gpufit.readthedocs.io/en/latest/bindings.html#python)
@@ -57,8 +115,18 @@ def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_
     All 2D NumPy arrays must be in row-major order (standard in NumPy), i.e. array.flags.C_CONTIGUOUS must be True
     (see also https://docs.scipy.org/doc/numpy/reference/arrays.ndarray.html#internal-memory-layout-of-an-ndarray)
 
-    :param data: The data - 2D NumPy array of dimension [number_fits, number_points] and data type np.float32
-    :param weights: The weights - 2D NumPy array of the same dimension and data type as parameter data or None (no weights available)
+    Arrays in GPU memory, i.e. objects with the attribute __cuda_array_interface__ (e.g. CuPy, PyTorch or Numba arrays),
+    are fitted in place by the CUDA interface of the library without transfers, see fit_cuda.
+
+    The data is transferred to the GPU in its own type and converted to float by the kernels, hence camera frames of
+    type np.uint16 are fitted without a conversion in Python.
+
+    The fits of each data type run on a fit context which is created by the first fit and reused by the following
+    fits, hence its GPU buffers are allocated once and not for each call.
+
+    :param data: The data - 2D NumPy array of dimension [number_fits, number_points] and data type np.float32,
+        np.uint16, np.float16 or np.uint8
+    :param weights: The weights - 2D NumPy array of the same dimension as parameter data and data type np.float32 or None (no weights available)
     :param model_id: The model ID
     :param initial_parameters: Initial values for parameters - NumPy array of dimension [number_fits, number_parameters] and data type np.float32
     :param tolerance: The fit tolerance or None (will use default value)
@@ -66,9 +134,15 @@ def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_
     :param parameters_to_fit: Which parameters to fit - NumPy array of length number_parameters and type np.int32 or None (will fit all parameters)
     :param estimator_id: The Estimator ID or None (will use default values)
     :param user_info: User info - NumPy array of type np.char or None (no user info available)
+    :param out: Preallocated output arrays (parameters, states, chi_squares, number_iterations) or None (will allocate new arrays),
+        for arrays in GPU memory see fit_cuda
     :return: parameters, states, chi_squares, number_iterations, execution_time
     """
 
+    if hasattr(data, '__cuda_array_interface__'):
+        return fit_cuda(data, weights, model_id, initial_parameters, tolerance, max_number_iterations, \
+                        parameters_to_fit, estimator_id, user_info, out)
+
     # check all 2D NumPy arrays for row-major memory layout (otherwise interpretation of order of dimensions fails)
     if not data.flags.c_contiguous:
         raise RuntimeError('Memory layout of data array mismatch.')
@@ -101,27 +175,15 @@ def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_
     if parameters_to_fit is not None and parameters_to_fit.shape[0] != number_parameters:
         raise RuntimeError('dimension mismatch in number of parameters between initial_parameters and parameters_to_fit')
 
-    # default value: tolerance
-    if not tolerance:
-        tolerance = 1e-4
-
-    # default value: max_number_iterations
-    if not max_number_iterations:
-        max_number_iterations = 25
-
-    # default value: estimator ID
-    if not estimator_id:
-        estimator_id = EstimatorID.LSE
-
-    # default value: parameters_to_fit
-    if parameters_to_fit is None:
-        parameters_to_fit = np.ones(number_parameters, dtype=np.int32)
+    # default values
+    tolerance, max_number_iterations, estimator_id, parameters_to_fit = _default_values(
+        tolerance, max_number_iterations, estimator_id, parameters_to_fit, number_parameters)
 
     # now only weights and user_info could be not given
 
-    # type check: data, weights (if given), initial_parameters are all np.float32
-    if data.dtype != np.float32:
-        raise RuntimeError('type of data is not np.float32')
+    # type check: data is of a type selected by the data type option, weights (if given) and initial_parameters are
+    # np.float32, the data is converted to float on the GPU
+    data_type = _data_type(data.dtype)
     if weights is not None and weights.dtype != np.float32:
         raise RuntimeError('type of weights is not np.float32')
     if initial_parameters.dtype != np.float32:
@@ -137,43 +199,52 @@ def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_
     else:
         user_info_size = 0
 
-    # pre-allocate output variables
-    parameters = np.zeros((number_fits, number_parameters), dtype=np.float32)
-    states = np.zeros(number_fits, dtype=np.int32)
-    chi_squares = np.zeros(number_fits, dtype=np.float32)
-    number_iterations = np.zeros(number_fits, dtype=np.int32)
+    # pre-allocate output variables or check the preallocated output arrays
+    if out is None:
+        parameters = np.zeros((number_fits, number_parameters), dtype=np.float32)
+        states = np.zeros(number_fits, dtype=np.int32)
+        chi_squares = np.zeros(number_fits, dtype=np.float32)
+        number_iterations = np.zeros(number_fits, dtype=np.int32)
+    else:
+        parameters, states, chi_squares, number_iterations = out
+        _check_output(parameters, (number_fits, number_parameters), np.float32, 'parameters')
+        _check_output(states, (number_fits,), np.int32, 'states')
+        _check_output(chi_squares, (number_fits,), np.float32, 'chi_squares')
+        _check_output(number_iterations, (number_fits,), np.int32, 'number_iterations')
 
     # conversion to ctypes types for optional C interface parameters using NULL pointer (None) as default argument
     if weights is not None:
-        weights_p = weights.ctypes.data_as(gpufit_func.argtypes[3])
+        weights_p = weights.ctypes.data_as(context_fit_func.argtypes[4])
     else:
         weights_p = None
     if user_info is not None:
-        user_info_p = user_info.ctypes.data_as(gpufit_func.argtypes[11])
+        user_info_p = user_info.ctypes.data_as(context_fit_func.argtypes[12])
     else:
         user_info_p = None
 
-    # call into the library (measure time)
-    t0 = time.clock()
-    status = gpufit_func(
-        gpufit_func.argtypes[0](number_fits), \
-        gpufit_func.argtypes[1](number_points), \
-        data.ctypes.data_as(gpufit_func.argtypes[2]), \
-        weights_p, \
-        gpufit_func.argtypes[4](model_id), \
-        initial_parameters.ctypes.data_as(gpufit_func.argtypes[5]), \
-        gpufit_func.argtypes[6](tolerance), \
-        gpufit_func.argtypes[7](max_number_iterations), \
-        parameters_to_fit.ctypes.data_as(gpufit_func.argtypes[8]), \
-        gpufit_func.argtypes[9](estimator_id), \
-        gpufit_func.argtypes[10](user_info_size), \
-        user_info_p, \
-        parameters.ctypes.data_as(gpufit_func.argtypes[12]), \
-        states.ctypes.data_as(gpufit_func.argtypes[13]), \
-        chi_squares.ctypes.data_as(gpufit_func.argtypes[14]), \
-        number_iterations.ctypes.data_as(gpufit_func.argtypes[15]))
-    t1 = time.clock()
-
+    # call into the library (measure time), the device buffers of the cached fit context are reused
+    context, lock = _context(data_type)
+    with lock:
+        t0 = timer()
+        status = context_fit_func(
+            context, \
+            context_fit_func.argtypes[1](number_fits), \
+            context_fit_func.argtypes[2](number_points), \
+            data.ctypes.data_as(context_fit_func.argtypes[3]), \
+            weights_p, \
+            context_fit_func.argtypes[5](model_id), \
+            initial_parameters.ctypes.data_as(context_fit_func.argtypes[6]), \
+            context_fit_func.argtypes[7](tolerance), \
+            context_fit_func.argtypes[8](max_number_iterations), \
+            parameters_to_fit.ctypes.data_as(context_fit_func.argtypes[9]), \
+            context_fit_func.argtypes[10](estimator_id), \
+            context_fit_func.argtypes[11](user_info_size), \
+            user_info_p, \
+            parameters.ctypes.data_as(context_fit_func.argtypes[13]), \
+            states.ctypes.data_as(context_fit_func.argtypes[14]), \
+            chi_squares.ctypes.data_as(context_fit_func.argtypes[15]), \
+            number_iterations.ctypes.data_as(context_fit_func.argtypes[16]))
+        t1 = timer()
 
     # check status
     if status != 0:
@@ -185,6 +256,244 @@ def fit(data, weights, model_id, initial_parameters, tolerance=None, max_number_
     return parameters, states, chi_squares, number_iterations, t1 - t0
 
 
+def fit_cuda(data, weights, model_id, initial_parameters, tolerance=None, max_number_iterations=None, \
+           parameters_to_fit=None, estimator_id=None, user_info=None, out=None):
+    """
+    Calls the C interface fit function of the library for data in GPU memory, without transfers between host and GPU.
+    (see also http://gpufit.readthedocs.io/en/latest/gpufit_api.html#gpufit-cuda-interface-gpufit-context-cuda-interface)
+
+    The arrays data, weights, initial_parameters and user_info and the output arrays are C contiguous arrays in GPU
+    memory with the attribute __cuda_array_interface__, e.g. CuPy, PyTorch or Numba arrays, of the same shapes and
+    types as the NumPy arrays passed to fit. parameters_to_fit is a NumPy array. The fitted parameters replace the
+    initial parameters in place.
+
+    The fit is launched in the CUDA stream of the entry 'stream' of __cuda_array_interface__, hence it starts after
+    the work queued by the producer of the arrays. All arrays naming a stream must name the same stream.
+
+    :param out: Preallocated output arrays in GPU memory (states, chi_squares, number_iterations) or None (will
+        allocate new CuPy arrays)
+    :return: parameters, states, chi_squares, number_iterations, execution_time
+    """
+
+    # size check: data is 2D and read number of points and fits
+    data_shape = tuple(data.__cuda_array_interface__['shape'])
+    if len(data_shape) != 2:
+        raise RuntimeError('data is not two-dimensional')
+    number_fits, number_points = data_shape
+
+    parameters_shape = tuple(initial_parameters.__cuda_array_interface__['shape'])
+    if len(parameters_shape) != 2:
+        raise RuntimeError('initial_parameters is not two-dimensional')
+    number_parameters = parameters_shape[1]
+
+    # size and type checks of the device arrays, their pointers are passed to the library
+    data_type = _data_type(np.dtype(data.__cuda_array_interface__['typestr']))
+    data_p = _device_pointer(data, data_shape, data.__cuda_array_interface__['typestr'], 'data')
+    weights_p = None
+    if weights is not None:
+        weights_p = _device_pointer(weights, data_shape, np.float32, 'weights')
+    parameters_p = _device_pointer(initial_parameters, (number_fits, number_parameters), np.float32, 'initial_parameters')
+    user_info_size = 0
+    user_info_p = None
+    if user_info is not None:
+        interface = user_info.__cuda_array_interface__
+        user_info_size = int(np.prod(interface['shape'])) * np.dtype(interface['typestr']).itemsize
+        user_info_p = _device_pointer(user_info, tuple(interface['shape']), interface['typestr'], 'user_info')
+
+    # size check: consistency with parameters_to_fit (if given)
+    if parameters_to_fit is not None and parameters_to_fit.shape[0] != number_parameters:
+        raise RuntimeError('dimension mismatch in number of parameters between initial_parameters and parameters_to_fit')
+
+    # default values
+    tolerance, max_number_iterations, estimator_id, parameters_to_fit = _default_values(
+        tolerance, max_number_iterations, estimator_id, parameters_to_fit, number_parameters)
+
+    if parameters_to_fit.dtype != np.int32:
+        raise RuntimeError('type of parameters_to_fit is not np.int32')
+
+    # pre-allocate output variables in GPU memory or use the preallocated output arrays
+    if out is None:
+        try:
+            import cupy
+        except ImportError:
+            raise RuntimeError('output arrays in GPU memory must be passed in out if CuPy is not available')
+        states = cupy.zeros(number_fits, dtype=np.int32)
+        chi_squares = cupy.zeros(number_fits, dtype=np.float32)
+        number_iterations = cupy.zeros(number_fits, dtype=np.int32)
+    else:
+        states, chi_squares, number_iterations = out
+    states_p = _device_pointer(states, (number_fits,), np.int32, 'states')
+    chi_squares_p = _device_pointer(chi_squares, (number_fits,), np.float32, 'chi_squares')
+    number_iterations_p = _device_pointer(number_iterations, (number_fits,), np.int32, 'number_iterations')
+
+    # conversion to ctypes types for optional C interface parameters using NULL pointer (None) as default argument
+    if weights_p is not None:
+        weights_p = cast(weights_p, context_cuda_interface_func.argtypes[4])
+    if user_info_p is not None:
+        user_info_p = cast(user_info_p, context_cuda_interface_func.argtypes[11])
+
+    # the fit is launched in the stream of the arrays, after the work of their producer
+    stream = _stream((data, weights, initial_parameters, user_info, states, chi_squares, number_iterations))
+
+    # call into the library (measure time), the device buffers of the cached fit context are reused
+    context, lock = _context(data_type)
+    with lock:
+        t0 = timer()
+        status = context_cuda_interface_func(
+            context, \
+            context_cuda_interface_func.argtypes[1](number_fits), \
+            context_cuda_interface_func.argtypes[2](number_points), \
+            cast(data_p, context_cuda_interface_func.argtypes[3]), \
+            weights_p, \
+            context_cuda_interface_func.argtypes[5](model_id), \
+            context_cuda_interface_func.argtypes[6](tolerance), \
+            context_cuda_interface_func.argtypes[7](max_number_iterations), \
+            parameters_to_fit.ctypes.data_as(context_cuda_interface_func.argtypes[8]), \
+            context_cuda_interface_func.argtypes[9](estimator_id), \
+            context_cuda_interface_func.argtypes[10](user_info_size), \
+            user_info_p, \
+            cast(parameters_p, context_cuda_interface_func.argtypes[12]), \
+            cast(states_p, context_cuda_interface_func.argtypes[13]), \
+            cast(chi_squares_p, context_cuda_interface_func.argtypes[14]), \
+            cast(number_iterations_p, context_cuda_interface_func.argtypes[15]), \
+            stream)
+        t1 = timer()
+
+    # check status
+    if status != 0:
+        # get error from last error and raise runtime error
+        error_message = error_func()
+        raise RuntimeError('status = {}, message = {}'.format(status, error_message))
+
+    # return output values
+    return initial_parameters, states, chi_squares, number_iterations, t1 - t0
+
+
+def _default_values(tolerance, max_number_iterations, estimator_id, parameters_to_fit, number_parameters):
+    """
+    Replaces the optional parameters which are not given by their default values.
+    """
+
+    # default value: tolerance
+    if not tolerance:
+        tolerance = 1e-4
+
+    # default value: max_number_iterations
+    if not max_number_iterations:
+        max_number_iterations = 25
+
+    # default value: estimator ID
+    if not estimator_id:
+        estimator_id = EstimatorID.LSE
+
+    # default value: parameters_to_fit
+    if parameters_to_fit is None:
+        parameters_to_fit = np.ones(number_parameters, dtype=np.int32)
+
+    return tolerance, max_number_iterations, estimator_id, parameters_to_fit
+
+
+def _data_type(dtype):
+    """
+    :return: The data type ID of the option OPTION_DATA_TYPE for a NumPy data type
+    """
+    for data_type in DataType.types:
+        if np.dtype(dtype) == data_type[0]:
+            return data_type[1]
+    raise RuntimeError('type of data is not np.float32, np.uint16, np.float16 or np.uint8')
+
+
+def _create_context(data_type):
+    """
+    :return: A fit context with the data type option set
+    """
+    context = c_void_p()
+    if create_context_func(byref(context)) != 0:
+        raise RuntimeError('status = -1, message = {}'.format(error_func()))
+    if set_option_func(context, OPTION_DATA_TYPE, data_type) != 0:
+        error_message = error_func()
+        destroy_context_func(context)
+        raise RuntimeError('status = -1, message = {}'.format(error_message))
+    return context
+
+
+# fit contexts of the data types, created by the first fit of each data type and kept until the interpreter exits,
+# each one with a lock serializing the fits of different threads on it
+_contexts = {}
+_contexts_lock = threading.Lock()
+
+
+def _context(data_type):
+    """
+    :return: The cached fit context of the data type and its lock
+    """
+    with _contexts_lock:
+        if data_type not in _contexts:
+            _contexts[data_type] = (_create_context(data_type), threading.Lock())
+        return _contexts[data_type]
+
+
+@atexit.register
+def _destroy_contexts():
+    """
+    Destroys the cached fit contexts.
+    """
+    with _contexts_lock:
+        for context, _ in _contexts.values():
+            destroy_context_func(context)
+        _contexts.clear()
+
+
+def _stream(arrays):
+    """
+    :return: The CUDA stream of the entries 'stream' of the __cuda_array_interface__ of the arrays, or None (the
+        legacy default stream) if no array names a stream. The values 1 and 2 of the interface are the handles of
+        the legacy and the per-thread default stream.
+    """
+    streams = set()
+    for array in arrays:
+        if array is not None:
+            stream = array.__cuda_array_interface__.get('stream')
+            if stream is not None:
+                streams.add(stream)
+    if len(streams) > 1:
+        raise RuntimeError('arrays in GPU memory of different CUDA streams')
+    return c_void_p(streams.pop()) if streams else None
+
+
+def _check_output(array, shape, dtype, name):
+    """
+    Checks a preallocated output NumPy array, which is written by the library.
+    """
+    if not isinstance(array, np.ndarray) or not array.flags.c_contiguous or not array.flags.writeable:
+        raise RuntimeError('Memory layout of {} array mismatch.'.format(name))
+    if array.shape != shape:
+        raise RuntimeError('dimension mismatch of {} array'.format(name))
+    if array.dtype != dtype:
+        raise RuntimeError('type of {} is not {}'.format(name, np.dtype(dtype).name))
+
+
+def _device_pointer(array, shape, dtype, name):
+    """
+    :return: The device pointer of a C contiguous array in GPU memory with the attribute __cuda_array_interface__
+    """
+    if not hasattr(array, '__cuda_array_interface__'):
+        raise RuntimeError('{} is not an array in GPU memory'.format(name))
+    interface = array.__cuda_array_interface__
+    if tuple(interface['shape']) != shape:
+        raise RuntimeError('dimension mismatch of {} array'.format(name))
+    if np.dtype(interface['typestr']) != np.dtype(dtype):
+        raise RuntimeError('type of {} is not {}'.format(name, np.dtype(dtype).name))
+    strides = interface.get('strides')
+    if strides is not None:
+        # C contiguous strides
+        item_size = np.dtype(interface['typestr']).itemsize
+        contiguous_strides = tuple(int(item_size * np.prod(shape[i + 1:])) for i in range(len(shape)))
+        if tuple(strides) != contiguous_strides:
+            raise RuntimeError('Memory layout of {} array mismatch.'.format(name))
+    return c_void_p(interface['data'][0])
+
+
 def get_last_error():
     """
 
@@ -199,3 +508,32 @@ def cuda_available():
     :return: True if CUDA is available, False otherwise
     """
     return cuda_available_func() != 0
+
+
+def register_host_buffer(array):
+    """
+    Page-locks the memory of a NumPy array, which is then transferred to the GPU without an intermediate copy.
+    (see also http://gpufit.readthedocs.io/en/latest/gpufit_api.html#page-locked-memory)
+
+    The array must be C contiguous and must not be resized while it is registered. Registering is expensive, hence
+    arrays should be registered once and be reused by many fits.
+
+    :param array: NumPy array
+    """
+    if not array.flags.c_contiguous:
+        raise RuntimeError('Memory layout of array mismatch.')
+
+    status = register_host_buffer_func(array.ctypes.data_as(c_void_p), array.nbytes)
+    if status != 0:
+        raise RuntimeError('status = {}, message = {}'.format(status, error_func()))
+
+
+def unregister_host_buffer(array):
+    """
+    Releases the page-locked memory of a NumPy array registered by register_host_buffer.
+
+    :param array: NumPy array
+    """
+    status = unregister_host_buffer_func(array.ctypes.data_as(c_void_p))
+    if status != 0:
+        raise RuntimeError('status = {}, message = {}'.format(status, error_func()))
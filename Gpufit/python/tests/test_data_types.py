@@ -0,0 +1,54 @@
+"""
+    Fits camera frames of type np.uint16 into preallocated output arrays.
+"""
+
+import unittest
+import numpy as np
+import pygpufit.gpufit as gf
+
+class Test(unittest.TestCase):
+
+    def test_data_types(self):
+        # constants
+        n_fits = 100
+        n_points = 10
+        n_parameter = 2
+
+        # true parameters
+        true_parameters = np.array((10, 5), dtype=np.float32)
+
+        # data values, integer camera counts
+        x = np.arange(n_points, dtype=np.float32)
+        data = np.tile(true_parameters[0] + true_parameters[1] * x, (n_fits, 1)).astype(np.uint16)
+
+        # initial parameters
+        initial_parameters = np.zeros((n_fits, n_parameter), dtype=np.float32)
+
+        # preallocated output arrays
+        out = (np.empty((n_fits, n_parameter), dtype=np.float32), np.empty(n_fits, dtype=np.int32), \
+               np.empty(n_fits, dtype=np.float32), np.empty(n_fits, dtype=np.int32))
+
+        # call to gpufit
+        parameters, states, chi_squares, number_iterations, execution_time = gf.fit(data, None, gf.ModelID.LINEAR_1D,
+                                                                                    initial_parameters, 1e-6, out=out)
+
+        # the results are written to the preallocated arrays
+        assert (parameters is out[0])
+        assert (states is out[1])
+        assert (np.all(states == 0))
+        for i in range(n_parameter):
+            assert (np.all(abs(true_parameters[i] - parameters[:, i]) < 1e-4))
+
+        # results of float data
+        parameters_float, _, _, _, _ = gf.fit(data.astype(np.float32), None, gf.ModelID.LINEAR_1D, initial_parameters,
+                                              1e-6)
+        assert (np.allclose(parameters, parameters_float))
+
+        # unsupported data type and mismatching output array
+        with self.assertRaises(RuntimeError):
+            gf.fit(data.astype(np.int32), None, gf.ModelID.LINEAR_1D, initial_parameters)
+        with self.assertRaises(RuntimeError):
+            gf.fit(data, None, gf.ModelID.LINEAR_1D, initial_parameters, out=(out[0], out[2], out[2], out[3]))
+
+if __name__ == '__main__':
+    unittest.main()
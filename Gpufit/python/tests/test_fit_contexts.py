@@ -0,0 +1,57 @@
+"""
+    Checks that the fits reuse the cached fit context of their data type, and the selection of the CUDA stream of
+    arrays in GPU memory.
+"""
+
+import unittest
+import numpy as np
+import pygpufit.gpufit as gf
+
+
+class DeviceArray():
+    """
+    Provides the entry 'stream' of __cuda_array_interface__, which is all that is read by the stream selection.
+    """
+
+    def __init__(self, stream):
+        self.__cuda_array_interface__ = {'shape': (1,), 'typestr': '<f4', 'data': (0, False), 'version': 3,
+                                         'stream': stream}
+
+
+class Test(unittest.TestCase):
+
+    def test_cached_contexts(self):
+        n_fits = 10
+        n_points = 10
+        x = np.arange(n_points, dtype=np.float32)
+        data = np.tile(1 + 0.5 * x, (n_fits, 1)).astype(np.float32)
+        initial_parameters = np.zeros((n_fits, 2), dtype=np.float32)
+
+        gf.fit(data, None, gf.ModelID.LINEAR_1D, initial_parameters, 1e-6)
+        context = gf._contexts[gf.DataType.FLOAT][0].value
+
+        # the second fit of the same data type uses the same fit context
+        parameters, states, _, _, _ = gf.fit(data, None, gf.ModelID.LINEAR_1D, initial_parameters, 1e-6)
+        assert (gf._contexts[gf.DataType.FLOAT][0].value == context)
+        assert (np.all(states == 0))
+        assert (np.allclose(parameters[:, 1], 0.5))
+
+        # another data type has its own fit context
+        gf.fit(data.astype(np.uint16), None, gf.ModelID.LINEAR_1D, initial_parameters, 1e-6)
+        assert (gf._contexts[gf.DataType.UINT16][0].value != context)
+
+    def test_streams(self):
+        # no stream, the default stream
+        assert (gf._stream((DeviceArray(None), None)) is None)
+
+        # the stream of the arrays, the per-thread default stream and a stream handle
+        assert (gf._stream((DeviceArray(2), DeviceArray(None), None)).value == 2)
+        assert (gf._stream((DeviceArray(0x1234), DeviceArray(0x1234))).value == 0x1234)
+
+        # arrays of different streams
+        with self.assertRaises(RuntimeError):
+            gf._stream((DeviceArray(1), DeviceArray(0x1234)))
+
+
+if __name__ == '__main__':
+    unittest.main()
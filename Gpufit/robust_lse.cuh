@@ -0,0 +1,221 @@
+#ifndef GPUFIT_ROBUST_LSE_CUH_INCLUDED
+#define GPUFIT_ROBUST_LSE_CUH_INCLUDED
+
+#include "input_data.cuh"
+#include <math.h>
+
+/* Description of the LSE_HUBER and LSE_CAUCHY estimators
+* ========================================================
+*
+* Robust least squares estimators, which reduce the influence of outliers on
+* the fitted parameters. The chi-square summand of a data point is 2 rho(r) of
+* the residual r = (data - value) * sqrt(weight), where rho is the Huber loss
+*
+*   rho(r) = r^2 / 2                    for |r| <= HUBER_THRESHOLD
+*   rho(r) = delta (|r| - delta / 2)    otherwise
+*
+* or the Cauchy loss
+*
+*   rho(r) = c^2 / 2 log(1 + (r / c)^2)
+*
+* Both equal the LSE summand for small residuals. The weights scale the
+* residuals, e.g. weights of 1 / sigma^2 for data points of standard deviation
+* sigma, and an unweighted fit uses the residuals in units of the data.
+*
+* The gradient is the sum of psi(r) = rho'(r) times the derivatives of the
+* model, and the hessian is the hessian of LSE with the weight of each data
+* point multiplied by psi(r) / r, as in iteratively reweighted least squares.
+* Hence the weights of the outliers are reduced in each iteration.
+*
+*/
+
+// the tuning constants of 95% efficiency for normally distributed residuals
+#define HUBER_THRESHOLD 1.345f
+#define CAUCHY_SCALE 2.385f
+
+// the residual of a data point scaled by its weight, and the scale
+__device__ __forceinline__ float get_robust_residual(
+    float & scale,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight)
+{
+    scale = weight ? sqrtf(weight[point_index]) : 1.f;
+
+    return (data[point_index] - value[point_index]) * scale;
+}
+
+/* Description of the calculate_chi_square_lse_huber function
+* ===========================================================
+*
+* This function calculates the chi-square summand of a data point for the
+* LSE_HUBER estimator and adds it to chi_square. The parameters are the same
+* as for calculate_chi_square_lse.
+*
+*/
+
+__device__ void calculate_chi_square_lse_huber(
+    float * chi_square,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight,
+    int * state,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = fabsf(get_robust_residual(scale, point_index, data, value, weight));
+
+    if (residual <= HUBER_THRESHOLD)
+    {
+        *chi_square += residual * residual;
+    }
+    else
+    {
+        *chi_square += HUBER_THRESHOLD * (2.f * residual - HUBER_THRESHOLD);
+    }
+}
+
+/* Description of the calculate_hessian_lse_huber function
+* ========================================================
+*
+* This function calculates the hessian summand of a data point for the
+* LSE_HUBER estimator and adds it to hessian. The parameters are the same as
+* for calculate_hessian_lse.
+*
+*/
+
+__device__ void calculate_hessian_lse_huber(
+    double * hessian,
+    int const point_index,
+    int const parameter_index_i,
+    int const parameter_index_j,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = fabsf(get_robust_residual(scale, point_index, data, value, weight));
+    float const residual_weight = residual <= HUBER_THRESHOLD ? 1.f : HUBER_THRESHOLD / residual;
+
+    *hessian
+        += derivative[parameter_index_i] * derivative[parameter_index_j]
+        * residual_weight * scale * scale;
+}
+
+/* Description of the calculate_gradient_lse_huber function
+* =========================================================
+*
+* This function calculates the gradient summand of a data point for the
+* LSE_HUBER estimator and adds it to gradient. The parameters are the same as
+* for calculate_gradient_lse.
+*
+*/
+
+__device__ void calculate_gradient_lse_huber(
+    float * gradient,
+    int const point_index,
+    int const parameter_index,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = get_robust_residual(scale, point_index, data, value, weight);
+    float const psi = fminf(fmaxf(residual, -HUBER_THRESHOLD), HUBER_THRESHOLD);
+
+    *gradient += derivative[parameter_index] * psi * scale;
+}
+
+/* Description of the calculate_chi_square_lse_cauchy function
+* ============================================================
+*
+* This function calculates the chi-square summand of a data point for the
+* LSE_CAUCHY estimator and adds it to chi_square. The parameters are the same
+* as for calculate_chi_square_lse.
+*
+*/
+
+__device__ void calculate_chi_square_lse_cauchy(
+    float * chi_square,
+    int const point_index,
+    InputData const data,
+    float const * value,
+    float const * weight,
+    int * state,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = get_robust_residual(scale, point_index, data, value, weight) / CAUCHY_SCALE;
+
+    *chi_square += CAUCHY_SCALE * CAUCHY_SCALE * log1pf(residual * residual);
+}
+
+/* Description of the calculate_hessian_lse_cauchy function
+* =========================================================
+*
+* This function calculates the hessian summand of a data point for the
+* LSE_CAUCHY estimator and adds it to hessian. The parameters are the same as
+* for calculate_hessian_lse.
+*
+*/
+
+__device__ void calculate_hessian_lse_cauchy(
+    double * hessian,
+    int const point_index,
+    int const parameter_index_i,
+    int const parameter_index_j,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = get_robust_residual(scale, point_index, data, value, weight) / CAUCHY_SCALE;
+    float const residual_weight = 1.f / (1.f + residual * residual);
+
+    *hessian
+        += derivative[parameter_index_i] * derivative[parameter_index_j]
+        * residual_weight * scale * scale;
+}
+
+/* Description of the calculate_gradient_lse_cauchy function
+* ==========================================================
+*
+* This function calculates the gradient summand of a data point for the
+* LSE_CAUCHY estimator and adds it to gradient. The parameters are the same as
+* for calculate_gradient_lse.
+*
+*/
+
+__device__ void calculate_gradient_lse_cauchy(
+    float * gradient,
+    int const point_index,
+    int const parameter_index,
+    InputData const data,
+    float const * value,
+    float const * derivative,
+    float const * weight,
+    char * user_info,
+    std::size_t const user_info_size)
+{
+    float scale = 0.f;
+    float const residual = get_robust_residual(scale, point_index, data, value, weight);
+    float const normalized_residual = residual / CAUCHY_SCALE;
+    float const psi = residual / (1.f + normalized_residual * normalized_residual);
+
+    *gradient += derivative[parameter_index] * psi * scale;
+}
+
+#endif
@@ -0,0 +1,125 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 1001 };
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+std::array< float, 4 > const true_parameters{ { 4.f, 2.f, 0.5f, 1.f } };
+std::array< float, 4 > const start_parameters{ { 2.f, 1.5f, 0.3f, 0.f } };
+
+void generate_gauss_1d(std::vector< float > & values)
+{
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = (x - true_parameters[1]) * (x - true_parameters[1]) / (2.f * true_parameters[2] * true_parameters[2]);
+        values[index] = true_parameters[0] * std::exp(-argx) + true_parameters[3];
+    }
+}
+
+// the number of active fits of each iteration
+void store_active_fits(gpufit_iteration_profile const * const profile, void * const user_data)
+{
+    std::vector< int > & n_active_fits = *static_cast< std::vector< int > * >(user_data);
+
+    BOOST_CHECK( profile->chunk_index == 0 );
+    BOOST_CHECK( profile->iteration == int(n_active_fits.size()) );
+    n_active_fits.push_back(profile->n_active_fits);
+}
+
+BOOST_AUTO_TEST_CASE( Active_Fits )
+{
+    /*
+        Performs fits of which every second one starts at the true parameters
+        and finishes after the first iteration, while the others take several
+        iterations, with different convergence check intervals.
+        - Checks that all fits converge to the true parameters.
+        - Checks that the finished fits are removed from the active fits at
+          each convergence check, hence later iterations calculate only the
+          fits which have not finished before.
+    */
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t index = 0; index < initial_parameters.size(); index++)
+    {
+        std::size_t const fit_index = index / n_parameters;
+        std::size_t const parameter_index = index % n_parameters;
+        initial_parameters[index]
+            = fit_index % 2
+            ? start_parameters[parameter_index]
+            : true_parameters[parameter_index];
+    }
+
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    std::vector< int > n_active_fits;
+    BOOST_CHECK( gpufit_context_set_profile_callback( context, store_active_fits, &n_active_fits ) == 0 );
+
+    for (int interval = 1; interval <= 3; interval++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_CONVERGENCE_CHECK_INTERVAL, interval ) == 0 );
+
+        std::vector< float > output_parameters(n_fits * n_parameters);
+        std::vector< int > output_states(n_fits);
+        std::vector< float > output_chi_squares(n_fits);
+        std::vector< int > output_n_iterations(n_fits);
+
+        n_active_fits.clear();
+
+        BOOST_CHECK( gpufit_context_fit(
+            context, n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(), 0.001f, 20,
+            parameters_to_fit.data(), LSE, 0, 0, output_parameters.data(), output_states.data(),
+            output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            BOOST_CHECK( output_states[ fit_index ] == STATE_CONVERGED );
+            for (std::size_t parameter_index = 0; parameter_index < n_parameters; parameter_index++)
+            {
+                BOOST_CHECK( std::abs(
+                    output_parameters[ fit_index * n_parameters + parameter_index ]
+                    - true_parameters[ parameter_index ] ) < 1e-4f );
+            }
+        }
+
+        BOOST_CHECK( output_n_iterations[ 0 ] == 1 );
+        BOOST_CHECK( output_n_iterations[ 1 ] > interval );
+        BOOST_REQUIRE( n_active_fits.size() > std::size_t(interval) );
+
+        // the fits active in an iteration are the fits which did not finish
+        // before the last convergence check
+        for (std::size_t iteration = 0; iteration < n_active_fits.size(); iteration++)
+        {
+            int const last_check = int(iteration) / interval * interval;
+
+            int n_unfinished_fits = 0;
+            for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+            {
+                if (output_n_iterations[ fit_index ] > last_check)
+                    n_unfinished_fits++;
+            }
+
+            BOOST_CHECK( n_active_fits[ iteration ] == n_unfinished_fits );
+        }
+
+        BOOST_CHECK( n_active_fits[ 0 ] == int(n_fits) );
+        BOOST_CHECK( n_active_fits[ interval ] <= int(n_fits / 2) );
+    }
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,112 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+std::size_t const n_fits{ 101 };
+
+char const * const cache_file{ "Autotune_cache.txt" };
+
+std::vector< std::string > read_lines(char const * path)
+{
+    std::vector< std::string > lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// the number of fits per block of a cache entry, 0 if it is not a power of 2
+int get_fits_per_block(std::string const & line)
+{
+    std::size_t const separator = line.rfind('\t');
+    if (separator == std::string::npos)
+        return 0;
+
+    int const n_fits_per_block = std::atoi(line.c_str() + separator + 1);
+    if (n_fits_per_block <= 0 || (n_fits_per_block & (n_fits_per_block - 1)) != 0)
+        return 0;
+
+    return n_fits_per_block;
+}
+
+BOOST_AUTO_TEST_CASE( Autotune )
+{
+    /*
+        Performs fits with autotuning of the number of fits per thread block,
+        with a number of fits which is not a power of two, and a cache file
+        set by GPUFIT_AUTOTUNE_CACHE.
+        - Checks that the first fit of a fit problem appends the number of
+          fits per block found to the cache file, which is a power of 2.
+        - Checks that a repeated fit uses the cached number of fits per block,
+          hence the cache file is not changed.
+        - Checks that a fit of a different number of points is tuned again.
+        - Checks that the results agree with the results without autotuning.
+        - Checks that invalid autotune options are rejected.
+    */
+
+    // the cache reads the environment variable when it is used first
+    {
+        std::ofstream file(cache_file);
+        file << "unrelated fit problem\t8\n";
+    }
+#ifdef _WIN32
+    _putenv_s("GPUFIT_AUTOTUNE_CACHE", cache_file);
+#else
+    setenv("GPUFIT_AUTOTUNE_CACHE", cache_file, 1);
+#endif
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    // peaks whose centers move with the fit index
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center_step = 0.01f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+    BOOST_CHECK( read_lines( cache_file ).size() == 1 );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_AUTOTUNE, 1 ) == 0 );
+
+    for (int repetition = 0; repetition < 2; repetition++)
+    {
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+        for (std::size_t index = 0; index < peaks.parameters.size(); index++)
+        {
+            BOOST_CHECK( std::abs( peaks.parameters[ index ] - reference_parameters[ index ] ) < 1e-5f );
+        }
+
+        std::vector< std::string > const lines = read_lines(cache_file);
+        BOOST_REQUIRE( lines.size() == 2 );
+        BOOST_CHECK( lines[ 1 ].find( " points 5 " ) != std::string::npos );
+        BOOST_CHECK( get_fits_per_block( lines[ 1 ] ) > 0 );
+    }
+
+    peaks.n_points = 9;
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    std::vector< std::string > const lines = read_lines(cache_file);
+    BOOST_REQUIRE( lines.size() == 3 );
+    BOOST_CHECK( lines[ 2 ].find( " points 9 " ) != std::string::npos );
+    BOOST_CHECK( get_fits_per_block( lines[ 2 ] ) > 0 );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_AUTOTUNE, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+
+    std::remove(cache_file);
+}
@@ -0,0 +1,137 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#define PI 3.1415926535897f
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 20 };
+std::size_t const size_x{ 8 };
+std::size_t const n_points{ size_x * size_x };
+std::size_t const n_parameters{ 7 };
+
+std::array< float, n_parameters > const true_parameters{ { 10.f, 3.5f, 3.5f, 0.9f, 1.1f, 1.f, PI / 16.f } };
+
+void generate_gauss_2d_rotated(std::vector< float > & values)
+{
+    float const a = true_parameters[0];
+    float const x0 = true_parameters[1];
+    float const y0 = true_parameters[2];
+    float const sx = true_parameters[3];
+    float const sy = true_parameters[4];
+    float const b = true_parameters[5];
+    float const r = true_parameters[6];
+
+    values.resize(n_fits * n_points);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        for (std::size_t point_index = 0; point_index < n_points; point_index++)
+        {
+            float const x = float(point_index % size_x);
+            float const y = float(point_index / size_x);
+            float const arga = ((x - x0) * std::cos(r)) - ((y - y0) * std::sin(r));
+            float const argb = ((x - x0) * std::sin(r)) + ((y - y0) * std::cos(r));
+            float const ex = std::exp((-0.5f) * (((arga / sx) * (arga / sx)) + ((argb / sy) * (argb / sy))));
+            values[fit_index * n_points + point_index] = a * ex + b;
+        }
+    }
+}
+
+// fits the first n_parameters_to_fit parameters, the other parameters are
+// fixed at their true values
+int fit_gauss_2d_rotated(
+    void * context,
+    std::vector< float > const & data,
+    std::size_t const n_parameters_to_fit,
+    std::vector< float > & output_parameters,
+    std::vector< int > & output_states)
+{
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        float const deviation = 0.02f * float(fit_index % 5 + 1);
+        for (std::size_t parameter_index = 0; parameter_index < n_parameters; parameter_index++)
+        {
+            initial_parameters[fit_index * n_parameters + parameter_index]
+                = true_parameters[parameter_index]
+                * (parameter_index < n_parameters_to_fit ? 1.f + deviation : 1.f);
+        }
+    }
+
+    // the hessian of a peak of zero amplitude has zero rows for the center,
+    // the widths and the rotation
+    initial_parameters[(n_fits - 1) * n_parameters + 0] = 0.f;
+
+    std::array< int, n_parameters > parameters_to_fit{};
+    for (std::size_t parameter_index = 0; parameter_index < n_parameters_to_fit; parameter_index++)
+    {
+        parameters_to_fit[parameter_index] = 1;
+    }
+
+    output_parameters.resize(n_fits * n_parameters);
+    output_states.resize(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    return gpufit_context_fit(
+        context, n_fits, n_points, const_cast< float * >(data.data()), 0, GAUSS_2D_ROTATED,
+        initial_parameters.data(), 1e-6f, 20, parameters_to_fit.data(), LSE, 0, 0,
+        output_parameters.data(), output_states.data(), output_chi_squares.data(), output_n_iterations.data());
+}
+
+BOOST_AUTO_TEST_CASE( Cholesky_Solver )
+{
+    /*
+        Performs fits of 1 to 7 parameters solving the equation systems by
+        Gauss-Jordan elimination and by Cholesky decomposition, one of the
+        fits with a singular hessian.
+        - Checks that the results of the Cholesky decomposition agree with
+          the results of the Gauss-Jordan elimination for each size of the
+          equation systems.
+        - Checks that both solvers report the same singular fits.
+        - Checks that invalid solver IDs are rejected.
+    */
+
+    std::vector< float > data;
+    generate_gauss_2d_rotated(data);
+
+    void * gauss_jordan = 0;
+    void * cholesky = 0;
+    BOOST_CHECK( gpufit_create_context( &gauss_jordan ) == 0 );
+    BOOST_CHECK( gpufit_create_context( &cholesky ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( cholesky, OPTION_SOLVER, SOLVER_CHOLESKY ) == 0 );
+
+    for (std::size_t n_parameters_to_fit = 1; n_parameters_to_fit <= n_parameters; n_parameters_to_fit++)
+    {
+        std::vector< float > reference_parameters;
+        std::vector< int > reference_states;
+        BOOST_CHECK( fit_gauss_2d_rotated( gauss_jordan, data, n_parameters_to_fit, reference_parameters, reference_states ) == 0 );
+
+        std::vector< float > output_parameters;
+        std::vector< int > output_states;
+        BOOST_CHECK( fit_gauss_2d_rotated( cholesky, data, n_parameters_to_fit, output_parameters, output_states ) == 0 );
+
+        BOOST_CHECK( output_states == reference_states );
+        BOOST_CHECK( reference_states[ n_fits - 1 ] == (n_parameters_to_fit > 1 ? STATE_SINGULAR_HESSIAN : STATE_CONVERGED) );
+
+        for (std::size_t fit_index = 0; fit_index < n_fits - 1; fit_index++)
+        {
+            BOOST_CHECK( reference_states[ fit_index ] == STATE_CONVERGED );
+            for (std::size_t parameter_index = 0; parameter_index < n_parameters; parameter_index++)
+            {
+                std::size_t const index = fit_index * n_parameters + parameter_index;
+                BOOST_CHECK( std::abs( output_parameters[ index ] - reference_parameters[ index ] ) < 1e-4f );
+            }
+        }
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( cholesky, OPTION_SOLVER, -1 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( gauss_jordan ) == 0 );
+    BOOST_CHECK( gpufit_destroy_context( cholesky ) == 0 );
+}
@@ -0,0 +1,64 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <vector>
+
+std::size_t const n_fits{ 1001 };
+std::size_t const n_parameters{ 4 };
+
+BOOST_AUTO_TEST_CASE( Chunk_Pipeline )
+{
+    /*
+        Fits peaks with a different center in each fit, split into chunks by a
+        small GPU memory budget, with one and several CUDA streams.
+        - Checks that the fits are split into several chunks.
+        - Checks that the results of each fit equal its results in a single
+          chunk, hence the chunks are fitted and returned in order.
+        - Checks that invalid options are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    // peaks whose centers move with the fit index, hence each fit has its own
+    // results, which are found at the position of the fit only
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center_step = 0.001f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+    std::vector< int > const reference_n_iterations = peaks.n_iterations;
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks == 1 );
+
+    // the centers differ between the fits
+    BOOST_CHECK( reference_parameters[ 1 ] < reference_parameters[ (n_fits - 1) * n_parameters + 1 ] );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 40000. ) == 0 );
+
+    for (int n_streams = 1; n_streams <= 3; n_streams++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_N_STREAMS, n_streams ) == 0 );
+
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+
+        BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+        BOOST_CHECK( profile.n_chunks > std::size_t(n_streams) );
+
+        BOOST_CHECK( peaks.parameters == reference_parameters );
+        BOOST_CHECK( peaks.n_iterations == reference_n_iterations );
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_N_STREAMS, 0 ) == -1 );
+    BOOST_CHECK( gpufit_context_set_option( context, -1, 1 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,164 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+void generate_gauss_1d(std::vector< float > & values, std::size_t const n_points)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        values[index] = a * std::exp(-argx) + b;
+    }
+}
+
+int fit_gauss_1d(void * context, std::size_t const n_fits, std::vector< float > & output_parameters)
+{
+    std::size_t const n_points{ 5 };
+    std::size_t const n_parameters{ 4 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data, n_points);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 2.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.5f;
+        initial_parameters[fit_index * n_parameters + 2] = 0.3f;
+        initial_parameters[fit_index * n_parameters + 3] = 0.f;
+    }
+
+    float tolerance{ 0.001f };
+    int max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    output_parameters.resize(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    return gpufit_context_fit
+        (
+            context,
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_1D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Constraints )
+{
+    /*
+        Performs fits with box constraints of the parameters.
+        - Checks that bounds which are not reached do not change the results.
+        - Checks that the parameters are kept within their bounds, by the
+          standard and the fused kernel.
+        - Checks that each fit uses its own bounds, if the bounds are set per
+          fit.
+        - Checks that invalid constraints are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::size_t const n_fits = 2;
+    std::size_t const n_parameters = 4;
+
+    std::vector< float > reference_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, reference_parameters ) == 0 );
+
+    // bounds of the center and the width, which are not reached
+    std::array< int, 4 > types{ { CONSTRAINT_NONE, CONSTRAINT_LOWER_UPPER, CONSTRAINT_LOWER, CONSTRAINT_NONE } };
+    std::array< float, 8 > bounds{ { 0.f, 0.f, 0.f, 4.f, 0.1f, 0.f, 0.f, 0.f } };
+    BOOST_CHECK( gpufit_context_set_constraints( context, 1, n_parameters, bounds.data(), types.data() ) == 0 );
+
+    std::vector< float > output_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters ) == 0 );
+    BOOST_CHECK( output_parameters == reference_parameters );
+
+    // an upper bound of the amplitude below its true value of 4
+    types[0] = CONSTRAINT_UPPER;
+    bounds[1] = 3.f;
+    BOOST_CHECK( gpufit_context_set_constraints( context, 1, n_parameters, bounds.data(), types.data() ) == 0 );
+
+    for (int fused = 0; fused < 2; fused++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, fused ) == 0 );
+        BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters ) == 0 );
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            BOOST_CHECK( output_parameters[ fit_index * n_parameters + 0 ] <= 3.f );
+            BOOST_CHECK( output_parameters[ fit_index * n_parameters + 1 ] >= 0.f );
+            BOOST_CHECK( output_parameters[ fit_index * n_parameters + 1 ] <= 4.f );
+            BOOST_CHECK( output_parameters[ fit_index * n_parameters + 2 ] >= 0.1f );
+        }
+    }
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, 0 ) == 0 );
+
+    // only the second fit is bounded
+    std::vector< float > fit_bounds(bounds.begin(), bounds.end());
+    fit_bounds.insert(fit_bounds.begin(), bounds.begin(), bounds.end());
+    fit_bounds[1] = 100.f;
+    BOOST_CHECK( gpufit_context_set_constraints( context, n_fits, n_parameters, fit_bounds.data(), types.data() ) == 0 );
+
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters ) == 0 );
+    for (std::size_t index = 0; index < n_parameters; index++)
+    {
+        BOOST_CHECK( output_parameters[ index ] == reference_parameters[ index ] );
+    }
+    BOOST_CHECK( output_parameters[ n_parameters + 0 ] <= 3.f );
+
+    // the bounds per fit must match the number of fits
+    BOOST_CHECK( fit_gauss_1d( context, n_fits + 1, output_parameters ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "constraints do not match the fits" );
+
+    // invalid constraints are rejected and keep the previous constraints
+    types[0] = 4;
+    BOOST_CHECK( gpufit_context_set_constraints( context, 1, n_parameters, bounds.data(), types.data() ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid constraint type" );
+
+    types[0] = CONSTRAINT_LOWER_UPPER;
+    bounds[0] = 5.f;
+    BOOST_CHECK( gpufit_context_set_constraints( context, 1, n_parameters, bounds.data(), types.data() ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "lower bound larger than upper bound" );
+
+    BOOST_CHECK( gpufit_context_set_constraints( context, 1, n_parameters, 0, types.data() ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid constraints" );
+
+    BOOST_CHECK( fit_gauss_1d( context, n_fits + 1, output_parameters ) == -1 );
+
+    // the constraints are removed
+    BOOST_CHECK( gpufit_context_set_constraints( context, 0, 0, 0, 0 ) == 0 );
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters ) == 0 );
+    BOOST_CHECK( output_parameters == reference_parameters );
+
+    BOOST_CHECK( gpufit_context_set_constraints( 0, 0, 0, 0, 0 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,105 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+std::size_t const n_fits{ 100 };
+int const max_n_iterations{ 30 };
+
+// peaks whose initial centers are increasingly far from the true centers,
+// hence the fits need different numbers of iterations
+GaussPeaks get_peaks()
+{
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center = 2.f;
+    peaks.initial_center_step = -0.006f;
+    peaks.tolerance = 1e-4f;
+    peaks.max_n_iterations = max_n_iterations;
+    return peaks;
+}
+
+BOOST_AUTO_TEST_CASE( Convergence_Check_Interval )
+{
+    /*
+        Performs fits needing different numbers of iterations, checking the
+        convergence after each iteration and only every 4 iterations.
+        - Checks that the iterations stop after the slowest fit with an
+          interval of 1, and at the next multiple of 4 with an interval of 4.
+        - Checks that the results and the numbers of iterations of the fits
+          are independent of the interval.
+        - Checks that invalid intervals are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    GaussPeaks peaks = get_peaks();
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+    std::vector< int > const reference_n_iterations = peaks.n_iterations;
+
+    int const slowest_fit = *std::max_element(reference_n_iterations.begin(), reference_n_iterations.end());
+    int const fastest_fit = *std::min_element(reference_n_iterations.begin(), reference_n_iterations.end());
+    BOOST_CHECK( fastest_fit < slowest_fit );
+    BOOST_CHECK( slowest_fit < max_n_iterations );
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations == std::size_t(slowest_fit) );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_CONVERGENCE_CHECK_INTERVAL, 4 ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations == std::size_t(std::min((slowest_fit + 3) / 4 * 4, max_n_iterations)) );
+
+    BOOST_CHECK( peaks.parameters == reference_parameters );
+    BOOST_CHECK( peaks.n_iterations == reference_n_iterations );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_CONVERGENCE_CHECK_INTERVAL, 0 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Convergence_Check_Interval_Warm_Start )
+{
+    /*
+        Repeats the fits with OPTION_WARM_START, checking the convergence
+        after each iteration and only every 4 iterations.
+        - Checks that the repeated fits give the same results and numbers of
+          iterations with both intervals, hence the damping factors of fits
+          which finished between two checks are not changed by the following
+          iterations.
+    */
+
+    std::vector< float > warm_parameters[2];
+    std::vector< int > warm_n_iterations[2];
+    int const intervals[2]{ 1, 4 };
+
+    for (int i = 0; i < 2; i++)
+    {
+        void * context = 0;
+        BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_WARM_START, 1 ) == 0 );
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_CONVERGENCE_CHECK_INTERVAL, intervals[i] ) == 0 );
+
+        GaussPeaks peaks = get_peaks();
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+        warm_parameters[i] = peaks.parameters;
+        warm_n_iterations[i] = peaks.n_iterations;
+
+        BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+    }
+
+    BOOST_CHECK( warm_parameters[1] == warm_parameters[0] );
+    BOOST_CHECK( warm_n_iterations[1] == warm_n_iterations[0] );
+}
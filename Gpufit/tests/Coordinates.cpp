@@ -0,0 +1,162 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+void generate_gauss_1d(std::vector< float > & values, std::size_t const n_points)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        values[index] = a * std::exp(-argx) + b;
+    }
+}
+
+// the initial center of each fit is shifted by shifts[fit_index]
+int fit_gauss_1d(
+    void * context,
+    std::size_t const n_fits,
+    std::vector< float > & output_parameters,
+    std::vector< float > const * shifts = 0)
+{
+    std::size_t const n_points{ 5 };
+    std::size_t const n_parameters{ 4 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data, n_points);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 2.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.5f + (shifts ? (*shifts)[fit_index] : 0.f);
+        initial_parameters[fit_index * n_parameters + 2] = 0.3f;
+        initial_parameters[fit_index * n_parameters + 3] = 0.f;
+    }
+
+    float tolerance{ 0.001f };
+    int max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    output_parameters.resize(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    return gpufit_context_fit
+        (
+            context,
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_1D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+}
+
+void check_shifted_gauss_1d(
+    std::vector< float > const & output_parameters,
+    std::vector< float > const & reference_parameters,
+    std::vector< float > const & shifts)
+{
+    for (std::size_t index = 0; index < output_parameters.size(); index++)
+    {
+        float const shift = index % 4 == 1 ? shifts[ index / 4 ] : 0.f;
+        BOOST_CHECK( std::abs( output_parameters[ index ] - reference_parameters[ index % 4 ] - shift ) < 1e-4f );
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Coordinates )
+{
+    /*
+        Performs fits on shifted coordinate grids.
+        - Checks that a shared grid, per fit grids and per fit offsets shift
+          the fitted centers.
+        - Checks that grids which do not match the fits are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::size_t const n_fits = 3;
+    std::size_t const n_points = 5;
+
+    std::vector< float > reference_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, 1, reference_parameters ) == 0 );
+
+    // shared grid 10, .., 14
+    std::vector< float > shifts(n_fits, 10.f);
+    std::vector< float > x_coordinates(n_points);
+    for (std::size_t point_index = 0; point_index < n_points; point_index++)
+    {
+        x_coordinates[point_index] = float(point_index) + 10.f;
+    }
+
+    BOOST_CHECK( gpufit_context_set_coordinates( context, n_points, 1, x_coordinates.data(), 0, 0, 0 ) == 0 );
+
+    std::vector< float > output_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &shifts ) == 0 );
+    check_shifted_gauss_1d( output_parameters, reference_parameters, shifts );
+
+    // one grid per fit, shifted by the fit index
+    x_coordinates.resize(n_fits * n_points);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        shifts[fit_index] = float(fit_index);
+        for (std::size_t point_index = 0; point_index < n_points; point_index++)
+        {
+            x_coordinates[fit_index * n_points + point_index] = float(point_index + fit_index);
+        }
+    }
+
+    BOOST_CHECK( gpufit_context_set_coordinates( context, n_points, n_fits, x_coordinates.data(), 0, 0, 0 ) == 0 );
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &shifts ) == 0 );
+    check_shifted_gauss_1d( output_parameters, reference_parameters, shifts );
+
+    // the number of grids must match the number of fits
+    BOOST_CHECK( fit_gauss_1d( context, n_fits + 1, output_parameters ) == -1 );
+
+    // offsets without a grid
+    std::vector< float > offsets(2 * n_fits);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        shifts[fit_index] = 2.f * float(fit_index);
+        offsets[2 * fit_index] = shifts[fit_index];
+    }
+
+    BOOST_CHECK( gpufit_context_set_coordinates( context, 0, 0, 0, 0, n_fits, offsets.data() ) == 0 );
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &shifts ) == 0 );
+    check_shifted_gauss_1d( output_parameters, reference_parameters, shifts );
+
+    // removing the grid restores the default coordinates
+    BOOST_CHECK( gpufit_context_set_coordinates( context, 0, 0, 0, 0, 0, 0 ) == 0 );
+    BOOST_CHECK( fit_gauss_1d( context, 1, output_parameters ) == 0 );
+    check_shifted_gauss_1d( output_parameters, reference_parameters, std::vector< float >(1, 0.f) );
+
+    BOOST_CHECK( gpufit_context_set_coordinates( context, 0, 1, x_coordinates.data(), 0, 0, 0 ) == -1 );
+    BOOST_CHECK( gpufit_context_set_coordinates( context, n_points, 1, 0, x_coordinates.data(), 0, 0 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,262 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuda_runtime.h>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+void generate_gauss_1d(std::vector< float > & values)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        values[index] = a * std::exp(-argx) + b;
+    }
+}
+
+void generate_initial_parameters(std::vector< float > & parameters)
+{
+    for (std::size_t index = 0; index < parameters.size(); index += n_parameters)
+    {
+        parameters[index + 0] = 2.f;
+        parameters[index + 1] = 1.5f;
+        parameters[index + 2] = 0.3f;
+        parameters[index + 3] = 0.f;
+    }
+}
+
+template< typename Type >
+struct Gpu_Array
+{
+    explicit Gpu_Array(std::vector< Type > const & host) : size_(host.size()), data_(0)
+    {
+        BOOST_REQUIRE( cudaMalloc(&data_, size_ * sizeof(Type)) == cudaSuccess );
+        BOOST_REQUIRE( cudaMemcpy(data_, host.data(), size_ * sizeof(Type), cudaMemcpyHostToDevice) == cudaSuccess );
+    }
+
+    ~Gpu_Array() { cudaFree(data_); }
+
+    std::vector< Type > read() const
+    {
+        std::vector< Type > host(size_);
+        BOOST_REQUIRE( cudaMemcpy(host.data(), data_, size_ * sizeof(Type), cudaMemcpyDeviceToHost) == cudaSuccess );
+        return host;
+    }
+
+    std::size_t const size_;
+    Type * data_;
+};
+
+BOOST_AUTO_TEST_CASE( Cuda_Interface )
+{
+    /*
+        Performs fits of data in GPU memory, in the default stream and in a
+        stream created by the caller.
+        - Checks that the results equal the results of fits of the same data
+          in host memory.
+        - Checks that invalid arguments are rejected.
+    */
+
+    std::size_t const n_fits{ 1000 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    generate_initial_parameters(initial_parameters);
+
+    float const tolerance{ 0.001f };
+    int const max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    std::vector< float > reference_parameters(n_fits * n_parameters);
+    std::vector< int > reference_states(n_fits);
+    std::vector< float > reference_chi_squares(n_fits);
+    std::vector< int > reference_n_iterations(n_fits);
+
+    BOOST_CHECK( gpufit(
+        n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(),
+        tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+        reference_parameters.data(), reference_states.data(),
+        reference_chi_squares.data(), reference_n_iterations.data()) == 0 );
+
+    Gpu_Array< float > gpu_data(data);
+    std::vector< int > zeros(n_fits, 0);
+    std::vector< float > float_zeros(n_fits, 0.f);
+
+    // default stream, without fit context
+    {
+        Gpu_Array< float > gpu_parameters(initial_parameters);
+        Gpu_Array< int > gpu_states(zeros);
+        Gpu_Array< float > gpu_chi_squares(float_zeros);
+        Gpu_Array< int > gpu_n_iterations(zeros);
+
+        BOOST_CHECK( gpufit_cuda_interface(
+            n_fits, n_points, gpu_data.data_, 0, GAUSS_1D,
+            tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+            gpu_parameters.data_, gpu_states.data_,
+            gpu_chi_squares.data_, gpu_n_iterations.data_) == 0 );
+
+        BOOST_CHECK( gpu_parameters.read() == reference_parameters );
+        BOOST_CHECK( gpu_states.read() == reference_states );
+        BOOST_CHECK( gpu_chi_squares.read() == reference_chi_squares );
+        BOOST_CHECK( gpu_n_iterations.read() == reference_n_iterations );
+    }
+
+    // stream of the caller, with a fit context which is reused for a fit of
+    // data in host memory afterwards
+    {
+        cudaStream_t stream = 0;
+        BOOST_REQUIRE( cudaStreamCreate(&stream) == cudaSuccess );
+
+        void * context = 0;
+        BOOST_CHECK( gpufit_create_context(&context) == 0 );
+
+        Gpu_Array< float > gpu_parameters(initial_parameters);
+        Gpu_Array< int > gpu_states(zeros);
+        Gpu_Array< float > gpu_chi_squares(float_zeros);
+        Gpu_Array< int > gpu_n_iterations(zeros);
+
+        BOOST_CHECK( gpufit_context_cuda_interface(
+            context, n_fits, n_points, gpu_data.data_, 0, GAUSS_1D,
+            tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+            gpu_parameters.data_, gpu_states.data_,
+            gpu_chi_squares.data_, gpu_n_iterations.data_, stream) == 0 );
+
+        BOOST_CHECK( gpu_parameters.read() == reference_parameters );
+        BOOST_CHECK( gpu_states.read() == reference_states );
+
+        std::vector< float > output_parameters(n_fits * n_parameters);
+        std::vector< int > output_states(n_fits);
+        std::vector< float > output_chi_squares(n_fits);
+        std::vector< int > output_n_iterations(n_fits);
+
+        BOOST_CHECK( gpufit_context_fit(
+            context, n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(),
+            tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+            output_parameters.data(), output_states.data(),
+            output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+        BOOST_CHECK( output_parameters == reference_parameters );
+
+        BOOST_CHECK( gpufit_context_cuda_interface(
+            0, n_fits, n_points, gpu_data.data_, 0, GAUSS_1D,
+            tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+            gpu_parameters.data_, gpu_states.data_,
+            gpu_chi_squares.data_, gpu_n_iterations.data_, stream) == -1 );
+
+        BOOST_CHECK( gpufit_destroy_context(context) == 0 );
+        cudaStreamDestroy(stream);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Cuda_Interface_Between_Host_Fits )
+{
+    /*
+        Performs a fit of data in host memory, a fit of data in GPU memory and
+        another fit of data in host memory with the same fit context.
+        - Checks that the results equal the results of fits without a fit
+          context.
+        - Checks that the last fit does not change the GPU memory of the
+          caller of the previous fit.
+    */
+
+    std::size_t const n_fits{ 1000 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    generate_initial_parameters(initial_parameters);
+
+    float const tolerance{ 0.001f };
+    int const max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    std::vector< float > reference_parameters(n_fits * n_parameters);
+    std::vector< int > reference_states(n_fits);
+    std::vector< float > reference_chi_squares(n_fits);
+    std::vector< int > reference_n_iterations(n_fits);
+
+    BOOST_CHECK( gpufit(
+        n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(),
+        tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+        reference_parameters.data(), reference_states.data(),
+        reference_chi_squares.data(), reference_n_iterations.data()) == 0 );
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context(&context) == 0 );
+
+    std::vector< float > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    BOOST_CHECK( gpufit_context_fit(
+        context, n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(),
+        tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+        output_parameters.data(), output_states.data(),
+        output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+    BOOST_CHECK( output_parameters == reference_parameters );
+
+    std::vector< int > zeros(n_fits, 0);
+    std::vector< float > float_zeros(n_fits, 0.f);
+
+    Gpu_Array< float > gpu_data(data);
+    Gpu_Array< float > gpu_parameters(initial_parameters);
+    Gpu_Array< int > gpu_states(zeros);
+    Gpu_Array< float > gpu_chi_squares(float_zeros);
+    Gpu_Array< int > gpu_n_iterations(zeros);
+
+    BOOST_CHECK( gpufit_context_cuda_interface(
+        context, n_fits, n_points, gpu_data.data_, 0, GAUSS_1D,
+        tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+        gpu_parameters.data_, gpu_states.data_,
+        gpu_chi_squares.data_, gpu_n_iterations.data_, 0) == 0 );
+
+    BOOST_CHECK( gpu_parameters.read() == reference_parameters );
+    BOOST_CHECK( gpu_states.read() == reference_states );
+
+    // the fit of data in host memory uses the buffers of the fit context, the
+    // arrays of the previous caller are not cleared or overwritten
+    std::vector< float > shifted_data(data);
+    for (std::size_t index = 0; index < shifted_data.size(); index++)
+    {
+        shifted_data[index] += 1.f;
+    }
+
+    BOOST_CHECK( gpufit_context_fit(
+        context, n_fits, n_points, shifted_data.data(), 0, GAUSS_1D, initial_parameters.data(),
+        tolerance, max_n_iterations, parameters_to_fit.data(), LSE, 0, 0,
+        output_parameters.data(), output_states.data(),
+        output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+    BOOST_CHECK( gpu_data.read() == data );
+    BOOST_CHECK( gpu_parameters.read() == reference_parameters );
+    BOOST_CHECK( gpu_states.read() == reference_states );
+    BOOST_CHECK( gpu_chi_squares.read() == reference_chi_squares );
+    BOOST_CHECK( gpu_n_iterations.read() == reference_n_iterations );
+
+    // the offset of the data is fitted by the background
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK( std::abs( output_parameters[ fit_index * n_parameters + 3 ] - 2.f ) < 1e-2f );
+    }
+
+    BOOST_CHECK( gpufit_destroy_context(context) == 0 );
+}
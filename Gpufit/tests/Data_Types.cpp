@@ -0,0 +1,138 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 100 };
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+// integer valued 1D Gaussian peaks whose amplitudes and backgrounds increase
+// with the fit index, all values are below 256
+void generate_counts(std::vector< float > & values)
+{
+    values.resize(n_fits * n_points);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        float const scale = 30.f + float(fit_index % 20);
+        for (std::size_t point_index = 0; point_index < n_points; point_index++)
+        {
+            float const x = float(point_index);
+            values[fit_index * n_points + point_index]
+                = std::round(scale * (4.f * std::exp(-(x - 2.f) * (x - 2.f) / (2.f * 0.5f * 0.5f)) + 1.f));
+        }
+    }
+}
+
+template< typename Type >
+int fit_counts(void * context, std::vector< Type > const & data, std::vector< float > & output_parameters)
+{
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 150.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.8f;
+        initial_parameters[fit_index * n_parameters + 2] = 0.4f;
+        initial_parameters[fit_index * n_parameters + 3] = 40.f;
+    }
+
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    output_parameters.resize(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    return gpufit_context_fit(
+        context, n_fits, n_points, reinterpret_cast< float * >(const_cast< Type * >(data.data())), 0, GAUSS_1D,
+        initial_parameters.data(), 0.001f, 20, parameters_to_fit.data(), MLE, 0, 0,
+        output_parameters.data(), output_states.data(), output_chi_squares.data(), output_n_iterations.data());
+}
+
+// half precision representation of integers up to 2048, which are exact
+unsigned short integer_to_half(unsigned int const value)
+{
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    int exponent = 0;
+    while ((value >> (exponent + 1)) != 0)
+    {
+        exponent++;
+    }
+    unsigned int const mantissa = ((value << 10) >> exponent) & 0x3ff;
+
+    return static_cast< unsigned short >(((exponent + 15) << 10) | mantissa);
+}
+
+BOOST_AUTO_TEST_CASE( Data_Types )
+{
+    /*
+        Performs fits of integer valued data passed as float, uint16, half
+        precision and uint8 values.
+        - Checks that the data values are copied to the GPU in their data
+          type, hence the bytes copied are reduced by the size of the data
+          values.
+        - Checks that the results equal the results of the float data.
+        - Checks that invalid data type IDs are rejected.
+    */
+
+    std::vector< float > float_data;
+    generate_counts(float_data);
+
+    std::vector< unsigned short > uint16_data(float_data.size());
+    std::vector< unsigned short > half_data(float_data.size());
+    std::vector< unsigned char > uint8_data(float_data.size());
+    for (std::size_t index = 0; index < float_data.size(); index++)
+    {
+        uint16_data[index] = static_cast< unsigned short >(float_data[index]);
+        half_data[index] = integer_to_half(static_cast< unsigned int >(float_data[index]));
+        uint8_data[index] = static_cast< unsigned char >(float_data[index]);
+    }
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    std::vector< float > reference_parameters;
+    BOOST_CHECK( fit_counts( context, float_data, reference_parameters ) == 0 );
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    std::size_t const reference_bytes_to_gpu = profile.bytes_to_gpu;
+
+    // the amplitudes differ between the fits
+    BOOST_CHECK( reference_parameters[ 0 ] < reference_parameters[ 19 * n_parameters ] );
+
+    std::size_t const n_values = n_fits * n_points;
+    std::vector< float > output_parameters;
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DATA_TYPE, DATA_TYPE_UINT16 ) == 0 );
+    BOOST_CHECK( fit_counts( context, uint16_data, output_parameters ) == 0 );
+    BOOST_CHECK( output_parameters == reference_parameters );
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.bytes_to_gpu + n_values * 2 == reference_bytes_to_gpu );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DATA_TYPE, DATA_TYPE_HALF ) == 0 );
+    BOOST_CHECK( fit_counts( context, half_data, output_parameters ) == 0 );
+    BOOST_CHECK( output_parameters == reference_parameters );
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.bytes_to_gpu + n_values * 2 == reference_bytes_to_gpu );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DATA_TYPE, DATA_TYPE_UINT8 ) == 0 );
+    BOOST_CHECK( fit_counts( context, uint8_data, output_parameters ) == 0 );
+    BOOST_CHECK( output_parameters == reference_parameters );
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.bytes_to_gpu + n_values * 3 == reference_bytes_to_gpu );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DATA_TYPE, 4 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,91 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/model_functions.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+
+BOOST_AUTO_TEST_CASE( Dual_Numbers )
+{
+    /*
+        Calculates the derivatives of the model functions by automatic
+        differentiation.
+        - Checks the derivatives of arithmetic operations and math functions.
+        - Checks the value and the derivatives of GAUSS_2D_ROTATED against the
+          analytic derivatives.
+        - Checks the value and the derivatives of CAUCHY_2D_ELLIPTIC against
+          the analytic derivatives.
+    */
+
+    Dual< 2 > const a = Dual< 2 >::variable(0.5f, 0);
+    Dual< 2 > const b = Dual< 2 >::variable(2.f, 1);
+
+    Dual< 2 > const f = a * b / (1.f + a) - exp(a) * sin(b) + sqrt(b);
+
+    float const df_da = b.value / ((1.f + a.value) * (1.f + a.value)) - std::exp(a.value) * std::sin(b.value);
+    float const df_db = a.value / (1.f + a.value) - std::exp(a.value) * std::cos(b.value) + 0.5f / std::sqrt(b.value);
+
+    BOOST_CHECK( std::abs(f.derivatives[0] - df_da) < 1e-5f );
+    BOOST_CHECK( std::abs(f.derivatives[1] - df_db) < 1e-5f );
+
+    std::array< float, 2 > const coordinates{ { 3.f, 4.5f } };
+    float const x = coordinates[0];
+    float const y = coordinates[1];
+
+    float value = 0.f;
+    std::array< float, 7 > derivatives;
+
+    // GAUSS_2D_ROTATED
+    {
+        std::array< float, 7 > const p{ { 10.f, 3.5f, 4.f, 1.5f, 2.f, 1.f, 0.3f } };
+
+        calculate_dual< 7 >(Gauss2DRotated(), p.data(), x, y, &value, derivatives.data(), 1);
+
+        float const cos_angle = std::cos(p[6]);
+        float const sin_angle = std::sin(p[6]);
+        float const arga = (x - p[1]) * cos_angle - (y - p[2]) * sin_angle;
+        float const argb = (x - p[1]) * sin_angle + (y - p[2]) * cos_angle;
+        float const ex = std::exp(-0.5f * ((arga / p[3]) * (arga / p[3]) + (argb / p[4]) * (argb / p[4])));
+
+        std::array< float, 7 > const expected{ {
+            ex,
+            ((p[0] * cos_angle * arga) / (p[3] * p[3]) + (p[0] * sin_angle * argb) / (p[4] * p[4])) * ex,
+            ((-p[0] * sin_angle * arga) / (p[3] * p[3]) + (p[0] * cos_angle * argb) / (p[4] * p[4])) * ex,
+            p[0] * arga * arga / (p[3] * p[3] * p[3]) * ex,
+            p[0] * argb * argb / (p[4] * p[4] * p[4]) * ex,
+            1.f,
+            p[0] * arga * argb * (1.f / (p[3] * p[3]) - 1.f / (p[4] * p[4])) * ex } };
+
+        BOOST_CHECK( std::abs(value - (p[0] * ex + p[5])) < 1e-5f );
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            BOOST_CHECK( std::abs(derivatives[i] - expected[i]) < 1e-4f );
+        }
+    }
+
+    // CAUCHY_2D_ELLIPTIC
+    {
+        std::array< float, 6 > const p{ { 10.f, 3.5f, 4.f, 1.5f, 2.f, 1.f } };
+
+        calculate_dual< 6 >(Cauchy2DElliptic(), p.data(), x, y, &value, derivatives.data(), 1);
+
+        float const argx = ((p[1] - x) / p[3]) * ((p[1] - x) / p[3]) + 1.f;
+        float const argy = ((p[2] - y) / p[4]) * ((p[2] - y) / p[4]) + 1.f;
+
+        std::array< float, 6 > const expected{ {
+            1.f / (argx * argy),
+            -2.f * p[0] * (p[1] - x) / (p[3] * p[3] * argx * argx * argy),
+            -2.f * p[0] * (p[2] - y) / (p[4] * p[4] * argy * argy * argx),
+            2.f * p[0] * (p[1] - x) * (p[1] - x) / (p[3] * p[3] * p[3] * argx * argx * argy),
+            2.f * p[0] * (p[2] - y) * (p[2] - y) / (p[4] * p[4] * p[4] * argy * argy * argx),
+            1.f } };
+
+        BOOST_CHECK( std::abs(value - (p[0] / (argx * argy) + p[5])) < 1e-5f );
+        for (std::size_t i = 0; i < expected.size(); i++)
+        {
+            BOOST_CHECK( std::abs(derivatives[i] - expected[i]) < 1e-4f );
+        }
+    }
+}
@@ -0,0 +1,114 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+std::size_t const n_points{ 20 };
+
+std::array< float, 2 > const true_parameters{ { 1.f, 0.5f } };
+
+// fits a straight line to the data with the given estimator
+int fit_linear_1d(
+    std::vector< float > & data,
+    float * weights,
+    int const estimator_id,
+    std::array< float, 2 > & output_parameters,
+    int & output_state)
+{
+    std::array< float, 2 > initial_parameters{ { 0.5f, 0.4f } };
+    std::array< int, 2 > parameters_to_fit{ { 1, 1 } };
+
+    float output_chi_square = 0.f;
+    int output_n_iterations = 0;
+
+    return gpufit(
+        1, n_points, data.data(), weights, LINEAR_1D, initial_parameters.data(), 1e-6f, 100,
+        parameters_to_fit.data(), estimator_id, 0, 0, output_parameters.data(), &output_state,
+        &output_chi_square, &output_n_iterations);
+}
+
+BOOST_AUTO_TEST_CASE( Robust_Estimators )
+{
+    /*
+        Fits a straight line to data with three outliers.
+        - Checks that the LSE fit is biased by the outliers.
+        - Checks that the LSE_HUBER and LSE_CAUCHY fits are close to the true
+          parameters.
+    */
+
+    std::vector< float > data(n_points);
+    for (std::size_t i = 0; i < n_points; i++)
+    {
+        data[i] = true_parameters[0] + true_parameters[1] * float(i);
+    }
+    data[5] += 20.f;
+    data[12] += 20.f;
+    data[17] += 20.f;
+
+    std::array< float, 2 > output_parameters;
+    int output_state = -1;
+
+    BOOST_CHECK( fit_linear_1d(data, 0, LSE, output_parameters, output_state) == 0 );
+    BOOST_CHECK( std::abs(output_parameters[0] - true_parameters[0]) > 1.f );
+
+    BOOST_CHECK( fit_linear_1d(data, 0, LSE_HUBER, output_parameters, output_state) == 0 );
+    BOOST_CHECK( output_state == STATE_CONVERGED );
+    BOOST_CHECK( std::abs(output_parameters[0] - true_parameters[0]) < 0.15f );
+    BOOST_CHECK( std::abs(output_parameters[1] - true_parameters[1]) < 0.02f );
+
+    BOOST_CHECK( fit_linear_1d(data, 0, LSE_CAUCHY, output_parameters, output_state) == 0 );
+    BOOST_CHECK( output_state == STATE_CONVERGED );
+    BOOST_CHECK( std::abs(output_parameters[0] - true_parameters[0]) < 0.05f );
+    BOOST_CHECK( std::abs(output_parameters[1] - true_parameters[1]) < 0.01f );
+}
+
+BOOST_AUTO_TEST_CASE( MLE_sCMOS )
+{
+    /*
+        Fits straight lines by MLE and MLE_SCMOS.
+        - Checks that MLE_SCMOS fits data with negative values, whose readout
+          noise variances are passed in the weights, to the true parameters.
+        - Checks that MLE_SCMOS without weights equals MLE.
+        - Checks that an invalid estimator ID is reported.
+    */
+
+    std::array< float, 2 > const parameters{ { -2.f, 0.5f } };
+
+    std::vector< float > data(n_points);
+    for (std::size_t i = 0; i < n_points; i++)
+    {
+        data[i] = parameters[0] + parameters[1] * float(i);
+    }
+    std::vector< float > variances(n_points, 5.f);
+
+    std::array< float, 2 > output_parameters;
+    int output_state = -1;
+
+    BOOST_CHECK( fit_linear_1d(data, variances.data(), MLE_SCMOS, output_parameters, output_state) == 0 );
+    BOOST_CHECK( output_state == STATE_CONVERGED );
+    BOOST_CHECK( std::abs(output_parameters[0] - parameters[0]) < 1e-3f );
+    BOOST_CHECK( std::abs(output_parameters[1] - parameters[1]) < 1e-4f );
+
+    for (std::size_t i = 0; i < n_points; i++)
+    {
+        data[i] = true_parameters[0] + true_parameters[1] * float(i);
+    }
+
+    std::array< float, 2 > mle_parameters;
+    int mle_state = -1;
+
+    BOOST_CHECK( fit_linear_1d(data, 0, MLE, mle_parameters, mle_state) == 0 );
+    BOOST_CHECK( fit_linear_1d(data, 0, MLE_SCMOS, output_parameters, output_state) == 0 );
+    BOOST_CHECK( output_state == mle_state );
+    BOOST_CHECK( std::abs(output_parameters[0] - mle_parameters[0]) < 1e-6f );
+    BOOST_CHECK( std::abs(output_parameters[1] - mle_parameters[1]) < 1e-6f );
+
+    BOOST_CHECK( fit_linear_1d(data, 0, 5, output_parameters, output_state) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid estimator ID" );
+}
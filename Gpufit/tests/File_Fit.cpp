@@ -0,0 +1,228 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+std::size_t const n_fits{ 25 };
+std::size_t const n_points{ 20 };
+std::size_t const n_parameters{ 2 };
+std::size_t const header_size{ 8 };
+
+char const * const data_file{ "File_Fit_data.bin" };
+char const * const initial_parameters_file{ "File_Fit_initial_parameters.bin" };
+char const * const output_file{ "File_Fit_output.bin" };
+
+template< typename T >
+void write_file(char const * path, std::vector< T > const & values, std::size_t const offset)
+{
+    std::FILE * file = std::fopen(path, "wb");
+    BOOST_REQUIRE( file );
+    std::vector< char > const header(offset, 'h');
+    std::fwrite(header.data(), 1, header.size(), file);
+    std::fwrite(values.data(), sizeof(T), values.size(), file);
+    std::fclose(file);
+}
+
+std::vector< char > read_file(char const * path)
+{
+    std::vector< char > content;
+    std::FILE * file = std::fopen(path, "rb");
+    BOOST_REQUIRE( file );
+    char buffer[4096];
+    std::size_t n_read = 0;
+    while ((n_read = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.insert(content.end(), buffer, buffer + n_read);
+    }
+    std::fclose(file);
+    return content;
+}
+
+// checks that the records of the output file equal the results of the fits in
+// memory
+void check_output_file(
+    std::vector< float > const & output_parameters,
+    std::vector< int > const & output_states,
+    std::vector< float > const & output_chi_squares,
+    std::vector< int > const & output_n_iterations)
+{
+    std::size_t const record_size = (n_parameters + 3) * 4;
+
+    std::vector< char > const output = read_file(output_file);
+    BOOST_REQUIRE( output.size() == n_fits * record_size );
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        char const * record = output.data() + fit_index * record_size;
+
+        float parameters[n_parameters];
+        int state = -1;
+        float chi_square = 0.f;
+        int n_iterations = 0;
+        std::memcpy(parameters, record, sizeof(parameters));
+        std::memcpy(&state, record + sizeof(parameters), 4);
+        std::memcpy(&chi_square, record + sizeof(parameters) + 4, 4);
+        std::memcpy(&n_iterations, record + sizeof(parameters) + 8, 4);
+
+        for (std::size_t parameter_index = 0; parameter_index < n_parameters; parameter_index++)
+        {
+            BOOST_CHECK( std::abs( parameters[ parameter_index ] - output_parameters[ fit_index * n_parameters + parameter_index ] ) < 1e-5f );
+        }
+        BOOST_CHECK( state == output_states[ fit_index ] );
+        BOOST_CHECK( std::abs( chi_square - output_chi_squares[ fit_index ] ) < 1e-5f );
+        BOOST_CHECK( n_iterations == output_n_iterations[ fit_index ] );
+    }
+}
+
+int fit_file(
+    void * context,
+    std::size_t const data_offset,
+    std::size_t const n_fits_to_fit,
+    std::size_t const batch_size,
+    std::vector< float > * x = 0)
+{
+    int parameters_to_fit[n_parameters]{ 1, 1 };
+
+    return gpufit_context_fit_file(
+        context, data_file, data_offset, n_fits_to_fit, n_points, 0, LINEAR_1D, initial_parameters_file,
+        1e-6f, 20, parameters_to_fit, LSE,
+        x ? x->size() * sizeof(float) : 0,
+        x ? reinterpret_cast< char * >(x->data()) : 0,
+        output_file, batch_size);
+}
+
+BOOST_AUTO_TEST_CASE( File_Fit )
+{
+    /*
+        Fits straight lines to the data stored in a file after a header, in
+        batches of 7 fits.
+        - Checks that the output file contains the results of the fits in
+          memory.
+        - Checks that all fits of the file are fitted if n_fits is 0.
+        - Checks that invalid files, sizes and offsets are reported.
+    */
+
+    std::vector< float > data(n_fits * n_points);
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        std::size_t const fit_index = index / n_points;
+        float const x = float(index % n_points);
+        data[index] = float(fit_index) + 0.5f * x + (index % 2 ? 0.1f : -0.1f);
+    }
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 0.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.f;
+    }
+
+    write_file(data_file, data, header_size);
+    write_file(initial_parameters_file, initial_parameters, 0);
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    int parameters_to_fit[n_parameters]{ 1, 1 };
+    std::vector< float > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    BOOST_CHECK( gpufit_context_fit(
+        context, n_fits, n_points, data.data(), 0, LINEAR_1D, initial_parameters.data(), 1e-6f, 20,
+        parameters_to_fit, LSE, 0, 0, output_parameters.data(), output_states.data(),
+        output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+    for (std::size_t n_fits_to_fit : { n_fits, std::size_t(0) })
+    {
+        BOOST_CHECK( fit_file( context, header_size, n_fits_to_fit, 7 ) == 0 );
+
+        check_output_file(output_parameters, output_states, output_chi_squares, output_n_iterations);
+    }
+
+    // invalid arguments
+    BOOST_CHECK( fit_file( context, header_size, n_fits + 1, 7 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "data file too small" );
+
+    BOOST_CHECK( fit_file( context, header_size + 2, n_fits, 7 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid data offset" );
+
+    BOOST_CHECK( fit_file( context, header_size, n_fits, 0 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid batch size" );
+
+    std::remove(data_file);
+    BOOST_CHECK( fit_file( context, header_size, n_fits, 7 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == std::string( "cannot open file " ) + data_file );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+
+    std::remove(initial_parameters_file);
+    std::remove(output_file);
+}
+
+BOOST_AUTO_TEST_CASE( File_Fit_User_Info )
+{
+    /*
+        Fits straight lines to data stored in a file, with X values in the user
+        info which are different for each fit, in batches of 7 fits.
+        - Checks that each batch uses the X values of its fits, hence the
+          output file contains the results of the fits in memory, which find
+          the true parameters of each fit.
+    */
+
+    std::vector< float > data(n_fits * n_points);
+    std::vector< float > x(n_fits * n_points);
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        std::size_t const fit_index = index / n_points;
+        x[index] = float(index % n_points) * float(fit_index + 1);
+        data[index] = float(fit_index) + 0.5f * x[index];
+    }
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 0.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.f;
+    }
+
+    write_file(data_file, data, 0);
+    write_file(initial_parameters_file, initial_parameters, 0);
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    int parameters_to_fit[n_parameters]{ 1, 1 };
+    std::vector< float > output_parameters(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    BOOST_CHECK( gpufit_context_fit(
+        context, n_fits, n_points, data.data(), 0, LINEAR_1D, initial_parameters.data(), 1e-6f, 20,
+        parameters_to_fit, LSE, x.size() * sizeof(float), reinterpret_cast< char * >(x.data()),
+        output_parameters.data(), output_states.data(), output_chi_squares.data(), output_n_iterations.data()) == 0 );
+
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK( std::abs( output_parameters[ fit_index * n_parameters + 0 ] - float(fit_index) ) < 1e-3f );
+        BOOST_CHECK( std::abs( output_parameters[ fit_index * n_parameters + 1 ] - 0.5f ) < 1e-3f );
+    }
+
+    BOOST_CHECK( fit_file( context, 0, n_fits, 7, &x ) == 0 );
+    check_output_file(output_parameters, output_states, output_chi_squares, output_n_iterations);
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+
+    std::remove(data_file);
+    std::remove(initial_parameters_file);
+    std::remove(output_file);
+}
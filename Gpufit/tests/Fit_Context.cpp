@@ -0,0 +1,108 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+void generate_gauss_1d(std::vector< float > & values, std::size_t const n_points)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        values[index] = a * std::exp(-argx) + b;
+    }
+}
+
+int fit_gauss_1d(void * context, std::size_t const n_fits, std::vector< float > & output_parameters)
+{
+    std::size_t const n_points{ 5 };
+    std::size_t const n_parameters{ 4 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data, n_points);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 2.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.5f;
+        initial_parameters[fit_index * n_parameters + 2] = 0.3f;
+        initial_parameters[fit_index * n_parameters + 3] = 0.f;
+    }
+
+    float tolerance{ 0.001f };
+    int max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    output_parameters.resize(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    return gpufit_context_fit
+        (
+            context,
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_1D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Context )
+{
+    /*
+        Performs several fits of different sizes using the same fit context.
+        - Checks that the context is reused without errors.
+        - Checks that all results equal the results of the first fit.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( context != 0 );
+
+    std::vector< float > reference_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, 10, reference_parameters ) == 0 );
+
+    // more fits than before, the device memory has to grow
+    std::vector< float > output_parameters;
+    BOOST_CHECK( fit_gauss_1d( context, 1000, output_parameters ) == 0 );
+    for (std::size_t index = 0; index < output_parameters.size(); index++)
+    {
+        BOOST_CHECK( output_parameters[ index ] == reference_parameters[ index % 4 ] );
+    }
+
+    // less fits than before, the device memory is reused
+    BOOST_CHECK( fit_gauss_1d( context, 3, output_parameters ) == 0 );
+    for (std::size_t index = 0; index < output_parameters.size(); index++)
+    {
+        BOOST_CHECK( output_parameters[ index ] == reference_parameters[ index % 4 ] );
+    }
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+
+    // a null context is rejected
+    BOOST_CHECK( fit_gauss_1d( 0, 1, output_parameters ) == -1 );
+}
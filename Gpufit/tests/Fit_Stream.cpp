@@ -0,0 +1,227 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+void generate_gauss_1d(
+    std::size_t const n_fits,
+    std::vector< float > & data,
+    std::vector< float > & initial_parameters)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    data.resize(n_fits * n_points);
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        data[index] = a * std::exp(-argx) + b;
+    }
+
+    initial_parameters.resize(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 2.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.5f;
+        initial_parameters[fit_index * n_parameters + 2] = 0.3f;
+        initial_parameters[fit_index * n_parameters + 3] = 0.f;
+    }
+}
+
+std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+int create_stream(void * context, void ** stream, std::size_t const batch_size, std::size_t const capacity, double const max_latency)
+{
+    return gpufit_create_stream(
+        stream,
+        context,
+        n_points,
+        GAUSS_1D,
+        LSE,
+        0.001f,
+        10,
+        parameters_to_fit.data(),
+        0,
+        0,
+        0,
+        batch_size,
+        capacity,
+        max_latency);
+}
+
+int push(void * stream, std::size_t const n_fits)
+{
+    std::vector< float > data;
+    std::vector< float > initial_parameters;
+    generate_gauss_1d(n_fits, data, initial_parameters);
+
+    return gpufit_stream_push(stream, n_fits, data.data(), 0, initial_parameters.data());
+}
+
+void fit_reference(void * context, std::vector< float > & reference_parameters)
+{
+    std::vector< float > data;
+    std::vector< float > initial_parameters;
+    generate_gauss_1d(1, data, initial_parameters);
+
+    reference_parameters.resize(n_parameters);
+    int state;
+    float chi_square;
+    int n_iterations;
+
+    BOOST_CHECK( gpufit_context_fit(
+        context, 1, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(), 0.001f, 10,
+        parameters_to_fit.data(), LSE, 0, 0, reference_parameters.data(), &state, &chi_square, &n_iterations) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Stream_Poll )
+{
+    /*
+        Pushes fits to a fit stream and reads the results by polling.
+        - Checks that all pushed fits are fitted, also across the end of the
+          ring buffer.
+        - Checks that pushing more fits than there are free slots fails.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::vector< float > reference_parameters;
+    fit_reference( context, reference_parameters );
+
+    void * stream = 0;
+    BOOST_CHECK( create_stream( context, &stream, 4, 16, 1000. ) == 0 );
+
+    std::vector< float > output_parameters(16 * n_parameters);
+    std::vector< int > output_states(16);
+    std::size_t n_fits = 0;
+
+    for (int round = 0; round < 3; round++)
+    {
+        BOOST_CHECK( push( stream, 3 ) == 0 );
+        BOOST_CHECK( push( stream, 7 ) == 0 );
+        BOOST_CHECK( gpufit_stream_flush( stream ) == 0 );
+
+        BOOST_CHECK( gpufit_stream_poll( stream, 16, output_parameters.data(), output_states.data(), 0, 0, &n_fits ) == 0 );
+        BOOST_CHECK( n_fits == 10 );
+        for (std::size_t index = 0; index < n_fits * n_parameters; index++)
+        {
+            BOOST_CHECK( output_parameters[ index ] == reference_parameters[ index % n_parameters ] );
+        }
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            BOOST_CHECK( output_states[ fit_index ] == STATE_CONVERGED );
+        }
+    }
+
+    BOOST_CHECK( gpufit_stream_poll( stream, 16, output_parameters.data(), 0, 0, 0, &n_fits ) == 0 );
+    BOOST_CHECK( n_fits == 0 );
+
+    // the results of these fits are not read
+    BOOST_CHECK( push( stream, 10 ) == 0 );
+    BOOST_CHECK( push( stream, 7 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_stream( stream ) == 0 );
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Stream_Latency )
+{
+    /*
+        Pushes less fits than the batch size.
+        - Checks that the fits are launched after the maximum latency.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    void * stream = 0;
+    BOOST_CHECK( create_stream( context, &stream, 100, 100, 10. ) == 0 );
+
+    BOOST_CHECK( push( stream, 2 ) == 0 );
+
+    std::vector< float > output_parameters(2 * n_parameters);
+    std::size_t n_polled = 0;
+    for (int i = 0; i < 1000 && n_polled < 2; i++)
+    {
+        std::size_t n_fits = 0;
+        BOOST_CHECK( gpufit_stream_poll( stream, 2 - n_polled, output_parameters.data() + n_polled * n_parameters, 0, 0, 0, &n_fits ) == 0 );
+        n_polled += n_fits;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_CHECK( n_polled == 2 );
+
+    BOOST_CHECK( gpufit_destroy_stream( stream ) == 0 );
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+struct StreamResults
+{
+    std::size_t n_fits;
+    bool in_order;
+    bool converged;
+};
+
+void collect_results(gpufit_stream_results const * const results, void * const user_data)
+{
+    StreamResults & stream_results = * static_cast< StreamResults * >(user_data);
+
+    stream_results.in_order = stream_results.in_order && results->first_fit_index == stream_results.n_fits;
+    for (std::size_t fit_index = 0; fit_index < results->n_fits; fit_index++)
+    {
+        stream_results.converged = stream_results.converged && results->states[fit_index] == STATE_CONVERGED;
+    }
+    stream_results.n_fits += results->n_fits;
+}
+
+BOOST_AUTO_TEST_CASE( Fit_Stream_Callback )
+{
+    /*
+        Pushes more fits than the capacity of a fit stream with a callback.
+        - Checks that the callback receives all results in order.
+        - Checks that invalid streams are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    void * stream = 0;
+    BOOST_CHECK( create_stream( context, &stream, 8, 16, 1. ) == 0 );
+
+    StreamResults results = { 0, true, true };
+    BOOST_CHECK( gpufit_stream_set_callback( stream, collect_results, &results ) == 0 );
+
+    for (int i = 0; i < 10; i++)
+    {
+        BOOST_CHECK( push( stream, 37 ) == 0 );
+    }
+    BOOST_CHECK( gpufit_stream_flush( stream ) == 0 );
+
+    BOOST_CHECK( results.n_fits == 370 );
+    BOOST_CHECK( results.in_order );
+    BOOST_CHECK( results.converged );
+
+    std::size_t n_fits = 0;
+    BOOST_CHECK( gpufit_stream_poll( stream, 1, 0, 0, 0, 0, &n_fits ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_stream( stream ) == 0 );
+
+    BOOST_CHECK( create_stream( context, &stream, 0, 16, 1. ) == -1 );
+    BOOST_CHECK( create_stream( context, &stream, 32, 16, 1. ) == -1 );
+    BOOST_CHECK( create_stream( 0, &stream, 8, 16, 1. ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,86 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 100 };
+
+BOOST_AUTO_TEST_CASE( Fused_Kernel )
+{
+    /*
+        Performs fits of 5 points with the default sequence of kernels and
+        with the fused kernel, and fits of 300 points with the fused kernel
+        enabled.
+        - Checks that the fused kernel calculates all iterations in the model
+          phase, without the kernels of the gradients, hessians and solver.
+        - Checks that the results of the fused kernel agree with the results
+          of the default sequence of kernels.
+        - Checks that fits of more than 256 points use the default sequence
+          of kernels.
+        - Checks that fits with PRECISION_DOUBLE use the default sequence of
+          kernels.
+        - Checks that invalid values are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    // peaks whose centers move with the fit index
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center_step = 0.01f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations > 0 );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_GRADIENTS ] > 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_HESSIANS ] > 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_SOLVER ] > 0. );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, 1 ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations == 0 );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_MODEL ] > 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_CHI_SQUARES ] == 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_GRADIENTS ] == 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_HESSIANS ] == 0. );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_SOLVER ] == 0. );
+
+    for (std::size_t index = 0; index < peaks.parameters.size(); index++)
+    {
+        BOOST_CHECK( std::abs( peaks.parameters[ index ] - reference_parameters[ index ] ) < 1e-4f );
+    }
+
+    // too many points for the shared memory of the fused kernel
+    peaks.n_points = 300;
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations > 0 );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_GRADIENTS ] > 0. );
+
+    // the fused kernel does not sum in the types of PRECISION_DOUBLE
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PRECISION, PRECISION_DOUBLE ) == 0 );
+    peaks.n_points = 5;
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_iterations > 0 );
+    BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_GRADIENTS ] > 0. );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
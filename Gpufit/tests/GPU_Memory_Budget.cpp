@@ -0,0 +1,74 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_AUTO_TEST_CASE( GPU_Memory_Budget )
+{
+    /*
+        Performs fits with a GPU memory budget of 20 kilobytes and with half of
+        the free GPU memory.
+        - Checks that the small budget splits the fits into several chunks,
+          whose GPU buffers do not exceed the budget.
+        - Checks that the fits are not split with half of the free memory.
+        - Checks that the results of each fit are independent of the budget.
+        - Checks that budgets too small for the buffers of a chunk or of a
+          single fit are reported.
+        - Checks that invalid budgets are rejected.
+    */
+
+    std::size_t const n_fits{ 1000 };
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    // peaks whose centers move with the fit index
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center_step = 0.001f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+
+    gpufit_profile profile;
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 20000. ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    BOOST_CHECK( peaks.parameters == reference_parameters );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks > 1 );
+    BOOST_CHECK( profile.gpu_memory <= 20000 );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 0.5 ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    BOOST_CHECK( peaks.parameters == reference_parameters );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks == 1 );
+    BOOST_CHECK( profile.gpu_memory > 20000 );
+
+    // less than the buffers independent of the number of fits
+    peaks.n_fits = 10;
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 1000. ) == 0 );
+    BOOST_CHECK( peaks.fit( context ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "maximum user info size exceeded or GPU memory budget too small" );
+
+    // less than these buffers and the buffers of a single fit
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 7800. ) == 0 );
+    BOOST_CHECK( peaks.fit( context ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "not enough free GPU memory available" );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, 0. ) == -1 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, -1. ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -85,3 +85,67 @@ BOOST_AUTO_TEST_CASE( Gauss_Fit_1D )
     BOOST_CHECK( std::fabsf(output_parameters[ 2 ] - true_parameters[ 2 ] ) < 1e-6f );
     BOOST_CHECK( std::fabsf(output_parameters[ 3 ] - true_parameters[ 3 ] ) < 1e-6f );
 }
+
+BOOST_AUTO_TEST_CASE( Gauss_Fit_1D_Many_Points )
+{
+	/*
+		Performs a single fit using the GAUSS_1D model with more data points
+		than threads per fit, which are calculated in loops over the data
+		points.
+		- Doesn't use user_info or weights.
+		- No noise is added.
+		- Checks fitted parameters equalling the true parameters.
+	*/
+
+    std::size_t const n_fits{ 1 } ;
+    std::size_t const n_points{ 2048 } ;
+
+    std::array< float, 4 > const true_parameters{ { 4.f, 1000.f, 200.f, 1.f } };
+
+    std::array< float, n_points > data{};
+    generate_gauss_1d( data, true_parameters );
+
+    std::array< float, 4 > initial_parameters{ { 3.f, 950.f, 150.f, 0.5f } };
+
+    float tolerance{ 1e-6f };
+
+    int max_n_iterations{ 20 };
+
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    std::array< float, 4 > output_parameters;
+    int output_states;
+    float output_chi_square;
+    int output_n_iterations;
+
+    int const status
+            = gpufit
+            (
+                n_fits,
+                n_points,
+                data.data(),
+                0,
+                GAUSS_1D,
+                initial_parameters.data(),
+                tolerance,
+                max_n_iterations,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                output_parameters.data(),
+                &output_states,
+                &output_chi_square,
+                &output_n_iterations
+            ) ;
+
+    BOOST_CHECK( status == 0 ) ;
+    BOOST_CHECK( output_states == 0 );
+    BOOST_CHECK( output_chi_square < 1e-4f );
+    BOOST_CHECK( output_n_iterations <= max_n_iterations );
+
+    BOOST_CHECK( std::fabsf(output_parameters[ 0 ] - true_parameters[ 0 ] ) < 1e-3f );
+    BOOST_CHECK( std::fabsf(output_parameters[ 1 ] - true_parameters[ 1 ] ) < 1e-2f );
+    BOOST_CHECK( std::fabsf(output_parameters[ 2 ] - true_parameters[ 2 ] ) < 1e-2f );
+    BOOST_CHECK( std::fabsf(output_parameters[ 3 ] - true_parameters[ 3 ] ) < 1e-3f );
+}
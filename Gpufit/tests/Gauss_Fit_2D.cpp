@@ -94,3 +94,53 @@ BOOST_AUTO_TEST_CASE( Gauss_Fit_2D )
 
     BOOST_CHECK( status_with_weights == 0 ) ;
 }
+
+BOOST_AUTO_TEST_CASE( Gauss_Fit_2D_Estimated_Initial_Parameters )
+{
+    /*
+        Performs a fit without initial parameters.
+        - Checks that the initial parameters are estimated from the data and
+          the fit converges to the true parameters.
+    */
+
+    std::size_t const n_fits{ 1 } ;
+    std::size_t const n_points{ 25 } ;
+    std::array< float, n_points > data{};
+    generate_gauss_2d(data);
+    std::array< float, 5 > const true_parameters{ { 4.f, 2.f, 2.f, 0.5f, 1.f } };
+    float tolerance{ 0.001f };
+    int max_n_iterations{ 10 };
+    std::array< int, 5 > parameters_to_fit{ { 1, 1, 1, 1, 1 } };
+    std::array< float, 5 > output_parameters;
+    int output_states;
+    float output_chi_square;
+    int output_n_iterations;
+
+    int const status
+            = gpufit
+            (
+                n_fits,
+                n_points,
+                data.data(),
+                0,
+                GAUSS_2D,
+                0,
+                tolerance,
+                max_n_iterations,
+                parameters_to_fit.data(),
+                LSE,
+                0,
+                0,
+                output_parameters.data(),
+                &output_states,
+                &output_chi_square,
+                &output_n_iterations
+            ) ;
+
+    BOOST_CHECK( status == 0 ) ;
+    BOOST_CHECK( output_states == STATE_CONVERGED ) ;
+    for (std::size_t i = 0; i < true_parameters.size(); i++)
+    {
+        BOOST_CHECK( std::abs( output_parameters[ i ] - true_parameters[ i ] ) < 1e-3f ) ;
+    }
+}
@@ -0,0 +1,97 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+char const * const parabola_source =
+    "__device__ void calculate_parabola(float const * parameters, int const n_fits, int const n_points,\n"
+    "    float * value, float * derivative, int const point_index, int const fit_index, int const chunk_index,\n"
+    "    char * user_info, std::size_t const user_info_size, Coordinates const & coordinates)\n"
+    "{\n"
+    "    float const x = get_x_coordinate(coordinates, n_points, point_index, fit_index);\n"
+    "    value[point_index] = parameters[0] + parameters[1] * x + parameters[2] * x * x;\n"
+    "    derivative[0] = 1.f;\n"
+    "    derivative[1] = x;\n"
+    "    derivative[2] = x * x;\n"
+    "}\n";
+
+#ifdef USE_NVRTC
+
+BOOST_AUTO_TEST_CASE( Jit_Model )
+{
+    /*
+        Registers a parabola model and fits it.
+        - Checks that registering the same model again returns its model ID.
+        - Checks that the fitted parameters equal the true parameters.
+        - Checks that errors in the model source are reported.
+    */
+
+    int model_id = -1;
+    BOOST_CHECK( gpufit_register_model( &model_id, parabola_source, "calculate_parabola", 3 ) == 0 );
+    BOOST_CHECK( model_id >= FIRST_JIT_MODEL );
+
+    int same_model_id = -1;
+    BOOST_CHECK( gpufit_register_model( &same_model_id, parabola_source, "calculate_parabola", 3 ) == 0 );
+    BOOST_CHECK( same_model_id == model_id );
+
+    std::size_t const n_fits{ 10 };
+    std::size_t const n_points{ 11 };
+    std::array< float, 3 > const true_parameters{ { 1.f, -0.5f, 0.25f } };
+
+    std::vector< float > data(n_fits * n_points);
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        float const x = float(index % n_points);
+        data[index] = true_parameters[0] + true_parameters[1] * x + true_parameters[2] * x * x;
+    }
+
+    std::vector< float > initial_parameters(n_fits * 3, 0.f);
+    std::array< int, 3 > parameters_to_fit{ { 1, 1, 1 } };
+
+    std::vector< float > output_parameters(n_fits * 3);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int const status = gpufit(
+        n_fits, n_points, data.data(), 0, model_id, initial_parameters.data(), 1e-6f, 20, parameters_to_fit.data(),
+        LSE, 0, 0, output_parameters.data(), output_states.data(), output_chi_squares.data(),
+        output_n_iterations.data());
+
+    BOOST_CHECK( status == 0 );
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK( output_states[fit_index] == STATE_CONVERGED );
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            BOOST_CHECK( std::abs(output_parameters[fit_index * 3 + i] - true_parameters[i]) < 1e-3f );
+        }
+    }
+
+    int invalid_model_id = -1;
+    BOOST_CHECK( gpufit_register_model( &invalid_model_id, "__device__ void f(", "f", 3 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ).find( "model compilation failed" ) == 0 );
+    BOOST_CHECK( gpufit_register_model( &invalid_model_id, parabola_source, "calculate parabola", 3 ) == -1 );
+    BOOST_CHECK( gpufit_register_model( &invalid_model_id, parabola_source, "calculate_parabola", 0 ) == -1 );
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE( Jit_Model )
+{
+    /*
+        Checks that registering a model fails without NVRTC.
+    */
+
+    int model_id = -1;
+    BOOST_CHECK( gpufit_register_model( &model_id, parabola_source, "calculate_parabola", 3 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "JIT models not available, build with USE_NVRTC" );
+}
+
+#endif
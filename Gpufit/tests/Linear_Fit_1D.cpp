@@ -5,6 +5,8 @@
 #include <boost/test/included/unit_test.hpp>
 
 #include <array>
+#include <cmath>
+#include <vector>
 
 BOOST_AUTO_TEST_CASE( Linear_Fit_1D )
 {
@@ -99,3 +101,89 @@ BOOST_AUTO_TEST_CASE( Linear_Fit_1D )
 	BOOST_CHECK(std::fabsf(output_parameters[1] - true_parameters[1]) < 1e-4f);
 
 }
+
+BOOST_AUTO_TEST_CASE( Linear_Fit_1D_Direct )
+{
+	/*
+		Performs least squares fits of lines with and without the direct
+		linear fit (OPTION_DIRECT_LINEAR_FIT).
+		- Uses the X values given by the data point indices.
+		- Uses non-trivial weights.
+		- Checks that the direct fits take a single iteration and find the
+		  true parameters, like the LM iterations.
+		- Checks that a fixed parameter keeps its initial value.
+	*/
+
+	std::size_t const n_fits{ 100 };
+	std::size_t const n_points{ 20 };
+
+	std::vector< float > data(n_fits * n_points);
+	std::vector< float > weights(n_fits * n_points);
+	std::vector< float > true_parameters(n_fits * 2);
+	for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+	{
+		true_parameters[fit_index * 2 + 0] = 10.f - 0.1f * fit_index;
+		true_parameters[fit_index * 2 + 1] = 0.05f * fit_index - 2.f;
+
+		for (std::size_t point_index = 0; point_index < n_points; point_index++)
+		{
+			std::size_t const index = fit_index * n_points + point_index;
+			data[index] = true_parameters[fit_index * 2 + 0] + true_parameters[fit_index * 2 + 1] * point_index;
+			weights[index] = 1.f + 0.1f * point_index;
+		}
+	}
+
+	std::vector< float > initial_parameters(n_fits * 2, 0.f);
+
+	std::array< int, 2 > parameters_to_fit{ { 1, 1 } };
+
+	std::vector< float > output_parameters(n_fits * 2);
+	std::vector< int > output_states(n_fits);
+	std::vector< float > output_chi_squares(n_fits);
+	std::vector< int > output_n_iterations(n_fits);
+
+	void * context = 0;
+	BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+	for (int direct = 0; direct <= 1; direct++)
+	{
+		BOOST_CHECK( gpufit_context_set_option( context, OPTION_DIRECT_LINEAR_FIT, direct ) == 0 );
+
+		int const status = gpufit_context_fit(
+			context, n_fits, n_points, data.data(), weights.data(), LINEAR_1D, initial_parameters.data(), 1e-6f, 100,
+			parameters_to_fit.data(), LSE, 0, 0, output_parameters.data(), output_states.data(),
+			output_chi_squares.data(), output_n_iterations.data());
+
+		BOOST_CHECK( status == 0 );
+		for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+		{
+			BOOST_CHECK( output_states[fit_index] == STATE_CONVERGED );
+			BOOST_CHECK( !direct || output_n_iterations[fit_index] == 1 );
+			BOOST_CHECK( std::abs(output_parameters[fit_index * 2 + 0] - true_parameters[fit_index * 2 + 0]) < 1e-3f );
+			BOOST_CHECK( std::abs(output_parameters[fit_index * 2 + 1] - true_parameters[fit_index * 2 + 1]) < 1e-4f );
+			BOOST_CHECK( output_chi_squares[fit_index] < 1e-4f );
+		}
+	}
+
+	// fixed offset, the slope is fitted through the initial offset
+	parameters_to_fit[0] = 0;
+	for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+	{
+		initial_parameters[fit_index * 2 + 0] = true_parameters[fit_index * 2 + 0];
+	}
+
+	int const status = gpufit_context_fit(
+		context, n_fits, n_points, data.data(), weights.data(), LINEAR_1D, initial_parameters.data(), 1e-6f, 100,
+		parameters_to_fit.data(), LSE, 0, 0, output_parameters.data(), output_states.data(),
+		output_chi_squares.data(), output_n_iterations.data());
+
+	BOOST_CHECK( status == 0 );
+	for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+	{
+		BOOST_CHECK( output_n_iterations[fit_index] == 1 );
+		BOOST_CHECK( output_parameters[fit_index * 2 + 0] == true_parameters[fit_index * 2 + 0] );
+		BOOST_CHECK( std::abs(output_parameters[fit_index * 2 + 1] - true_parameters[fit_index * 2 + 1]) < 1e-4f );
+	}
+
+	BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
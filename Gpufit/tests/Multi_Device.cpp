@@ -0,0 +1,67 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cuda_runtime.h>
+
+#include <vector>
+
+std::size_t const n_fits{ 1001 };
+
+BOOST_AUTO_TEST_CASE( Multi_Device )
+{
+    /*
+        Performs fits distributed to all visible CUDA devices, and fits on each
+        explicitly selected device.
+        - Checks that each device fits at least one chunk.
+        - Checks that the results of each fit equal its results on a single
+          device, hence the parts of the devices are returned in order.
+        - Checks that invalid device IDs are rejected.
+    */
+
+    int n_devices = 0;
+    BOOST_REQUIRE( cudaGetDeviceCount( &n_devices ) == cudaSuccess );
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    // peaks whose centers move with the fit index, hence each fit has its own
+    // results, which are found at the position of the fit only
+    GaussPeaks peaks(n_fits, 5);
+    peaks.center_step = 0.001f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_N_STREAMS, 2 ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_MULTI_DEVICE, 1 ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    BOOST_CHECK( peaks.parameters == reference_parameters );
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks >= std::size_t(2 * n_devices) );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_MULTI_DEVICE, 0 ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_N_STREAMS, 1 ) == 0 );
+
+    for (int device = 0; device < n_devices; device++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_DEVICE, device ) == 0 );
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+        BOOST_CHECK( peaks.parameters == reference_parameters );
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DEVICE, -1 ) == -1 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DEVICE, n_devices ) == -1 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DEVICE, 0.5 ) == -1 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_MULTI_DEVICE, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
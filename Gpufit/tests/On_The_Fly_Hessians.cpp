@@ -0,0 +1,65 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 100 };
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+BOOST_AUTO_TEST_CASE( On_The_Fly_Hessians )
+{
+    /*
+        Performs fits accumulating the hessians while calculating the model
+        values, without storing the model derivatives in GPU memory.
+        - Checks that the GPU memory of the fits is reduced by the buffers of
+          the model values and derivatives.
+        - Checks that the results agree with the results of the default
+          sequence of kernels.
+        - Checks that invalid values are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+
+    // peaks whose centers move with the fit index
+    GaussPeaks peaks(n_fits, n_points);
+    peaks.center_step = 0.01f;
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+    std::vector< float > const reference_parameters = peaks.parameters;
+    std::vector< int > const reference_states = peaks.states;
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks == 1 );
+    std::size_t const reference_gpu_memory = profile.gpu_memory;
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_ON_THE_FLY_HESSIANS, 1 ) == 0 );
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks == 1 );
+
+    // one model value and n_parameters derivatives per data point
+    std::size_t const derivatives_memory = n_fits * n_points * (n_parameters + 1) * sizeof(float);
+    BOOST_CHECK( profile.gpu_memory + derivatives_memory == reference_gpu_memory );
+
+    BOOST_CHECK( peaks.states == reference_states );
+    for (std::size_t index = 0; index < peaks.parameters.size(); index++)
+    {
+        BOOST_CHECK( std::abs( peaks.parameters[ index ] - reference_parameters[ index ] ) < 1e-5f );
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_ON_THE_FLY_HESSIANS, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,151 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 1000 };
+std::size_t const n_points{ 10 };
+std::size_t const n_parameters{ 2 };
+
+std::array< float, 2 > const true_parameters{ { 1.f, 0.5f } };
+
+// fits the data of n_fits straight lines with the given number of streams
+int fit_linear_1d(
+    int const n_streams,
+    float * data,
+    float * initial_parameters,
+    float * output_parameters,
+    int * output_states,
+    float * output_chi_squares,
+    int * output_n_iterations)
+{
+    for (std::size_t index = 0; index < n_fits * n_points; index++)
+    {
+        float const x = float(index % n_points);
+        data[index] = true_parameters[0] + true_parameters[1] * x;
+    }
+
+    for (std::size_t index = 0; index < n_fits * n_parameters; index++)
+    {
+        initial_parameters[index] = 0.f;
+    }
+
+    std::array< int, 2 > parameters_to_fit{ { 1, 1 } };
+
+    void * context = 0;
+    gpufit_create_context(&context);
+    gpufit_context_set_option(context, OPTION_N_STREAMS, n_streams);
+
+    int const status = gpufit_context_fit(
+        context, n_fits, n_points, data, 0, LINEAR_1D, initial_parameters, 1e-6f, 20, parameters_to_fit.data(),
+        LSE, 0, 0, output_parameters, output_states, output_chi_squares, output_n_iterations);
+
+    gpufit_destroy_context(context);
+
+    return status;
+}
+
+void check_results(float const * output_parameters, int const * output_states)
+{
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK( output_states[fit_index] == STATE_CONVERGED );
+        for (std::size_t i = 0; i < n_parameters; i++)
+        {
+            BOOST_CHECK( std::abs(output_parameters[fit_index * n_parameters + i] - true_parameters[i]) < 1e-4f );
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( Page_Locked_Memory )
+{
+    /*
+        Performs fits whose input and output arrays are in page-locked memory,
+        with one and with several streams.
+        - Checks that the memory allocated by gpufit_alloc_host is fitted.
+        - Checks that memory registered by gpufit_register_host_buffer is
+          fitted.
+        - Checks that registering a buffer twice and unregistering memory
+          which is not registered fails.
+    */
+
+    // allocated page-locked memory
+    {
+        void * data = 0;
+        void * initial_parameters = 0;
+        void * output_parameters = 0;
+        void * output_states = 0;
+        void * output_chi_squares = 0;
+        void * output_n_iterations = 0;
+
+        BOOST_CHECK( gpufit_alloc_host(&data, n_fits * n_points * sizeof(float)) == 0 );
+        BOOST_CHECK( gpufit_alloc_host(&initial_parameters, n_fits * n_parameters * sizeof(float)) == 0 );
+        BOOST_CHECK( gpufit_alloc_host(&output_parameters, n_fits * n_parameters * sizeof(float)) == 0 );
+        BOOST_CHECK( gpufit_alloc_host(&output_states, n_fits * sizeof(int)) == 0 );
+        BOOST_CHECK( gpufit_alloc_host(&output_chi_squares, n_fits * sizeof(float)) == 0 );
+        BOOST_CHECK( gpufit_alloc_host(&output_n_iterations, n_fits * sizeof(int)) == 0 );
+
+        for (int n_streams = 1; n_streams <= 4; n_streams *= 2)
+        {
+            int const status = fit_linear_1d(
+                n_streams,
+                static_cast< float * >(data),
+                static_cast< float * >(initial_parameters),
+                static_cast< float * >(output_parameters),
+                static_cast< int * >(output_states),
+                static_cast< float * >(output_chi_squares),
+                static_cast< int * >(output_n_iterations));
+
+            BOOST_CHECK( status == 0 );
+            check_results(static_cast< float * >(output_parameters), static_cast< int * >(output_states));
+        }
+
+        BOOST_CHECK( gpufit_free_host(data) == 0 );
+        BOOST_CHECK( gpufit_free_host(initial_parameters) == 0 );
+        BOOST_CHECK( gpufit_free_host(output_parameters) == 0 );
+        BOOST_CHECK( gpufit_free_host(output_states) == 0 );
+        BOOST_CHECK( gpufit_free_host(output_chi_squares) == 0 );
+        BOOST_CHECK( gpufit_free_host(output_n_iterations) == 0 );
+    }
+
+    BOOST_CHECK( gpufit_alloc_host(0, 1) == -1 );
+
+    // registered memory of the caller, a single buffer because memory pages
+    // cannot be registered twice
+    {
+        std::vector< float > buffer(n_fits * (n_points + 2 * n_parameters + 3));
+        std::size_t const size = buffer.size() * sizeof(float);
+
+        float * const data = buffer.data();
+        float * const initial_parameters = data + n_fits * n_points;
+        float * const output_parameters = initial_parameters + n_fits * n_parameters;
+        float * const output_chi_squares = output_parameters + n_fits * n_parameters;
+        int * const output_states = reinterpret_cast< int * >(output_chi_squares + n_fits);
+        int * const output_n_iterations = output_states + n_fits;
+
+        BOOST_CHECK( gpufit_register_host_buffer(buffer.data(), size) == 0 );
+        BOOST_CHECK( gpufit_register_host_buffer(buffer.data(), size) == -1 );
+
+        int const status = fit_linear_1d(
+            2,
+            data,
+            initial_parameters,
+            output_parameters,
+            output_states,
+            output_chi_squares,
+            output_n_iterations);
+
+        BOOST_CHECK( status == 0 );
+        check_results(output_parameters, output_states);
+
+        BOOST_CHECK( gpufit_unregister_host_buffer(buffer.data()) == 0 );
+        BOOST_CHECK( gpufit_unregister_host_buffer(buffer.data()) == -1 );
+    }
+
+    BOOST_CHECK( gpufit_register_host_buffer(0, 1) == -1 );
+}
@@ -0,0 +1,108 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <vector>
+
+std::size_t const n_points{ 16385 };
+std::size_t const n_parameters{ 2 };
+
+// The data values of the line fit are 8192 at the first point and +1 or -1 at
+// all other points, balanced such that the gradient of the chi-square is zero
+// at the initial parameters (0, 0), which are therefore not changed. The
+// chi-square value is 8192^2 + 16384 = 67125248. Each of the 256 threads of
+// the fit sums up every 256th point, the first thread adds 64 squares of 1 to
+// 8192^2, which are below half of the float precision of 8.
+void generate_data(std::vector< float > & data, std::vector< float > & x)
+{
+    data.resize(n_points);
+    x.resize(n_points);
+
+    data[0] = 8192.f;
+    x[0] = 0.f;
+
+    for (std::size_t index = 0; index < n_points - 1; index++)
+    {
+        std::size_t const half = (n_points - 1) / 2;
+
+        x[index + 1] = index % 2 ? -1.f : 1.f;
+
+        if (index < half)
+        {
+            data[index + 1] = -1.f;
+        }
+        else
+        {
+            data[index + 1] = ((index - half) / 2) % 2 ? -1.f : 1.f;
+        }
+    }
+}
+
+int fit_line(void * context, std::vector< float > & data, std::vector< float > & x, float & output_chi_square, std::array< float, n_parameters > & output_parameters)
+{
+    std::array< float, n_parameters > initial_parameters{ { 0.f, 0.f } };
+    std::array< int, n_parameters > parameters_to_fit{ { 1, 1 } };
+    int output_state = -1;
+    int output_n_iterations = 0;
+
+    int const status = gpufit_context_fit(
+        context, 1, n_points, data.data(), 0, LINEAR_1D, initial_parameters.data(), 1e-6f, 10,
+        parameters_to_fit.data(), LSE, x.size() * sizeof(float), reinterpret_cast< char * >(x.data()),
+        output_parameters.data(), &output_state, &output_chi_square, &output_n_iterations);
+
+    BOOST_CHECK( output_state == STATE_CONVERGED );
+
+    return status;
+}
+
+BOOST_AUTO_TEST_CASE( Precision )
+{
+    /*
+        Performs a fit whose chi-square value is a sum of one large and many
+        small values, with each precision mode, iterated and by the direct
+        linear fit.
+        - Checks that the double and compensated sums find the exact
+          chi-square value.
+        - Checks that the float sums of the float and mixed modes lose the
+          small values added to the large value.
+        - Checks that invalid precision IDs are rejected.
+    */
+
+    std::vector< float > data;
+    std::vector< float > x;
+    generate_data(data, x);
+
+    float const exact_chi_square = 67125248.f;
+    float const float_chi_square = exact_chi_square - 64.f;
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::array< int, 4 > const precision_ids{ { PRECISION_FLOAT, PRECISION_MIXED, PRECISION_COMPENSATED, PRECISION_DOUBLE } };
+    std::array< float, 4 > const chi_squares{ { float_chi_square, float_chi_square, exact_chi_square, exact_chi_square } };
+
+    for (int direct_linear_fit = 0; direct_linear_fit < 2; direct_linear_fit++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_DIRECT_LINEAR_FIT, direct_linear_fit ) == 0 );
+
+        for (std::size_t precision_index = 0; precision_index < precision_ids.size(); precision_index++)
+        {
+            BOOST_CHECK( gpufit_context_set_option( context, OPTION_PRECISION, precision_ids[precision_index] ) == 0 );
+
+            float output_chi_square = 0.f;
+            std::array< float, n_parameters > output_parameters;
+            BOOST_CHECK( fit_line( context, data, x, output_chi_square, output_parameters ) == 0 );
+
+            BOOST_CHECK( output_chi_square == chi_squares[ precision_index ] );
+            BOOST_CHECK( output_parameters[ 0 ] == 0.f );
+            BOOST_CHECK( output_parameters[ 1 ] == 0.f );
+        }
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PRECISION, 4 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
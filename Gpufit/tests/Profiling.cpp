@@ -0,0 +1,130 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include "gauss_peaks.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+std::size_t const n_fits{ 1000 };
+std::size_t const n_points{ 5 };
+std::size_t const n_parameters{ 4 };
+
+// the iteration profiles passed to the callback
+struct IterationProfiles
+{
+    std::vector< gpufit_iteration_profile > profiles;
+};
+
+void store_iteration_profile(gpufit_iteration_profile const * const profile, void * const user_data)
+{
+    static_cast< IterationProfiles * >(user_data)->profiles.push_back(*profile);
+}
+
+BOOST_AUTO_TEST_CASE( Profiling )
+{
+    /*
+        Performs fits in one chunk and in several chunks with profiling
+        enabled and a profile callback, and with profiling disabled.
+        - Checks that the profile counts the bytes transferred, the chunks and
+          the iterations of all chunks.
+        - Checks that the callback is called for each iteration of each chunk
+          in order, with the phase times of the iteration.
+        - Checks that nothing is profiled if profiling is disabled.
+        - Checks that invalid profiling options are rejected.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    IterationProfiles iteration_profiles;
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 1 ) == 0 );
+    BOOST_CHECK( gpufit_context_set_profile_callback(
+        context, store_iteration_profile, &iteration_profiles ) == 0 );
+
+    // the data, the initial parameters and the indices of the parameters to
+    // fit of each chunk are copied to the GPU, the results are copied back
+    std::size_t const bytes_to_gpu = n_fits * (n_points + n_parameters) * sizeof(float);
+    std::size_t const bytes_from_gpu = n_fits * (n_parameters * sizeof(float) + 3 * 4);
+
+    // peaks whose centers move with the fit index
+    GaussPeaks peaks(n_fits, n_points);
+    peaks.center_step = 0.001f;
+
+    std::array< double, 2 > const budgets{ { 0.1, 20000. } };
+
+    for (std::size_t budget_index = 0; budget_index < budgets.size(); budget_index++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_GPU_MEMORY_BUDGET, budgets[budget_index] ) == 0 );
+
+        iteration_profiles.profiles.clear();
+
+        BOOST_CHECK( peaks.fit( context ) == 0 );
+
+        gpufit_profile profile;
+        BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+
+        BOOST_CHECK( (profile.n_chunks == 1) == (budget_index == 0) );
+        BOOST_CHECK( profile.bytes_to_gpu == bytes_to_gpu + profile.n_chunks * n_parameters * sizeof(int) );
+        BOOST_CHECK( profile.bytes_from_gpu == bytes_from_gpu );
+        BOOST_CHECK( profile.n_iterations == iteration_profiles.profiles.size() );
+        BOOST_CHECK( profile.total_time > 0. );
+        BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_TRANSFERS ] > 0. );
+        BOOST_CHECK( profile.phase_times[ PROFILE_PHASE_MODEL ] > 0. );
+
+        // the iterations of each chunk, which begin at 0 and end with the
+        // slowest fit of the chunk
+        std::array< double, N_PROFILE_PHASES > iteration_phase_times{};
+        int chunk_index = 0;
+        int n_chunk_iterations = 0;
+        for (std::size_t i = 0; i < iteration_profiles.profiles.size(); i++)
+        {
+            gpufit_iteration_profile const & iteration_profile = iteration_profiles.profiles[ i ];
+
+            if (iteration_profile.chunk_index != chunk_index)
+            {
+                BOOST_CHECK( iteration_profile.chunk_index == chunk_index + 1 );
+                chunk_index = iteration_profile.chunk_index;
+                n_chunk_iterations = 0;
+            }
+
+            BOOST_CHECK( iteration_profile.iteration == n_chunk_iterations );
+            BOOST_CHECK( iteration_profile.n_active_fits > 0 );
+            n_chunk_iterations++;
+
+            for (int phase_id = 0; phase_id < N_PROFILE_PHASES; phase_id++)
+            {
+                iteration_phase_times[ phase_id ] += iteration_profile.phase_times[ phase_id ];
+            }
+        }
+        BOOST_CHECK( std::size_t(chunk_index + 1) == profile.n_chunks );
+
+        // the solver runs in the iterations only
+        BOOST_CHECK( std::abs( iteration_phase_times[ PROFILE_PHASE_SOLVER ] - profile.phase_times[ PROFILE_PHASE_SOLVER ] ) < 1e-6 );
+        for (int phase_id = 0; phase_id < N_PROFILE_PHASES; phase_id++)
+        {
+            BOOST_CHECK( iteration_phase_times[ phase_id ] <= profile.phase_times[ phase_id ] + 1e-6 );
+        }
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 0 ) == 0 );
+
+    iteration_profiles.profiles.clear();
+
+    BOOST_CHECK( peaks.fit( context ) == 0 );
+
+    gpufit_profile profile;
+    BOOST_CHECK( gpufit_context_get_profile( context, &profile ) == 0 );
+    BOOST_CHECK( profile.n_chunks == 0 );
+    BOOST_CHECK( profile.n_iterations == 0 );
+    BOOST_CHECK( profile.bytes_to_gpu == 0 );
+    BOOST_CHECK( iteration_profiles.profiles.empty() );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_PROFILING, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,240 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+
+std::size_t const n_fits{ 10 };
+std::size_t const n_points{ 20 };
+std::size_t const n_parameters{ 2 };
+
+// points of a straight line with alternating deviations, weighted by the
+// inverse variances of their standard deviations
+void generate_linear_1d(std::vector< float > & data, std::vector< float > & weights)
+{
+    data.resize(n_fits * n_points);
+    weights.resize(n_fits * n_points);
+
+    for (std::size_t index = 0; index < data.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const sigma = 0.5f + 0.05f * x;
+
+        data[index] = 1.f + 0.5f * x + (index % 2 ? 0.1f : -0.1f);
+        weights[index] = 1.f / (sigma * sigma);
+    }
+}
+
+int fit_linear_1d(
+    void * context,
+    std::array< int, 2 > & parameters_to_fit,
+    int const uncertainty_type,
+    std::vector< float > & output_parameters,
+    std::vector< float > & output_chi_squares,
+    std::vector< float > * output_uncertainties,
+    std::vector< int > * output_n_iterations = 0)
+{
+    std::vector< float > data;
+    std::vector< float > weights;
+    generate_linear_1d(data, weights);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 1.f;
+        initial_parameters[fit_index * n_parameters + 1] = 0.f;
+    }
+
+    output_parameters.resize(n_fits * n_parameters);
+    output_chi_squares.resize(n_fits);
+    std::vector< int > output_states(n_fits);
+    std::vector< int > n_iterations(n_fits);
+    if (!output_n_iterations)
+        output_n_iterations = &n_iterations;
+    output_n_iterations->resize(n_fits);
+
+    return gpufit_context_fit_uncertainties
+        (
+            context,
+            n_fits,
+            n_points,
+            data.data(),
+            weights.data(),
+            LINEAR_1D,
+            initial_parameters.data(),
+            1e-6f,
+            20,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations->data(),
+            uncertainty_type,
+            output_uncertainties ? output_uncertainties->data() : 0
+        );
+}
+
+BOOST_AUTO_TEST_CASE( Uncertainties )
+{
+    /*
+        Fits straight lines to weighted data and calculates the uncertainties
+        of the fitted parameters.
+        - Checks that the fit results equal the results without uncertainties.
+        - Checks that the covariances equal the inverse of the normal matrix
+          and the standard deviations equal the square roots of its diagonal,
+          with the direct linear fit, the LM iterations, the fused kernel and
+          the hessians calculated on the fly.
+        - Checks that parameters which are not fitted have no uncertainty.
+        - Checks that invalid uncertainty outputs are rejected.
+    */
+
+    // the inverse of the normal matrix of the weighted points
+    std::vector< float > data;
+    std::vector< float > weights;
+    generate_linear_1d(data, weights);
+
+    double s = 0., sx = 0., sxx = 0.;
+    for (std::size_t point_index = 0; point_index < n_points; point_index++)
+    {
+        double const x = double(point_index);
+        s += weights[point_index];
+        sx += weights[point_index] * x;
+        sxx += weights[point_index] * x * x;
+    }
+    double const determinant = s * sxx - sx * sx;
+    std::array< double, 4 > const covariances{ { sxx / determinant, -sx / determinant, -sx / determinant, s / determinant } };
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::array< int, 2 > parameters_to_fit{ { 1, 1 } };
+
+    std::vector< float > reference_parameters, reference_chi_squares;
+    BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, UNCERTAINTY_NONE, reference_parameters, reference_chi_squares, 0 ) == 0 );
+
+    std::array< std::array< int, 3 >, 4 > const options{ {
+        { { 1, 0, 0 } },
+        { { 0, 0, 0 } },
+        { { 0, 1, 0 } },
+        { { 0, 0, 1 } } } };
+
+    for (std::size_t i = 0; i < options.size(); i++)
+    {
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_DIRECT_LINEAR_FIT, options[i][0] ) == 0 );
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, options[i][1] ) == 0 );
+        BOOST_CHECK( gpufit_context_set_option( context, OPTION_ON_THE_FLY_HESSIANS, options[i][2] ) == 0 );
+
+        std::vector< float > output_parameters, output_chi_squares;
+        std::vector< float > output_covariances(n_fits * n_parameters * n_parameters);
+        BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, UNCERTAINTY_COVARIANCES, output_parameters, output_chi_squares, &output_covariances ) == 0 );
+
+        for (std::size_t index = 0; index < output_parameters.size(); index++)
+        {
+            BOOST_CHECK( std::abs( output_parameters[ index ] - reference_parameters[ index ] ) < 1e-4f );
+        }
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            BOOST_CHECK( std::abs( output_chi_squares[ fit_index ] - reference_chi_squares[ fit_index ] ) < 1e-4f * reference_chi_squares[ fit_index ] );
+        }
+        for (std::size_t index = 0; index < output_covariances.size(); index++)
+        {
+            double const expected = covariances[ index % 4 ];
+            BOOST_CHECK( std::abs( output_covariances[ index ] - expected ) < 1e-3 * std::abs( expected ) );
+        }
+
+        std::vector< float > output_deviations(n_fits * n_parameters);
+        BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, UNCERTAINTY_STANDARD_DEVIATIONS, output_parameters, output_chi_squares, &output_deviations ) == 0 );
+
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            float const * deviations = &output_deviations[ fit_index * n_parameters ];
+            BOOST_CHECK( std::abs( deviations[ 0 ] - std::sqrt( covariances[ 0 ] ) ) < 1e-3 * std::sqrt( covariances[ 0 ] ) );
+            BOOST_CHECK( std::abs( deviations[ 1 ] - std::sqrt( covariances[ 3 ] ) ) < 1e-3 * std::sqrt( covariances[ 3 ] ) );
+        }
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_DIRECT_LINEAR_FIT, 1 ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_FUSED_KERNEL, 0 ) == 0 );
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_ON_THE_FLY_HESSIANS, 0 ) == 0 );
+
+    // the intercept is not fitted, the variance of the slope is the inverse
+    // of its diagonal element of the normal matrix
+    parameters_to_fit[0] = 0;
+
+    std::vector< float > output_parameters, output_chi_squares;
+    std::vector< float > output_covariances(n_fits * n_parameters * n_parameters);
+    BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, UNCERTAINTY_COVARIANCES, output_parameters, output_chi_squares, &output_covariances ) == 0 );
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        float const * current_covariances = &output_covariances[ fit_index * n_parameters * n_parameters ];
+        BOOST_CHECK( current_covariances[ 0 ] == 0.f );
+        BOOST_CHECK( current_covariances[ 1 ] == 0.f );
+        BOOST_CHECK( current_covariances[ 2 ] == 0.f );
+        BOOST_CHECK( std::abs( current_covariances[ 3 ] - 1. / sxx ) < 1e-3 / sxx );
+    }
+
+    parameters_to_fit[0] = 1;
+
+    // invalid uncertainty outputs
+    BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, 3, output_parameters, output_chi_squares, &output_covariances ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "invalid uncertainty type" );
+
+    BOOST_CHECK( fit_linear_1d( context, parameters_to_fit, UNCERTAINTY_STANDARD_DEVIATIONS, output_parameters, output_chi_squares, 0 ) == -1 );
+    BOOST_CHECK( std::string( gpufit_get_last_error() ) == "uncertainty output not set" );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Uncertainties_Warm_Start )
+{
+    /*
+        Repeats fit calls with warm starts enabled, with and without
+        uncertainties, by the LM iterations.
+        - Checks that the repeated fits with uncertainties start from the same
+          parameters and damping factors as the fits without uncertainties,
+          with the hessians calculated separately and on the fly.
+    */
+
+    std::array< int, 2 > parameters_to_fit{ { 1, 1 } };
+
+    for (int on_the_fly_hessians = 0; on_the_fly_hessians < 2; on_the_fly_hessians++)
+    {
+        std::array< void *, 2 > contexts{ { 0, 0 } };
+        for (void * & context : contexts)
+        {
+            BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+            BOOST_CHECK( gpufit_context_set_option( context, OPTION_DIRECT_LINEAR_FIT, 0 ) == 0 );
+            BOOST_CHECK( gpufit_context_set_option( context, OPTION_ON_THE_FLY_HESSIANS, on_the_fly_hessians ) == 0 );
+            BOOST_CHECK( gpufit_context_set_option( context, OPTION_WARM_START, 1 ) == 0 );
+        }
+
+        std::vector< float > reference_parameters, reference_chi_squares;
+        std::vector< int > reference_n_iterations;
+        std::vector< float > output_parameters, output_chi_squares;
+        std::vector< int > output_n_iterations;
+        std::vector< float > output_covariances(n_fits * n_parameters * n_parameters);
+
+        for (int call = 0; call < 2; call++)
+        {
+            BOOST_CHECK( fit_linear_1d( contexts[0], parameters_to_fit, UNCERTAINTY_NONE, reference_parameters, reference_chi_squares, 0, &reference_n_iterations ) == 0 );
+            BOOST_CHECK( fit_linear_1d( contexts[1], parameters_to_fit, UNCERTAINTY_COVARIANCES, output_parameters, output_chi_squares, &output_covariances, &output_n_iterations ) == 0 );
+
+            BOOST_CHECK( output_parameters == reference_parameters );
+            BOOST_CHECK( output_chi_squares == reference_chi_squares );
+            BOOST_CHECK( output_n_iterations == reference_n_iterations );
+        }
+
+        for (void * context : contexts)
+        {
+            BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+        }
+    }
+}
@@ -0,0 +1,156 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Gpufit/gpufit.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+void generate_gauss_1d(std::vector< float > & values, std::size_t const n_points)
+{
+    float const a = 4.f;
+    float const x0 = 2.f;
+    float const s = 0.5f;
+    float const b = 1.f;
+
+    for (std::size_t index = 0; index < values.size(); index++)
+    {
+        float const x = float(index % n_points);
+        float const argx = ((x - x0)*(x - x0)) / (2.f * s * s);
+        values[index] = a * std::exp(-argx) + b;
+    }
+}
+
+int fit_gauss_1d(
+    void * context,
+    std::size_t const n_fits,
+    std::vector< float > & output_parameters,
+    std::vector< int > * n_iterations = 0)
+{
+    std::size_t const n_points{ 5 };
+    std::size_t const n_parameters{ 4 };
+
+    std::vector< float > data(n_fits * n_points);
+    generate_gauss_1d(data, n_points);
+
+    std::vector< float > initial_parameters(n_fits * n_parameters);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        initial_parameters[fit_index * n_parameters + 0] = 2.f;
+        initial_parameters[fit_index * n_parameters + 1] = 1.5f;
+        initial_parameters[fit_index * n_parameters + 2] = 0.3f;
+        initial_parameters[fit_index * n_parameters + 3] = 0.f;
+    }
+
+    float tolerance{ 0.001f };
+    int max_n_iterations{ 10 };
+    std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+    output_parameters.resize(n_fits * n_parameters);
+    std::vector< int > output_states(n_fits);
+    std::vector< float > output_chi_squares(n_fits);
+    std::vector< int > output_n_iterations(n_fits);
+
+    int const status = gpufit_context_fit
+        (
+            context,
+            n_fits,
+            n_points,
+            data.data(),
+            0,
+            GAUSS_1D,
+            initial_parameters.data(),
+            tolerance,
+            max_n_iterations,
+            parameters_to_fit.data(),
+            LSE,
+            0,
+            0,
+            output_parameters.data(),
+            output_states.data(),
+            output_chi_squares.data(),
+            output_n_iterations.data()
+        );
+
+    if (n_iterations)
+        * n_iterations = output_n_iterations;
+
+    return status;
+}
+
+BOOST_AUTO_TEST_CASE( Warm_Start )
+{
+    /*
+        Repeats a fit call with warm starts enabled.
+        - Checks that the repeated fits start from the previous results and
+          need less iterations.
+        - Checks that the fits excluded by the warm start mask start from
+          their initial parameters.
+    */
+
+    void * context = 0;
+    BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+
+    std::size_t const n_fits = 10;
+
+    std::vector< float > reference_parameters;
+    std::vector< int > reference_n_iterations;
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, reference_parameters, &reference_n_iterations ) == 0 );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_WARM_START, 1 ) == 0 );
+
+    // the first fit call has no previous results
+    std::vector< float > output_parameters;
+    std::vector< int > n_iterations;
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &n_iterations ) == 0 );
+    BOOST_CHECK( n_iterations == reference_n_iterations );
+
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &n_iterations ) == 0 );
+    for (std::size_t index = 0; index < output_parameters.size(); index++)
+    {
+        BOOST_CHECK( std::abs( output_parameters[ index ] - reference_parameters[ index ] ) < 1e-4f );
+    }
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        BOOST_CHECK( n_iterations[ fit_index ] < reference_n_iterations[ fit_index ] );
+    }
+
+    // the even fits start from their initial parameters
+    std::vector< int > mask(n_fits);
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+    {
+        mask[ fit_index ] = fit_index % 2;
+    }
+    BOOST_CHECK( gpufit_context_set_warm_start_mask( context, n_fits, mask.data() ) == 0 );
+
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &n_iterations ) == 0 );
+    for (std::size_t fit_index = 0; fit_index < n_fits; fit_index += 2)
+    {
+        BOOST_CHECK( n_iterations[ fit_index ] == reference_n_iterations[ fit_index ] );
+    }
+    for (std::size_t index = 0; index < output_parameters.size(); index++)
+    {
+        BOOST_CHECK( std::abs( output_parameters[ index ] - reference_parameters[ index ] ) < 1e-4f );
+    }
+
+    // the mask must match the number of fits
+    BOOST_CHECK( fit_gauss_1d( context, n_fits + 1, output_parameters ) == -1 );
+    BOOST_CHECK( gpufit_context_set_warm_start_mask( context, 0, 0 ) == 0 );
+
+    // a different number of fits is not warm started
+    BOOST_CHECK( fit_gauss_1d( context, n_fits + 1, output_parameters, &n_iterations ) == 0 );
+    for (std::size_t fit_index = 0; fit_index < n_fits + 1; fit_index++)
+    {
+        BOOST_CHECK( n_iterations[ fit_index ] == reference_n_iterations[ 0 ] );
+    }
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_WARM_START, 0 ) == 0 );
+    BOOST_CHECK( fit_gauss_1d( context, n_fits, output_parameters, &n_iterations ) == 0 );
+    BOOST_CHECK( n_iterations == reference_n_iterations );
+
+    BOOST_CHECK( gpufit_context_set_option( context, OPTION_WARM_START, 2 ) == -1 );
+
+    BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
@@ -0,0 +1,85 @@
+#ifndef GPUFIT_TEST_GAUSS_PEAKS_H_INCLUDED
+#define GPUFIT_TEST_GAUSS_PEAKS_H_INCLUDED
+
+#include "Gpufit/gpufit.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+/*
+Fits of 1D Gaussian peaks with an amplitude of 4, a width of 0.5 and an offset
+of 1, sampled at 5 points and scaled to the number of points. The center of the
+peak of fit i is center + i * center_step, the initial center of fit i is
+2 + i * initial_center_step, hence fits with moving centers have their own
+results, and fits with moving initial centers need different numbers of
+iterations.
+*/
+struct GaussPeaks
+{
+    GaussPeaks(std::size_t const fits, std::size_t const points) :
+        n_fits(fits),
+        n_points(points),
+        center(1.5f),
+        center_step(0.f),
+        initial_center_step(0.f),
+        tolerance(1e-6f),
+        max_n_iterations(20)
+    {
+    }
+
+    int fit(void * context)
+    {
+        std::size_t const n_parameters = 4;
+
+        std::vector< float > data(n_fits * n_points);
+        std::vector< float > initial_parameters(n_fits * n_parameters);
+
+        float const scale = float(n_points - 1) / 4.f;
+        float const width = 0.5f * scale;
+
+        for (std::size_t fit_index = 0; fit_index < n_fits; fit_index++)
+        {
+            float const fit_center = (center + center_step * float(fit_index)) * scale;
+            for (std::size_t point_index = 0; point_index < n_points; point_index++)
+            {
+                float const x = float(point_index);
+                data[fit_index * n_points + point_index]
+                    = 4.f * std::exp(-(x - fit_center) * (x - fit_center) / (2.f * width * width)) + 1.f;
+            }
+
+            initial_parameters[fit_index * n_parameters + 0] = 3.f;
+            initial_parameters[fit_index * n_parameters + 1] = (2.f + initial_center_step * float(fit_index)) * scale;
+            initial_parameters[fit_index * n_parameters + 2] = 0.4f * scale;
+            initial_parameters[fit_index * n_parameters + 3] = 0.5f;
+        }
+
+        std::array< int, 4 > parameters_to_fit{ { 1, 1, 1, 1 } };
+
+        parameters.resize(n_fits * n_parameters);
+        states.resize(n_fits);
+        chi_squares.resize(n_fits);
+        n_iterations.resize(n_fits);
+
+        return gpufit_context_fit(
+            context, n_fits, n_points, data.data(), 0, GAUSS_1D, initial_parameters.data(), tolerance,
+            max_n_iterations, parameters_to_fit.data(), LSE, 0, 0, parameters.data(), states.data(),
+            chi_squares.data(), n_iterations.data());
+    }
+
+    std::size_t n_fits;
+    std::size_t n_points;
+    float center;
+    float center_step;
+    float initial_center_step;
+    float tolerance;
+    int max_n_iterations;
+
+    // the results of the last call of fit
+    std::vector< float > parameters;
+    std::vector< int > states;
+    std::vector< float > chi_squares;
+    std::vector< int > n_iterations;
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "gpufit.h"
+#include "warm_start.cuh"
+#include <cuda_runtime.h>
+#include <device_launch_parameters.h>
+#include <algorithm>
+#include <cmath>
+
+/* Description of the cuda_warm_start function
+* ============================================
+*
+* This function replaces the initial parameters and the initial damping factor
+* of each fit which converged in the previous fit call by its fitted
+* parameters and its final damping factor. Only the fitted parameters are
+* replaced.
+*
+* Parameters:
+*
+* parameters: An input and output vector of concatenated sets of model
+*             parameters, holding the initial parameters.
+*
+* lambdas: An input and output vector of the initial damping factors.
+*
+* stored_parameters: An input vector of the fitted parameters of the previous
+*                    fit call.
+*
+* stored_lambdas: An input vector of the final damping factors of the previous
+*                 fit call.
+*
+* stored_states: An input vector of the fit states of the previous fit call.
+*
+* mask: An input vector of the warm start mask, or NULL. Fits with a mask value
+*       of 0 are not warm started.
+*
+* parameters_to_fit_indices: An input vector of indices of fitted parameters.
+*
+* n_parameters_to_fit: The number of model parameters that are not held fixed.
+*
+* n_parameters: The number of model parameters.
+*
+* n_fits: The number of fits.
+*
+* Calling the cuda_warm_start function
+* ====================================
+*
+*   int const example_value = 256;
+*
+*   threads.x = min(n_fits, example_value);
+*   blocks.x = int(ceil(float(n_fits) / float(threads.x)));
+*
+*   cuda_warm_start<<< blocks, threads >>>(
+*       parameters,
+*       lambdas,
+*       stored_parameters,
+*       stored_lambdas,
+*       stored_states,
+*       mask,
+*       parameters_to_fit_indices,
+*       n_parameters_to_fit,
+*       n_parameters,
+*       n_fits);
+*
+*/
+
+__global__ void cuda_warm_start(
+    float * parameters,
+    float * lambdas,
+    float const * stored_parameters,
+    float const * stored_lambdas,
+    int const * stored_states,
+    int const * mask,
+    int const * parameters_to_fit_indices,
+    int const n_parameters_to_fit,
+    int const n_parameters,
+    int const n_fits)
+{
+    int const fit_index = blockIdx.x * blockDim.x + threadIdx.x;
+
+    if (fit_index >= n_fits)
+        return;
+
+    if (stored_states[fit_index] != STATE_CONVERGED)
+        return;
+
+    if (mask && !mask[fit_index])
+        return;
+
+    for (int i = 0; i < n_parameters_to_fit; i++)
+    {
+        int const parameter_index = fit_index * n_parameters + parameters_to_fit_indices[i];
+        parameters[parameter_index] = stored_parameters[parameter_index];
+    }
+
+    lambdas[fit_index] = stored_lambdas[fit_index];
+}
+
+WarmStart::WarmStart() :
+    enabled_(false),
+    mask_(),
+    n_fits_(0),
+    n_parameters_(0),
+    n_parameters_to_fit_(0),
+    model_id_(-1),
+    fit_offset_(0),
+    valid_(false),
+    seeding_(false)
+{
+}
+
+void WarmStart::set_mask(std::size_t const n_fits, int const * const mask)
+{
+    if (mask && n_fits == 0)
+    {
+        throw std::runtime_error("invalid warm start mask");
+    }
+
+    mask_.assign(mask, mask ? mask + n_fits : mask);
+}
+
+// takes over the mask of another fit context
+void WarmStart::configure(WarmStart const & warm_start)
+{
+    mask_.configure(warm_start.mask_);
+}
+
+void WarmStart::check(std::size_t const n_fits) const
+{
+    if (enabled_ && !mask_.empty() && mask_.size() != n_fits)
+    {
+        throw std::runtime_error("warm start mask does not match the fits");
+    }
+}
+
+void WarmStart::release()
+{
+    parameters_.reset();
+    lambdas_.reset();
+    states_.reset();
+    mask_.release();
+    valid_ = false;
+}
+
+// prepares the device memory of a fit call on the current device
+void WarmStart::begin(Info const & info)
+{
+    seeding_
+        = enabled_
+        && valid_
+        && n_fits_ == info.n_fits_
+        && n_parameters_ == info.n_parameters_
+        && model_id_ == info.model_id_
+        && fit_offset_ == info.fit_offset_;
+
+    // the stored state is overwritten by the fit call
+    valid_ = false;
+    n_parameters_to_fit_ = info.n_parameters_to_fit_;
+
+    if (!enabled_)
+    {
+        release();
+        return;
+    }
+
+    if (!seeding_)
+    {
+        std::size_t const n_values = info.n_fits_ * info.n_parameters_;
+
+        if (!parameters_ || n_fits_ * n_parameters_ != n_values)
+            parameters_.reset(new Device_Array< float >(n_values));
+        if (!lambdas_ || n_fits_ != info.n_fits_)
+            lambdas_.reset(new Device_Array< float >(info.n_fits_));
+        if (!states_ || n_fits_ != info.n_fits_)
+            states_.reset(new Device_Array< int >(info.n_fits_));
+
+        n_fits_ = info.n_fits_;
+        n_parameters_ = info.n_parameters_;
+        model_id_ = info.model_id_;
+        fit_offset_ = info.fit_offset_;
+    }
+
+    // copies a changed mask to the device
+    mask_.get_device_data();
+}
+
+// index of the first fit of the current chunk within the fits of this device
+std::size_t WarmStart::get_chunk_offset(GPUData const & gpu_data) const
+{
+    return std::size_t(gpu_data.first_fit_index_) - fit_offset_;
+}
+
+void WarmStart::seed(GPUData & gpu_data, int const chunk_size)
+{
+    if (!seeding_)
+        return;
+
+    std::size_t const chunk_offset = get_chunk_offset(gpu_data);
+
+    // the mask covers the fits on all devices
+    int const * const device_mask = mask_.get_device_data();
+    int const * const mask = device_mask ? device_mask + gpu_data.first_fit_index_ : 0;
+
+    dim3 threads(1, 1, 1);
+    dim3 blocks(1, 1, 1);
+
+    threads.x = std::min(chunk_size, 256);
+    blocks.x = int(std::ceil(float(chunk_size) / float(threads.x)));
+
+    cuda_warm_start<<< blocks, threads, 0, gpu_data.stream_ >>>(
+        gpu_data.parameters_,
+        gpu_data.lambdas_,
+        static_cast< float const * >(*parameters_) + chunk_offset * n_parameters_,
+        static_cast< float const * >(*lambdas_) + chunk_offset,
+        static_cast< int const * >(*states_) + chunk_offset,
+        mask,
+        gpu_data.parameters_to_fit_indices_,
+        n_parameters_to_fit_,
+        n_parameters_,
+        chunk_size);
+    CUDA_CHECK_STATUS(cudaGetLastError());
+}
+
+// keeps the results of the current chunk for the next fit call
+void WarmStart::store(GPUData & gpu_data, int const chunk_size)
+{
+    if (!enabled_)
+        return;
+
+    std::size_t const chunk_offset = get_chunk_offset(gpu_data);
+
+    gpu_data.copy(
+        static_cast< float * >(*parameters_) + chunk_offset * n_parameters_,
+        gpu_data.parameters_,
+        chunk_size * n_parameters_);
+    gpu_data.copy(
+        static_cast< float * >(*lambdas_) + chunk_offset,
+        gpu_data.lambdas_,
+        chunk_size);
+    gpu_data.copy(
+        static_cast< int * >(*states_) + chunk_offset,
+        gpu_data.states_,
+        chunk_size);
+}
+
+void WarmStart::end()
+{
+    valid_ = enabled_;
+}
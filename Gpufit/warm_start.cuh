@@ -0,0 +1,80 @@
+#ifndef GPUFIT_WARM_START_CUH_INCLUDED
+#define GPUFIT_WARM_START_CUH_INCLUDED
+
+#include "gpu_data.cuh"
+#include "device_mirror.h"
+
+#include <memory>
+#include <vector>
+
+/* Description of the WarmStart class
+* ==================================
+*
+* The warm start state of a fit context (OPTION_WARM_START). After each chunk
+* of a fit call, the fitted parameters, the final values of the LM damping
+* factors and the states of the fits are kept in device memory. A following
+* fit call with the same model and number of fits starts each fit which
+* converged in the previous fit call from these parameters and this damping
+* factor, instead of from its initial parameters and the default damping
+* factor. Parameters which are not fitted keep their initial values.
+*
+* The warm start mask (gpufit_context_set_warm_start_mask()) selects the fits
+* which are warm started, e.g. to restart the fits of regions of interest
+* containing a new object. In multi-device mode each device context keeps the
+* state of the fits calculated on its device, and a copy of the mask of the
+* fit context.
+*
+* Usage:
+*
+*   warm_start.begin(info);
+*   for each chunk:
+*       gpu_data.init(...);
+*       warm_start.seed(gpu_data, chunk_size);
+*       ... fit the chunk ...
+*       warm_start.store(gpu_data, chunk_size);
+*   warm_start.end();
+*
+*/
+
+class WarmStart
+{
+public:
+    WarmStart();
+
+    void set_mask(std::size_t const n_fits, int const * mask);
+    void configure(WarmStart const & warm_start);
+    void check(std::size_t const n_fits) const;
+    void begin(Info const & info);
+    void seed(GPUData & gpu_data, int const chunk_size);
+    void store(GPUData & gpu_data, int const chunk_size);
+    void end();
+    void release();
+
+    bool is_allocated() const { return parameters_ || mask_.is_allocated(); }
+
+public:
+    bool enabled_;
+
+private:
+    std::size_t get_chunk_offset(GPUData const & gpu_data) const;
+
+    DeviceMirror< int > mask_;
+
+    // size and model of the fits of the stored state
+    std::size_t n_fits_;
+    int n_parameters_;
+    int n_parameters_to_fit_;
+    int model_id_;
+    std::size_t fit_offset_;
+
+    // the stored state is complete after a successful fit call, and is
+    // used by the current fit call
+    bool valid_;
+    bool seeding_;
+
+    std::unique_ptr< Device_Array< float > > parameters_;
+    std::unique_ptr< Device_Array< float > > lambdas_;
+    std::unique_ptr< Device_Array< int > > states_;
+};
+
+#endif
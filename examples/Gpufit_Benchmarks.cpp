@@ -0,0 +1,733 @@
+/*
+ * Benchmarks Gpufit and Cpufit for all fit models, both estimators, several
+ * numbers of data points and fits, with and without weights, and with all
+ * parameters or all but the last parameter fitted. The speed, the GPU memory
+ * and the distribution of the numbers of iterations of each run are printed
+ * and optionally written to JSON and CSV files, which can be compared between
+ * releases to detect performance regressions.
+ *
+ * Usage: Gpufit_Benchmarks [--quick] [--json <file>] [--csv <file>] [--max-cpufit-fits <n>]
+ *
+ *   --quick             runs a reduced set of configurations
+ *   --json <file>       writes the results to a JSON file
+ *   --csv <file>        writes the results to a CSV file
+ *   --max-cpufit-fits   largest number of fits run by Cpufit (default 10000)
+ */
+
+#include "Cpufit/cpufit.h"
+#include "Gpufit/gpufit.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+std::mt19937 rng(0);
+
+/*
+    Description of a fit model, the data points of two-dimensional models are
+    arranged on a square grid
+*/
+struct Model
+{
+    char const * name;
+    int id;
+    int n_dimensions;
+    std::size_t n_parameters;
+};
+
+std::vector< Model > const models
+{
+    { "GAUSS_1D", GAUSS_1D, 1, 4 },
+    { "GAUSS_2D", GAUSS_2D, 2, 5 },
+    { "GAUSS_2D_ELLIPTIC", GAUSS_2D_ELLIPTIC, 2, 6 },
+    { "GAUSS_2D_ROTATED", GAUSS_2D_ROTATED, 2, 7 },
+    { "CAUCHY_2D_ELLIPTIC", CAUCHY_2D_ELLIPTIC, 2, 6 },
+    { "LINEAR_1D", LINEAR_1D, 1, 2 }
+};
+
+/*
+    True parameters of a model whose data points have the x (and y)
+    coordinates 0, .., size - 1
+*/
+std::vector< float > get_true_parameters(int const model_id, std::size_t const size)
+{
+    float const center = (float(size) - 1.f) / 2.f;
+
+    switch (model_id)
+    {
+    case GAUSS_1D:
+        return { 500.f, center, 2.f, 10.f };
+    case GAUSS_2D:
+        return { 500.f, center, center, 1.5f, 10.f };
+    case GAUSS_2D_ELLIPTIC:
+    case CAUCHY_2D_ELLIPTIC:
+        return { 500.f, center, center, 1.2f, 1.8f, 10.f };
+    case GAUSS_2D_ROTATED:
+        return { 500.f, center, center, 1.2f, 1.8f, 10.f, 0.5f };
+    case LINEAR_1D:
+        return { 10.f, 2.f };
+    default:
+        throw std::runtime_error("unknown model ID");
+    }
+}
+
+/*
+    Model value at the data point (x, y), y is 0 for one-dimensional models
+*/
+float calculate_model_value(int const model_id, std::vector< float > const & p, float const x, float const y)
+{
+    switch (model_id)
+    {
+    case GAUSS_1D:
+    {
+        float const argx = (x - p[1]) * (x - p[1]) / (2.f * p[2] * p[2]);
+        return p[0] * std::exp(-argx) + p[3];
+    }
+    case GAUSS_2D:
+    {
+        float const argx = (x - p[1]) * (x - p[1]) + (y - p[2]) * (y - p[2]);
+        return p[0] * std::exp(-argx / (2.f * p[3] * p[3])) + p[4];
+    }
+    case GAUSS_2D_ELLIPTIC:
+    {
+        float const argx = (x - p[1]) * (x - p[1]) / (2.f * p[3] * p[3]);
+        float const argy = (y - p[2]) * (y - p[2]) / (2.f * p[4] * p[4]);
+        return p[0] * std::exp(-(argx + argy)) + p[5];
+    }
+    case GAUSS_2D_ROTATED:
+    {
+        float const arga = (x - p[1]) * std::cos(p[6]) - (y - p[2]) * std::sin(p[6]);
+        float const argb = (x - p[1]) * std::sin(p[6]) + (y - p[2]) * std::cos(p[6]);
+        float const ex = std::exp(-0.5f * ((arga / p[3]) * (arga / p[3]) + (argb / p[4]) * (argb / p[4])));
+        return p[0] * ex + p[5];
+    }
+    case CAUCHY_2D_ELLIPTIC:
+    {
+        float const argx = ((p[1] - x) / p[3]) * ((p[1] - x) / p[3]) + 1.f;
+        float const argy = ((p[2] - y) / p[4]) * ((p[2] - y) / p[4]) + 1.f;
+        return p[0] / (argx * argy) + p[5];
+    }
+    case LINEAR_1D:
+        return p[0] + p[1] * x;
+    default:
+        throw std::runtime_error("unknown model ID");
+    }
+}
+
+/*
+    Fit problem of a benchmark configuration, the data and initial parameters
+    are generated once per model and number of points for the largest number
+    of fits
+*/
+struct Problem
+{
+    Model model;
+    std::size_t n_points;
+    std::size_t n_fits;
+    std::vector< float > data;
+    std::vector< float > weights;
+    std::vector< float > initial_parameters;
+    std::vector< float > true_parameters;
+};
+
+void generate_problem(Problem & problem, Model const & model, std::size_t const size, std::size_t const n_fits)
+{
+    problem.model = model;
+    problem.n_points = model.n_dimensions == 2 ? size * size : size;
+    problem.n_fits = n_fits;
+    problem.true_parameters = get_true_parameters(model.id, size);
+
+    // Poisson distributed data, positive as required by the MLE estimator
+    std::vector< float > values(problem.n_points);
+    for (std::size_t point_index = 0; point_index < problem.n_points; point_index++)
+    {
+        float const x = float(point_index % size);
+        float const y = model.n_dimensions == 2 ? float(point_index / size) : 0.f;
+        values[point_index] = calculate_model_value(model.id, problem.true_parameters, x, y);
+    }
+
+    problem.data.resize(n_fits * problem.n_points);
+    problem.weights.resize(n_fits * problem.n_points);
+    for (std::size_t index = 0; index < problem.data.size(); index++)
+    {
+        std::poisson_distribution< int > poisson(values[index % problem.n_points]);
+        problem.data[index] = float(poisson(rng));
+        problem.weights[index] = 1.f / (std::max)(problem.data[index], 1.f);
+    }
+
+    // initial parameters within +-10% of the true parameters
+    std::uniform_real_distribution< float > uniform(0.9f, 1.1f);
+
+    problem.initial_parameters.resize(n_fits * model.n_parameters);
+    for (std::size_t index = 0; index < problem.initial_parameters.size(); index++)
+    {
+        problem.initial_parameters[index]
+            = problem.true_parameters[index % model.n_parameters] * uniform(rng);
+    }
+}
+
+/*
+    A benchmark configuration and its result
+*/
+struct Run
+{
+    std::string backend;
+    std::string model;
+    std::string estimator;
+    std::size_t n_points;
+    std::size_t n_fits;
+    bool weights;
+    std::string parameters_to_fit;
+
+    int status;
+    std::string error;
+    double time;
+    std::size_t gpu_memory;
+
+    std::vector< int > iteration_histogram;
+    std::vector< std::size_t > state_counts;
+};
+
+/*
+    Input and output arrays of a fit call, as passed to gpufit() and cpufit()
+*/
+struct FitCall
+{
+    std::size_t n_fits;
+    std::size_t n_points;
+    float * data;
+    float * weights;
+    int model_id;
+    float * initial_parameters;
+    float tolerance;
+    int max_n_iterations;
+    int * parameters_to_fit;
+    int estimator_id;
+
+    std::vector< float > output_parameters;
+    std::vector< int > output_states;
+    std::vector< float > output_chi_squares;
+    std::vector< int > output_n_iterations;
+};
+
+void init_fit_call(
+    FitCall & call,
+    Problem & problem,
+    std::size_t const n_fits,
+    bool const use_weights,
+    float * const initial_parameters,
+    int * const parameters_to_fit,
+    int const estimator_id,
+    float const tolerance,
+    int const max_n_iterations)
+{
+    call.n_fits = n_fits;
+    call.n_points = problem.n_points;
+    call.data = problem.data.data();
+    call.weights = use_weights ? problem.weights.data() : 0;
+    call.model_id = problem.model.id;
+    call.initial_parameters = initial_parameters;
+    call.tolerance = tolerance;
+    call.max_n_iterations = max_n_iterations;
+    call.parameters_to_fit = parameters_to_fit;
+    call.estimator_id = estimator_id;
+
+    call.output_parameters.resize(n_fits * problem.model.n_parameters);
+    call.output_states.resize(n_fits);
+    call.output_chi_squares.resize(n_fits);
+    call.output_n_iterations.resize(n_fits);
+}
+
+/*
+    A backend performs the fit call and measures its time in milliseconds
+    and, if available, the GPU memory used
+*/
+typedef int (* Backend)(FitCall & call, Run & run);
+
+int run_cpufit(FitCall & call, Run & run)
+{
+    std::chrono::high_resolution_clock::time_point const t0 = std::chrono::high_resolution_clock::now();
+
+    int const status = cpufit(
+        call.n_fits,
+        call.n_points,
+        call.data,
+        call.weights,
+        call.model_id,
+        call.initial_parameters,
+        call.tolerance,
+        call.max_n_iterations,
+        call.parameters_to_fit,
+        call.estimator_id,
+        0,
+        0,
+        call.output_parameters.data(),
+        call.output_states.data(),
+        call.output_chi_squares.data(),
+        call.output_n_iterations.data());
+
+    std::chrono::duration< double, std::milli > const time = std::chrono::high_resolution_clock::now() - t0;
+    run.time = time.count();
+
+    if (status != STATUS_OK)
+        run.error = cpufit_get_last_error();
+
+    return status;
+}
+
+int run_gpufit(FitCall & call, Run & run)
+{
+    std::chrono::high_resolution_clock::time_point const t0 = std::chrono::high_resolution_clock::now();
+
+    int const status = gpufit(
+        call.n_fits,
+        call.n_points,
+        call.data,
+        call.weights,
+        call.model_id,
+        call.initial_parameters,
+        call.tolerance,
+        call.max_n_iterations,
+        call.parameters_to_fit,
+        call.estimator_id,
+        0,
+        0,
+        call.output_parameters.data(),
+        call.output_states.data(),
+        call.output_chi_squares.data(),
+        call.output_n_iterations.data());
+
+    std::chrono::duration< double, std::milli > const time = std::chrono::high_resolution_clock::now() - t0;
+    run.time = time.count();
+
+    if (status != STATUS_OK)
+        run.error = gpufit_get_last_error();
+
+    return status;
+}
+
+/*
+    Fits with a new fit context whose profile provides the GPU memory of the
+    fit call
+*/
+int run_gpufit_context(FitCall & call, Run & run)
+{
+    void * context = 0;
+    if (gpufit_create_context(&context) != STATUS_OK
+        || gpufit_context_set_option(context, OPTION_PROFILING, 1) != STATUS_OK)
+    {
+        run.error = gpufit_get_last_error();
+        gpufit_destroy_context(context);
+        return STATUS_ERROR;
+    }
+
+    std::chrono::high_resolution_clock::time_point const t0 = std::chrono::high_resolution_clock::now();
+
+    int const status = gpufit_context_fit(
+        context,
+        call.n_fits,
+        call.n_points,
+        call.data,
+        call.weights,
+        call.model_id,
+        call.initial_parameters,
+        call.tolerance,
+        call.max_n_iterations,
+        call.parameters_to_fit,
+        call.estimator_id,
+        0,
+        0,
+        call.output_parameters.data(),
+        call.output_states.data(),
+        call.output_chi_squares.data(),
+        call.output_n_iterations.data());
+
+    std::chrono::duration< double, std::milli > const time = std::chrono::high_resolution_clock::now() - t0;
+    run.time = time.count();
+
+    gpufit_profile profile;
+    if (status == STATUS_OK && gpufit_context_get_profile(context, &profile) == STATUS_OK)
+        run.gpu_memory = profile.gpu_memory;
+
+    if (status != STATUS_OK)
+        run.error = gpufit_get_last_error();
+
+    gpufit_destroy_context(context);
+
+    return status;
+}
+
+/*
+    All backends, new backends are added here
+*/
+struct BackendEntry
+{
+    char const * name;
+    Backend run;
+    bool uses_gpu;
+};
+
+std::vector< BackendEntry > const backends
+{
+    { "cpufit", run_cpufit, false },
+    { "gpufit", run_gpufit, true },
+    { "gpufit_context", run_gpufit_context, true }
+};
+
+void get_statistics(FitCall const & call, Run & run)
+{
+    run.iteration_histogram.assign(call.max_n_iterations + 1, 0);
+    run.state_counts.assign(4, 0);
+
+    for (std::size_t fit_index = 0; fit_index < call.n_fits; fit_index++)
+    {
+        int const n_iterations = (std::min)((std::max)(call.output_n_iterations[fit_index], 0), call.max_n_iterations);
+        run.iteration_histogram[n_iterations]++;
+
+        int const state = call.output_states[fit_index];
+        if (state >= 0 && state < int(run.state_counts.size()))
+            run.state_counts[state]++;
+    }
+}
+
+double get_mean_n_iterations(Run const & run)
+{
+    double sum = 0.;
+    std::size_t count = 0;
+    for (std::size_t n_iterations = 0; n_iterations < run.iteration_histogram.size(); n_iterations++)
+    {
+        sum += double(n_iterations) * run.iteration_histogram[n_iterations];
+        count += run.iteration_histogram[n_iterations];
+    }
+    return count ? sum / double(count) : 0.;
+}
+
+// the smallest number of iterations reached by the given fraction of fits
+int get_n_iterations_quantile(Run const & run, double const fraction)
+{
+    std::size_t const n_fits = std::accumulate(run.iteration_histogram.begin(), run.iteration_histogram.end(), std::size_t(0));
+    std::size_t count = 0;
+    for (std::size_t n_iterations = 0; n_iterations < run.iteration_histogram.size(); n_iterations++)
+    {
+        count += run.iteration_histogram[n_iterations];
+        if (count > 0 && double(count) >= fraction * double(n_fits))
+            return int(n_iterations);
+    }
+    return 0;
+}
+
+double get_fits_per_second(Run const & run)
+{
+    return run.time > 0. ? double(run.n_fits) / run.time * 1000. : 0.;
+}
+
+void print_header()
+{
+    std::cout << std::left
+        << std::setw(16) << "backend"
+        << std::setw(20) << "model"
+        << std::setw(5) << "est."
+        << std::right
+        << std::setw(7) << "points"
+        << std::setw(9) << "fits"
+        << std::setw(5) << "wt."
+        << std::setw(11) << "fitted"
+        << std::setw(14) << "fits/s"
+        << std::setw(11) << "GPU MB"
+        << std::setw(8) << "iter."
+        << std::setw(8) << "conv.%"
+        << std::endl;
+    std::cout << std::string(114, '-') << std::endl;
+}
+
+void print_run(Run const & run)
+{
+    std::cout << std::left
+        << std::setw(16) << run.backend
+        << std::setw(20) << run.model
+        << std::setw(5) << run.estimator
+        << std::right
+        << std::setw(7) << run.n_points
+        << std::setw(9) << run.n_fits
+        << std::setw(5) << (run.weights ? "yes" : "no")
+        << std::setw(11) << run.parameters_to_fit;
+
+    if (run.status != 0)
+    {
+        std::cout << "  error: " << run.error << std::endl;
+        return;
+    }
+
+    std::cout << std::fixed
+        << std::setw(14) << std::setprecision(0) << get_fits_per_second(run)
+        << std::setw(11) << std::setprecision(2) << double(run.gpu_memory) / 1048576.
+        << std::setw(8) << std::setprecision(2) << get_mean_n_iterations(run)
+        << std::setw(8) << std::setprecision(1) << 100. * double(run.state_counts[STATE_CONVERGED]) / double(run.n_fits)
+        << std::endl;
+}
+
+void write_json(std::string const & file_name, std::vector< Run > const & runs, int const cuda_runtime_version, int const cuda_driver_version)
+{
+    std::ofstream file(file_name);
+
+    file << "{\n";
+    file << "  \"cuda_runtime_version\": " << cuda_runtime_version << ",\n";
+    file << "  \"cuda_driver_version\": " << cuda_driver_version << ",\n";
+    file << "  \"runs\": [\n";
+
+    for (std::size_t run_index = 0; run_index < runs.size(); run_index++)
+    {
+        Run const & run = runs[run_index];
+
+        file << std::setprecision(10)
+            << "    {"
+            << "\"backend\": \"" << run.backend << "\", "
+            << "\"model\": \"" << run.model << "\", "
+            << "\"estimator\": \"" << run.estimator << "\", "
+            << "\"n_points\": " << run.n_points << ", "
+            << "\"n_fits\": " << run.n_fits << ", "
+            << "\"weights\": " << (run.weights ? "true" : "false") << ", "
+            << "\"parameters_to_fit\": \"" << run.parameters_to_fit << "\", "
+            << "\"status\": " << run.status << ", "
+            << "\"time_ms\": " << run.time << ", "
+            << "\"fits_per_second\": " << get_fits_per_second(run) << ", "
+            << "\"gpu_memory_bytes\": " << run.gpu_memory << ", "
+            << "\"n_iterations\": {"
+            << "\"min\": " << get_n_iterations_quantile(run, 0.) << ", "
+            << "\"median\": " << get_n_iterations_quantile(run, 0.5) << ", "
+            << "\"mean\": " << get_mean_n_iterations(run) << ", "
+            << "\"max\": " << get_n_iterations_quantile(run, 1.) << ", "
+            << "\"histogram\": [";
+        for (std::size_t i = 0; i < run.iteration_histogram.size(); i++)
+        {
+            file << (i ? ", " : "") << run.iteration_histogram[i];
+        }
+        file << "]}, \"states\": [";
+        for (std::size_t i = 0; i < run.state_counts.size(); i++)
+        {
+            file << (i ? ", " : "") << run.state_counts[i];
+        }
+        file << "]}" << (run_index + 1 < runs.size() ? "," : "") << "\n";
+    }
+
+    file << "  ]\n";
+    file << "}\n";
+}
+
+void write_csv(std::string const & file_name, std::vector< Run > const & runs)
+{
+    std::ofstream file(file_name);
+
+    file << "backend,model,estimator,n_points,n_fits,weights,parameters_to_fit,status,time_ms,fits_per_second,"
+        << "gpu_memory_bytes,min_iterations,median_iterations,mean_iterations,max_iterations,"
+        << "converged,max_iteration,singular_hessian,neg_curvature_mle\n";
+
+    for (std::size_t run_index = 0; run_index < runs.size(); run_index++)
+    {
+        Run const & run = runs[run_index];
+
+        file << std::setprecision(10)
+            << run.backend << ','
+            << run.model << ','
+            << run.estimator << ','
+            << run.n_points << ','
+            << run.n_fits << ','
+            << (run.weights ? 1 : 0) << ','
+            << run.parameters_to_fit << ','
+            << run.status << ','
+            << run.time << ','
+            << get_fits_per_second(run) << ','
+            << run.gpu_memory << ','
+            << get_n_iterations_quantile(run, 0.) << ','
+            << get_n_iterations_quantile(run, 0.5) << ','
+            << get_mean_n_iterations(run) << ','
+            << get_n_iterations_quantile(run, 1.);
+        for (std::size_t i = 0; i < run.state_counts.size(); i++)
+        {
+            file << ',' << run.state_counts[i];
+        }
+        file << '\n';
+    }
+}
+
+bool is_gpu_available(int & cuda_runtime_version, int & cuda_driver_version)
+{
+    if (gpufit_get_cuda_version(&cuda_runtime_version, &cuda_driver_version) == 0)
+    {
+        std::cout << "CUDA error detected. Error string: " << gpufit_get_last_error() << std::endl;
+        return false;
+    }
+
+    if (cuda_driver_version == 0 || cuda_runtime_version == 0 || cuda_driver_version < cuda_runtime_version)
+    {
+        std::cout << "No compatible CUDA device and driver detected." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char * argv[])
+{
+    bool quick = false;
+    std::string json_file_name;
+    std::string csv_file_name;
+    std::size_t max_cpufit_fits = 10000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--quick") == 0)
+        {
+            quick = true;
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            json_file_name = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csv_file_name = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--max-cpufit-fits") == 0 && i + 1 < argc)
+        {
+            max_cpufit_fits = std::strtoul(argv[++i], 0, 10);
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0]
+                << " [--quick] [--json <file>] [--csv <file>] [--max-cpufit-fits <n>]" << std::endl;
+            return 1;
+        }
+    }
+
+    int cuda_runtime_version = 0;
+    int cuda_driver_version = 0;
+    bool const gpu_available = is_gpu_available(cuda_runtime_version, cuda_driver_version);
+    if (!gpu_available)
+    {
+        std::cout << "Skipping Gpufit benchmarks." << std::endl;
+    }
+
+    // sizes of the data, the number of points along x (and y)
+    std::vector< std::size_t > const sizes_1d = quick ? std::vector< std::size_t >{ 16 } : std::vector< std::size_t >{ 16, 64 };
+    std::vector< std::size_t > const sizes_2d = quick ? std::vector< std::size_t >{ 5 } : std::vector< std::size_t >{ 5, 9 };
+    std::vector< std::size_t > const n_fits_all = quick ? std::vector< std::size_t >{ 1000 } : std::vector< std::size_t >{ 1000, 10000, 100000 };
+
+    float const tolerance = 0.0001f;
+    int const max_n_iterations = 20;
+
+    // the first fit call initializes the CUDA context
+    if (gpu_available)
+    {
+        Problem problem;
+        generate_problem(problem, models[0], sizes_1d[0], 1);
+
+        std::vector< int > parameters_to_fit(models[0].n_parameters, 1);
+
+        FitCall call;
+        init_fit_call(
+            call, problem, 1, false, problem.initial_parameters.data(), parameters_to_fit.data(), LSE,
+            tolerance, max_n_iterations);
+
+        Run run = Run();
+        run_gpufit(call, run);
+    }
+
+    std::vector< Run > runs;
+
+    print_header();
+
+    for (std::size_t model_index = 0; model_index < models.size(); model_index++)
+    {
+        Model const & model = models[model_index];
+        std::vector< std::size_t > const & sizes = model.n_dimensions == 2 ? sizes_2d : sizes_1d;
+
+        for (std::size_t size_index = 0; size_index < sizes.size(); size_index++)
+        {
+            Problem problem;
+            generate_problem(problem, model, sizes[size_index], n_fits_all.back());
+
+            for (int estimator_id = LSE; estimator_id <= MLE; estimator_id++)
+            {
+                // MLE does not use weights
+                for (int use_weights = 0; use_weights <= (estimator_id == LSE ? 1 : 0); use_weights++)
+                {
+                    for (int fix_last = 0; fix_last <= 1; fix_last++)
+                    {
+                        std::vector< int > parameters_to_fit(model.n_parameters, 1);
+                        std::vector< float > initial_parameters = problem.initial_parameters;
+
+                        // the fixed parameter keeps its true value
+                        if (fix_last)
+                        {
+                            std::size_t const last = model.n_parameters - 1;
+                            parameters_to_fit[last] = 0;
+                            for (std::size_t fit_index = 0; fit_index < problem.n_fits; fit_index++)
+                            {
+                                initial_parameters[fit_index * model.n_parameters + last] = problem.true_parameters[last];
+                            }
+                        }
+
+                        for (std::size_t n_fits_index = 0; n_fits_index < n_fits_all.size(); n_fits_index++)
+                        {
+                            std::size_t const n_fits = n_fits_all[n_fits_index];
+
+                            for (std::size_t backend_index = 0; backend_index < backends.size(); backend_index++)
+                            {
+                                BackendEntry const & backend = backends[backend_index];
+
+                                if (backend.uses_gpu ? !gpu_available : n_fits > max_cpufit_fits)
+                                    continue;
+
+                                FitCall call;
+                                init_fit_call(
+                                    call, problem, n_fits, use_weights != 0, initial_parameters.data(),
+                                    parameters_to_fit.data(), estimator_id, tolerance, max_n_iterations);
+
+                                Run run = Run();
+                                run.backend = backend.name;
+                                run.model = model.name;
+                                run.estimator = estimator_id == LSE ? "LSE" : "MLE";
+                                run.n_points = problem.n_points;
+                                run.n_fits = n_fits;
+                                run.weights = use_weights != 0;
+                                run.parameters_to_fit = fix_last ? "fixed_last" : "all";
+                                run.state_counts.assign(4, 0);
+
+                                run.status = backend.run(call, run);
+                                if (run.status == 0)
+                                    get_statistics(call, run);
+
+                                print_run(run);
+                                runs.push_back(run);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (!json_file_name.empty())
+    {
+        write_json(json_file_name, runs, cuda_runtime_version, cuda_driver_version);
+        std::cout << std::endl << "Results written to " << json_file_name << std::endl;
+    }
+
+    if (!csv_file_name.empty())
+    {
+        write_csv(csv_file_name, runs);
+        std::cout << std::endl << "Results written to " << csv_file_name << std::endl;
+    }
+
+    return 0;
+}
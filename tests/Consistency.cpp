@@ -6,6 +6,8 @@
 
 #include <boost/test/included/unit_test.hpp>
 
+#include <string>
+#include <thread>
 #include <vector>
 
 void generate_input_linear_fit_1d(FitInput & i)
@@ -218,3 +220,93 @@ BOOST_AUTO_TEST_CASE( Consistency )
     perform_cpufit_gpufit_and_check(&generate_input_gauss_fit_2d_elliptic);
 
 }
+
+BOOST_AUTO_TEST_CASE( Consistency_Cpufit_Threads )
+{
+	BOOST_CHECK( cpufit_set_number_of_threads( 4 ) == 0 );
+
+	BOOST_TEST_MESSAGE( "gauss_fit_1d" );
+	perform_cpufit_gpufit_and_check(&generate_input_gauss_fit_1d);
+
+	BOOST_TEST_MESSAGE( "gauss_fit_2d" );
+	perform_cpufit_gpufit_and_check(&generate_input_gauss_fit_2d);
+
+	BOOST_CHECK( cpufit_set_number_of_threads( -1 ) == -1 );
+	BOOST_CHECK( cpufit_set_number_of_threads( 1 ) == 0 );
+}
+
+BOOST_AUTO_TEST_CASE( Consistency_Cpufit_Concurrent_Calls )
+{
+	/*
+		Calls Cpufit from several threads at the same time, each with its own
+		number of threads.
+		- Checks that each call gives the results of a single threaded call.
+		- Checks that an invalid number of threads is reported to the caller.
+	*/
+
+	FitInput i;
+	generate_input_gauss_fit_2d(i);
+	BOOST_CHECK(i.sanity_check());
+
+	std::size_t const n_callers = 4;
+	std::vector< FitOutput > outputs(n_callers + 1);
+	std::vector< int > statuses(n_callers + 1, -1);
+
+	auto call_cpufit = [&i, &outputs, &statuses](std::size_t const caller, int const n_threads)
+	{
+		FitOutput & o = outputs[caller];
+		clean_resize(o.parameters, i.n_fits * i.n_parameters);
+		clean_resize(o.states, i.n_fits);
+		clean_resize(o.chi_squares, i.n_fits);
+		clean_resize(o.n_iterations, i.n_fits);
+
+		statuses[caller]
+			= cpufit_with_threads
+			(
+				i.n_fits,
+				i.n_points,
+				i.data.data(),
+				i.weights(),
+				i.model_id,
+				i.initial_parameters.data(),
+				i.tolerance,
+				i.max_n_iterations,
+				i.parameters_to_fit.data(),
+				i.estimator_id,
+				i.user_info_size(),
+				i.user_info(),
+				o.parameters.data(),
+				o.states.data(),
+				o.chi_squares.data(),
+				o.n_iterations.data(),
+				n_threads
+			);
+	};
+
+	// the reference is the last element
+	call_cpufit(n_callers, 1);
+	BOOST_CHECK(statuses[n_callers] == 0);
+
+	std::vector< std::thread > callers;
+	for (std::size_t caller = 0; caller < n_callers; caller++)
+	{
+		callers.emplace_back(call_cpufit, caller, int(caller + 1));
+	}
+	for (std::thread & caller : callers)
+	{
+		caller.join();
+	}
+
+	for (std::size_t caller = 0; caller < n_callers; caller++)
+	{
+		BOOST_CHECK(statuses[caller] == 0);
+		BOOST_CHECK(outputs[caller].states == outputs[n_callers].states);
+		BOOST_CHECK(outputs[caller].n_iterations == outputs[n_callers].n_iterations);
+		BOOST_CHECK(outputs[caller].parameters == outputs[n_callers].parameters);
+		BOOST_CHECK(outputs[caller].chi_squares == outputs[n_callers].chi_squares);
+	}
+
+	call_cpufit(0, -1);
+	BOOST_CHECK(statuses[0] == -1);
+	BOOST_CHECK(std::string(cpufit_get_last_error()) == "invalid number of threads");
+}
@@ -0,0 +1,166 @@
+#define BOOST_TEST_MODULE Gpufit
+
+#include "Cpufit/cpufit.h"
+#include "Gpufit/gpufit.h"
+#include "Tests/utils.h"
+
+#include <boost/test/included/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+void generate_input_gauss_fit_2d(FitInput & i)
+{
+	// number fits, points, parameters
+	i.n_fits = 10000;
+	std::size_t const size_x = 9;
+	i.n_points = size_x * size_x;
+	i.n_parameters = 5; // GAUSS_2D has five parameters
+
+	// data of peaks at random positions, initial parameters at the center
+	clean_resize(i.data, i.n_fits * i.n_points);
+	clean_resize(i.initial_parameters, i.n_fits * i.n_parameters);
+
+	float const center_x = (static_cast<float>(size_x) - 1.f) / 2.f;
+	std::uniform_real_distribution< float > shift(-1.f, 1.f);
+	std::vector< float > fit_data(i.n_points);
+
+	for (std::size_t fit_index = 0; fit_index < i.n_fits; fit_index++)
+	{
+		std::vector< float > const true_parameters{ { 4.f, center_x + shift(rng), center_x + shift(rng), 1.5f, 1.f } };
+		generate_gauss_2d(fit_data, true_parameters);
+		std::copy(fit_data.begin(), fit_data.end(), i.data.begin() + fit_index * i.n_points);
+
+		std::vector< float > const initial_parameters{ { 3.f, center_x, center_x, 1.2f, 0.5f } };
+		std::copy(initial_parameters.begin(), initial_parameters.end(), i.initial_parameters.begin() + fit_index * i.n_parameters);
+	}
+	i.weights_.clear(); // no weights
+
+	// model id and estimator id
+	i.model_id = GAUSS_2D;
+	i.estimator_id = LSE;
+
+	// parameters to fit
+	i.parameters_to_fit = { 1, 1, 1, 1, 1 };
+
+	// tolerance and max_n_iterations
+	i.tolerance = 0.0001f;
+	i.max_n_iterations = 20;
+
+	// user info
+	i.user_info_.clear(); // no user info
+}
+
+void resize_output(FitOutput & o, FitInput const & i)
+{
+	clean_resize(o.parameters, i.n_fits * i.n_parameters);
+	// states which are not set by a fit
+	o.states.assign(i.n_fits, -1);
+	clean_resize(o.chi_squares, i.n_fits);
+	clean_resize(o.n_iterations, i.n_fits);
+}
+
+#ifdef USE_CPUFIT
+
+BOOST_AUTO_TEST_CASE( Hybrid_Fit )
+{
+	/*
+		Shares the fits of a fit call between the GPU and Cpufit.
+		- Checks that every fit is calculated.
+		- Checks that the results equal the results of Cpufit, and the results
+		  of a second fit call, which splits the fits by the measured
+		  throughputs, equal these of the first.
+	*/
+
+	FitInput i;
+	generate_input_gauss_fit_2d(i);
+	BOOST_CHECK(i.sanity_check());
+
+	FitOutput cpu, hybrid;
+	resize_output(cpu, i);
+
+	BOOST_CHECK( cpufit_set_number_of_threads( 2 ) == 0 );
+
+	int const cpu_status
+		= cpufit
+		(
+			i.n_fits,
+			i.n_points,
+			i.data.data(),
+			i.weights(),
+			i.model_id,
+			i.initial_parameters.data(),
+			i.tolerance,
+			i.max_n_iterations,
+			i.parameters_to_fit.data(),
+			i.estimator_id,
+			i.user_info_size(),
+			i.user_info(),
+			cpu.parameters.data(),
+			cpu.states.data(),
+			cpu.chi_squares.data(),
+			cpu.n_iterations.data()
+		);
+
+	BOOST_CHECK(cpu_status == 0);
+
+	void * context = 0;
+	BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+	BOOST_CHECK( gpufit_context_set_option( context, OPTION_CPU_THREADS, 2 ) == 0 );
+
+	for (int call = 0; call < 2; call++)
+	{
+		resize_output(hybrid, i);
+
+		int const hybrid_status
+			= gpufit_context_fit
+			(
+				context,
+				i.n_fits,
+				i.n_points,
+				i.data.data(),
+				i.weights(),
+				i.model_id,
+				i.initial_parameters.data(),
+				i.tolerance,
+				i.max_n_iterations,
+				i.parameters_to_fit.data(),
+				i.estimator_id,
+				i.user_info_size(),
+				i.user_info(),
+				hybrid.parameters.data(),
+				hybrid.states.data(),
+				hybrid.chi_squares.data(),
+				hybrid.n_iterations.data()
+			);
+
+		BOOST_CHECK(hybrid_status == 0);
+
+		// check both output for equality
+		BOOST_CHECK(cpu.states == hybrid.states);
+		BOOST_CHECK(cpu.n_iterations == hybrid.n_iterations);
+		BOOST_CHECK(close_or_equal(cpu.parameters, hybrid.parameters));
+		BOOST_CHECK(close_or_equal(cpu.chi_squares, hybrid.chi_squares));
+	}
+
+	BOOST_CHECK( gpufit_context_set_option( context, OPTION_CPU_THREADS, -1 ) == -1 );
+	BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+#else
+
+BOOST_AUTO_TEST_CASE( Hybrid_Fit )
+{
+	/*
+		Checks that sharing the fits with Cpufit fails without USE_CPUFIT.
+	*/
+
+	void * context = 0;
+	BOOST_CHECK( gpufit_create_context( &context ) == 0 );
+	BOOST_CHECK( gpufit_context_set_option( context, OPTION_CPU_THREADS, 2 ) == -1 );
+	BOOST_CHECK( std::string( gpufit_get_last_error() ) == "Cpufit not available, build with USE_CPUFIT" );
+	BOOST_CHECK( gpufit_context_set_option( context, OPTION_CPU_THREADS, 0 ) == 0 );
+	BOOST_CHECK( gpufit_destroy_context( context ) == 0 );
+}
+
+#endif